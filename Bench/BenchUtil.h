@@ -0,0 +1,62 @@
+//***************************************************************************************
+// BenchUtil.h
+//
+// Timing for the headless benchmarks.  Each case is run a few times and the fastest run
+// is reported, which is the least disturbed by the rest of the system.
+//***************************************************************************************
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+namespace BenchUtil
+{
+	// Milliseconds taken by the fastest of repeats calls to func.
+	template<typename Function>
+	double FastestMs(int repeats, Function func)
+	{
+		double best = 1e30;
+		for(int i = 0; i < repeats; ++i)
+		{
+			auto start = std::chrono::high_resolution_clock::now();
+			func();
+			auto end = std::chrono::high_resolution_clock::now();
+
+			best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+		}
+		return best;
+	}
+
+	// Keeps the compiler from dropping work whose result is otherwise unused: the value's
+	// address escapes into an asm block it cannot see through, or into a volatile on MSVC.
+	template<typename T>
+	void KeepAlive(const T& value)
+	{
+#if defined(__GNUC__)
+		asm volatile("" : : "g"(&value) : "memory");
+#else
+		static const void* volatile sink;
+		sink = &value;
+#endif
+	}
+
+	// Small deterministic generator, so every run times the same data.
+	class Random
+	{
+	public:
+		explicit Random(std::uint32_t seed = 1u) : mState(seed) {}
+
+		// Uniform in [a, b).
+		float Next(float a, float b)
+		{
+			mState = mState*1664525u + 1013904223u;
+			return a + (b - a)*((mState >> 8) / 16777216.0f);
+		}
+
+	private:
+		std::uint32_t mState;
+	};
+}
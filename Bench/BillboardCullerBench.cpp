@@ -0,0 +1,51 @@
+//***************************************************************************************
+// BillboardCullerBench.cpp
+//
+// BillboardCuller::Cull against CullReference on random sprite sets of up to a million
+// sprites, seen from above the middle of the set like the tree sprites in the scene.
+//***************************************************************************************
+
+#include "BillboardCuller.h"
+#include "BenchUtil.h"
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+using namespace DirectX;
+
+int main()
+{
+	XMMATRIX view = XMMatrixLookAtLH(XMVectorSet(0.0f, 30.0f, -80.0f, 1.0f), XMVectorZero(),
+		XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+	XMMATRIX proj = XMMatrixPerspectiveFovLH(0.25f*XM_PI, 16.0f / 9.0f, 1.0f, 1000.0f);
+	XMMATRIX viewProj = XMMatrixMultiply(view, proj);
+
+	BenchUtil::Random random;
+
+	std::printf("%10s %10s %14s %14s\n", "sprites", "visible", "vector (ms)", "reference (ms)");
+
+	for(std::uint32_t count : { 1000u, 10000u, 100000u, 1000000u })
+	{
+		// Spread over a square that grows with the count, so about the same fraction
+		// of the sprites is visible at every size.
+		float extent = 25.0f*std::sqrt(count / 1000.0f);
+
+		BillboardCuller culler;
+		culler.Reserve(count);
+		for(std::uint32_t i = 0; i < count; ++i)
+		{
+			XMFLOAT3 center(random.Next(-extent, extent), 12.0f, random.Next(-extent, extent));
+			culler.Add(center, XMFLOAT2(20.0f, 20.0f), i % 3);
+		}
+
+		std::vector<BillboardInstance> instances(count);
+
+		double vectorMs = BenchUtil::FastestMs(10, [&] { culler.Cull(viewProj, instances.data(), count); });
+		std::uint32_t visible = culler.LastStats().Visible;
+		double referenceMs = BenchUtil::FastestMs(10, [&] { culler.CullReference(viewProj, instances.data(), count); });
+
+		std::printf("%10u %10u %14.4f %14.4f\n", count, visible, vectorMs, referenceMs);
+	}
+
+	return 0;
+}
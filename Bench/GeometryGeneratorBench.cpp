@@ -0,0 +1,34 @@
+//***************************************************************************************
+// GeometryGeneratorBench.cpp
+//
+// Times GeometryGenerator's surfaces of revolution at high tessellation.
+//***************************************************************************************
+
+#include "GeometryGenerator.h"
+#include "BenchUtil.h"
+#include <cstdio>
+
+int main()
+{
+	GeometryGenerator geoGen;
+
+	std::printf("%12s %12s %14s %14s\n", "slices", "stacks", "sphere (ms)", "cylinder (ms)");
+
+	// Below ParallelVertexCount the rings are built on one thread.
+	const GeometryGenerator::uint32 tessellations[][2] = { { 64, 32 }, { 256, 128 }, { 1024, 512 }, { 2048, 1024 } };
+	for(const auto& t : tessellations)
+	{
+		double sphereMs = BenchUtil::FastestMs(5, [&]
+		{
+			BenchUtil::KeepAlive(geoGen.CreateSphere(1.0f, t[0], t[1]).Vertices.size());
+		});
+		double cylinderMs = BenchUtil::FastestMs(5, [&]
+		{
+			BenchUtil::KeepAlive(geoGen.CreateCylinder(1.0f, 0.5f, 2.0f, t[0], t[1]).Vertices.size());
+		});
+
+		std::printf("%12u %12u %14.4f %14.4f\n", t[0], t[1], sphereMs, cylinderMs);
+	}
+
+	return 0;
+}
@@ -0,0 +1,73 @@
+//***************************************************************************************
+// ShadowCascadesBench.cpp
+//
+// Times fitting the cascades to the scene's camera, and ShadowCascades::Cull against
+// CullReference on random casters spread over the shadow distance.
+//***************************************************************************************
+
+#include "ShadowCascades.h"
+#include "BenchUtil.h"
+#include <cstdio>
+#include <vector>
+
+using namespace DirectX;
+
+int main()
+{
+	const XMFLOAT3 eye(0.0f, 30.0f, -80.0f);
+	XMMATRIX view = XMMatrixLookAtLH(XMLoadFloat3(&eye), XMVectorZero(), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+	const XMFLOAT3 lightDirection(0.57735f, -0.57735f, 0.57735f);
+
+	// As the scene sets them up.
+	ShadowCascadeSettings settings;
+	settings.MaxDistance = 300.0f;
+	ShadowCascades cascades(settings);
+
+	double fitMs = BenchUtil::FastestMs(10, [&]
+	{
+		for(int r = 0; r < 1000; ++r)
+			cascades.Fit(view, 0.25f*XM_PI, 16.0f / 9.0f, 1.0f, 1000.0f, lightDirection);
+	}) / 1000.0;
+
+	std::printf("%d cascades fitted in %.5f ms\n\n", cascades.CascadeCount(), fitMs);
+	std::printf("%10s %28s %14s %14s\n", "casters", "per cascade", "vector (ms)", "reference (ms)");
+
+	BenchUtil::Random random;
+	for(std::uint32_t count : { 1000u, 10000u, 100000u })
+	{
+		// Spread around the eye over the shadow distance, low enough to be scenery.
+		cascades.ClearCasters();
+		for(std::uint32_t i = 0; i < count; ++i)
+		{
+			BoundingSphere sphere;
+			sphere.Center = XMFLOAT3(eye.x + random.Next(-settings.MaxDistance, settings.MaxDistance),
+				random.Next(-5.0f, 30.0f), eye.z + random.Next(-settings.MaxDistance, settings.MaxDistance));
+			sphere.Radius = random.Next(0.5f, 8.0f);
+			cascades.AddCaster(sphere);
+		}
+
+		std::vector<std::vector<std::uint32_t>> visible;
+		std::vector<std::vector<std::uint32_t>> reference;
+
+		double vectorMs = BenchUtil::FastestMs(10, [&]
+		{
+			visible.clear();
+			cascades.Cull(visible);
+		});
+		double referenceMs = BenchUtil::FastestMs(10, [&]
+		{
+			reference.clear();
+			cascades.CullReference(reference);
+		});
+
+		char lists[64] = "";
+		int length = 0;
+		for(const auto& list : visible)
+			length += std::snprintf(lists + length, sizeof(lists) - length, " %zu", list.size());
+
+		std::printf("%10u %28s %14.4f %14.4f%s\n", count, lists, vectorMs, referenceMs,
+			visible == reference ? "" : "  results differ");
+	}
+
+	return 0;
+}
@@ -0,0 +1,116 @@
+//***************************************************************************************
+// VertexConverterBench.cpp
+//
+// VertexConversion::ConvertVertices against the hand written loops the apps used before,
+// for the apps' vertex and for a compact one with packed normals and half texcoords.
+//***************************************************************************************
+
+#include "VertexConverter.h"
+#include "GeometryGenerator.h"
+#include "BenchUtil.h"
+#include <cstdio>
+#include <vector>
+
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+
+namespace
+{
+	struct Vertex
+	{
+		XMFLOAT3 Pos;
+		XMFLOAT3 Normal;
+		XMFLOAT2 TexC;
+	};
+
+	struct CompactVertex
+	{
+		XMFLOAT3 Pos;
+		XMBYTEN4 Normal;
+		XMHALF2 TexC;
+	};
+
+	using StdLayout = VertexConversion::Layout<
+		VERTEX_ATTRIBUTE(GeometryGenerator::Vertex, Position, Vertex, Pos, VertexConversion::Copy),
+		VERTEX_ATTRIBUTE(GeometryGenerator::Vertex, Normal, Vertex, Normal, VertexConversion::Copy),
+		VERTEX_ATTRIBUTE(GeometryGenerator::Vertex, TexC, Vertex, TexC, VertexConversion::Copy)>;
+
+	using CompactLayout = VertexConversion::Layout<
+		VERTEX_ATTRIBUTE(GeometryGenerator::Vertex, Position, CompactVertex, Pos, VertexConversion::Copy),
+		VERTEX_ATTRIBUTE(GeometryGenerator::Vertex, Normal, CompactVertex, Normal, VertexConversion::PackNormal),
+		VERTEX_ATTRIBUTE(GeometryGenerator::Vertex, TexC, CompactVertex, TexC, VertexConversion::FloatToHalf)>;
+
+	void HandLoop(const std::vector<GeometryGenerator::Vertex>& src, std::vector<Vertex>& dst)
+	{
+		dst.resize(src.size());
+		for(size_t i = 0; i < src.size(); ++i)
+		{
+			dst[i].Pos = src[i].Position;
+			dst[i].Normal = src[i].Normal;
+			dst[i].TexC = src[i].TexC;
+		}
+	}
+
+	void HandLoop(const std::vector<GeometryGenerator::Vertex>& src, std::vector<CompactVertex>& dst)
+	{
+		dst.resize(src.size());
+		for(size_t i = 0; i < src.size(); ++i)
+		{
+			dst[i].Pos = src[i].Position;
+			XMStoreByteN4(&dst[i].Normal, XMLoadFloat3(&src[i].Normal));
+			dst[i].TexC.x = XMConvertFloatToHalf(src[i].TexC.x);
+			dst[i].TexC.y = XMConvertFloatToHalf(src[i].TexC.y);
+		}
+	}
+}
+
+int main()
+{
+	std::printf("%10s %14s %14s %14s %14s\n", "vertices", "hand (ms)", "layout (ms)",
+		"hand cmp (ms)", "layout cmp (ms)");
+
+	for(size_t count : { (size_t)24, (size_t)1024, (size_t)16 * 1024, (size_t)256 * 1024, (size_t)1024 * 1024 })
+	{
+		std::vector<GeometryGenerator::Vertex> src(count);
+		for(size_t i = 0; i < count; ++i)
+		{
+			float t = (float)i / count;
+			src[i] = GeometryGenerator::Vertex(t, 2.0f*t, 3.0f*t, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, t, 1.0f - t);
+		}
+
+		std::vector<Vertex> vertices;
+		std::vector<CompactVertex> compact;
+
+		// Enough repeats that the small cases still take a measurable time.
+		int repeats = (int)std::max((size_t)5, (size_t)(1 << 20) / count);
+		int inner = count < 16 * 1024 ? 100 : 1;
+
+		double hand = BenchUtil::FastestMs(repeats, [&]
+		{
+			for(int k = 0; k < inner; ++k)
+				HandLoop(src, vertices);
+		}) / inner;
+		double layout = BenchUtil::FastestMs(repeats, [&]
+		{
+			for(int k = 0; k < inner; ++k)
+				VertexConversion::ConvertVertices<StdLayout>(src, vertices);
+		}) / inner;
+		double handCompact = BenchUtil::FastestMs(repeats, [&]
+		{
+			for(int k = 0; k < inner; ++k)
+				HandLoop(src, compact);
+		}) / inner;
+		double layoutCompact = BenchUtil::FastestMs(repeats, [&]
+		{
+			for(int k = 0; k < inner; ++k)
+				VertexConversion::ConvertVertices<CompactLayout>(src, compact);
+		}) / inner;
+
+		BenchUtil::KeepAlive(vertices);
+		BenchUtil::KeepAlive(compact);
+
+		std::printf("%10zu %14.4f %14.4f %14.4f %14.4f\n", count, hand, layout, handCompact, layoutCompact);
+	}
+
+	return 0;
+}
@@ -0,0 +1,192 @@
+//***************************************************************************************
+// WavesBench.cpp
+//
+// The wave simulation: how much each boundary reflects and what a step costs, the
+// explicit and implicit integrators at rising wave speeds, and Buoyancy's batched
+// surface sampling against one point at a time.
+//***************************************************************************************
+
+#include "Waves.h"
+#include "Buoyancy.h"
+#include "BenchUtil.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	void Boundaries()
+	{
+		// The scene's water, without damping so only the boundary takes energy out.
+		const float dx = 1.0f;
+		const float dt = 0.03f;
+		const float speed = 4.0f;
+
+		// Energy is measured in a window around the pulse, after the wave front had time
+		// to reach the edge of the 64 x 64 grids and come back.
+		const int window = 40;
+		const int steps = (int)((64*dx / speed + 4.0f) / dt);
+
+		struct Result
+		{
+			float Energy;
+			double StepMs;
+		};
+
+		auto run = [&](int size, int spongeWidth, int stepCount)
+		{
+			Waves waves(size, size, dx, dt, speed, 0.0f, spongeWidth);
+			waves.Disturb(size / 2, size / 2, 1.0f);
+
+			Result result;
+			result.StepMs = BenchUtil::FastestMs(1, [&]
+			{
+				for(int s = 0; s < stepCount; ++s)
+					waves.Update(dt);
+			}) / stepCount;
+
+			int first = size / 2 - window / 2;
+			result.Energy = waves.Energy(first, first + window, first, first + window);
+			return result;
+		};
+
+		// On a grid this large nothing reflected gets back in time, so what is left in the
+		// window is the wake every grid has.
+		float initial = run(512, 0, 10).Energy;
+		Result open = run(512, 0, steps);
+
+		std::printf("Wave boundaries\n%24s %12s %12s\n", "", "reflected", "ms per step");
+		std::printf("%24s %11.3f%% %12.4f\n", "512 x 512 reflective", 0.0f, open.StepMs);
+
+		const int configs[][2] = { { 64, 0 }, { 64, 4 }, { 64, 8 }, { 64, 12 }, { 128, 0 }, { 128, 20 } };
+		for(const auto& config : configs)
+		{
+			Result r = run(config[0], config[1], steps);
+			float reflected = std::max(r.Energy - open.Energy, 0.0f) / initial;
+
+			char name[32];
+			if(config[1] > 0)
+				std::snprintf(name, sizeof(name), "%d x %d sponge %d", config[0], config[0], config[1]);
+			else
+				std::snprintf(name, sizeof(name), "%d x %d reflective", config[0], config[0]);
+
+			std::printf("%24s %11.3f%% %12.4f\n", name, 100.0f*reflected, r.StepMs);
+		}
+	}
+
+	void Integrators()
+	{
+		const int size = 128;
+		const float dx = 1.0f;
+		const int frames = 30;
+
+		auto simulateSecond = [&](float speed, Waves::Integrator integrator, int steps)
+		{
+			float dt = 1.0f / steps;
+			Waves waves(size, size, dx, dt, speed, 0.2f, 20);
+			waves.SetIntegrator(integrator);
+			waves.Disturb(size / 2, size / 2, 1.0f);
+
+			return BenchUtil::FastestMs(1, [&]
+			{
+				for(int s = 0; s < steps; ++s)
+					waves.Update(dt);
+			});
+		};
+
+		std::printf("\nWave integrators, %d x %d, ms per simulated second\n", size, size);
+		std::printf("%10s %14s %10s %14s %10s\n", "speed", "explicit", "steps", "implicit", "steps");
+
+		for(float speed : { 4.0f, 16.0f, 64.0f, 256.0f })
+		{
+			// At least one step per frame, more when the speed makes that unstable.
+			int explicitSteps = std::max(frames, (int)std::ceil(1.0f / Waves::MaxExplicitTimeStep(dx, speed)));
+
+			double explicitMs = simulateSecond(speed, Waves::Integrator::Explicit, explicitSteps);
+			double implicitMs = simulateSecond(speed, Waves::Integrator::Implicit, frames);
+
+			std::printf("%10d %14.3f %10d %14.3f %10d\n", (int)speed, explicitMs, explicitSteps, implicitMs, frames);
+		}
+	}
+
+	void Sampling()
+	{
+		const int repeats = 20;
+		const float dt = 1.0f / 60.0f;
+
+		// The scene's water, a few seconds after a handful of drops.
+		Waves waves(128, 128, 1.0f, 0.03f, 4.0f, 0.2f, 20);
+		BenchUtil::Random random;
+		for(int d = 0; d < 20; ++d)
+			waves.Disturb(16 + (int)random.Next(0.0f, 96.0f), 16 + (int)random.Next(0.0f, 96.0f), 0.5f);
+		for(int s = 0; s < 100; ++s)
+			waves.Update(0.03f);
+
+		float halfWidth = 0.5f*waves.Width();
+		float halfDepth = 0.5f*waves.Depth();
+
+		std::printf("\nBuoyancy, ms per update, and the largest difference between the samplings\n");
+		std::printf("%10s %14s %14s %14s %14s\n", "bodies", "batched", "one at a time", "update", "difference");
+
+		for(int count : { 1024, 4096, 16384 })
+		{
+			std::vector<float> x(count), z(count);
+			for(int k = 0; k < count; ++k)
+			{
+				x[k] = random.Next(-halfWidth, halfWidth);
+				z[k] = random.Next(-halfDepth, halfDepth);
+			}
+
+			// Height, normal and velocity.
+			std::vector<float> batched[5], reference[5];
+			for(int q = 0; q < 5; ++q)
+			{
+				batched[q].resize(count);
+				reference[q].resize(count);
+			}
+
+			double batchedMs = BenchUtil::FastestMs(repeats, [&]
+			{
+				waves.SampleSurface(count, x.data(), z.data(), batched[0].data(),
+					batched[1].data(), batched[2].data(), batched[3].data(), batched[4].data());
+			});
+			double referenceMs = BenchUtil::FastestMs(repeats, [&]
+			{
+				waves.SampleSurfaceReference(count, x.data(), z.data(), reference[0].data(),
+					reference[1].data(), reference[2].data(), reference[3].data(), reference[4].data());
+			});
+
+			float maxDifference = 0.0f;
+			for(int q = 0; q < 5; ++q)
+			{
+				for(int k = 0; k < count; ++k)
+					maxDifference = std::max(maxDifference, std::fabs(batched[q][k] - reference[q][k]));
+			}
+
+			Buoyancy bodies;
+			for(int k = 0; k < count; ++k)
+				bodies.Add(XMFLOAT3(x[k], 0.0f, z[k]), 1.0f, random.Next(0.4f, 0.8f));
+
+			double updateMs = 1e30;
+			for(int r = 0; r < repeats; ++r)
+			{
+				bodies.Update(waves, dt);
+				updateMs = std::min(updateMs, bodies.Stats().SampleMs + bodies.Stats().IntegrateMs);
+			}
+
+			std::printf("%10d %14.4f %14.4f %14.4f %14g\n", count, batchedMs, referenceMs, updateMs, maxDifference);
+		}
+	}
+}
+
+int main()
+{
+	Boundaries();
+	Integrators();
+	Sampling();
+
+	return 0;
+}
@@ -0,0 +1,225 @@
+//***************************************************************************************
+// BillboardCuller.cpp
+//***************************************************************************************
+
+#include "BillboardCuller.h"
+#include "FrustumCuller.h"
+#include <ppl.h>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	// Radius given to padding slots.  Large enough that no plane distance can make up
+	// for it.
+	const float PaddingRadius = -1.0e30f;
+}
+
+BillboardCuller::BillboardCuller()
+{
+}
+
+BillboardCuller::~BillboardCuller()
+{
+}
+
+void BillboardCuller::Clear()
+{
+	mCenterX.clear();
+	mCenterY.clear();
+	mCenterZ.clear();
+	mRadius.clear();
+	mSize.clear();
+	mTextureIndex.clear();
+	mCount = 0;
+}
+
+void BillboardCuller::Reserve(std::uint32_t count)
+{
+	std::uint32_t padded = (count + 3) & ~3u;
+	mCenterX.reserve(padded);
+	mCenterY.reserve(padded);
+	mCenterZ.reserve(padded);
+	mRadius.reserve(padded);
+	mSize.reserve(count);
+	mTextureIndex.reserve(count);
+}
+
+std::uint32_t BillboardCuller::Add(const XMFLOAT3& center, const XMFLOAT2& size, std::uint32_t textureIndex)
+{
+	std::uint32_t index = mCount++;
+
+	if(index % 4 == 0)
+	{
+		mCenterX.resize(index + 4, 0.0f);
+		mCenterY.resize(index + 4, 0.0f);
+		mCenterZ.resize(index + 4, 0.0f);
+		mRadius.resize(index + 4, PaddingRadius);
+	}
+
+	// The quad turns about the y-axis, so its corners stay within the half width and
+	// half height of the center.
+	float halfWidth = 0.5f*size.x;
+	float halfHeight = 0.5f*size.y;
+
+	mCenterX[index] = center.x;
+	mCenterY[index] = center.y;
+	mCenterZ[index] = center.z;
+	mRadius[index] = std::sqrt(halfWidth*halfWidth + halfHeight*halfHeight);
+
+	mSize.push_back(size);
+	mTextureIndex.push_back(textureIndex);
+
+	return index;
+}
+
+std::uint32_t BillboardCuller::Count()const
+{
+	return mCount;
+}
+
+const BillboardCullStats& BillboardCuller::LastStats()const
+{
+	return mStats;
+}
+
+std::uint32_t BillboardCuller::Cull(FXMMATRIX viewProj, BillboardInstance* instances, std::uint32_t maxInstances)
+{
+	XMFLOAT4 planes[6];
+	FrustumCuller::ExtractPlanes(viewProj, planes);
+
+	std::uint32_t chunkCount = (mCount + ChunkSize - 1) / ChunkSize;
+	if(mChunkVisible.size() < chunkCount)
+		mChunkVisible.resize(chunkCount);
+
+	auto cullChunk = [&](std::uint32_t chunk)
+	{
+		std::uint32_t first = chunk*ChunkSize;
+		std::uint32_t last = std::min(first + ChunkSize, mCount);
+
+		mChunkVisible[chunk].clear();
+		CullRange(planes, first, last, mChunkVisible[chunk]);
+	};
+
+	if(chunkCount > 1)
+		concurrency::parallel_for(0u, chunkCount, cullChunk);
+	else if(chunkCount == 1)
+		cullChunk(0);
+
+	// Where each chunk's instances start in the output.
+	std::vector<std::uint32_t> offsets(chunkCount + 1, 0);
+	for(std::uint32_t chunk = 0; chunk < chunkCount; ++chunk)
+		offsets[chunk + 1] = offsets[chunk] + (std::uint32_t)mChunkVisible[chunk].size();
+
+	std::uint32_t visibleCount = offsets[chunkCount];
+	std::uint32_t written = std::min(visibleCount, maxInstances);
+
+	auto writeChunk = [&](std::uint32_t chunk)
+	{
+		const std::vector<std::uint32_t>& visible = mChunkVisible[chunk];
+		for(std::uint32_t i = 0; i < (std::uint32_t)visible.size() && offsets[chunk] + i < written; ++i)
+			WriteInstance(visible[i], instances[offsets[chunk] + i]);
+	};
+
+	if(chunkCount > 1)
+		concurrency::parallel_for(0u, chunkCount, writeChunk);
+	else if(chunkCount == 1)
+		writeChunk(0);
+
+	mStats.Tested = mCount;
+	mStats.Visible = visibleCount;
+	mStats.Dropped = visibleCount - written;
+
+	return written;
+}
+
+std::uint32_t BillboardCuller::CullReference(FXMMATRIX viewProj, BillboardInstance* instances, std::uint32_t maxInstances)
+{
+	XMFLOAT4 planes[6];
+	FrustumCuller::ExtractPlanes(viewProj, planes);
+
+	std::uint32_t visibleCount = 0;
+	std::uint32_t written = 0;
+	for(std::uint32_t i = 0; i < mCount; ++i)
+	{
+		bool inside = true;
+		for(int p = 0; p < 6 && inside; ++p)
+		{
+			float d = planes[p].x*mCenterX[i] + planes[p].y*mCenterY[i] +
+				planes[p].z*mCenterZ[i] + planes[p].w;
+
+			inside = d + mRadius[i] >= 0.0f;
+		}
+
+		if(!inside)
+			continue;
+
+		visibleCount++;
+		if(written < maxInstances)
+			WriteInstance(i, instances[written++]);
+	}
+
+	mStats.Tested = mCount;
+	mStats.Visible = visibleCount;
+	mStats.Dropped = visibleCount - written;
+
+	return written;
+}
+
+void BillboardCuller::CullRange(const XMFLOAT4 planes[6], std::uint32_t first, std::uint32_t last,
+	std::vector<std::uint32_t>& visible)const
+{
+	// first is a multiple of ChunkSize, and so of four.
+	assert(first % 4 == 0);
+
+	XMVECTOR planeX[6], planeY[6], planeZ[6], planeW[6];
+	for(int i = 0; i < 6; ++i)
+	{
+		planeX[i] = XMVectorReplicate(planes[i].x);
+		planeY[i] = XMVectorReplicate(planes[i].y);
+		planeZ[i] = XMVectorReplicate(planes[i].z);
+		planeW[i] = XMVectorReplicate(planes[i].w);
+	}
+
+	const XMVECTOR zero = XMVectorZero();
+
+	for(std::uint32_t base = first; base < last; base += 4)
+	{
+		XMVECTOR x = XMLoadFloat4((const XMFLOAT4*)&mCenterX[base]);
+		XMVECTOR y = XMLoadFloat4((const XMFLOAT4*)&mCenterY[base]);
+		XMVECTOR z = XMLoadFloat4((const XMFLOAT4*)&mCenterZ[base]);
+		XMVECTOR r = XMLoadFloat4((const XMFLOAT4*)&mRadius[base]);
+
+		// A billboard is culled once its sphere is completely behind any plane.
+		XMVECTOR inside = XMVectorTrueInt();
+		for(int i = 0; i < 6; ++i)
+		{
+			XMVECTOR d = XMVectorMultiplyAdd(x, planeX[i], planeW[i]);
+			d = XMVectorMultiplyAdd(y, planeY[i], d);
+			d = XMVectorMultiplyAdd(z, planeZ[i], d);
+			d = XMVectorAdd(d, r);
+
+			inside = XMVectorAndInt(inside, XMVectorGreaterOrEqual(d, zero));
+		}
+
+		XMUINT4 mask;
+		XMStoreUInt4(&mask, inside);
+
+		const std::uint32_t lanes[4] = { mask.x, mask.y, mask.z, mask.w };
+		for(std::uint32_t j = 0; j < 4 && base + j < last; ++j)
+		{
+			if(lanes[j] != 0)
+				visible.push_back(base + j);
+		}
+	}
+}
+
+void BillboardCuller::WriteInstance(std::uint32_t index, BillboardInstance& instance)const
+{
+	instance.CenterW = XMFLOAT3(mCenterX[index], mCenterY[index], mCenterZ[index]);
+	instance.SizeW = mSize[index];
+	instance.TextureIndex = mTextureIndex[index];
+}
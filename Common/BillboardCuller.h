@@ -0,0 +1,88 @@
+//***************************************************************************************
+// BillboardCuller.h
+//
+// Frustum culls y-axis aligned billboards and writes the visible ones, compacted, as
+// instance records for an instanced quad draw.  The billboards are kept in structure-
+// of-arrays form and tested four at a time with XMVECTOR math, against the sphere that
+// encloses the quad in every orientation.
+//
+// Large sets are split into chunks that are culled in parallel.  Each chunk collects the
+// indices of its visible billboards, and the instances are then written with every
+// chunk starting where the previous one ended, so the output keeps the input order.
+//***************************************************************************************
+
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+
+// Per-instance data of the quad draw; see TreeSprite.hlsl.
+struct BillboardInstance
+{
+	DirectX::XMFLOAT3 CenterW;
+	DirectX::XMFLOAT2 SizeW;
+	std::uint32_t TextureIndex;
+};
+
+struct BillboardCullStats
+{
+	std::uint32_t Tested = 0;
+	std::uint32_t Visible = 0;
+
+	// Visible billboards that did not fit in the output.
+	std::uint32_t Dropped = 0;
+};
+
+class BillboardCuller
+{
+public:
+	BillboardCuller();
+	BillboardCuller(const BillboardCuller& rhs) = delete;
+	BillboardCuller& operator=(const BillboardCuller& rhs) = delete;
+	~BillboardCuller();
+
+	void Clear();
+	void Reserve(std::uint32_t count);
+
+	// Returns the index the billboard was stored at.
+	std::uint32_t Add(const DirectX::XMFLOAT3& center, const DirectX::XMFLOAT2& size, std::uint32_t textureIndex);
+
+	std::uint32_t Count()const;
+
+	// Writes the billboards that are at least partly inside the frustum of the given
+	// view-projection matrix to instances, at most maxInstances of them, and returns how
+	// many were written.  instances can point to mapped upload memory; it is only
+	// written to, front to back.
+	std::uint32_t Cull(DirectX::FXMMATRIX viewProj, BillboardInstance* instances, std::uint32_t maxInstances);
+
+	// The same, one billboard at a time and on one thread, to check Cull() against.
+	std::uint32_t CullReference(DirectX::FXMMATRIX viewProj, BillboardInstance* instances, std::uint32_t maxInstances);
+
+	const BillboardCullStats& LastStats()const;
+
+	// Billboards per parallel task.
+	static const std::uint32_t ChunkSize = 16 * 1024;
+
+private:
+	void CullRange(const DirectX::XMFLOAT4 planes[6], std::uint32_t first, std::uint32_t last,
+		std::vector<std::uint32_t>& visible)const;
+	void WriteInstance(std::uint32_t index, BillboardInstance& instance)const;
+
+	// Padded to a multiple of four; padding billboards have a negative radius so they
+	// are never reported.
+	std::vector<float> mCenterX;
+	std::vector<float> mCenterY;
+	std::vector<float> mCenterZ;
+	std::vector<float> mRadius;
+
+	std::vector<DirectX::XMFLOAT2> mSize;
+	std::vector<std::uint32_t> mTextureIndex;
+
+	std::uint32_t mCount = 0;
+
+	// Visible indices of each chunk, kept between calls to avoid reallocating.
+	std::vector<std::vector<std::uint32_t>> mChunkVisible;
+
+	BillboardCullStats mStats;
+};
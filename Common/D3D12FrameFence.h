@@ -0,0 +1,49 @@
+//***************************************************************************************
+// D3D12FrameFence.h
+//
+// FrameFence on top of an ID3D12Fence.  The Win32 event used for waiting is created once
+// and reused, instead of creating and closing one on every stall.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include "FramePacer.h"
+
+class D3D12FrameFence : public FrameFence
+{
+public:
+	explicit D3D12FrameFence(ID3D12Fence* fence) :
+		mFence(fence)
+	{
+		mEvent = CreateEventEx(nullptr, nullptr, 0, EVENT_ALL_ACCESS);
+		if(mEvent == nullptr)
+			ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
+	}
+
+	D3D12FrameFence(const D3D12FrameFence& rhs) = delete;
+	D3D12FrameFence& operator=(const D3D12FrameFence& rhs) = delete;
+
+	~D3D12FrameFence()
+	{
+		CloseHandle(mEvent);
+	}
+
+	virtual std::uint64_t GetCompletedValue()override
+	{
+		return mFence->GetCompletedValue();
+	}
+
+	virtual void WaitForValue(std::uint64_t value)override
+	{
+		if(mFence->GetCompletedValue() >= value)
+			return;
+
+		ThrowIfFailed(mFence->SetEventOnCompletion(value, mEvent));
+		WaitForSingleObject(mEvent, INFINITE);
+	}
+
+private:
+	ID3D12Fence* mFence = nullptr;
+	HANDLE mEvent = nullptr;
+};
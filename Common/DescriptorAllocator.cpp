@@ -0,0 +1,192 @@
+//***************************************************************************************
+// DescriptorAllocator.cpp
+//***************************************************************************************
+
+#include "DescriptorAllocator.h"
+#include <algorithm>
+#include <cassert>
+
+DescriptorAllocator::DescriptorAllocator(std::uint32_t persistentCount, std::uint32_t transientCount)
+{
+	mPersistentCount = persistentCount;
+	mTransientCount = transientCount;
+
+	if(persistentCount > 0)
+		mFreeBlocks.push_back({ 0, persistentCount });
+}
+
+DescriptorAllocator::~DescriptorAllocator()
+{
+}
+
+std::uint32_t DescriptorAllocator::Capacity()const
+{
+	return mPersistentCount + mTransientCount;
+}
+
+DescriptorRange DescriptorAllocator::AllocatePersistent(std::uint32_t count)
+{
+	DescriptorRange range;
+	if(count == 0)
+		return range;
+
+	// First fit.  The persistent region is small and allocations are rare, so a
+	// linear walk over the free blocks is fine.
+	for(size_t i = 0; i < mFreeBlocks.size(); ++i)
+	{
+		FreeBlock& block = mFreeBlocks[i];
+		if(block.Count < count)
+			continue;
+
+		range.Offset = block.Offset;
+		range.Count = count;
+
+		block.Offset += count;
+		block.Count -= count;
+		if(block.Count == 0)
+			mFreeBlocks.erase(mFreeBlocks.begin() + i);
+
+		break;
+	}
+
+	return range;
+}
+
+void DescriptorAllocator::FreePersistent(const DescriptorRange& range)
+{
+	if(!range.IsValid() || range.Count == 0)
+		return;
+
+	assert(range.Offset + range.Count <= mPersistentCount);
+
+	auto it = std::lower_bound(mFreeBlocks.begin(), mFreeBlocks.end(), range.Offset,
+		[](const FreeBlock& b, std::uint32_t offset) { return b.Offset < offset; });
+
+	// Catch double frees and overlapping ranges in debug builds.
+	assert(it == mFreeBlocks.end() || range.Offset + range.Count <= it->Offset);
+	assert(it == mFreeBlocks.begin() || (it - 1)->Offset + (it - 1)->Count <= range.Offset);
+
+	it = mFreeBlocks.insert(it, { range.Offset, range.Count });
+
+	// Merge with the following block.
+	auto next = it + 1;
+	if(next != mFreeBlocks.end() && it->Offset + it->Count == next->Offset)
+	{
+		it->Count += next->Count;
+		mFreeBlocks.erase(next);
+	}
+
+	// Merge with the preceding block.
+	if(it != mFreeBlocks.begin())
+	{
+		auto prev = it - 1;
+		if(prev->Offset + prev->Count == it->Offset)
+		{
+			prev->Count += it->Count;
+			mFreeBlocks.erase(it);
+		}
+	}
+}
+
+DescriptorRange DescriptorAllocator::AllocateTransient(std::uint32_t count)
+{
+	DescriptorRange range;
+	if(count == 0 || count > mTransientCount)
+		return range;
+
+	std::uint32_t used = (std::uint32_t)(mAllocatedTotal - mReleasedTotal);
+	if(used == 0)
+	{
+		// Nothing in flight, so start again from the beginning of the ring.  Frames still
+		// pending allocated nothing that has not been released, so they ended where the
+		// head is now; move them with it, or releasing them would set the tail back to
+		// where the old head was.
+		mHead = 0;
+		mTail = 0;
+		for(FrameMarker& frame : mPendingFrames)
+			frame.Head = 0;
+	}
+
+	std::uint32_t start = 0;
+	std::uint32_t wasted = 0;
+	if(used == 0 || mHead > mTail)
+	{
+		// Free space is [head, end) followed by [0, tail).
+		if(mTransientCount - mHead >= count)
+		{
+			start = mHead;
+		}
+		else if(mTail >= count)
+		{
+			// Not enough room before the end; skip the remainder and wrap around
+			// so the range stays contiguous.
+			wasted = mTransientCount - mHead;
+			start = 0;
+		}
+		else
+		{
+			return range;
+		}
+	}
+	else
+	{
+		// Free space is [head, tail).  head == tail with work in flight means full.
+		if(mTail - mHead < count)
+			return range;
+
+		start = mHead;
+	}
+
+	mHead = start + count;
+	if(mHead == mTransientCount)
+		mHead = 0;
+
+	mAllocatedTotal += wasted + count;
+	mTransientPeak = std::max(mTransientPeak, (std::uint32_t)(mAllocatedTotal - mReleasedTotal));
+
+	range.Offset = mPersistentCount + start;
+	range.Count = count;
+	return range;
+}
+
+void DescriptorAllocator::FinishFrame(std::uint64_t fenceValue)
+{
+	assert(mPendingFrames.empty() || mPendingFrames.back().Fence <= fenceValue);
+
+	mPendingFrames.push_back({ fenceValue, mHead, mAllocatedTotal });
+}
+
+void DescriptorAllocator::ReleaseCompleted(std::uint64_t completedFenceValue)
+{
+	while(!mPendingFrames.empty() && mPendingFrames.front().Fence <= completedFenceValue)
+	{
+		const FrameMarker& frame = mPendingFrames.front();
+		mTail = frame.Head;
+		mReleasedTotal = frame.AllocatedTotal;
+		mPendingFrames.pop_front();
+	}
+}
+
+DescriptorHeapStats DescriptorAllocator::Stats()const
+{
+	DescriptorHeapStats stats;
+	stats.PersistentCapacity = mPersistentCount;
+	stats.PersistentFreeBlocks = (std::uint32_t)mFreeBlocks.size();
+
+	std::uint32_t totalFree = 0;
+	for(const FreeBlock& block : mFreeBlocks)
+	{
+		totalFree += block.Count;
+		stats.LargestFreeBlock = std::max(stats.LargestFreeBlock, block.Count);
+	}
+
+	stats.PersistentUsed = mPersistentCount - totalFree;
+	if(totalFree > 0)
+		stats.Fragmentation = 1.0f - (float)stats.LargestFreeBlock / (float)totalFree;
+
+	stats.TransientCapacity = mTransientCount;
+	stats.TransientUsed = (std::uint32_t)(mAllocatedTotal - mReleasedTotal);
+	stats.TransientPeak = mTransientPeak;
+
+	return stats;
+}
@@ -0,0 +1,106 @@
+//***************************************************************************************
+// DescriptorAllocator.h
+//
+// Hands out descriptor slots from a heap that is split into two regions:
+//   -A persistent region at the front of the heap, managed with a sorted free list of
+//    blocks, for descriptors that live until they are explicitly freed (textures).
+//   -A transient ring at the back of the heap for descriptors that are only needed
+//    for the frame being recorded.  Slots are reclaimed once the GPU has passed the
+//    fence value the frame was submitted with.
+//
+// This class only does the bookkeeping on offsets, it never touches a real heap, so it
+// can be driven from any stand-in.  See DescriptorHeap.h for the D3D12 wrapper.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+// A contiguous run of descriptors, given as an offset from the start of the heap.
+struct DescriptorRange
+{
+	static const std::uint32_t InvalidOffset = 0xffffffff;
+
+	std::uint32_t Offset = InvalidOffset;
+	std::uint32_t Count = 0;
+
+	bool IsValid()const { return Offset != InvalidOffset; }
+};
+
+struct DescriptorHeapStats
+{
+	std::uint32_t PersistentCapacity = 0;
+	std::uint32_t PersistentUsed = 0;
+	std::uint32_t PersistentFreeBlocks = 0;
+	std::uint32_t LargestFreeBlock = 0;
+
+	// 0 when all free persistent space is one block, approaching 1 as the free
+	// space gets split into many small blocks.
+	float Fragmentation = 0.0f;
+
+	std::uint32_t TransientCapacity = 0;
+	std::uint32_t TransientUsed = 0;
+	std::uint32_t TransientPeak = 0;
+};
+
+class DescriptorAllocator
+{
+public:
+	DescriptorAllocator(std::uint32_t persistentCount, std::uint32_t transientCount);
+	DescriptorAllocator(const DescriptorAllocator& rhs) = delete;
+	DescriptorAllocator& operator=(const DescriptorAllocator& rhs) = delete;
+	~DescriptorAllocator();
+
+	std::uint32_t Capacity()const;
+
+	// Returns an invalid range if there is no free block large enough.
+	DescriptorRange AllocatePersistent(std::uint32_t count);
+	void FreePersistent(const DescriptorRange& range);
+
+	// Returns an invalid range if the ring is full.  Transient ranges are never freed
+	// individually; they are reclaimed a frame at a time by ReleaseCompleted().
+	DescriptorRange AllocateTransient(std::uint32_t count);
+
+	// Marks the end of the transient allocations made for the frame that will be
+	// signaled with fenceValue.
+	void FinishFrame(std::uint64_t fenceValue);
+
+	// Reclaims the transient slots of every finished frame whose fence value the
+	// GPU has reached.
+	void ReleaseCompleted(std::uint64_t completedFenceValue);
+
+	DescriptorHeapStats Stats()const;
+
+private:
+	struct FreeBlock
+	{
+		std::uint32_t Offset;
+		std::uint32_t Count;
+	};
+
+	struct FrameMarker
+	{
+		std::uint64_t Fence;
+		std::uint32_t Head;
+		std::uint64_t AllocatedTotal;
+	};
+
+	std::uint32_t mPersistentCount = 0;
+
+	// Sorted by offset, adjacent blocks are always merged.
+	std::vector<FreeBlock> mFreeBlocks;
+
+	std::uint32_t mTransientCount = 0;
+	std::uint32_t mHead = 0;
+	std::uint32_t mTail = 0;
+
+	// Running totals of ring slots handed out (including slots skipped when an
+	// allocation wraps) and slots given back.  Their difference is the ring usage.
+	std::uint64_t mAllocatedTotal = 0;
+	std::uint64_t mReleasedTotal = 0;
+	std::uint32_t mTransientPeak = 0;
+
+	std::deque<FrameMarker> mPendingFrames;
+};
@@ -0,0 +1,87 @@
+//***************************************************************************************
+// DescriptorHeap.h
+//
+// Owns an ID3D12DescriptorHeap and uses a DescriptorAllocator to hand out slots from it.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include "DescriptorAllocator.h"
+
+class DescriptorHeap
+{
+public:
+	DescriptorHeap(ID3D12Device* device, D3D12_DESCRIPTOR_HEAP_TYPE type,
+		UINT persistentCount, UINT transientCount, bool shaderVisible) :
+		mAllocator(persistentCount, transientCount),
+		mShaderVisible(shaderVisible)
+	{
+		D3D12_DESCRIPTOR_HEAP_DESC heapDesc = {};
+		heapDesc.NumDescriptors = persistentCount + transientCount;
+		heapDesc.Type = type;
+		heapDesc.Flags = shaderVisible ? D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE : D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+		ThrowIfFailed(device->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(&mHeap)));
+
+		mDescriptorSize = device->GetDescriptorHandleIncrementSize(type);
+	}
+
+	DescriptorHeap(const DescriptorHeap& rhs) = delete;
+	DescriptorHeap& operator=(const DescriptorHeap& rhs) = delete;
+
+	ID3D12DescriptorHeap* Heap()const
+	{
+		return mHeap.Get();
+	}
+
+	DescriptorRange AllocatePersistent(UINT count = 1)
+	{
+		DescriptorRange range = mAllocator.AllocatePersistent(count);
+		assert(range.IsValid() && "Persistent descriptor region is full.");
+		return range;
+	}
+
+	void FreePersistent(const DescriptorRange& range)
+	{
+		mAllocator.FreePersistent(range);
+	}
+
+	DescriptorRange AllocateTransient(UINT count = 1)
+	{
+		DescriptorRange range = mAllocator.AllocateTransient(count);
+		assert(range.IsValid() && "Transient descriptor ring is full.");
+		return range;
+	}
+
+	void FinishFrame(UINT64 fenceValue)
+	{
+		mAllocator.FinishFrame(fenceValue);
+	}
+
+	void ReleaseCompleted(UINT64 completedFenceValue)
+	{
+		mAllocator.ReleaseCompleted(completedFenceValue);
+	}
+
+	CD3DX12_CPU_DESCRIPTOR_HANDLE CpuHandle(UINT offset)const
+	{
+		return CD3DX12_CPU_DESCRIPTOR_HANDLE(mHeap->GetCPUDescriptorHandleForHeapStart(), (INT)offset, mDescriptorSize);
+	}
+
+	CD3DX12_GPU_DESCRIPTOR_HANDLE GpuHandle(UINT offset)const
+	{
+		assert(mShaderVisible);
+		return CD3DX12_GPU_DESCRIPTOR_HANDLE(mHeap->GetGPUDescriptorHandleForHeapStart(), (INT)offset, mDescriptorSize);
+	}
+
+	DescriptorHeapStats Stats()const
+	{
+		return mAllocator.Stats();
+	}
+
+private:
+	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> mHeap;
+	DescriptorAllocator mAllocator;
+	UINT mDescriptorSize = 0;
+	bool mShaderVisible = false;
+};
@@ -0,0 +1,64 @@
+//***************************************************************************************
+// DirtyRowTracker.cpp
+//***************************************************************************************
+
+#include "DirtyRowTracker.h"
+#include <algorithm>
+#include <cassert>
+
+DirtyRowTracker::DirtyRowTracker(std::uint32_t rowCount, std::uint32_t slotCount, std::uint32_t rowByteSize)
+{
+	assert(slotCount > 0 && slotCount <= 32);
+
+	mRowCount = rowCount;
+	mSlotCount = slotCount;
+	mRowByteSize = rowByteSize;
+	mAllSlots = slotCount == 32 ? 0xffffffff : (1u << slotCount) - 1;
+
+	mPending.resize(rowCount);
+	MarkAll();
+}
+
+DirtyRowTracker::~DirtyRowTracker()
+{
+}
+
+std::uint32_t DirtyRowTracker::RowCount()const
+{
+	return mRowCount;
+}
+
+std::uint32_t DirtyRowTracker::SlotCount()const
+{
+	return mSlotCount;
+}
+
+void DirtyRowTracker::MarkRows(std::uint32_t firstRow, std::uint32_t count)
+{
+	assert(firstRow + count <= mRowCount);
+
+	for(std::uint32_t i = firstRow; i < firstRow + count; ++i)
+		mPending[i] = mAllSlots;
+}
+
+void DirtyRowTracker::MarkAll()
+{
+	std::fill(mPending.begin(), mPending.end(), mAllSlots);
+}
+
+bool DirtyRowTracker::IsPending(std::uint32_t slot, std::uint32_t row)const
+{
+	assert(row < mRowCount);
+	return (mPending[row] & SlotBit(slot)) != 0;
+}
+
+const DirtyRowStats& DirtyRowTracker::Stats()const
+{
+	return mStats;
+}
+
+std::uint32_t DirtyRowTracker::SlotBit(std::uint32_t slot)const
+{
+	assert(slot < mSlotCount);
+	return 1u << slot;
+}
@@ -0,0 +1,102 @@
+//***************************************************************************************
+// DirtyRowTracker.h
+//
+// Tracks which rows of a dynamic mesh changed since each copy of its vertex data was
+// last written.  With N frames in flight there are N copies (one per frame resource),
+// so a row that changes has to be rewritten in each of them, each at the time that copy
+// is next used.
+//
+// Rows are marked as they change, for all slots at once.  When a slot is about to be
+// used, Collect() hands out the pending rows of that slot as runs of consecutive rows
+// and clears them, so only those runs need copying.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+struct DirtyRowStats
+{
+	// Of the last Collect().
+	std::uint32_t RowsUploaded = 0;
+	std::uint32_t Runs = 0;
+	std::uint64_t BytesUploaded = 0;
+
+	// Bytes a full rewrite would have taken.
+	std::uint64_t BytesFull = 0;
+
+	// Over all calls to Collect().
+	std::uint64_t TotalBytesUploaded = 0;
+	std::uint64_t TotalBytesFull = 0;
+};
+
+class DirtyRowTracker
+{
+public:
+	// At most 32 slots.  Every row starts out pending in every slot, since nothing has
+	// been written yet.
+	DirtyRowTracker(std::uint32_t rowCount, std::uint32_t slotCount, std::uint32_t rowByteSize);
+	DirtyRowTracker(const DirtyRowTracker& rhs) = delete;
+	DirtyRowTracker& operator=(const DirtyRowTracker& rhs) = delete;
+	~DirtyRowTracker();
+
+	std::uint32_t RowCount()const;
+	std::uint32_t SlotCount()const;
+
+	// Marks rows [firstRow, firstRow + count) as changed in every slot.
+	void MarkRows(std::uint32_t firstRow, std::uint32_t count = 1);
+	void MarkAll();
+
+	bool IsPending(std::uint32_t slot, std::uint32_t row)const;
+
+	// Calls copyRows(firstRow, rowCount) for each run of rows pending in the slot, in
+	// increasing order, and clears them for that slot.
+	template<typename CopyRows>
+	void Collect(std::uint32_t slot, CopyRows copyRows)
+	{
+		std::uint32_t bit = SlotBit(slot);
+
+		mStats.RowsUploaded = 0;
+		mStats.Runs = 0;
+
+		std::uint32_t row = 0;
+		while(row < mRowCount)
+		{
+			if((mPending[row] & bit) == 0)
+			{
+				++row;
+				continue;
+			}
+
+			std::uint32_t first = row;
+			while(row < mRowCount && (mPending[row] & bit) != 0)
+				mPending[row++] &= ~bit;
+
+			copyRows(first, row - first);
+
+			mStats.RowsUploaded += row - first;
+			mStats.Runs++;
+		}
+
+		mStats.BytesUploaded = (std::uint64_t)mStats.RowsUploaded*mRowByteSize;
+		mStats.BytesFull = (std::uint64_t)mRowCount*mRowByteSize;
+		mStats.TotalBytesUploaded += mStats.BytesUploaded;
+		mStats.TotalBytesFull += mStats.BytesFull;
+	}
+
+	const DirtyRowStats& Stats()const;
+
+private:
+	std::uint32_t SlotBit(std::uint32_t slot)const;
+
+	std::uint32_t mRowCount = 0;
+	std::uint32_t mSlotCount = 0;
+	std::uint32_t mRowByteSize = 0;
+
+	// Bit s of mPending[row] is set while the row still has to be written to slot s.
+	std::vector<std::uint32_t> mPending;
+	std::uint32_t mAllSlots = 0;
+
+	DirtyRowStats mStats;
+};
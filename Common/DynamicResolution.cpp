@@ -0,0 +1,116 @@
+//***************************************************************************************
+// DynamicResolution.cpp
+//***************************************************************************************
+
+#include "DynamicResolution.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+DynamicResolution::DynamicResolution(const DynamicResolutionSettings& settings)
+{
+	assert(settings.MinScale > 0.0f && settings.MinScale <= settings.MaxScale);
+	assert(settings.TargetFrameTime > 0.0);
+
+	mSettings = settings;
+	Reset();
+}
+
+const DynamicResolutionSettings& DynamicResolution::Settings()const
+{
+	return mSettings;
+}
+
+void DynamicResolution::SetTargetFrameTime(double seconds)
+{
+	assert(seconds > 0.0);
+	mSettings.TargetFrameTime = seconds;
+}
+
+float DynamicResolution::Update(double gpuFrameTime, double cpuFrameTime)
+{
+	const DynamicResolutionSettings& s = mSettings;
+
+	if(!mHaveSample)
+	{
+		mSmoothedGpuTime = gpuFrameTime;
+		mHaveSample = true;
+	}
+	else
+	{
+		mSmoothedGpuTime += s.Smoothing*(gpuFrameTime - mSmoothedGpuTime);
+	}
+
+	float error = (float)((s.TargetFrameTime - mSmoothedGpuTime) / s.TargetFrameTime);
+	if(std::fabs(error) < s.Deadband)
+		error = 0.0f;
+
+	// Going lower does not help if the CPU can not make the budget anyway.
+	bool cpuBound = cpuFrameTime > s.TargetFrameTime;
+	if(cpuBound && error < 0.0f)
+	{
+		error = 0.0f;
+		mStats.CpuBoundFrames++;
+	}
+
+	// Velocity form: the PID terms give a relative change of the area, so the gains do
+	// not depend on the current resolution and clamping the area is all the anti-windup
+	// that is needed.
+	float delta = s.Kp*(error - mPrevError) + s.Ki*error + s.Kd*(error - 2.0f*mPrevError + mPrevError2);
+	mPrevError2 = mPrevError;
+	mPrevError = error;
+
+	float minArea = s.MinScale*s.MinScale;
+	float maxArea = s.MaxScale*s.MaxScale;
+	mArea = std::min(std::max(mArea*(1.0f + delta), minArea), maxArea);
+
+	// Only move once the unquantized scale is a whole step away, then quantize.  Rounding
+	// alone would flip between two steps whenever the scale sat near the middle.
+	float scale = std::sqrt(mArea);
+	float target = std::floor(scale / s.ScaleStep + 0.5f)*s.ScaleStep;
+	target = std::min(std::max(target, s.MinScale), s.MaxScale);
+
+	bool atLimit = (target == s.MinScale || target == s.MaxScale) && target != mScale;
+	if(target != mScale && (std::fabs(scale - mScale) >= s.ScaleStep || atLimit))
+	{
+		if(target > mScale)
+			mStats.ScaleIncreases++;
+		else
+			mStats.ScaleDecreases++;
+
+		mScale = target;
+	}
+
+	mStats.Scale = mScale;
+	mStats.SmoothedGpuTime = mSmoothedGpuTime;
+	return mScale;
+}
+
+float DynamicResolution::Scale()const
+{
+	return mScale;
+}
+
+std::uint32_t DynamicResolution::ScaledSize(std::uint32_t fullSize)const
+{
+	std::uint32_t size = (std::uint32_t)(fullSize*mScale + 0.5f);
+	return std::max(size, (std::uint32_t)1);
+}
+
+void DynamicResolution::Reset()
+{
+	mScale = mSettings.MaxScale;
+	mArea = mScale*mScale;
+	mSmoothedGpuTime = 0.0;
+	mHaveSample = false;
+	mPrevError = 0.0f;
+	mPrevError2 = 0.0f;
+
+	mStats = DynamicResolutionStats();
+	mStats.Scale = mScale;
+}
+
+const DynamicResolutionStats& DynamicResolution::Stats()const
+{
+	return mStats;
+}
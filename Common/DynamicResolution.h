@@ -0,0 +1,97 @@
+//***************************************************************************************
+// DynamicResolution.h
+//
+// Picks the fraction of the window resolution to render at so the GPU frame time stays
+// within a budget.
+//
+// The controlled quantity is the rendered area (scale squared), since that is what pixel
+// cost grows with.  A PID loop drives it from the relative headroom
+//     error = (budget - gpuTime) / budget
+// measured on a smoothed GPU frame time.  Hysteresis keeps the scale from hunting:
+//   -Errors inside the deadband count as zero, so the loop rests once near the budget.
+//   -The output is quantized and a new scale is only taken once the unquantized one is a
+//    whole step away from the current one.
+//   -When the CPU alone already misses the budget, a lower resolution would not help, so
+//    the scale is not lowered any further.
+//
+// Frame times are passed in by the caller, so recorded or simulated load traces can
+// drive the controller without a GPU.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+
+struct DynamicResolutionSettings
+{
+	// Frame time budget in seconds.
+	double TargetFrameTime = 1.0 / 60.0;
+
+	float MinScale = 0.5f;
+	float MaxScale = 1.0f;
+
+	// Gains applied to the relative error.  Each frame the rendered area changes by
+	// Kp*(change in error) + Ki*error + Kd*(change in the change), as a fraction of itself.
+	float Kp = 0.1f;
+	float Ki = 0.1f;
+	float Kd = 0.02f;
+
+	// Relative errors smaller than this are ignored.
+	float Deadband = 0.05f;
+
+	// Scale changes are made in steps of this size.
+	float ScaleStep = 1.0f / 32.0f;
+
+	// Weight of the newest sample in the exponential moving average of frame times.  Low
+	// enough that loads swinging every few frames average out instead of being chased.
+	float Smoothing = 0.05f;
+};
+
+struct DynamicResolutionStats
+{
+	float Scale = 1.0f;
+	double SmoothedGpuTime = 0.0;
+	std::uint32_t ScaleIncreases = 0;
+	std::uint32_t ScaleDecreases = 0;
+
+	// Frames in which a decrease was held back because the CPU was over budget.
+	std::uint32_t CpuBoundFrames = 0;
+};
+
+class DynamicResolution
+{
+public:
+	explicit DynamicResolution(const DynamicResolutionSettings& settings = DynamicResolutionSettings());
+
+	const DynamicResolutionSettings& Settings()const;
+	void SetTargetFrameTime(double seconds);
+
+	// Feeds the times of the last frame, in seconds, and returns the scale to render the
+	// next frame at.  cpuFrameTime should not include time spent waiting on the GPU.
+	float Update(double gpuFrameTime, double cpuFrameTime);
+
+	float Scale()const;
+
+	// Returns a dimension scaled by the current scale, never less than one.
+	std::uint32_t ScaledSize(std::uint32_t fullSize)const;
+
+	// Goes back to the maximum scale and forgets the controller history.
+	void Reset();
+
+	const DynamicResolutionStats& Stats()const;
+
+private:
+	DynamicResolutionSettings mSettings;
+
+	// Unquantized rendered area the PID loop works on, and the scale actually used.
+	float mArea = 1.0f;
+	float mScale = 1.0f;
+
+	double mSmoothedGpuTime = 0.0;
+	bool mHaveSample = false;
+
+	float mPrevError = 0.0f;
+	float mPrevError2 = 0.0f;
+
+	DynamicResolutionStats mStats;
+};
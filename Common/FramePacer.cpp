@@ -0,0 +1,222 @@
+//***************************************************************************************
+// FramePacer.cpp
+//***************************************************************************************
+
+#include "FramePacer.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+
+namespace
+{
+	// Frames per evaluation window.
+	const int WindowLength = 30;
+
+	// Fraction of the frame the CPU has to spend waiting before the depth is touched.
+	const double WaitThreshold = 0.10;
+
+	// GPU utilization below which the GPU is considered starved, and above which it is
+	// considered saturated.  The gap between them is the hysteresis band.
+	const double GpuStarvedThreshold = 0.80;
+	const double GpuSaturatedThreshold = 0.95;
+
+	// Windows to hold off reducing the depth after it was increased.  If the increase
+	// undid a decrease made just before, the hold off is doubled, up to the maximum.
+	const int DecreaseHoldOffWindows = 8;
+	const int MaxDecreaseHoldOffWindows = 128;
+
+	double SteadyClockSeconds()
+	{
+		using namespace std::chrono;
+		return duration<double>(steady_clock::now().time_since_epoch()).count();
+	}
+}
+
+FramePacer::FramePacer(FrameFence* fence, int maxFramesInFlight, int initialFramesInFlight, Clock clock)
+{
+	assert(fence != nullptr);
+	assert(maxFramesInFlight >= MinFramesInFlight);
+
+	mFence = fence;
+	mClock = clock ? clock : Clock(SteadyClockSeconds);
+	mMaxFramesInFlight = maxFramesInFlight;
+	mFramesInFlight = std::min(std::max(initialFramesInFlight, (int)MinFramesInFlight), maxFramesInFlight);
+
+	mHoldOffLength = DecreaseHoldOffWindows;
+
+	mStats.FramesInFlight = mFramesInFlight;
+}
+
+FramePacer::~FramePacer()
+{
+}
+
+int FramePacer::FramesInFlight()const
+{
+	return mFramesInFlight;
+}
+
+int FramePacer::MaxFramesInFlight()const
+{
+	return mMaxFramesInFlight;
+}
+
+void FramePacer::SetAdaptive(bool adaptive)
+{
+	mAdaptive = adaptive;
+}
+
+bool FramePacer::IsAdaptive()const
+{
+	return mAdaptive;
+}
+
+void FramePacer::SetFramesInFlight(int framesInFlight)
+{
+	framesInFlight = std::min(std::max(framesInFlight, (int)MinFramesInFlight), mMaxFramesInFlight);
+	if(framesInFlight != mFramesInFlight)
+	{
+		mFramesInFlight = framesInFlight;
+		mStats.FramesInFlight = framesInFlight;
+		mDepthChanged = true;
+	}
+}
+
+bool FramePacer::BeginFrame(std::uint64_t frameResourceFence)
+{
+	double start = mClock();
+
+	if(mLastFrameStart >= 0.0)
+	{
+		mWindowFrameTime += start - mLastFrameStart;
+		mWindowFrames++;
+	}
+	mLastFrameStart = start;
+
+	// The frame about to be recorded may only start once the frame submitted
+	// FramesInFlight() frames ago is done.  The frame resource being reused can be older
+	// than that when the depth was just lowered, so wait on whichever is later.
+	std::uint64_t waitValue = frameResourceFence;
+	if(mLastSubmitted + 1 > (std::uint64_t)mFramesInFlight)
+		waitValue = std::max(waitValue, mLastSubmitted + 1 - (std::uint64_t)mFramesInFlight);
+
+	std::uint64_t completed = mFence->GetCompletedValue();
+	bool stalled = waitValue != 0 && completed < waitValue;
+	if(stalled)
+	{
+		mFence->WaitForValue(waitValue);
+		completed = mFence->GetCompletedValue();
+		mStats.StalledFrames++;
+	}
+
+	double end = mClock();
+	mLastCpuWait = stalled ? end - start : 0.0;
+	mWindowCpuWait += mLastCpuWait;
+	mStats.TotalFrames++;
+
+	RetireCompleted(completed, end);
+
+	if(mWindowFrames >= WindowLength)
+		Evaluate();
+
+	bool depthChanged = mDepthChanged;
+	mDepthChanged = false;
+	return depthChanged;
+}
+
+void FramePacer::EndFrame(std::uint64_t fenceValue)
+{
+	assert(fenceValue > mLastSubmitted);
+
+	mLastSubmitted = fenceValue;
+	mInFlight.push_back({ fenceValue, mClock() });
+}
+
+void FramePacer::RetireCompleted(std::uint64_t completedValue, double now)
+{
+	double retiredBusy = 0.0;
+	int retiredCount = 0;
+
+	while(!mInFlight.empty() && mInFlight.front().Fence <= completedValue)
+	{
+		const SubmittedFrame& frame = mInFlight.front();
+
+		// There is no GPU timestamp here, so a frame counts as completed when its fence was
+		// seen to pass.  That is exact for the frame that was just waited on and an upper
+		// bound for frames that finished before we looked.  The GPU can not start a frame
+		// before it was submitted or before the previous one finished, so frames retired
+		// together add up to the span from the first one starting until now.
+		double completion = now;
+		double start = std::max(frame.SubmitTime, mLastCompletion);
+
+		retiredBusy += std::max(0.0, completion - start);
+		retiredCount++;
+		mLastCompletion = completion;
+		mInFlight.pop_front();
+	}
+
+	mWindowGpuBusy += retiredBusy;
+	if(retiredCount > 0)
+		mLastGpuBusy = retiredBusy / retiredCount;
+}
+
+void FramePacer::Evaluate()
+{
+	double frameTime = mWindowFrameTime / mWindowFrames;
+	double cpuWait = mWindowCpuWait / mWindowFrames;
+	double gpuBusy = mWindowGpuBusy / mWindowFrames;
+
+	mStats.FrameTime = frameTime;
+	mStats.CpuWait = cpuWait;
+	mStats.GpuBusy = gpuBusy;
+
+	mWindowFrames = 0;
+	mWindowFrameTime = 0.0;
+	mWindowCpuWait = 0.0;
+	mWindowGpuBusy = 0.0;
+
+	if(mDecreaseHoldOff > 0)
+		mDecreaseHoldOff--;
+	mWindowsSinceDecrease++;
+
+	if(!mAdaptive || frameTime <= 0.0)
+		return;
+
+	double waitRatio = cpuWait / frameTime;
+	double gpuUtilization = gpuBusy / frameTime;
+
+	if(waitRatio < WaitThreshold)
+		return;
+
+	if(gpuUtilization < GpuStarvedThreshold && mFramesInFlight < mMaxFramesInFlight)
+	{
+		SetFramesInFlight(mFramesInFlight + 1);
+		mStats.DepthIncreases++;
+
+		if(mWindowsSinceDecrease <= 2)
+			mHoldOffLength = std::min(mHoldOffLength * 2, MaxDecreaseHoldOffWindows);
+		mDecreaseHoldOff = mHoldOffLength;
+	}
+	else if(gpuUtilization > GpuSaturatedThreshold && mFramesInFlight > MinFramesInFlight &&
+		mDecreaseHoldOff == 0)
+	{
+		SetFramesInFlight(mFramesInFlight - 1);
+		mStats.DepthDecreases++;
+		mWindowsSinceDecrease = 0;
+	}
+}
+
+double FramePacer::LastCpuWait()const
+{
+	return mLastCpuWait;
+}
+
+double FramePacer::LastGpuBusy()const
+{
+	return mLastGpuBusy;
+}
+
+const FramePacingStats& FramePacer::Stats()const
+{
+	return mStats;
+}
@@ -0,0 +1,144 @@
+//***************************************************************************************
+// FramePacer.h
+//
+// Decides how far the CPU may run ahead of the GPU and keeps track of how long each side
+// spends waiting on the other.
+//
+// Every frame the app asks for the fence value it has to wait on before it can reuse a
+// frame resource, and reports the fence value it signaled once the frame is submitted.
+// From that the pacer measures:
+//   -CPU wait: time spent blocked on the fence at the start of a frame.
+//   -GPU busy: an estimate of how long the GPU spent on each frame, taken from when the
+//    frame was submitted and when its fence was seen to complete.  That is exact for
+//    frames the CPU waited on.  When the CPU is the bottleneck frames finish before
+//    anyone looks, so it is only an upper bound, capped by the frame time.
+//
+// In adaptive mode the number of frames in flight is moved between MinFramesInFlight
+// and the maximum given at construction:
+//   -If the CPU keeps waiting while the GPU also sits idle part of the time, the two are
+//    serialized on each other and another frame of buffering is added.
+//   -If the CPU keeps waiting while the GPU is saturated, the extra frames only add
+//    latency, so one is removed.
+// After a frame is added, removing it again is held off for a few evaluation windows so
+// the depth does not bounce between two values.
+//
+// The pacer only talks to the GPU through FrameFence and reads time through a clock
+// function, so a simulated GPU timeline can stand in for both.  See D3D12FrameFence.h for
+// the real fence and Tests/SimulatedGpuTimeline.h for the simulated one.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+
+class FrameFence
+{
+public:
+	virtual ~FrameFence() {}
+
+	virtual std::uint64_t GetCompletedValue() = 0;
+
+	// Blocks until the fence reaches the given value.
+	virtual void WaitForValue(std::uint64_t value) = 0;
+};
+
+struct FramePacingStats
+{
+	int FramesInFlight = 0;
+
+	// Averages over the last evaluation window, in seconds.
+	double FrameTime = 0.0;
+	double CpuWait = 0.0;
+	double GpuBusy = 0.0;
+
+	// Times the depth was changed by the controller.
+	std::uint32_t DepthIncreases = 0;
+	std::uint32_t DepthDecreases = 0;
+
+	// Frames that had to wait on the fence at all.
+	std::uint64_t StalledFrames = 0;
+	std::uint64_t TotalFrames = 0;
+};
+
+class FramePacer
+{
+public:
+	static const int MinFramesInFlight = 1;
+
+	// Returns the current time in seconds.
+	typedef std::function<double()> Clock;
+
+	// The clock defaults to std::chrono::steady_clock.
+	FramePacer(FrameFence* fence, int maxFramesInFlight, int initialFramesInFlight, Clock clock = Clock());
+	FramePacer(const FramePacer& rhs) = delete;
+	FramePacer& operator=(const FramePacer& rhs) = delete;
+	~FramePacer();
+
+	int FramesInFlight()const;
+	int MaxFramesInFlight()const;
+
+	// Turning adaptive mode off keeps the current depth until SetFramesInFlight is called.
+	void SetAdaptive(bool adaptive);
+	bool IsAdaptive()const;
+	void SetFramesInFlight(int framesInFlight);
+
+	// Call at the start of a frame with the fence value of the frame resource about to be
+	// reused.  Waits (if needed) until the GPU has passed both that value and the frame
+	// submitted FramesInFlight() frames ago.  Returns true if the depth changed since the
+	// previous call, in which case frame resources that sat unused may be out of date.
+	bool BeginFrame(std::uint64_t frameResourceFence);
+
+	// Call once the frame's commands are submitted and fenceValue has been signaled.
+	void EndFrame(std::uint64_t fenceValue);
+
+	// Time blocked in the last BeginFrame, in seconds.
+	double LastCpuWait()const;
+
+	// Estimated GPU time per frame of the frames seen to complete in the last
+	// BeginFrame that retired any, in seconds.
+	double LastGpuBusy()const;
+
+	const FramePacingStats& Stats()const;
+
+private:
+	struct SubmittedFrame
+	{
+		std::uint64_t Fence;
+		double SubmitTime;
+	};
+
+	void RetireCompleted(std::uint64_t completedValue, double now);
+	void Evaluate();
+
+private:
+	FrameFence* mFence = nullptr;
+	Clock mClock;
+
+	int mMaxFramesInFlight = 1;
+	int mFramesInFlight = 1;
+	bool mAdaptive = true;
+	bool mDepthChanged = false;
+
+	std::uint64_t mLastSubmitted = 0;
+	std::deque<SubmittedFrame> mInFlight;
+
+	double mLastFrameStart = -1.0;
+	double mLastCompletion = 0.0;
+	double mLastCpuWait = 0.0;
+	double mLastGpuBusy = 0.0;
+
+	// Accumulated over the current evaluation window.
+	int mWindowFrames = 0;
+	double mWindowFrameTime = 0.0;
+	double mWindowCpuWait = 0.0;
+	double mWindowGpuBusy = 0.0;
+
+	// Evaluation windows left before the depth may be reduced again.
+	int mDecreaseHoldOff = 0;
+	int mHoldOffLength = 0;
+	int mWindowsSinceDecrease = 1000;
+
+	FramePacingStats mStats;
+};
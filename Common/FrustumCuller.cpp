@@ -0,0 +1,149 @@
+//***************************************************************************************
+// FrustumCuller.cpp
+//***************************************************************************************
+
+#include "FrustumCuller.h"
+#include <cassert>
+
+using namespace DirectX;
+
+namespace
+{
+	// Radius given to padding slots.  Large enough that no plane distance can make up
+	// for it.
+	const float PaddingRadius = -1.0e30f;
+}
+
+FrustumCuller::FrustumCuller()
+{
+}
+
+FrustumCuller::~FrustumCuller()
+{
+}
+
+void FrustumCuller::Clear()
+{
+	mCenterX.clear();
+	mCenterY.clear();
+	mCenterZ.clear();
+	mRadius.clear();
+	mCount = 0;
+}
+
+std::uint32_t FrustumCuller::Add(const BoundingSphere& sphere)
+{
+	std::uint32_t index = mCount++;
+
+	if(index % 4 == 0)
+	{
+		mCenterX.resize(index + 4, 0.0f);
+		mCenterY.resize(index + 4, 0.0f);
+		mCenterZ.resize(index + 4, 0.0f);
+		mRadius.resize(index + 4, PaddingRadius);
+	}
+
+	Set(index, sphere);
+	return index;
+}
+
+void FrustumCuller::Set(std::uint32_t index, const BoundingSphere& sphere)
+{
+	assert(index < mCount);
+
+	mCenterX[index] = sphere.Center.x;
+	mCenterY[index] = sphere.Center.y;
+	mCenterZ[index] = sphere.Center.z;
+	mRadius[index] = sphere.Radius;
+}
+
+std::uint32_t FrustumCuller::Count()const
+{
+	return mCount;
+}
+
+void FrustumCuller::ExtractPlanes(FXMMATRIX viewProj, XMFLOAT4 planes[6])
+{
+	// With row vectors, clip = v*M, so each clip coordinate is v dotted with a column
+	// of M.  The planes follow from -w <= x <= w, -w <= y <= w and 0 <= z <= w.
+	XMMATRIX columns = XMMatrixTranspose(viewProj);
+
+	XMVECTOR p[6];
+	p[0] = XMVectorAdd(columns.r[3], columns.r[0]);
+	p[1] = XMVectorSubtract(columns.r[3], columns.r[0]);
+	p[2] = XMVectorAdd(columns.r[3], columns.r[1]);
+	p[3] = XMVectorSubtract(columns.r[3], columns.r[1]);
+	p[4] = columns.r[2];
+	p[5] = XMVectorSubtract(columns.r[3], columns.r[2]);
+
+	for(int i = 0; i < 6; ++i)
+		XMStoreFloat4(&planes[i], XMPlaneNormalize(p[i]));
+}
+
+void FrustumCuller::Cull(FXMMATRIX viewProj, std::vector<std::uint32_t>& visible)const
+{
+	XMFLOAT4 planes[6];
+	ExtractPlanes(viewProj, planes);
+
+	XMVECTOR planeX[6], planeY[6], planeZ[6], planeW[6];
+	for(int i = 0; i < 6; ++i)
+	{
+		planeX[i] = XMVectorReplicate(planes[i].x);
+		planeY[i] = XMVectorReplicate(planes[i].y);
+		planeZ[i] = XMVectorReplicate(planes[i].z);
+		planeW[i] = XMVectorReplicate(planes[i].w);
+	}
+
+	const XMVECTOR zero = XMVectorZero();
+
+	for(std::uint32_t base = 0; base < mCount; base += 4)
+	{
+		XMVECTOR x = XMLoadFloat4((const XMFLOAT4*)&mCenterX[base]);
+		XMVECTOR y = XMLoadFloat4((const XMFLOAT4*)&mCenterY[base]);
+		XMVECTOR z = XMLoadFloat4((const XMFLOAT4*)&mCenterZ[base]);
+		XMVECTOR r = XMLoadFloat4((const XMFLOAT4*)&mRadius[base]);
+
+		// A sphere is culled once it is completely behind any plane.
+		XMVECTOR inside = XMVectorTrueInt();
+		for(int i = 0; i < 6; ++i)
+		{
+			XMVECTOR d = XMVectorMultiplyAdd(x, planeX[i], planeW[i]);
+			d = XMVectorMultiplyAdd(y, planeY[i], d);
+			d = XMVectorMultiplyAdd(z, planeZ[i], d);
+			d = XMVectorAdd(d, r);
+
+			inside = XMVectorAndInt(inside, XMVectorGreaterOrEqual(d, zero));
+		}
+
+		XMUINT4 mask;
+		XMStoreUInt4(&mask, inside);
+
+		const std::uint32_t lanes[4] = { mask.x, mask.y, mask.z, mask.w };
+		for(std::uint32_t j = 0; j < 4 && base + j < mCount; ++j)
+		{
+			if(lanes[j] != 0)
+				visible.push_back(base + j);
+		}
+	}
+}
+
+void FrustumCuller::CullReference(FXMMATRIX viewProj, std::vector<std::uint32_t>& visible)const
+{
+	XMFLOAT4 planes[6];
+	ExtractPlanes(viewProj, planes);
+
+	for(std::uint32_t i = 0; i < mCount; ++i)
+	{
+		bool inside = true;
+		for(int p = 0; p < 6 && inside; ++p)
+		{
+			float d = planes[p].x*mCenterX[i] + planes[p].y*mCenterY[i] +
+				planes[p].z*mCenterZ[i] + planes[p].w;
+
+			inside = d + mRadius[i] >= 0.0f;
+		}
+
+		if(inside)
+			visible.push_back(i);
+	}
+}
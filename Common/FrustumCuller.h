@@ -0,0 +1,51 @@
+//***************************************************************************************
+// FrustumCuller.h
+//
+// Tests a set of world space bounding spheres against the view frustum.  The spheres are
+// kept in structure-of-arrays form so Cull() can test four of them per plane at once with
+// XMVECTOR math.  CullReference() does the same test one sphere at a time and is there to
+// check the vector path against.
+//***************************************************************************************
+
+#pragma once
+
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+#include <cstdint>
+#include <vector>
+
+class FrustumCuller
+{
+public:
+	FrustumCuller();
+	FrustumCuller(const FrustumCuller& rhs) = delete;
+	FrustumCuller& operator=(const FrustumCuller& rhs) = delete;
+	~FrustumCuller();
+
+	void Clear();
+
+	// Returns the index the sphere was stored at.
+	std::uint32_t Add(const DirectX::BoundingSphere& sphere);
+	void Set(std::uint32_t index, const DirectX::BoundingSphere& sphere);
+
+	std::uint32_t Count()const;
+
+	// Appends the indices of the spheres that are at least partly inside the frustum of
+	// the given view-projection matrix, in increasing order.
+	void Cull(DirectX::FXMMATRIX viewProj, std::vector<std::uint32_t>& visible)const;
+	void CullReference(DirectX::FXMMATRIX viewProj, std::vector<std::uint32_t>& visible)const;
+
+	// Extracts the six frustum planes (left, right, bottom, top, near, far) from a
+	// view-projection matrix, normalized and pointing inwards.
+	static void ExtractPlanes(DirectX::FXMMATRIX viewProj, DirectX::XMFLOAT4 planes[6]);
+
+private:
+	// Padded to a multiple of four; padding spheres have a negative radius so they
+	// are never reported.
+	std::vector<float> mCenterX;
+	std::vector<float> mCenterY;
+	std::vector<float> mCenterZ;
+	std::vector<float> mRadius;
+
+	std::uint32_t mCount = 0;
+};
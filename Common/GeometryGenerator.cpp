@@ -3,7 +3,9 @@
 //***************************************************************************************
 
 #include "GeometryGenerator.h"
+#include <ppl.h>
 #include <algorithm>
+#include <cassert>
 
 using namespace DirectX;
 
@@ -102,113 +104,170 @@ GeometryGenerator::MeshData GeometryGenerator::CreateBox(float width, float heig
 
 GeometryGenerator::MeshData GeometryGenerator::CreateSphere(float radius, uint32 sliceCount, uint32 stackCount)
 {
-    MeshData meshData;
+	assert(stackCount >= 2);
 
 	//
-	// Compute the vertices stating at the top pole and moving down the stacks.
+	// Build the profile from the bottom pole up.  phi is measured down from the top
+	// pole, and the normal of a ring is its direction from the center.
 	//
 
 	// Poles: note that there will be texture coordinate distortion as there is
 	// not a unique point on the texture map to assign to the pole when mapping
 	// a rectangular texture onto a sphere.
-	Vertex topVertex(0.0f, +radius, 0.0f, 0.0f, +1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f);
-	Vertex bottomVertex(0.0f, -radius, 0.0f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f);
-
-	meshData.Vertices.push_back( topVertex );
+	std::vector<RevolutionRing> profile(stackCount + 1);
 
-	float phiStep   = XM_PI/stackCount;
-	float thetaStep = 2.0f*XM_PI/sliceCount;
+	profile[0].Y = -radius;
+	profile[0].V = 1.0f;
+	profile[0].NormalR = 0.0f;
+	profile[0].NormalY = -1.0f;
+	profile[0].Pole = true;
 
-	// Compute vertices for each stack ring (do not count the poles as rings).
-	for(uint32 i = 1; i <= stackCount-1; ++i)
+	float phiStep = XM_PI/stackCount;
+	for(uint32 i = 1; i < stackCount; ++i)
 	{
-		float phi = i*phiStep;
+		float phi = (stackCount - i)*phiStep;
+		float sinPhi = sinf(phi);
+		float cosPhi = cosf(phi);
+
+		profile[i].Radius = radius*sinPhi;
+		profile[i].Y = radius*cosPhi;
+		profile[i].V = phi / XM_PI;
+		profile[i].NormalR = sinPhi;
+		profile[i].NormalY = cosPhi;
+	}
 
-		// Vertices of ring.
-        for(uint32 j = 0; j <= sliceCount; ++j)
-		{
-			float theta = j*thetaStep;
+	profile[stackCount].Y = +radius;
+	profile[stackCount].V = 0.0f;
+	profile[stackCount].NormalR = 0.0f;
+	profile[stackCount].NormalY = +1.0f;
+	profile[stackCount].Pole = true;
 
-			Vertex v;
+	return CreateRevolution(profile, sliceCount);
+}
 
-			// spherical to cartesian
-			v.Position.x = radius*sinf(phi)*cosf(theta);
-			v.Position.y = radius*cosf(phi);
-			v.Position.z = radius*sinf(phi)*sinf(theta);
+GeometryGenerator::MeshData GeometryGenerator::CreateRevolution(const std::vector<RevolutionRing>& profile, uint32 sliceCount)
+{
+	MeshData meshData;
+	AppendRevolution(profile, BuildSliceTable(sliceCount), meshData);
+	return meshData;
+}
 
-			// Partial derivative of P with respect to theta
-			v.TangentU.x = -radius*sinf(phi)*sinf(theta);
-			v.TangentU.y = 0.0f;
-			v.TangentU.z = +radius*sinf(phi)*cosf(theta);
+std::vector<XMFLOAT4> GeometryGenerator::BuildSliceTable(uint32 sliceCount)
+{
+	assert(sliceCount >= 3);
 
-			XMVECTOR T = XMLoadFloat3(&v.TangentU);
-			XMStoreFloat3(&v.TangentU, XMVector3Normalize(T));
+	// The last entry repeats the first at 2pi, so the seam vertices get their own
+	// texture coordinates.
+	std::vector<XMFLOAT4> slices(sliceCount + 1);
 
-			XMVECTOR p = XMLoadFloat3(&v.Position);
-			XMStoreFloat3(&v.Normal, XMVector3Normalize(p));
+	float dTheta = 2.0f*XM_PI/sliceCount;
+	for(uint32 j = 0; j <= sliceCount; ++j)
+		slices[j] = XMFLOAT4(cosf(j*dTheta), 0.0f, sinf(j*dTheta), 0.0f);
 
-			v.TexC.x = theta / XM_2PI;
-			v.TexC.y = phi / XM_PI;
+	return slices;
+}
 
-			meshData.Vertices.push_back( v );
-		}
-	}
+void GeometryGenerator::AppendRevolution(const std::vector<RevolutionRing>& profile,
+										 const std::vector<XMFLOAT4>& slices, MeshData& meshData)
+{
+	assert(profile.size() >= 2);
 
-	meshData.Vertices.push_back( bottomVertex );
+	uint32 sliceCount = (uint32)slices.size() - 1;
+	uint32 ringVertexCount = sliceCount + 1;
+	uint32 ringCount = (uint32)profile.size();
+	uint32 stackCount = ringCount - 1;
 
-	//
-	// Compute indices for top stack.  The top stack was written first to the vertex buffer
-	// and connects the top pole to the first ring.
-	//
+	uint32 baseIndex = (uint32)meshData.Vertices.size();
+	uint32 indexBase = (uint32)meshData.Indices32.size();
 
-    for(uint32 i = 1; i <= sliceCount; ++i)
+	// Where each ring's vertices and each stack's indices start.  A pole has one vertex
+	// and is joined to its neighbour by a fan.
+	std::vector<uint32> firstVertex(ringCount + 1, 0);
+	for(uint32 i = 0; i < ringCount; ++i)
 	{
-		meshData.Indices32.push_back(0);
-		meshData.Indices32.push_back(i+1);
-		meshData.Indices32.push_back(i);
+		assert(!profile[i].Pole || i == 0 || i == stackCount);
+		firstVertex[i + 1] = firstVertex[i] + (profile[i].Pole ? 1 : ringVertexCount);
 	}
-	
-	//
-	// Compute indices for inner stacks (not connected to poles).
-	//
 
-	// Offset the indices to the index of the first vertex in the first ring.
-	// This is just skipping the top pole vertex.
-    uint32 baseIndex = 1;
-    uint32 ringVertexCount = sliceCount + 1;
-	for(uint32 i = 0; i < stackCount-2; ++i)
+	std::vector<uint32> firstIndex(stackCount + 1, 0);
+	for(uint32 i = 0; i < stackCount; ++i)
 	{
-		for(uint32 j = 0; j < sliceCount; ++j)
+		assert(!(profile[i].Pole && profile[i + 1].Pole));
+		bool fan = profile[i].Pole || profile[i + 1].Pole;
+		firstIndex[i + 1] = firstIndex[i] + sliceCount*(fan ? 3 : 6);
+	}
+
+	meshData.Vertices.resize(baseIndex + firstVertex[ringCount]);
+	meshData.Indices32.resize(indexBase + firstIndex[stackCount]);
+
+	auto buildRing = [&](uint32 i)
+	{
+		const RevolutionRing& ring = profile[i];
+		Vertex* v = &meshData.Vertices[baseIndex + firstVertex[i]];
+
+		if(ring.Pole)
+		{
+			*v = Vertex(0.0f, ring.Y, 0.0f, 0.0f, ring.NormalY, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, ring.V);
+			return;
+		}
+
+		// Position = (r*c, y, r*s) and Normal = (nr*c, ny, nr*s), where (c, 0, s) is the
+		// slice's direction from the table.
+		XMVECTOR radius = XMVectorReplicate(ring.Radius);
+		XMVECTOR normalR = XMVectorReplicate(ring.NormalR);
+		XMVECTOR y = XMVectorSet(0.0f, ring.Y, 0.0f, 0.0f);
+		XMVECTOR normalY = XMVectorSet(0.0f, ring.NormalY, 0.0f, 0.0f);
+
+		for(uint32 j = 0; j <= sliceCount; ++j)
 		{
-			meshData.Indices32.push_back(baseIndex + i*ringVertexCount + j);
-			meshData.Indices32.push_back(baseIndex + i*ringVertexCount + j+1);
-			meshData.Indices32.push_back(baseIndex + (i+1)*ringVertexCount + j);
+			XMVECTOR d = XMLoadFloat4(&slices[j]);
+
+			XMStoreFloat3(&v[j].Position, XMVectorMultiplyAdd(d, radius, y));
+			XMStoreFloat3(&v[j].Normal, XMVectorMultiplyAdd(d, normalR, normalY));
 
-			meshData.Indices32.push_back(baseIndex + (i+1)*ringVertexCount + j);
-			meshData.Indices32.push_back(baseIndex + i*ringVertexCount + j+1);
-			meshData.Indices32.push_back(baseIndex + (i+1)*ringVertexCount + j+1);
+			// Partial derivative of P with respect to theta, which is unit length.
+			v[j].TangentU = XMFLOAT3(-slices[j].z, 0.0f, slices[j].x);
+			v[j].TexC = XMFLOAT2((float)j/sliceCount, ring.V);
 		}
-	}
+	};
 
-	//
-	// Compute indices for bottom stack.  The bottom stack was written last to the vertex buffer
-	// and connects the bottom pole to the bottom ring.
-	//
+	auto buildStack = [&](uint32 i)
+	{
+		uint32 a = baseIndex + firstVertex[i];
+		uint32 b = baseIndex + firstVertex[i + 1];
+		uint32* k = &meshData.Indices32[indexBase + firstIndex[i]];
 
-	// South pole vertex was added last.
-	uint32 southPoleIndex = (uint32)meshData.Vertices.size()-1;
+		for(uint32 j = 0; j < sliceCount; ++j)
+		{
+			if(profile[i].Pole)
+			{
+				*k++ = a; *k++ = b + j; *k++ = b + j+1;
+			}
+			else if(profile[i + 1].Pole)
+			{
+				*k++ = b; *k++ = a + j+1; *k++ = a + j;
+			}
+			else
+			{
+				*k++ = a + j; *k++ = b + j;   *k++ = b + j+1;
+				*k++ = a + j; *k++ = b + j+1; *k++ = a + j+1;
+			}
+		}
+	};
 
-	// Offset the indices to the index of the first vertex in the last ring.
-	baseIndex = southPoleIndex - ringVertexCount;
-	
-	for(uint32 i = 0; i < sliceCount; ++i)
+	// Only meshes with many vertices are worth handing to other threads.
+	if(firstVertex[ringCount] >= ParallelVertexCount)
 	{
-		meshData.Indices32.push_back(southPoleIndex);
-		meshData.Indices32.push_back(baseIndex+i);
-		meshData.Indices32.push_back(baseIndex+i+1);
+		concurrency::parallel_for(0u, ringCount, buildRing);
+		concurrency::parallel_for(0u, stackCount, buildStack);
+	}
+	else
+	{
+		for(uint32 i = 0; i < ringCount; ++i)
+			buildRing(i);
+		for(uint32 i = 0; i < stackCount; ++i)
+			buildStack(i);
 	}
-
-    return meshData;
 }
  
 void GeometryGenerator::Subdivide(MeshData& meshData)
@@ -392,194 +451,68 @@ GeometryGenerator::MeshData GeometryGenerator::CreateCylinder(float bottomRadius
 	// Amount to increment radius as we move up each stack level from bottom to top.
 	float radiusStep = (topRadius - bottomRadius) / stackCount;
 
-	uint32 ringCount = stackCount+1;
+	// Cylinder can be parameterized as follows, where we introduce v
+	// parameter that goes in the same direction as the v tex-coord
+	// so that the bitangent goes in the same direction as the v tex-coord.
+	//   Let r0 be the bottom radius and let r1 be the top radius.
+	//   y(v) = h - hv for v in [0,1].
+	//   r(v) = r1 + (r0-r1)v
+	//
+	//   x(t, v) = r(v)*cos(t)
+	//   y(t, v) = h - hv
+	//   z(t, v) = r(v)*sin(t)
+	// 
+	//  dx/dt = -r(v)*sin(t)
+	//  dy/dt = 0
+	//  dz/dt = +r(v)*cos(t)
+	//
+	//  dx/dv = (r0-r1)*cos(t)
+	//  dy/dv = -h
+	//  dz/dv = (r0-r1)*sin(t)
+	//
+	// The normal T x B = (h*cos(t), r0-r1, h*sin(t)) has the same slope on every ring.
+	float dr = bottomRadius - topRadius;
+	float length = sqrtf(height*height + dr*dr);
 
-	// Compute vertices for each stack ring starting at the bottom and moving up.
-	for(uint32 i = 0; i < ringCount; ++i)
+	// Rings from the bottom up.
+	std::vector<RevolutionRing> profile(stackCount + 1);
+	for(uint32 i = 0; i <= stackCount; ++i)
 	{
-		float y = -0.5f*height + i*stackHeight;
-		float r = bottomRadius + i*radiusStep;
-
-		// vertices of ring
-		float dTheta = 2.0f*XM_PI/sliceCount;
-		for(uint32 j = 0; j <= sliceCount; ++j)
-		{
-			Vertex vertex;
-
-			float c = cosf(j*dTheta);
-			float s = sinf(j*dTheta);
-
-			vertex.Position = XMFLOAT3(r*c, y, r*s);
-
-			vertex.TexC.x = (float)j/sliceCount;
-			vertex.TexC.y = 1.0f - (float)i/stackCount;
-
-			// Cylinder can be parameterized as follows, where we introduce v
-			// parameter that goes in the same direction as the v tex-coord
-			// so that the bitangent goes in the same direction as the v tex-coord.
-			//   Let r0 be the bottom radius and let r1 be the top radius.
-			//   y(v) = h - hv for v in [0,1].
-			//   r(v) = r1 + (r0-r1)v
-			//
-			//   x(t, v) = r(v)*cos(t)
-			//   y(t, v) = h - hv
-			//   z(t, v) = r(v)*sin(t)
-			// 
-			//  dx/dt = -r(v)*sin(t)
-			//  dy/dt = 0
-			//  dz/dt = +r(v)*cos(t)
-			//
-			//  dx/dv = (r0-r1)*cos(t)
-			//  dy/dv = -h
-			//  dz/dv = (r0-r1)*sin(t)
-
-			// This is unit length.
-			vertex.TangentU = XMFLOAT3(-s, 0.0f, c);
-
-			float dr = bottomRadius-topRadius;
-			XMFLOAT3 bitangent(dr*c, -height, dr*s);
-
-			XMVECTOR T = XMLoadFloat3(&vertex.TangentU);
-			XMVECTOR B = XMLoadFloat3(&bitangent);
-			XMVECTOR N = XMVector3Normalize(XMVector3Cross(T, B));
-			XMStoreFloat3(&vertex.Normal, N);
-
-			meshData.Vertices.push_back(vertex);
-		}
+		profile[i].Radius = bottomRadius + i*radiusStep;
+		profile[i].Y = -0.5f*height + i*stackHeight;
+		profile[i].V = 1.0f - (float)i/stackCount;
+		profile[i].NormalR = height / length;
+		profile[i].NormalY = dr / length;
 	}
 
-	// Add one because we duplicate the first and last vertex per ring
-	// since the texture coordinates are different.
-	uint32 ringVertexCount = sliceCount+1;
-
-	// Compute indices for each stack.
-	for(uint32 i = 0; i < stackCount; ++i)
-	{
-		for(uint32 j = 0; j < sliceCount; ++j)
-		{
-			meshData.Indices32.push_back(i*ringVertexCount + j);
-			meshData.Indices32.push_back((i+1)*ringVertexCount + j);
-			meshData.Indices32.push_back((i+1)*ringVertexCount + j+1);
-
-			meshData.Indices32.push_back(i*ringVertexCount + j);
-			meshData.Indices32.push_back((i+1)*ringVertexCount + j+1);
-			meshData.Indices32.push_back(i*ringVertexCount + j+1);
-		}
-	}
+	// The caps share the sides' slice table.
+	std::vector<XMFLOAT4> slices = BuildSliceTable(sliceCount);
 
-	BuildCylinderTopCap(bottomRadius, topRadius, height, sliceCount, stackCount, meshData);
-	BuildCylinderBottomCap(bottomRadius, topRadius, height, sliceCount, stackCount, meshData);
+	AppendRevolution(profile, slices, meshData);
+	BuildCylinderTopCap(topRadius, height, slices, meshData);
+	BuildCylinderBottomCap(bottomRadius, height, slices, meshData);
 
     return meshData;
 }
 
 GeometryGenerator::MeshData GeometryGenerator::CreateCone(float bottomRadius, float topRadius, float height, uint32 sliceCount, uint32 stackCount)
 {
-	MeshData meshData;
-
-	//
-	// Build Stacks.
-	// 
-
-	float stackHeight = height / stackCount;
-
-	// Amount to increment radius as we move up each stack level from bottom to top.
-	float radiusStep = (topRadius - bottomRadius) / stackCount;
-
-	uint32 ringCount = stackCount + 1;
-
-	// Compute vertices for each stack ring starting at the bottom and moving up.
-	for (uint32 i = 0; i < ringCount; ++i)
-	{
-		float y = -0.5f * height + i * stackHeight;
-		float r = bottomRadius + i * radiusStep;
-
-		// vertices of ring
-		float dTheta = 2.0f * XM_PI / sliceCount;
-		for (uint32 j = 0; j <= sliceCount; ++j)
-		{
-			Vertex vertex;
-
-			float c = cosf(j * dTheta);
-			float s = sinf(j * dTheta);
-
-			vertex.Position = XMFLOAT3(r * c, y, r * s);
-
-			vertex.TexC.x = (float)j / sliceCount;
-			vertex.TexC.y = 1.0f - (float)i / stackCount;
-
-			// Cylinder can be parameterized as follows, where we introduce v
-			// parameter that goes in the same direction as the v tex-coord
-			// so that the bitangent goes in the same direction as the v tex-coord.
-			//   Let r0 be the bottom radius and let r1 be the top radius.
-			//   y(v) = h - hv for v in [0,1].
-			//   r(v) = r1 + (r0-r1)v
-			//
-			//   x(t, v) = r(v)*cos(t)
-			//   y(t, v) = h - hv
-			//   z(t, v) = r(v)*sin(t)
-			// 
-			//  dx/dt = -r(v)*sin(t)
-			//  dy/dt = 0
-			//  dz/dt = +r(v)*cos(t)
-			//
-			//  dx/dv = (r0-r1)*cos(t)
-			//  dy/dv = -h
-			//  dz/dv = (r0-r1)*sin(t)
-
-			// This is unit length.
-			vertex.TangentU = XMFLOAT3(-s, 0.0f, c);
-
-			float dr = bottomRadius - topRadius;
-			XMFLOAT3 bitangent(dr * c, -height, dr * s);
-
-			XMVECTOR T = XMLoadFloat3(&vertex.TangentU);
-			XMVECTOR B = XMLoadFloat3(&bitangent);
-			XMVECTOR N = XMVector3Normalize(XMVector3Cross(T, B));
-			XMStoreFloat3(&vertex.Normal, N);
-
-			meshData.Vertices.push_back(vertex);
-		}
-	}
-
-	// Add one because we duplicate the first and last vertex per ring
-	// since the texture coordinates are different.
-	uint32 ringVertexCount = sliceCount + 1;
-
-	// Compute indices for each stack.
-	for (uint32 i = 0; i < stackCount; ++i)
-	{
-		for (uint32 j = 0; j < sliceCount; ++j)
-		{
-			meshData.Indices32.push_back(i * ringVertexCount + j);
-			meshData.Indices32.push_back((i + 1) * ringVertexCount + j);
-			meshData.Indices32.push_back((i + 1) * ringVertexCount + j + 1);
-
-			meshData.Indices32.push_back(i * ringVertexCount + j);
-			meshData.Indices32.push_back((i + 1) * ringVertexCount + j + 1);
-			meshData.Indices32.push_back(i * ringVertexCount + j + 1);
-		}
-	}
-
-	BuildCylinderTopCap(bottomRadius, topRadius, height, sliceCount, stackCount, meshData);
-	BuildCylinderBottomCap(bottomRadius, topRadius, height, sliceCount, stackCount, meshData);
-
-	return meshData;
+	return CreateCylinder(bottomRadius, topRadius, height, sliceCount, stackCount);
 }
 
-void GeometryGenerator::BuildCylinderTopCap(float bottomRadius, float topRadius, float height,
-											uint32 sliceCount, uint32 stackCount, MeshData& meshData)
+void GeometryGenerator::BuildCylinderTopCap(float topRadius, float height,
+											const std::vector<XMFLOAT4>& slices, MeshData& meshData)
 {
+	uint32 sliceCount = (uint32)slices.size() - 1;
 	uint32 baseIndex = (uint32)meshData.Vertices.size();
 
 	float y = 0.5f*height;
-	float dTheta = 2.0f*XM_PI/sliceCount;
 
 	// Duplicate cap ring vertices because the texture coordinates and normals differ.
 	for(uint32 i = 0; i <= sliceCount; ++i)
 	{
-		float x = topRadius*cosf(i*dTheta);
-		float z = topRadius*sinf(i*dTheta);
+		float x = topRadius*slices[i].x;
+		float z = topRadius*slices[i].z;
 
 		// Scale down by the height to try and make top cap texture coord area
 		// proportional to base.
@@ -603,22 +536,22 @@ void GeometryGenerator::BuildCylinderTopCap(float bottomRadius, float topRadius,
 	}
 }
 
-void GeometryGenerator::BuildCylinderBottomCap(float bottomRadius, float topRadius, float height,
-											   uint32 sliceCount, uint32 stackCount, MeshData& meshData)
+void GeometryGenerator::BuildCylinderBottomCap(float bottomRadius, float height,
+											   const std::vector<XMFLOAT4>& slices, MeshData& meshData)
 {
 	// 
 	// Build bottom cap.
 	//
 
+	uint32 sliceCount = (uint32)slices.size() - 1;
 	uint32 baseIndex = (uint32)meshData.Vertices.size();
 	float y = -0.5f*height;
 
 	// vertices of ring
-	float dTheta = 2.0f*XM_PI/sliceCount;
 	for(uint32 i = 0; i <= sliceCount; ++i)
 	{
-		float x = bottomRadius*cosf(i*dTheta);
-		float z = bottomRadius*sinf(i*dTheta);
+		float x = bottomRadius*slices[i].x;
+		float z = bottomRadius*slices[i].z;
 
 		// Scale down by the height to try and make top cap texture coord area
 		// proportional to base.
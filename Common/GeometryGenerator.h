@@ -74,6 +74,25 @@ public:
 		std::vector<uint16> mIndices16;
 	};
 
+	///<summary>
+	/// One ring of a surface of revolution about the y-axis: its radius and height,
+	/// its v texture coordinate, and its normal split into the part pointing away
+	/// from the axis and the part along y.  A pole is a single vertex on the axis,
+	/// and may only be the first or last ring.
+	///</summary>
+	struct RevolutionRing
+	{
+		float Radius = 0.0f;
+		float Y = 0.0f;
+		float V = 0.0f;
+		float NormalR = 1.0f;
+		float NormalY = 0.0f;
+		bool Pole = false;
+	};
+
+	// Surfaces of revolution with at least this many vertices are built on several threads.
+	static const uint32 ParallelVertexCount = 16384;
+
 	///<summary>
 	/// Creates a box centered at the origin with the given dimensions, where each
     /// face has m rows and n columns of vertices.
@@ -99,6 +118,8 @@ public:
 	///</summary>
     MeshData CreateCylinder(float bottomRadius, float topRadius, float height, uint32 sliceCount, uint32 stackCount);
 
+	///<summary>
+	/// Same as CreateCylinder, for callers that would rather name the shape.
 	///</summary>
 	MeshData CreateCone(float bottomRadius, float topRadius, float height, uint32 sliceCount, uint32 stackCount);
 
@@ -108,6 +129,14 @@ public:
 	///</summary>
     MeshData CreateGrid(float width, float depth, uint32 m, uint32 n);
 
+	///<summary>
+	/// Sweeps a profile of rings, listed from the bottom up, around the y-axis.  Each
+	/// ring gets sliceCount+1 vertices, the seam being duplicated for the texture
+	/// coordinates, with u going from 0 to 1.  The sine and cosine of each slice are
+	/// computed once per call.  The sphere, cylinder and cone are built with it.
+	///</summary>
+	MeshData CreateRevolution(const std::vector<RevolutionRing>& profile, uint32 sliceCount);
+
 	///<summary>
 	/// Creates a quad aligned with the screen.  This is useful for postprocessing and screen effects.
 	///</summary>
@@ -116,7 +145,14 @@ public:
 private:
 	
     Vertex MidPoint(const Vertex& v0, const Vertex& v1);
-    void BuildCylinderTopCap(float bottomRadius, float topRadius, float height, uint32 sliceCount, uint32 stackCount, MeshData& meshData);
-    void BuildCylinderBottomCap(float bottomRadius, float topRadius, float height, uint32 sliceCount, uint32 stackCount, MeshData& meshData);
+    void BuildCylinderTopCap(float topRadius, float height, const std::vector<DirectX::XMFLOAT4>& slices, MeshData& meshData);
+    void BuildCylinderBottomCap(float bottomRadius, float height, const std::vector<DirectX::XMFLOAT4>& slices, MeshData& meshData);
+
+	// (cos, 0, sin, 0) of each slice's angle, with the first repeated at the end.
+	static std::vector<DirectX::XMFLOAT4> BuildSliceTable(uint32 sliceCount);
+
+	// Appends the surface's vertices and indices to meshData.
+	void AppendRevolution(const std::vector<RevolutionRing>& profile,
+		const std::vector<DirectX::XMFLOAT4>& slices, MeshData& meshData);
 };
 
@@ -0,0 +1,476 @@
+//***************************************************************************************
+// ImpostorBaker.cpp
+//***************************************************************************************
+
+#include "ImpostorBaker.h"
+#include <ppl.h>
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+using namespace DirectX;
+
+namespace
+{
+	float SignNotZero(float x)
+	{
+		return x >= 0.0f ? 1.0f : -1.0f;
+	}
+
+	std::uint32_t PackUnorm4(float r, float g, float b, float a)
+	{
+		auto pack = [](float x) { return (std::uint32_t)(std::min(std::max(x, 0.0f), 1.0f)*255.0f + 0.5f); };
+		return pack(r) | (pack(g) << 8) | (pack(b) << 16) | (pack(a) << 24);
+	}
+
+	// Twice the signed area of triangle (a, b, p); positive when p is to the left of a->b
+	// with y pointing down.
+	float EdgeFunction(const XMFLOAT3& a, const XMFLOAT3& b, float px, float py)
+	{
+		return (b.x - a.x)*(py - a.y) - (b.y - a.y)*(px - a.x);
+	}
+
+	const char FileMagic[4] = { 'I', 'M', 'P', 'A' };
+	const std::uint32_t FileVersion = 1;
+
+	// Plain data is written as it is in memory, little endian on every target.
+	template<typename T>
+	void Write(std::ofstream& file, const T* data, std::size_t count = 1)
+	{
+		file.write(reinterpret_cast<const char*>(data), sizeof(T)*count);
+	}
+
+	template<typename T>
+	bool Read(std::ifstream& file, T* data, std::size_t count = 1)
+	{
+		return bool(file.read(reinterpret_cast<char*>(data), sizeof(T)*count));
+	}
+
+	void WriteString(std::ofstream& file, const std::string& s)
+	{
+		std::uint32_t length = (std::uint32_t)s.size();
+		Write(file, &length);
+		file.write(s.data(), length);
+	}
+
+	bool ReadString(std::ifstream& file, std::string& s)
+	{
+		std::uint32_t length = 0;
+		if(!Read(file, &length) || length > 1024)
+			return false;
+
+		s.resize(length);
+		return length == 0 || bool(file.read(&s[0], length));
+	}
+}
+
+ImpostorBaker::ImpostorBaker(const ImpostorBakeSettings& settings)
+{
+	assert(settings.FramesPerSide > 0 && settings.FrameSize > 0);
+	mSettings = settings;
+}
+
+const ImpostorBakeSettings& ImpostorBaker::Settings()const
+{
+	return mSettings;
+}
+
+void ImpostorBaker::Bake(const ImpostorMesh& mesh, FXMMATRIX transform,
+	const AlbedoFunction& albedo, ImpostorAtlas& atlas)const
+{
+	assert(mesh.IndexCount % 3 == 0);
+
+	atlas.FramesPerSide = mSettings.FramesPerSide;
+	atlas.FrameSize = mSettings.FrameSize;
+	atlas.Width = mSettings.FramesPerSide*mSettings.FrameSize;
+	atlas.Albedo.assign((size_t)atlas.Width*atlas.Width, 0);
+	atlas.Normal.assign((size_t)atlas.Width*atlas.Width, 0);
+	atlas.Center = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	atlas.Radius = 0.0f;
+
+	if(mesh.IndexCount == 0)
+		return;
+
+	//
+	// Gather the referenced vertices, transformed, and the triangles.
+	//
+	const std::uint8_t* vertexBytes = static_cast<const std::uint8_t*>(mesh.Vertices);
+
+	std::vector<std::uint32_t> indices(mesh.IndexCount);
+	for(std::uint32_t i = 0; i < mesh.IndexCount; ++i)
+	{
+		std::uint32_t index = mesh.SixteenBitIndices ?
+			static_cast<const std::uint16_t*>(mesh.Indices)[mesh.StartIndexLocation + i] :
+			static_cast<const std::uint32_t*>(mesh.Indices)[mesh.StartIndexLocation + i];
+
+		indices[i] = (std::uint32_t)((std::int32_t)index + mesh.BaseVertexLocation);
+		assert(indices[i] < mesh.VertexCount);
+	}
+
+	XMMATRIX normalTransform = XMMatrixTranspose(XMMatrixInverse(nullptr, transform));
+
+	std::vector<BakeVertex> vertices(mesh.VertexCount);
+	XMVECTOR boundsMin = XMVectorReplicate(FLT_MAX);
+	XMVECTOR boundsMax = XMVectorReplicate(-FLT_MAX);
+	for(std::uint32_t i = 0; i < mesh.VertexCount; ++i)
+	{
+		const std::uint8_t* v = vertexBytes + (size_t)i*mesh.VertexStride;
+
+		XMVECTOR pos = XMVector3TransformCoord(
+			XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(v + mesh.PositionOffset)), transform);
+		XMVECTOR normal = XMVector3Normalize(XMVector3TransformNormal(
+			XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(v + mesh.NormalOffset)), normalTransform));
+
+		XMStoreFloat3(&vertices[i].Pos, pos);
+		XMStoreFloat3(&vertices[i].Normal, normal);
+		vertices[i].TexC = *reinterpret_cast<const XMFLOAT2*>(v + mesh.TexCOffset);
+	}
+
+	// Only vertices that are used count towards the bounds.
+	for(std::uint32_t index : indices)
+	{
+		XMVECTOR pos = XMLoadFloat3(&vertices[index].Pos);
+		boundsMin = XMVectorMin(boundsMin, pos);
+		boundsMax = XMVectorMax(boundsMax, pos);
+	}
+
+	XMVECTOR center = XMVectorScale(XMVectorAdd(boundsMin, boundsMax), 0.5f);
+	float radius = 0.0f;
+	for(std::uint32_t index : indices)
+	{
+		XMVECTOR d = XMVectorSubtract(XMLoadFloat3(&vertices[index].Pos), center);
+		radius = std::max(radius, XMVectorGetX(XMVector3Length(d)));
+	}
+
+	XMStoreFloat3(&atlas.Center, center);
+	atlas.Radius = std::max(radius, 1.0e-4f);
+
+	//
+	// Every frame writes its own cell of the atlas, so they can be baked in parallel.
+	//
+	std::uint32_t framesPerSide = mSettings.FramesPerSide;
+	concurrency::parallel_for(0u, framesPerSide*framesPerSide, [&](std::uint32_t frame)
+	{
+		std::uint32_t frameX = frame % framesPerSide;
+		std::uint32_t frameY = frame / framesPerSide;
+
+		BakeFrame(vertices, indices, albedo, frameX, frameY, atlas);
+		DilateFrame(frameX, frameY, atlas);
+	});
+}
+
+void ImpostorBaker::BakeFrame(const std::vector<BakeVertex>& vertices, const std::vector<std::uint32_t>& indices,
+	const AlbedoFunction& albedo, std::uint32_t frameX, std::uint32_t frameY, ImpostorAtlas& atlas)const
+{
+	const std::uint32_t size = mSettings.FrameSize;
+	const float fsize = (float)size;
+
+	XMFLOAT3 dir = FrameDirection(frameX, frameY, mSettings.FramesPerSide);
+	XMFLOAT3 right, up;
+	FrameBasis(dir, right, up);
+
+	XMVECTOR rightV = XMLoadFloat3(&right);
+	XMVECTOR upV = XMLoadFloat3(&up);
+	XMVECTOR lookV = XMVectorNegate(XMLoadFloat3(&dir));
+	XMVECTOR centerV = XMLoadFloat3(&atlas.Center);
+	float invRadius = 1.0f / atlas.Radius;
+
+	// Texel coordinates (y down) and depth along the view direction of every vertex.
+	std::vector<XMFLOAT3> screen(vertices.size());
+	for(size_t i = 0; i < vertices.size(); ++i)
+	{
+		XMVECTOR rel = XMVectorSubtract(XMLoadFloat3(&vertices[i].Pos), centerV);
+		float sx = XMVectorGetX(XMVector3Dot(rel, rightV))*invRadius;
+		float sy = XMVectorGetX(XMVector3Dot(rel, upV))*invRadius;
+
+		screen[i].x = (sx*0.5f + 0.5f)*fsize;
+		screen[i].y = (0.5f - sy*0.5f)*fsize;
+		screen[i].z = XMVectorGetX(XMVector3Dot(rel, lookV));
+	}
+
+	std::vector<float> depth((size_t)size*size, FLT_MAX);
+
+	std::uint32_t* albedoRow0 = &atlas.Albedo[(size_t)frameY*size*atlas.Width + frameX*size];
+	std::uint32_t* normalRow0 = &atlas.Normal[(size_t)frameY*size*atlas.Width + frameX*size];
+
+	for(size_t t = 0; t < indices.size(); t += 3)
+	{
+		std::uint32_t i0 = indices[t + 0];
+		std::uint32_t i1 = indices[t + 1];
+		std::uint32_t i2 = indices[t + 2];
+
+		const XMFLOAT3& p0 = screen[i0];
+		const XMFLOAT3& p1 = screen[i1];
+		const XMFLOAT3& p2 = screen[i2];
+
+		float area = EdgeFunction(p0, p1, p2.x, p2.y);
+		if(std::fabs(area) < 1.0e-8f)
+			continue;
+
+		// No back face culling, so accept either winding.
+		float invArea = 1.0f / area;
+
+		int minX = std::max((int)std::floor(std::min(std::min(p0.x, p1.x), p2.x)), 0);
+		int maxX = std::min((int)std::ceil(std::max(std::max(p0.x, p1.x), p2.x)), (int)size - 1);
+		int minY = std::max((int)std::floor(std::min(std::min(p0.y, p1.y), p2.y)), 0);
+		int maxY = std::min((int)std::ceil(std::max(std::max(p0.y, p1.y), p2.y)), (int)size - 1);
+
+		for(int y = minY; y <= maxY; ++y)
+		{
+			for(int x = minX; x <= maxX; ++x)
+			{
+				float px = x + 0.5f;
+				float py = y + 0.5f;
+
+				float b0 = EdgeFunction(p1, p2, px, py)*invArea;
+				float b1 = EdgeFunction(p2, p0, px, py)*invArea;
+				float b2 = EdgeFunction(p0, p1, px, py)*invArea;
+				if(b0 < 0.0f || b1 < 0.0f || b2 < 0.0f)
+					continue;
+
+				// Orthographic, so depth and attributes interpolate linearly on screen.
+				float z = b0*p0.z + b1*p1.z + b2*p2.z;
+				float& stored = depth[(size_t)y*size + x];
+				if(z >= stored)
+					continue;
+				stored = z;
+
+				const BakeVertex& v0 = vertices[i0];
+				const BakeVertex& v1 = vertices[i1];
+				const BakeVertex& v2 = vertices[i2];
+
+				XMVECTOR n = XMVectorScale(XMLoadFloat3(&v0.Normal), b0);
+				n = XMVectorMultiplyAdd(XMLoadFloat3(&v1.Normal), XMVectorReplicate(b1), n);
+				n = XMVectorMultiplyAdd(XMLoadFloat3(&v2.Normal), XMVectorReplicate(b2), n);
+				XMFLOAT3 normal;
+				XMStoreFloat3(&normal, XMVector3Normalize(n));
+
+				XMFLOAT4 color(1.0f, 1.0f, 1.0f, 1.0f);
+				if(albedo)
+				{
+					XMFLOAT2 texC(
+						b0*v0.TexC.x + b1*v1.TexC.x + b2*v2.TexC.x,
+						b0*v0.TexC.y + b1*v1.TexC.y + b2*v2.TexC.y);
+					color = albedo(texC);
+				}
+
+				size_t texel = (size_t)y*atlas.Width + x;
+				albedoRow0[texel] = PackUnorm4(color.x, color.y, color.z, 1.0f);
+				normalRow0[texel] = PackUnorm4(normal.x*0.5f + 0.5f, normal.y*0.5f + 0.5f, normal.z*0.5f + 0.5f, 1.0f);
+			}
+		}
+	}
+}
+
+void ImpostorBaker::DilateFrame(std::uint32_t frameX, std::uint32_t frameY, ImpostorAtlas& atlas)const
+{
+	const int size = (int)mSettings.FrameSize;
+	const std::uint32_t alphaMask = 0xff000000u;
+
+	std::uint32_t* albedo = &atlas.Albedo[(size_t)frameY*size*atlas.Width + frameX*size];
+	std::uint32_t* normal = &atlas.Normal[(size_t)frameY*size*atlas.Width + frameX*size];
+
+	// Texels filled so far, including by earlier passes.  Filled texels keep alpha 0.
+	std::vector<std::uint8_t> filled((size_t)size*size);
+	for(int y = 0; y < size; ++y)
+	{
+		for(int x = 0; x < size; ++x)
+			filled[(size_t)y*size + x] = (albedo[(size_t)y*atlas.Width + x] & alphaMask) != 0;
+	}
+
+	std::vector<std::uint8_t> next;
+	for(std::uint32_t pass = 0; pass < mSettings.DilationPasses; ++pass)
+	{
+		next = filled;
+
+		for(int y = 0; y < size; ++y)
+		{
+			for(int x = 0; x < size; ++x)
+			{
+				if(filled[(size_t)y*size + x])
+					continue;
+
+				const int dx[4] = { -1, 1, 0, 0 };
+				const int dy[4] = { 0, 0, -1, 1 };
+				for(int k = 0; k < 4; ++k)
+				{
+					int nx = x + dx[k];
+					int ny = y + dy[k];
+					if(nx < 0 || ny < 0 || nx >= size || ny >= size || !filled[(size_t)ny*size + nx])
+						continue;
+
+					size_t from = (size_t)ny*atlas.Width + nx;
+					size_t to = (size_t)y*atlas.Width + x;
+					albedo[to] = albedo[from] & ~alphaMask;
+					normal[to] = normal[from] & ~alphaMask;
+					next[(size_t)y*size + x] = 1;
+					break;
+				}
+			}
+		}
+
+		filled.swap(next);
+	}
+}
+
+XMFLOAT3 ImpostorBaker::FrameDirection(std::uint32_t x, std::uint32_t y, std::uint32_t framesPerSide)
+{
+	XMFLOAT2 uv((x + 0.5f) / framesPerSide, (y + 0.5f) / framesPerSide);
+	return OctahedralDecode(uv);
+}
+
+void ImpostorBaker::NearestFrame(const XMFLOAT3& dir, std::uint32_t framesPerSide,
+	std::uint32_t& x, std::uint32_t& y)
+{
+	XMFLOAT2 uv = OctahedralEncode(dir);
+	x = std::min((std::uint32_t)(uv.x*framesPerSide), framesPerSide - 1);
+	y = std::min((std::uint32_t)(uv.y*framesPerSide), framesPerSide - 1);
+}
+
+void ImpostorBaker::FrameBasis(const XMFLOAT3& dir, XMFLOAT3& right, XMFLOAT3& up)
+{
+	// Same axes as XMMatrixLookAtLH for a viewer looking along -dir.
+	XMVECTOR look = XMVectorNegate(XMVector3Normalize(XMLoadFloat3(&dir)));
+	XMVECTOR worldUp = std::fabs(dir.y) > 0.999f*XMVectorGetX(XMVector3Length(XMLoadFloat3(&dir))) ?
+		XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f) : XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+
+	XMVECTOR r = XMVector3Normalize(XMVector3Cross(worldUp, look));
+	XMVECTOR u = XMVector3Cross(look, r);
+
+	XMStoreFloat3(&right, r);
+	XMStoreFloat3(&up, u);
+}
+
+XMFLOAT2 ImpostorBaker::OctahedralEncode(const XMFLOAT3& dir)
+{
+	float sum = std::fabs(dir.x) + std::fabs(dir.y) + std::fabs(dir.z);
+	if(sum == 0.0f)
+		return XMFLOAT2(0.5f, 0.5f);
+
+	float a = dir.x / sum;
+	float b = dir.z / sum;
+
+	// The lower half of the octahedron is folded out over the corners.
+	if(dir.y < 0.0f)
+	{
+		float foldedA = (1.0f - std::fabs(b))*SignNotZero(a);
+		float foldedB = (1.0f - std::fabs(a))*SignNotZero(b);
+		a = foldedA;
+		b = foldedB;
+	}
+
+	return XMFLOAT2(a*0.5f + 0.5f, b*0.5f + 0.5f);
+}
+
+XMFLOAT3 ImpostorBaker::OctahedralDecode(const XMFLOAT2& uv)
+{
+	float a = uv.x*2.0f - 1.0f;
+	float b = uv.y*2.0f - 1.0f;
+	float c = 1.0f - std::fabs(a) - std::fabs(b);
+
+	if(c < 0.0f)
+	{
+		float unfoldedA = (1.0f - std::fabs(b))*SignNotZero(a);
+		float unfoldedB = (1.0f - std::fabs(a))*SignNotZero(b);
+		a = unfoldedA;
+		b = unfoldedB;
+	}
+
+	XMFLOAT3 dir;
+	XMStoreFloat3(&dir, XMVector3Normalize(XMVectorSet(a, c, b, 0.0f)));
+	return dir;
+}
+
+bool ImpostorBaker::WriteFile(const std::string& path, const std::vector<ImpostorFileEntry>& entries)
+{
+	std::ofstream file(path, std::ios::binary);
+	if(!file)
+		return false;
+
+	std::uint32_t count = (std::uint32_t)entries.size();
+	file.write(FileMagic, sizeof(FileMagic));
+	Write(file, &FileVersion);
+	Write(file, &count);
+
+	for(const ImpostorFileEntry& entry : entries)
+	{
+		const ImpostorAtlas& atlas = entry.Atlas;
+		assert(atlas.Albedo.size() == (size_t)atlas.Width*atlas.Width && atlas.Normal.size() == atlas.Albedo.size());
+
+		WriteString(file, entry.Geometry);
+		WriteString(file, entry.Material);
+		Write(file, &entry.Transform);
+		Write(file, &atlas.FramesPerSide);
+		Write(file, &atlas.FrameSize);
+		Write(file, &atlas.Width);
+		Write(file, &atlas.Center);
+		Write(file, &atlas.Radius);
+		Write(file, atlas.Albedo.data(), atlas.Albedo.size());
+		Write(file, atlas.Normal.data(), atlas.Normal.size());
+	}
+
+	return bool(file);
+}
+
+bool ImpostorBaker::ReadFile(const std::string& path, std::vector<ImpostorFileEntry>& entries)
+{
+	entries.clear();
+
+	std::ifstream file(path, std::ios::binary);
+	if(!file)
+		return false;
+
+	char magic[4];
+	std::uint32_t version = 0;
+	std::uint32_t count = 0;
+	if(!Read(file, magic, 4) || std::memcmp(magic, FileMagic, 4) != 0 ||
+		!Read(file, &version) || version != FileVersion || !Read(file, &count))
+	{
+		return false;
+	}
+
+	entries.resize(count);
+	for(ImpostorFileEntry& entry : entries)
+	{
+		ImpostorAtlas& atlas = entry.Atlas;
+		if(!ReadString(file, entry.Geometry) || !ReadString(file, entry.Material) ||
+			!Read(file, &entry.Transform) || !Read(file, &atlas.FramesPerSide) ||
+			!Read(file, &atlas.FrameSize) || !Read(file, &atlas.Width) ||
+			!Read(file, &atlas.Center) || !Read(file, &atlas.Radius))
+		{
+			return false;
+		}
+
+		if(atlas.Width != atlas.FramesPerSide*atlas.FrameSize || atlas.Width == 0 || atlas.Width > 16384)
+			return false;
+
+		atlas.Albedo.resize((size_t)atlas.Width*atlas.Width);
+		atlas.Normal.resize(atlas.Albedo.size());
+		if(!Read(file, atlas.Albedo.data(), atlas.Albedo.size()) || !Read(file, atlas.Normal.data(), atlas.Normal.size()))
+			return false;
+	}
+
+	return true;
+}
+
+int ImpostorBaker::FindEntry(const std::vector<ImpostorFileEntry>& entries, const std::string& geometry,
+	const std::string& material, const XMFLOAT4X4& transform)
+{
+	for(std::size_t e = 0; e < entries.size(); ++e)
+	{
+		const ImpostorFileEntry& entry = entries[e];
+		bool same = entry.Geometry == geometry && entry.Material == material;
+		for(int i = 0; i < 4 && same; ++i)
+		{
+			for(int j = 0; j < 4 && same; ++j)
+				same = std::fabs(entry.Transform.m[i][j] - transform.m[i][j]) <= 1.0e-5f;
+		}
+
+		if(same)
+			return (int)e;
+	}
+	return -1;
+}
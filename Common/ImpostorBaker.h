@@ -0,0 +1,140 @@
+//***************************************************************************************
+// ImpostorBaker.h
+//
+// Bakes impostors: a mesh is rendered from FramesPerSide x FramesPerSide directions
+// into an atlas of albedo and normal frames, so a distant object can be drawn as one
+// quad showing the frame baked closest to the direction it is seen from.
+//
+// The directions come from an octahedral map of the sphere: frame (x, y) is the
+// direction the center of its cell decodes to, and a view direction is matched to a
+// frame by encoding it and taking the cell it lands in.
+//
+// Frames are rendered with a small software rasterizer (orthographic, depth tested,
+// no culling), one task per frame, so baking needs no GPU and is done ahead of time.
+//***************************************************************************************
+
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Indexed triangles to bake, read from vertex and index memory laid out as in a
+// MeshGeometry's CPU buffers.
+struct ImpostorMesh
+{
+	const void* Vertices = nullptr;
+	std::uint32_t VertexStride = 0;
+	std::uint32_t VertexCount = 0;
+
+	// Byte offsets of the float3 position, float3 normal and float2 texture
+	// coordinates inside a vertex.
+	std::uint32_t PositionOffset = 0;
+	std::uint32_t NormalOffset = 12;
+	std::uint32_t TexCOffset = 24;
+
+	const void* Indices = nullptr;
+	bool SixteenBitIndices = true;
+	std::uint32_t IndexCount = 0;
+	std::uint32_t StartIndexLocation = 0;
+	std::int32_t BaseVertexLocation = 0;
+};
+
+struct ImpostorBakeSettings
+{
+	std::uint32_t FramesPerSide = 8;
+
+	// Width and height of one frame in texels.
+	std::uint32_t FrameSize = 32;
+
+	// Rings of empty texels around the silhouette that get the color of their covered
+	// neighbours, so filtering at the edge does not pull in black.
+	std::uint32_t DilationPasses = 2;
+};
+
+// Width x Width texels of R8G8B8A8 data per channel.  Alpha is 255 where the mesh
+// covers the texel and 0 elsewhere.  Normals are stored as n*0.5 + 0.5 in the space
+// the mesh was baked in.
+struct ImpostorAtlas
+{
+	std::uint32_t FramesPerSide = 0;
+	std::uint32_t FrameSize = 0;
+	std::uint32_t Width = 0;
+
+	std::vector<std::uint32_t> Albedo;
+	std::vector<std::uint32_t> Normal;
+
+	// Sphere around the baked mesh.  Every frame shows the area of a square
+	// 2*Radius wide around Center.
+	DirectX::XMFLOAT3 Center = { 0.0f, 0.0f, 0.0f };
+	float Radius = 0.0f;
+};
+
+// A baked atlas as stored in an impostor file, with what it was baked from: the name
+// of the mesh and of its material, and the transform passed to Bake.
+struct ImpostorFileEntry
+{
+	std::string Geometry;
+	std::string Material;
+	DirectX::XMFLOAT4X4 Transform;
+	ImpostorAtlas Atlas;
+};
+
+class ImpostorBaker
+{
+public:
+	// Returns the albedo of the surface at the given texture coordinates.
+	typedef std::function<DirectX::XMFLOAT4(const DirectX::XMFLOAT2& texC)> AlbedoFunction;
+
+	explicit ImpostorBaker(const ImpostorBakeSettings& settings = ImpostorBakeSettings());
+
+	const ImpostorBakeSettings& Settings()const;
+
+	// Bakes the mesh, after applying transform to it, into atlas.  Normals are
+	// transformed by the inverse transpose of transform.
+	void Bake(const ImpostorMesh& mesh, DirectX::FXMMATRIX transform,
+		const AlbedoFunction& albedo, ImpostorAtlas& atlas)const;
+
+	// Unit direction (from the object toward the viewer) frame (x, y) was baked from.
+	static DirectX::XMFLOAT3 FrameDirection(std::uint32_t x, std::uint32_t y, std::uint32_t framesPerSide);
+
+	// Frame baked from the direction closest to dir, which need not be normalized.
+	static void NearestFrame(const DirectX::XMFLOAT3& dir, std::uint32_t framesPerSide,
+		std::uint32_t& x, std::uint32_t& y);
+
+	// Screen axes of a frame baked from direction dir: right and up as seen by a viewer
+	// looking back along -dir.  Quads drawn with a frame must use the same axes.
+	static void FrameBasis(const DirectX::XMFLOAT3& dir, DirectX::XMFLOAT3& right, DirectX::XMFLOAT3& up);
+
+	// Maps a unit direction to [0,1]^2 and back; y is the axis through the middle
+	// of the map.
+	static DirectX::XMFLOAT2 OctahedralEncode(const DirectX::XMFLOAT3& dir);
+	static DirectX::XMFLOAT3 OctahedralDecode(const DirectX::XMFLOAT2& uv);
+
+	// Impostors are baked offline by Tools/ImpostorBake into one binary file of
+	// entries, which the app reads at startup.
+	static bool WriteFile(const std::string& path, const std::vector<ImpostorFileEntry>& entries);
+	static bool ReadFile(const std::string& path, std::vector<ImpostorFileEntry>& entries);
+
+	// Index of the entry baked from geometry and material with transform, to within
+	// rounding, or -1.
+	static int FindEntry(const std::vector<ImpostorFileEntry>& entries, const std::string& geometry,
+		const std::string& material, const DirectX::XMFLOAT4X4& transform);
+
+private:
+	struct BakeVertex
+	{
+		DirectX::XMFLOAT3 Pos;
+		DirectX::XMFLOAT3 Normal;
+		DirectX::XMFLOAT2 TexC;
+	};
+
+	void BakeFrame(const std::vector<BakeVertex>& vertices, const std::vector<std::uint32_t>& indices,
+		const AlbedoFunction& albedo, std::uint32_t frameX, std::uint32_t frameY, ImpostorAtlas& atlas)const;
+
+	void DilateFrame(std::uint32_t frameX, std::uint32_t frameY, ImpostorAtlas& atlas)const;
+
+	ImpostorBakeSettings mSettings;
+};
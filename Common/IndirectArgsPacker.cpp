@@ -0,0 +1,104 @@
+//***************************************************************************************
+// IndirectArgsPacker.cpp
+//***************************************************************************************
+
+#include "IndirectArgsPacker.h"
+#include <DirectXMath.h>
+#include <cassert>
+#include <cstring>
+
+using namespace DirectX;
+
+IndirectArgsPacker::IndirectArgsPacker(std::uint32_t commandByteSize)
+{
+	assert(commandByteSize > 0 && commandByteSize % 16 == 0);
+	mCommandByteSize = commandByteSize;
+}
+
+IndirectArgsPacker::~IndirectArgsPacker()
+{
+}
+
+std::uint32_t IndirectArgsPacker::CommandByteSize()const
+{
+	return mCommandByteSize;
+}
+
+void IndirectArgsPacker::Clear()
+{
+	mCommands.clear();
+	mCount = 0;
+}
+
+void IndirectArgsPacker::Resize(std::uint32_t count)
+{
+	mCommands.resize((size_t)count*(mCommandByteSize / 16), Block());
+	mCount = count;
+}
+
+std::uint32_t IndirectArgsPacker::Count()const
+{
+	return mCount;
+}
+
+void IndirectArgsPacker::Set(std::uint32_t index, const void* command)
+{
+	assert(index < mCount);
+	std::memcpy(&mCommands[(size_t)index*(mCommandByteSize / 16)], command, mCommandByteSize);
+}
+
+const void* IndirectArgsPacker::Command(std::uint32_t index)const
+{
+	assert(index < mCount);
+	return &mCommands[(size_t)index*(mCommandByteSize / 16)];
+}
+
+void IndirectArgsPacker::Pack(const std::uint32_t* order, std::uint32_t count, std::uint64_t addressBase,
+	void* dest)const
+{
+	const std::uint32_t blocksPerCommand = mCommandByteSize / 16;
+
+	// The destination need not be 16 byte aligned, so use unaligned stores.
+	std::uint32_t* out = static_cast<std::uint32_t*>(dest);
+
+	for(std::uint32_t i = 0; i < count; ++i)
+	{
+		assert(order[i] < mCount);
+		const Block* src = &mCommands[(size_t)order[i]*blocksPerCommand];
+
+		// The address is the only field that is not copied as it is.
+		std::uint64_t address;
+		std::memcpy(&address, src[0].Words, sizeof(address));
+		address += addressBase;
+
+		XMVECTOR first = XMLoadInt4(src[0].Words);
+		first = XMVectorSetIntX(first, (std::uint32_t)address);
+		first = XMVectorSetIntY(first, (std::uint32_t)(address >> 32));
+		XMStoreInt4(out, first);
+
+		for(std::uint32_t b = 1; b < blocksPerCommand; ++b)
+			XMStoreInt4(out + 4*b, XMLoadInt4(src[b].Words));
+
+		out += 4*blocksPerCommand;
+	}
+}
+
+void IndirectArgsPacker::PackReference(const std::uint32_t* order, std::uint32_t count,
+	std::uint64_t addressBase, void* dest)const
+{
+	std::uint8_t* out = static_cast<std::uint8_t*>(dest);
+
+	for(std::uint32_t i = 0; i < count; ++i)
+	{
+		const std::uint8_t* src = static_cast<const std::uint8_t*>(Command(order[i]));
+
+		std::uint64_t address;
+		std::memcpy(&address, src, sizeof(address));
+		address += addressBase;
+
+		std::memcpy(out, &address, sizeof(address));
+		std::memcpy(out + sizeof(address), src + sizeof(address), mCommandByteSize - sizeof(address));
+
+		out += mCommandByteSize;
+	}
+}
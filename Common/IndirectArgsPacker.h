@@ -0,0 +1,58 @@
+//***************************************************************************************
+// IndirectArgsPacker.h
+//
+// Writes the indirect draw commands of the visible items of a frame into an argument
+// buffer in one pass.
+//
+// Each item's command is built once, when the item is set, and kept in one contiguous
+// array.  A command starts with a 64-bit GPU address stored relative to a base given at
+// packing time, so the same commands serve every frame resource.  Pack() gathers the
+// commands of a list of items (the culler's output in draw order), copying them 16
+// bytes at a time with XMVECTOR loads and stores and relocating the address.  Writing
+// whole commands in order also suits the write-combined memory upload buffers live in.
+// PackReference() copies one field at a time and is there to check Pack() against.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+class IndirectArgsPacker
+{
+public:
+	// commandByteSize has to be a non-zero multiple of 16.
+	explicit IndirectArgsPacker(std::uint32_t commandByteSize);
+	IndirectArgsPacker(const IndirectArgsPacker& rhs) = delete;
+	IndirectArgsPacker& operator=(const IndirectArgsPacker& rhs) = delete;
+	~IndirectArgsPacker();
+
+	std::uint32_t CommandByteSize()const;
+
+	void Clear();
+
+	// Sets the number of items.  Commands of new items are zero filled.
+	void Resize(std::uint32_t count);
+	std::uint32_t Count()const;
+
+	// Stores the command of the given item.  Its first eight bytes are the address
+	// relative to the base passed to Pack().
+	void Set(std::uint32_t index, const void* command);
+	const void* Command(std::uint32_t index)const;
+
+	// Writes the commands of items order[0], ..., order[count - 1] one after another to
+	// dest, with addressBase added to the address of each.
+	void Pack(const std::uint32_t* order, std::uint32_t count, std::uint64_t addressBase, void* dest)const;
+	void PackReference(const std::uint32_t* order, std::uint32_t count, std::uint64_t addressBase, void* dest)const;
+
+private:
+	std::uint32_t mCommandByteSize = 0;
+	std::uint32_t mCount = 0;
+
+	// In 16 byte units so every command starts 16 byte aligned.
+	struct alignas(16) Block
+	{
+		std::uint32_t Words[4];
+	};
+	std::vector<Block> mCommands;
+};
@@ -0,0 +1,117 @@
+//***************************************************************************************
+// MemoryBudget.cpp
+//***************************************************************************************
+
+#include "MemoryBudget.h"
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+
+MemoryBudget::MemoryBudget()
+{
+	for(int i = 0; i < (int)MemoryCategory::Count; ++i)
+		mCategories[i].Category = (MemoryCategory)i;
+}
+
+MemoryBudget::~MemoryBudget()
+{
+}
+
+void MemoryBudget::Track(const void* key, MemoryCategory category, std::uint64_t bytes)
+{
+	assert(key != nullptr);
+	assert(category != MemoryCategory::Count);
+
+	Untrack(key);
+
+	mAllocations[key] = { category, bytes };
+
+	MemoryCategoryReport& c = mCategories[(int)category];
+	c.Bytes += bytes;
+	c.Allocations++;
+	c.PeakBytes = std::max(c.PeakBytes, c.Bytes);
+}
+
+bool MemoryBudget::Untrack(const void* key)
+{
+	auto it = mAllocations.find(key);
+	if(it == mAllocations.end())
+		return false;
+
+	MemoryCategoryReport& c = mCategories[(int)it->second.Category];
+	c.Bytes -= it->second.Bytes;
+	c.Allocations--;
+
+	mAllocations.erase(it);
+	return true;
+}
+
+bool MemoryBudget::IsTracked(const void* key)const
+{
+	return mAllocations.find(key) != mAllocations.end();
+}
+
+std::uint64_t MemoryBudget::Bytes(MemoryCategory category)const
+{
+	return mCategories[(int)category].Bytes;
+}
+
+std::uint64_t MemoryBudget::TotalBytes()const
+{
+	std::uint64_t total = 0;
+	for(const MemoryCategoryReport& c : mCategories)
+		total += c.Bytes;
+
+	return total;
+}
+
+void MemoryBudget::SetBudget(MemoryCategory category, std::uint64_t bytes)
+{
+	mCategories[(int)category].BudgetBytes = bytes;
+}
+
+bool MemoryBudget::OverBudget(MemoryCategory category)const
+{
+	const MemoryCategoryReport& c = mCategories[(int)category];
+	return c.BudgetBytes != 0 && c.Bytes > c.BudgetBytes;
+}
+
+std::vector<MemoryCategoryReport> MemoryBudget::Report()const
+{
+	return std::vector<MemoryCategoryReport>(std::begin(mCategories), std::end(mCategories));
+}
+
+std::wstring MemoryBudget::FormatReport()const
+{
+	std::wstring text;
+	for(const MemoryCategoryReport& c : mCategories)
+	{
+		text += std::wstring(CategoryName(c.Category)) + L": " + std::to_wstring(c.Bytes / 1024) + L" KB in " +
+			std::to_wstring(c.Allocations) + L" allocations, peak " + std::to_wstring(c.PeakBytes / 1024) + L" KB";
+
+		if(c.BudgetBytes != 0)
+		{
+			text += L", budget " + std::to_wstring(c.BudgetBytes / 1024) + L" KB";
+			if(c.Bytes > c.BudgetBytes)
+				text += L" (over)";
+		}
+
+		text += L"\n";
+	}
+
+	text += L"Total: " + std::to_wstring(TotalBytes() / 1024) + L" KB\n";
+	return text;
+}
+
+const wchar_t* MemoryBudget::CategoryName(MemoryCategory category)
+{
+	switch(category)
+	{
+	case MemoryCategory::GeometryCpu: return L"Geometry (CPU)";
+	case MemoryCategory::GeometryGpu: return L"Geometry (GPU)";
+	case MemoryCategory::Textures:    return L"Textures";
+	case MemoryCategory::Constants:   return L"Constants";
+	case MemoryCategory::Staging:     return L"Staging";
+	default:                          return L"Unknown";
+	}
+}
@@ -0,0 +1,88 @@
+//***************************************************************************************
+// MemoryBudget.h
+//
+// Accounts for the memory held by each subsystem.  Allocations are tracked by a key
+// (usually the address of the object or resource) together with a category and a size,
+// so they can be untracked without remembering either.  Tracking a key again replaces
+// what was recorded for it, which suits resources that get recreated in place.
+//
+// Only the bookkeeping is done here; the caller decides what an allocation is and how
+// big it is.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+enum class MemoryCategory : int
+{
+	// CPU copies of vertex and index data.
+	GeometryCpu = 0,
+
+	// Vertex and index buffers in default heaps.
+	GeometryGpu,
+
+	// Textures and render targets.
+	Textures,
+
+	// Constant buffers.
+	Constants,
+
+	// Upload heaps: initialization uploaders and per-frame dynamic data.
+	Staging,
+
+	Count
+};
+
+struct MemoryCategoryReport
+{
+	MemoryCategory Category = MemoryCategory::GeometryCpu;
+	std::uint64_t Bytes = 0;
+	std::uint64_t PeakBytes = 0;
+	std::uint32_t Allocations = 0;
+
+	// Zero when there is no budget.
+	std::uint64_t BudgetBytes = 0;
+};
+
+class MemoryBudget
+{
+public:
+	MemoryBudget();
+	MemoryBudget(const MemoryBudget& rhs) = delete;
+	MemoryBudget& operator=(const MemoryBudget& rhs) = delete;
+	~MemoryBudget();
+
+	void Track(const void* key, MemoryCategory category, std::uint64_t bytes);
+
+	// Returns false if the key was not tracked.
+	bool Untrack(const void* key);
+	bool IsTracked(const void* key)const;
+
+	std::uint64_t Bytes(MemoryCategory category)const;
+	std::uint64_t TotalBytes()const;
+
+	// A budget of zero means none.
+	void SetBudget(MemoryCategory category, std::uint64_t bytes);
+	bool OverBudget(MemoryCategory category)const;
+
+	std::vector<MemoryCategoryReport> Report()const;
+
+	// One line per category, for the debug output.
+	std::wstring FormatReport()const;
+
+	static const wchar_t* CategoryName(MemoryCategory category);
+
+private:
+	struct Allocation
+	{
+		MemoryCategory Category;
+		std::uint64_t Bytes;
+	};
+
+	std::unordered_map<const void*, Allocation> mAllocations;
+	MemoryCategoryReport mCategories[(int)MemoryCategory::Count];
+};
@@ -0,0 +1,1011 @@
+//***************************************************************************************
+// ReferenceRenderer.cpp
+//***************************************************************************************
+
+#include "ReferenceRenderer.h"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <thread>
+
+using namespace DirectX;
+
+namespace
+{
+	const std::uint32_t VertexBlockSize = 4096;
+	const std::uint32_t TriangleBlockSize = 4096;
+
+	typedef std::chrono::high_resolution_clock Clock;
+
+	double MillisecondsSince(Clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	// Runs fn(0) ... fn(taskCount - 1) on up to threadCount threads, the calling thread
+	// included.  Tasks are handed out one at a time, so uneven tasks balance out.
+	template<typename Fn>
+	void RunTasks(std::uint32_t threadCount, std::uint32_t taskCount, const Fn& fn)
+	{
+		std::atomic<std::uint32_t> next(0);
+		auto worker = [&]()
+		{
+			for(std::uint32_t task = next++; task < taskCount; task = next++)
+				fn(task);
+		};
+
+		std::uint32_t helpers = std::min(threadCount, taskCount);
+		helpers = helpers > 0 ? helpers - 1 : 0;
+
+		std::vector<std::thread> threads;
+		threads.reserve(helpers);
+		for(std::uint32_t i = 0; i < helpers; ++i)
+			threads.emplace_back(worker);
+
+		worker();
+
+		for(auto& t : threads)
+			t.join();
+	}
+
+	const XMFLOAT4X4 Identity4x4(
+		1.0f, 0.0f, 0.0f, 0.0f,
+		0.0f, 1.0f, 0.0f, 0.0f,
+		0.0f, 0.0f, 1.0f, 0.0f,
+		0.0f, 0.0f, 0.0f, 1.0f);
+
+	template<typename T>
+	const T& Attribute(const void* base, std::uint32_t stride, std::uint32_t i)
+	{
+		return *reinterpret_cast<const T*>(reinterpret_cast<const std::uint8_t*>(base) + std::size_t(i)*stride);
+	}
+
+	std::uint32_t VertexIndex(const ReferenceMesh& mesh, std::uint32_t i)
+	{
+		std::uint32_t index = mesh.SixteenBitIndices ?
+			reinterpret_cast<const std::uint16_t*>(mesh.Indices)[mesh.StartIndexLocation + i] :
+			reinterpret_cast<const std::uint32_t*>(mesh.Indices)[mesh.StartIndexLocation + i];
+
+		return index + mesh.BaseVertexLocation;
+	}
+
+	XMVECTOR UnpackColor(std::uint32_t c)
+	{
+		return XMVectorSet(
+			float(c & 0xff), float((c >> 8) & 0xff), float((c >> 16) & 0xff), float(c >> 24)) * (1.0f / 255.0f);
+	}
+
+	std::uint32_t PackColor(const XMFLOAT4& c)
+	{
+		auto channel = [](float x)
+		{
+			return std::uint32_t(std::min(std::max(x, 0.0f), 1.0f)*255.0f + 0.5f);
+		};
+
+		return channel(c.x) | (channel(c.y) << 8) | (channel(c.z) << 16) | (channel(c.w) << 24);
+	}
+
+	// Bilinear filtering with wrap addressing, as gsamAnisotropicWrap at mip 0.
+	XMVECTOR SampleWrap(const ReferenceImage* image, float u, float v)
+	{
+		if(image == nullptr || image->Pixels.empty())
+			return XMVectorSplatOne();
+
+		float x = u*image->Width - 0.5f;
+		float y = v*image->Height - 0.5f;
+		float fx = std::floor(x);
+		float fy = std::floor(y);
+		float tx = x - fx;
+		float ty = y - fy;
+
+		auto wrap = [](float i, std::uint32_t n)
+		{
+			long long m = (long long)i % (long long)n;
+			return std::uint32_t(m < 0 ? m + n : m);
+		};
+
+		std::uint32_t x0 = wrap(fx, image->Width);
+		std::uint32_t y0 = wrap(fy, image->Height);
+		std::uint32_t x1 = (x0 + 1) % image->Width;
+		std::uint32_t y1 = (y0 + 1) % image->Height;
+
+		const std::uint32_t* p = image->Pixels.data();
+		XMVECTOR top = XMVectorLerp(UnpackColor(p[y0*image->Width + x0]), UnpackColor(p[y0*image->Width + x1]), tx);
+		XMVECTOR bottom = XMVectorLerp(UnpackColor(p[y1*image->Width + x0]), UnpackColor(p[y1*image->Width + x1]), tx);
+
+		return XMVectorLerp(top, bottom, ty);
+	}
+
+	//
+	// LightingUtil.hlsl.
+	//
+
+	struct ShadingMaterial
+	{
+		XMVECTOR DiffuseAlbedo;
+		XMVECTOR FresnelR0;
+		float Shininess;
+	};
+
+	float Saturate(float x)
+	{
+		return std::min(std::max(x, 0.0f), 1.0f);
+	}
+
+	float CalcAttenuation(float d, float falloffStart, float falloffEnd)
+	{
+		return Saturate((falloffEnd - d) / (falloffEnd - falloffStart));
+	}
+
+	XMVECTOR SchlickFresnel(FXMVECTOR r0, FXMVECTOR normal, FXMVECTOR lightVec)
+	{
+		float cosIncidentAngle = Saturate(XMVectorGetX(XMVector3Dot(normal, lightVec)));
+
+		float f0 = 1.0f - cosIncidentAngle;
+		return r0 + (XMVectorSplatOne() - r0)*(f0*f0*f0*f0*f0);
+	}
+
+	XMVECTOR BlinnPhong(FXMVECTOR lightStrength, FXMVECTOR lightVec, FXMVECTOR normal, GXMVECTOR toEye,
+		const ShadingMaterial& mat)
+	{
+		const float m = mat.Shininess * 256.0f;
+		XMVECTOR halfVec = XMVector3Normalize(toEye + lightVec);
+
+		float roughnessFactor = (m + 8.0f)*std::pow(std::max(XMVectorGetX(XMVector3Dot(halfVec, normal)), 0.0f), m) / 8.0f;
+		XMVECTOR fresnelFactor = SchlickFresnel(mat.FresnelR0, halfVec, lightVec);
+
+		XMVECTOR specAlbedo = fresnelFactor*roughnessFactor;
+		specAlbedo = specAlbedo / (specAlbedo + XMVectorSplatOne());
+
+		return (mat.DiffuseAlbedo + specAlbedo) * lightStrength;
+	}
+
+	XMVECTOR ComputeDirectionalLight(const ReferenceLight& L, const ShadingMaterial& mat,
+		FXMVECTOR normal, FXMVECTOR toEye)
+	{
+		XMVECTOR lightVec = -XMLoadFloat3(&L.Direction);
+
+		float ndotl = std::max(XMVectorGetX(XMVector3Dot(lightVec, normal)), 0.0f);
+		XMVECTOR lightStrength = XMLoadFloat3(&L.Strength) * ndotl;
+
+		return BlinnPhong(lightStrength, lightVec, normal, toEye, mat);
+	}
+
+	XMVECTOR ComputeLocalLight(const ReferenceLight& L, const ShadingMaterial& mat, FXMVECTOR pos,
+		FXMVECTOR normal, FXMVECTOR toEye, bool spot)
+	{
+		XMVECTOR lightVec = XMLoadFloat3(&L.Position) - pos;
+
+		float d = XMVectorGetX(XMVector3Length(lightVec));
+		if(d > L.FalloffEnd)
+			return XMVectorZero();
+
+		lightVec /= d;
+
+		float ndotl = std::max(XMVectorGetX(XMVector3Dot(lightVec, normal)), 0.0f);
+		XMVECTOR lightStrength = XMLoadFloat3(&L.Strength) * ndotl;
+		lightStrength *= CalcAttenuation(d, L.FalloffStart, L.FalloffEnd);
+
+		if(spot)
+		{
+			float cosAngle = XMVectorGetX(XMVector3Dot(-lightVec, XMLoadFloat3(&L.Direction)));
+			lightStrength *= std::pow(std::max(cosAngle, 0.0f), L.SpotPower);
+		}
+
+		return BlinnPhong(lightStrength, lightVec, normal, toEye, mat);
+	}
+
+	XMVECTOR ComputeLighting(const ReferencePass& pass, const ShadingMaterial& mat,
+		FXMVECTOR pos, FXMVECTOR normal, FXMVECTOR toEye)
+	{
+		XMVECTOR result = XMVectorZero();
+
+		std::uint32_t i = 0;
+		for(; i < pass.NumDirLights; ++i)
+			result += ComputeDirectionalLight(pass.Lights[i], mat, normal, toEye);
+
+		for(; i < pass.NumDirLights + pass.NumPointLights; ++i)
+			result += ComputeLocalLight(pass.Lights[i], mat, pos, normal, toEye, false);
+
+		for(; i < pass.NumDirLights + pass.NumPointLights + pass.NumSpotLights; ++i)
+			result += ComputeLocalLight(pass.Lights[i], mat, pos, normal, toEye, true);
+
+		return XMVectorSetW(result, 0.0f);
+	}
+
+	// Default.hlsl's PS.  Returns false where the pixel is clipped.
+	bool ShadePixel(const ReferencePass& pass, const ReferenceDrawItem& item,
+		const float attributes[8], XMFLOAT4& color)
+	{
+		XMVECTOR diffuseAlbedo = SampleWrap(item.DiffuseMap, attributes[6], attributes[7]) *
+			XMLoadFloat4(&item.DiffuseAlbedo);
+
+		if(item.BlendMode == ReferenceBlendMode::AlphaTested && XMVectorGetW(diffuseAlbedo) - 0.1f < 0.0f)
+			return false;
+
+		XMVECTOR posW = XMVectorSet(attributes[0], attributes[1], attributes[2], 1.0f);
+		XMVECTOR normalW = XMVector3Normalize(XMVectorSet(attributes[3], attributes[4], attributes[5], 0.0f));
+
+		XMVECTOR toEyeW = XMLoadFloat3(&pass.EyePosW) - posW;
+		float distToEye = XMVectorGetX(XMVector3Length(toEyeW));
+		toEyeW /= distToEye;
+
+		XMVECTOR ambient = XMLoadFloat4(&pass.AmbientLight)*diffuseAlbedo;
+
+		ShadingMaterial mat;
+		mat.DiffuseAlbedo = diffuseAlbedo;
+		mat.FresnelR0 = XMLoadFloat3(&item.FresnelR0);
+		mat.Shininess = 1.0f - item.Roughness;
+
+		XMVECTOR litColor = ambient + ComputeLighting(pass, mat, posW, normalW, toEyeW);
+
+		if(pass.Fog)
+		{
+			float fogAmount = Saturate((distToEye - pass.FogStart) / pass.FogRange);
+			litColor = XMVectorLerp(litColor, XMLoadFloat4(&pass.FogColor), fogAmount);
+		}
+
+		litColor = XMVectorSetW(litColor, XMVectorGetW(diffuseAlbedo));
+		XMStoreFloat4(&color, litColor);
+
+		return true;
+	}
+
+	// Twice the signed area of (a, b, p); positive when p is to the right of a->b with
+	// y pointing down, i.e. for clockwise triangles.
+	float EdgeFunction(float ax, float ay, float bx, float by, float px, float py)
+	{
+		return (bx - ax)*(py - ay) - (by - ay)*(px - ax);
+	}
+}
+
+ReferenceDrawItem::ReferenceDrawItem()
+	: World(Identity4x4), TexTransform(Identity4x4), MatTransform(Identity4x4)
+{
+}
+
+ReferenceRenderer::ReferenceRenderer(std::uint32_t width, std::uint32_t height, std::uint32_t threadCount)
+{
+	mThreadCount = threadCount != 0 ? threadCount : std::max(1u, std::thread::hardware_concurrency());
+	Resize(width, height);
+}
+
+ReferenceRenderer::~ReferenceRenderer()
+{
+}
+
+void ReferenceRenderer::Resize(std::uint32_t width, std::uint32_t height)
+{
+	mWidth = std::max(width, 1u);
+	mHeight = std::max(height, 1u);
+	mTilesX = (mWidth + TileSize - 1) / TileSize;
+	mTilesY = (mHeight + TileSize - 1) / TileSize;
+
+	mColor.resize(std::size_t(mWidth)*mHeight);
+	mDepth.resize(std::size_t(mWidth)*mHeight);
+	mTileBins.resize(std::size_t(mTilesX)*mTilesY);
+
+	mImage.Width = mWidth;
+	mImage.Height = mHeight;
+	mImage.Pixels.assign(std::size_t(mWidth)*mHeight, 0);
+}
+
+void ReferenceRenderer::Render(const ReferencePass& pass, const std::vector<ReferenceDrawItem>& items)
+{
+	mStats = ReferenceStats();
+	Clock::time_point frameStart = Clock::now();
+
+	Clock::time_point start = Clock::now();
+	ShadeVertices(pass, items);
+	mStats.VertexMs = MillisecondsSince(start);
+
+	start = Clock::now();
+	SetupTriangles(items);
+	mStats.SetupMs = MillisecondsSince(start);
+
+	start = Clock::now();
+	std::fill(mColor.begin(), mColor.end(), pass.ClearColor);
+	std::fill(mDepth.begin(), mDepth.end(), 1.0f);
+
+	std::vector<TileCounters> counters(mTileBins.size());
+	RunTasks(mThreadCount, (std::uint32_t)mTileBins.size(), [&](std::uint32_t tile)
+	{
+		RasterizeTile(pass, items, tile, counters[tile]);
+	});
+
+	for(const auto& c : counters)
+		mStats.PixelsShaded += c.PixelsShaded;
+	mStats.RasterMs = MillisecondsSince(start);
+
+	start = Clock::now();
+	Resolve();
+	mStats.ResolveMs = MillisecondsSince(start);
+
+	mStats.TotalMs = MillisecondsSince(frameStart);
+}
+
+const ReferenceImage& ReferenceRenderer::Image()const
+{
+	return mImage;
+}
+
+const ReferenceStats& ReferenceRenderer::Stats()const
+{
+	return mStats;
+}
+
+std::uint32_t ReferenceRenderer::ThreadCount()const
+{
+	return mThreadCount;
+}
+
+void ReferenceRenderer::ShadeVertices(const ReferencePass& pass, const std::vector<ReferenceDrawItem>& items)
+{
+	mShaded.resize(items.size());
+	mFirstVertex.assign(items.size(), 0);
+
+	// Only the vertices the indices reach are shaded.
+	struct Block
+	{
+		std::uint32_t Item;
+		std::uint32_t First;
+		std::uint32_t Count;
+	};
+	std::vector<Block> blocks;
+
+	for(std::uint32_t i = 0; i < (std::uint32_t)items.size(); ++i)
+	{
+		const ReferenceMesh& mesh = items[i].Mesh;
+
+		std::uint32_t minIndex = std::numeric_limits<std::uint32_t>::max();
+		std::uint32_t maxIndex = 0;
+		for(std::uint32_t j = 0; j < mesh.IndexCount; ++j)
+		{
+			std::uint32_t index = VertexIndex(mesh, j);
+			minIndex = std::min(minIndex, index);
+			maxIndex = std::max(maxIndex, index);
+		}
+
+		if(mesh.IndexCount == 0)
+		{
+			mShaded[i].clear();
+			continue;
+		}
+
+		assert(maxIndex < mesh.VertexCount);
+
+		mFirstVertex[i] = minIndex;
+		mShaded[i].resize(maxIndex - minIndex + 1);
+
+		for(std::uint32_t first = minIndex; first <= maxIndex; first += VertexBlockSize)
+			blocks.push_back({ i, first, std::min(VertexBlockSize, maxIndex + 1 - first) });
+	}
+
+	XMMATRIX viewProj = XMLoadFloat4x4(&pass.ViewProj);
+
+	RunTasks(mThreadCount, (std::uint32_t)blocks.size(), [&](std::uint32_t b)
+	{
+		const Block& block = blocks[b];
+		const ReferenceDrawItem& item = items[block.Item];
+		const ReferenceMesh& mesh = item.Mesh;
+
+		XMMATRIX world = XMLoadFloat4x4(&item.World);
+		XMMATRIX texTransform = XMLoadFloat4x4(&item.TexTransform) * XMLoadFloat4x4(&item.MatTransform);
+
+		// UvAnimation.hlsl's rotation and scrolling, folded into the texture transform.
+		if(item.UvRotationSpeed != 0.0f)
+		{
+			float angle = std::fmod(item.UvRotationSpeed*pass.TotalTime, XM_2PI);
+			XMMATRIX toCenter = XMMatrixTranslation(-item.UvRotationCenter.x, -item.UvRotationCenter.y, 0.0f);
+			XMMATRIX fromCenter = XMMatrixTranslation(item.UvRotationCenter.x, item.UvRotationCenter.y, 0.0f);
+			texTransform = texTransform * toCenter * XMMatrixRotationZ(angle) * fromCenter;
+		}
+
+		float scrollU = item.UvScrollSpeed.x*pass.TotalTime;
+		float scrollV = item.UvScrollSpeed.y*pass.TotalTime;
+		texTransform = texTransform * XMMatrixTranslation(scrollU - std::floor(scrollU), scrollV - std::floor(scrollV), 0.0f);
+
+		ShadedVertex* out = mShaded[block.Item].data() + (block.First - mFirstVertex[block.Item]);
+		for(std::uint32_t v = block.First; v < block.First + block.Count; ++v, ++out)
+		{
+			XMVECTOR posL = XMLoadFloat3(&Attribute<XMFLOAT3>(mesh.Positions, mesh.PositionStride, v));
+			XMVECTOR normalL = XMLoadFloat3(&Attribute<XMFLOAT3>(mesh.Normals, mesh.NormalStride, v));
+			XMVECTOR texC = XMLoadFloat2(&Attribute<XMFLOAT2>(mesh.TexCoords, mesh.TexCStride, v));
+
+			// Assumes nonuniform scaling, as the shader does.
+			XMVECTOR posW = XMVector3TransformCoord(posL, world);
+			XMStoreFloat3(&out->PosW, posW);
+			XMStoreFloat3(&out->NormalW, XMVector3TransformNormal(normalL, world));
+			XMStoreFloat4(&out->PosH, XMVector4Transform(XMVectorSetW(posW, 1.0f), viewProj));
+			XMStoreFloat2(&out->TexC, XMVector4Transform(XMVectorSet(XMVectorGetX(texC), XMVectorGetY(texC), 0.0f, 1.0f), texTransform));
+		}
+	});
+
+	for(const auto& block : blocks)
+		mStats.VerticesShaded += block.Count;
+}
+
+void ReferenceRenderer::SetupTriangles(const std::vector<ReferenceDrawItem>& items)
+{
+	struct Block
+	{
+		std::uint32_t Item;
+		std::uint32_t FirstTriangle;
+		std::uint32_t Count;
+		std::vector<SetupTriangle> Triangles;
+		std::uint64_t Culled = 0;
+		std::uint64_t Clipped = 0;
+	};
+	std::vector<Block> blocks;
+
+	for(std::uint32_t i = 0; i < (std::uint32_t)items.size(); ++i)
+	{
+		std::uint32_t triangleCount = items[i].Mesh.IndexCount / 3;
+		mStats.TrianglesSubmitted += triangleCount;
+
+		for(std::uint32_t first = 0; first < triangleCount; first += TriangleBlockSize)
+		{
+			Block block;
+			block.Item = i;
+			block.FirstTriangle = first;
+			block.Count = std::min(TriangleBlockSize, triangleCount - first);
+			blocks.push_back(std::move(block));
+		}
+	}
+
+	RunTasks(mThreadCount, (std::uint32_t)blocks.size(), [&](std::uint32_t b)
+	{
+		Block& block = blocks[b];
+		const ReferenceDrawItem& item = items[block.Item];
+		const ReferenceMesh& mesh = item.Mesh;
+		const ShadedVertex* shaded = mShaded[block.Item].data();
+		std::uint32_t firstVertex = mFirstVertex[block.Item];
+
+		for(std::uint32_t t = block.FirstTriangle; t < block.FirstTriangle + block.Count; ++t)
+		{
+			const ShadedVertex* v[3];
+			for(std::uint32_t k = 0; k < 3; ++k)
+				v[k] = &shaded[VertexIndex(mesh, 3*t + k) - firstVertex];
+
+			// Trivially outside one of the frustum planes.
+			bool outside = false;
+			for(std::uint32_t plane = 0; plane < 6 && !outside; ++plane)
+			{
+				outside = true;
+				for(std::uint32_t k = 0; k < 3 && outside; ++k)
+				{
+					const XMFLOAT4& p = v[k]->PosH;
+					float d =
+						plane == 0 ? p.w + p.x :
+						plane == 1 ? p.w - p.x :
+						plane == 2 ? p.w + p.y :
+						plane == 3 ? p.w - p.y :
+						plane == 4 ? p.z : p.w - p.z;
+					outside = d < 0.0f;
+				}
+			}
+
+			if(outside)
+			{
+				++block.Culled;
+				continue;
+			}
+
+			bool crossesNear = v[0]->PosH.z < 0.0f || v[1]->PosH.z < 0.0f || v[2]->PosH.z < 0.0f;
+			if(!crossesNear)
+			{
+				std::size_t before = block.Triangles.size();
+				EmitTriangle(*v[0], *v[1], *v[2], item, block.Item, block.Triangles);
+				if(block.Triangles.size() == before)
+					++block.Culled;
+				continue;
+			}
+
+			// Clip the polygon against z >= 0.  One triangle becomes at most a quad.
+			ShadedVertex polygon[4];
+			std::uint32_t n = 0;
+			for(std::uint32_t k = 0; k < 3; ++k)
+			{
+				const ShadedVertex& a = *v[k];
+				const ShadedVertex& c = *v[(k + 1) % 3];
+
+				if(a.PosH.z >= 0.0f)
+					polygon[n++] = a;
+
+				if((a.PosH.z >= 0.0f) != (c.PosH.z >= 0.0f))
+				{
+					float s = a.PosH.z / (a.PosH.z - c.PosH.z);
+
+					ShadedVertex& out = polygon[n++];
+					XMStoreFloat4(&out.PosH, XMVectorLerp(XMLoadFloat4(&a.PosH), XMLoadFloat4(&c.PosH), s));
+					XMStoreFloat3(&out.PosW, XMVectorLerp(XMLoadFloat3(&a.PosW), XMLoadFloat3(&c.PosW), s));
+					XMStoreFloat3(&out.NormalW, XMVectorLerp(XMLoadFloat3(&a.NormalW), XMLoadFloat3(&c.NormalW), s));
+					XMStoreFloat2(&out.TexC, XMVectorLerp(XMLoadFloat2(&a.TexC), XMLoadFloat2(&c.TexC), s));
+				}
+			}
+
+			++block.Clipped;
+			for(std::uint32_t k = 2; k < n; ++k)
+				EmitTriangle(polygon[0], polygon[k - 1], polygon[k], item, block.Item, block.Triangles);
+		}
+	});
+
+	// Concatenate in submission order and bin.
+	mTriangles.clear();
+	for(auto& bin : mTileBins)
+		bin.clear();
+
+	for(auto& block : blocks)
+	{
+		mStats.TrianglesCulled += block.Culled;
+		mStats.TrianglesClipped += block.Clipped;
+
+		for(const auto& tri : block.Triangles)
+		{
+			std::uint32_t index = (std::uint32_t)mTriangles.size();
+			mTriangles.push_back(tri);
+
+			std::uint32_t tx0 = tri.MinX / TileSize;
+			std::uint32_t ty0 = tri.MinY / TileSize;
+			std::uint32_t tx1 = tri.MaxX / TileSize;
+			std::uint32_t ty1 = tri.MaxY / TileSize;
+
+			for(std::uint32_t ty = ty0; ty <= ty1; ++ty)
+			{
+				for(std::uint32_t tx = tx0; tx <= tx1; ++tx)
+					mTileBins[ty*mTilesX + tx].push_back(index);
+			}
+
+			mStats.TileEntries += (tx1 - tx0 + 1)*(ty1 - ty0 + 1);
+		}
+	}
+
+	mStats.TrianglesRasterized = mTriangles.size();
+}
+
+void ReferenceRenderer::EmitTriangle(const ShadedVertex& a, const ShadedVertex& b, const ShadedVertex& c,
+	const ReferenceDrawItem& item, std::uint32_t itemIndex, std::vector<SetupTriangle>& out)const
+{
+	SetupTriangle tri;
+	tri.Item = itemIndex;
+
+	const ShadedVertex* v[3] = { &a, &b, &c };
+	for(std::uint32_t k = 0; k < 3; ++k)
+	{
+		float invW = 1.0f / v[k]->PosH.w;
+
+		SetupVertex& s = tri.V[k];
+		s.X = (0.5f + 0.5f*v[k]->PosH.x*invW)*mWidth;
+		s.Y = (0.5f - 0.5f*v[k]->PosH.y*invW)*mHeight;
+		s.Z = v[k]->PosH.z*invW;
+		s.InvW = invW;
+
+		const float attributes[8] =
+		{
+			v[k]->PosW.x, v[k]->PosW.y, v[k]->PosW.z,
+			v[k]->NormalW.x, v[k]->NormalW.y, v[k]->NormalW.z,
+			v[k]->TexC.x, v[k]->TexC.y
+		};
+		for(std::uint32_t j = 0; j < 8; ++j)
+			s.Attributes[j] = attributes[j]*invW;
+	}
+
+	// Front faces are clockwise on screen, which is a positive area with y down.
+	float area = EdgeFunction(tri.V[0].X, tri.V[0].Y, tri.V[1].X, tri.V[1].Y, tri.V[2].X, tri.V[2].Y);
+	if(area == 0.0f || (area < 0.0f && item.CullBackFaces))
+		return;
+
+	// Back faces that are drawn get wound the other way, so raster only deals with one.
+	if(area < 0.0f)
+	{
+		std::swap(tri.V[1], tri.V[2]);
+		area = -area;
+	}
+
+	tri.InvArea = 1.0f / area;
+
+	float minX = std::min(std::min(tri.V[0].X, tri.V[1].X), tri.V[2].X);
+	float minY = std::min(std::min(tri.V[0].Y, tri.V[1].Y), tri.V[2].Y);
+	float maxX = std::max(std::max(tri.V[0].X, tri.V[1].X), tri.V[2].X);
+	float maxY = std::max(std::max(tri.V[0].Y, tri.V[1].Y), tri.V[2].Y);
+
+	// Pixels whose centers can be inside.
+	tri.MinX = std::max(0, (int)std::ceil(minX - 0.5f));
+	tri.MinY = std::max(0, (int)std::ceil(minY - 0.5f));
+	tri.MaxX = std::min((int)mWidth - 1, (int)std::floor(maxX - 0.5f));
+	tri.MaxY = std::min((int)mHeight - 1, (int)std::floor(maxY - 0.5f));
+
+	if(tri.MinX > tri.MaxX || tri.MinY > tri.MaxY)
+		return;
+
+	out.push_back(tri);
+}
+
+void ReferenceRenderer::RasterizeTile(const ReferencePass& pass, const std::vector<ReferenceDrawItem>& items,
+	std::uint32_t tile, TileCounters& counters)
+{
+	int tileMinX = int(tile % mTilesX)*TileSize;
+	int tileMinY = int(tile / mTilesX)*TileSize;
+	int tileMaxX = std::min(tileMinX + (int)TileSize, (int)mWidth) - 1;
+	int tileMaxY = std::min(tileMinY + (int)TileSize, (int)mHeight) - 1;
+
+	for(std::uint32_t index : mTileBins[tile])
+	{
+		const SetupTriangle& tri = mTriangles[index];
+		const ReferenceDrawItem& item = items[tri.Item];
+		const SetupVertex& v0 = tri.V[0];
+		const SetupVertex& v1 = tri.V[1];
+		const SetupVertex& v2 = tri.V[2];
+
+		int minX = std::max(tri.MinX, tileMinX);
+		int minY = std::max(tri.MinY, tileMinY);
+		int maxX = std::min(tri.MaxX, tileMaxX);
+		int maxY = std::min(tri.MaxY, tileMaxY);
+
+		// Top-left rule: a pixel center exactly on an edge belongs to the triangle only
+		// if the edge is a top or a left edge.
+		auto isTopLeft = [](const SetupVertex& a, const SetupVertex& b)
+		{
+			float dx = b.X - a.X;
+			float dy = b.Y - a.Y;
+			return (dy == 0.0f && dx > 0.0f) || dy < 0.0f;
+		};
+		const bool topLeft0 = isTopLeft(v1, v2);
+		const bool topLeft1 = isTopLeft(v2, v0);
+		const bool topLeft2 = isTopLeft(v0, v1);
+
+		for(int y = minY; y <= maxY; ++y)
+		{
+			float py = y + 0.5f;
+
+			for(int x = minX; x <= maxX; ++x)
+			{
+				float px = x + 0.5f;
+
+				float w0 = EdgeFunction(v1.X, v1.Y, v2.X, v2.Y, px, py);
+				float w1 = EdgeFunction(v2.X, v2.Y, v0.X, v0.Y, px, py);
+				float w2 = EdgeFunction(v0.X, v0.Y, v1.X, v1.Y, px, py);
+
+				if(w0 < 0.0f || w1 < 0.0f || w2 < 0.0f ||
+				   (w0 == 0.0f && !topLeft0) || (w1 == 0.0f && !topLeft1) || (w2 == 0.0f && !topLeft2))
+				{
+					continue;
+				}
+
+				w0 *= tri.InvArea;
+				w1 *= tri.InvArea;
+				w2 *= tri.InvArea;
+
+				std::size_t pixel = std::size_t(y)*mWidth + x;
+				float z = w0*v0.Z + w1*v1.Z + w2*v2.Z;
+				if(z < 0.0f || z > 1.0f || !(z < mDepth[pixel]))
+					continue;
+
+				float w = 1.0f / (w0*v0.InvW + w1*v1.InvW + w2*v2.InvW);
+				float attributes[8];
+				for(std::uint32_t j = 0; j < 8; ++j)
+					attributes[j] = (w0*v0.Attributes[j] + w1*v1.Attributes[j] + w2*v2.Attributes[j])*w;
+
+				XMFLOAT4 color;
+				if(!ShadePixel(pass, item, attributes, color))
+					continue;
+
+				++counters.PixelsShaded;
+
+				if(item.BlendMode == ReferenceBlendMode::Transparent)
+				{
+					// SRC_ALPHA, INV_SRC_ALPHA for color; ONE, ZERO for alpha.
+					XMFLOAT4& dst = mColor[pixel];
+					float a = color.w;
+					dst.x = color.x*a + dst.x*(1.0f - a);
+					dst.y = color.y*a + dst.y*(1.0f - a);
+					dst.z = color.z*a + dst.z*(1.0f - a);
+					dst.w = a;
+				}
+				else
+				{
+					mColor[pixel] = color;
+				}
+
+				mDepth[pixel] = z;
+			}
+		}
+	}
+}
+
+void ReferenceRenderer::Resolve()
+{
+	RunTasks(mThreadCount, mTilesY, [&](std::uint32_t tileRow)
+	{
+		std::uint32_t firstRow = tileRow*TileSize;
+		std::uint32_t lastRow = std::min(firstRow + TileSize, mHeight);
+
+		for(std::size_t i = std::size_t(firstRow)*mWidth; i < std::size_t(lastRow)*mWidth; ++i)
+		{
+			// The swap chain is presented opaque.
+			mImage.Pixels[i] = PackColor(mColor[i]) | 0xff000000;
+		}
+	});
+}
+
+bool ReferenceRenderer::WriteTga(const std::string& path, const ReferenceImage& image)
+{
+	std::ofstream file(path, std::ios::binary);
+	if(!file)
+		return false;
+
+	std::uint8_t header[18] = {};
+	header[2] = 2; // Uncompressed true color.
+	header[12] = std::uint8_t(image.Width & 0xff);
+	header[13] = std::uint8_t(image.Width >> 8);
+	header[14] = std::uint8_t(image.Height & 0xff);
+	header[15] = std::uint8_t(image.Height >> 8);
+	header[16] = 32;
+	header[17] = 0x28; // 8 alpha bits, top row first.
+	file.write(reinterpret_cast<const char*>(header), sizeof(header));
+
+	std::vector<std::uint8_t> bgra(image.Pixels.size()*4);
+	for(std::size_t i = 0; i < image.Pixels.size(); ++i)
+	{
+		std::uint32_t c = image.Pixels[i];
+		bgra[4*i + 0] = std::uint8_t(c >> 16);
+		bgra[4*i + 1] = std::uint8_t(c >> 8);
+		bgra[4*i + 2] = std::uint8_t(c);
+		bgra[4*i + 3] = std::uint8_t(c >> 24);
+	}
+	file.write(reinterpret_cast<const char*>(bgra.data()), bgra.size());
+
+	return bool(file);
+}
+
+bool ReferenceRenderer::ReadTga(const std::string& path, ReferenceImage& image)
+{
+	std::ifstream file(path, std::ios::binary);
+	if(!file)
+		return false;
+
+	std::uint8_t header[18];
+	if(!file.read(reinterpret_cast<char*>(header), sizeof(header)))
+		return false;
+
+	std::uint32_t bytesPerPixel = header[16] / 8;
+	if(header[1] != 0 || header[2] != 2 || (bytesPerPixel != 3 && bytesPerPixel != 4))
+		return false;
+
+	file.seekg(header[0], std::ios::cur);
+
+	image.Width = header[12] | (header[13] << 8);
+	image.Height = header[14] | (header[15] << 8);
+	image.Pixels.resize(std::size_t(image.Width)*image.Height);
+
+	std::vector<std::uint8_t> data(image.Pixels.size()*bytesPerPixel);
+	if(!file.read(reinterpret_cast<char*>(data.data()), data.size()))
+		return false;
+
+	bool topRowFirst = (header[17] & 0x20) != 0;
+	for(std::uint32_t y = 0; y < image.Height; ++y)
+	{
+		const std::uint8_t* row = data.data() + std::size_t(topRowFirst ? y : image.Height - 1 - y)*image.Width*bytesPerPixel;
+		for(std::uint32_t x = 0; x < image.Width; ++x)
+		{
+			const std::uint8_t* p = row + x*bytesPerPixel;
+			std::uint32_t a = bytesPerPixel == 4 ? p[3] : 0xff;
+			image.Pixels[std::size_t(y)*image.Width + x] = p[2] | (p[1] << 8) | (p[0] << 16) | (a << 24);
+		}
+	}
+
+	return true;
+}
+
+bool ReferenceRenderer::ReadDds(const std::string& path, ReferenceImage& image)
+{
+	std::ifstream file(path, std::ios::binary);
+	if(!file)
+		return false;
+
+	// "DDS ", the DDS_HEADER and, with a "DX10" four character code, DDS_HEADER_DXT10.
+	std::uint8_t header[148];
+	if(!file.read(reinterpret_cast<char*>(header), 128) || std::memcmp(header, "DDS ", 4) != 0)
+		return false;
+
+	auto u32 = [&](std::size_t offset)
+	{
+		return std::uint32_t(header[offset]) | (std::uint32_t(header[offset + 1]) << 8) |
+			(std::uint32_t(header[offset + 2]) << 16) | (std::uint32_t(header[offset + 3]) << 24);
+	};
+
+	std::uint32_t height = u32(12);
+	std::uint32_t width = u32(16);
+	std::uint32_t pixelFlags = u32(80);
+	std::uint32_t bitCount = u32(88);
+	std::uint32_t redMask = u32(92);
+
+	enum class Format { BC1, BC2, BC3, RGBA, BGRA } format;
+	if((pixelFlags & 0x4) != 0) // DDPF_FOURCC
+	{
+		if(std::memcmp(header + 84, "DXT1", 4) == 0)
+			format = Format::BC1;
+		else if(std::memcmp(header + 84, "DXT3", 4) == 0)
+			format = Format::BC2;
+		else if(std::memcmp(header + 84, "DXT5", 4) == 0)
+			format = Format::BC3;
+		else if(std::memcmp(header + 84, "DX10", 4) == 0)
+		{
+			if(!file.read(reinterpret_cast<char*>(header + 128), 20))
+				return false;
+
+			switch(u32(128))
+			{
+			case 71: case 72: format = Format::BC1; break;  // DXGI_FORMAT_BC1_UNORM(_SRGB)
+			case 74: case 75: format = Format::BC2; break;
+			case 77: case 78: format = Format::BC3; break;
+			case 28: case 29: format = Format::RGBA; break; // DXGI_FORMAT_R8G8B8A8_UNORM(_SRGB)
+			case 87: case 91: format = Format::BGRA; break;
+			default: return false;
+			}
+		}
+		else
+			return false;
+	}
+	else if((pixelFlags & 0x40) != 0 && bitCount == 32) // DDPF_RGB
+		format = redMask == 0xff ? Format::RGBA : Format::BGRA;
+	else
+		return false;
+
+	if(width == 0 || height == 0)
+		return false;
+
+	image.Width = width;
+	image.Height = height;
+	image.Pixels.assign(std::size_t(width)*height, 0);
+
+	if(format == Format::RGBA || format == Format::BGRA)
+	{
+		if(!file.read(reinterpret_cast<char*>(image.Pixels.data()), image.Pixels.size()*4))
+			return false;
+
+		if(format == Format::BGRA)
+		{
+			for(std::uint32_t& c : image.Pixels)
+				c = (c & 0xff00ff00) | ((c >> 16) & 0xff) | ((c & 0xff) << 16);
+		}
+		return true;
+	}
+
+	std::uint32_t blocksX = (width + 3) / 4;
+	std::uint32_t blocksY = (height + 3) / 4;
+	std::uint32_t blockSize = format == Format::BC1 ? 8 : 16;
+
+	std::vector<std::uint8_t> data(std::size_t(blocksX)*blocksY*blockSize);
+	if(!file.read(reinterpret_cast<char*>(data.data()), data.size()))
+		return false;
+
+	auto expand565 = [](std::uint32_t c)
+	{
+		std::uint32_t r = (c >> 11) & 0x1f;
+		std::uint32_t g = (c >> 5) & 0x3f;
+		std::uint32_t b = c & 0x1f;
+		return ((r << 3) | (r >> 2)) | (((g << 2) | (g >> 4)) << 8) | (((b << 3) | (b >> 2)) << 16);
+	};
+
+	// Channel by channel a*(3 - t)/3 + b*t/3, or the midpoint for t = -1.
+	auto mix = [](std::uint32_t a, std::uint32_t b, int t)
+	{
+		std::uint32_t c = 0;
+		for(std::uint32_t shift = 0; shift < 24; shift += 8)
+		{
+			std::uint32_t ca = (a >> shift) & 0xff;
+			std::uint32_t cb = (b >> shift) & 0xff;
+			std::uint32_t m = t < 0 ? (ca + cb) / 2 : (ca*(3 - t) + cb*t) / 3;
+			c |= m << shift;
+		}
+		return c;
+	};
+
+	for(std::uint32_t by = 0; by < blocksY; ++by)
+	{
+		for(std::uint32_t bx = 0; bx < blocksX; ++bx)
+		{
+			const std::uint8_t* block = data.data() + (std::size_t(by)*blocksX + bx)*blockSize;
+
+			// Alpha of the sixteen texels, then the BC1 color block after it.
+			std::uint32_t alpha[16];
+			for(int i = 0; i < 16; ++i)
+				alpha[i] = 0xff;
+
+			if(format == Format::BC2)
+			{
+				for(int i = 0; i < 16; ++i)
+					alpha[i] = ((block[i / 2] >> (4*(i & 1))) & 0xf)*17;
+				block += 8;
+			}
+			else if(format == Format::BC3)
+			{
+				std::uint32_t a[8] = { block[0], block[1] };
+				for(int i = 2; i < 8; ++i)
+				{
+					if(a[0] > a[1])
+						a[i] = (a[0]*(8 - i) + a[1]*(i - 1)) / 7;
+					else
+						a[i] = i < 6 ? (a[0]*(6 - i) + a[1]*(i - 1)) / 5 : (i == 6 ? 0 : 255);
+				}
+
+				std::uint64_t bits = 0;
+				for(int i = 0; i < 6; ++i)
+					bits |= std::uint64_t(block[2 + i]) << (8*i);
+				for(int i = 0; i < 16; ++i)
+					alpha[i] = a[(bits >> (3*i)) & 7];
+				block += 8;
+			}
+
+			std::uint32_t c0 = block[0] | (block[1] << 8);
+			std::uint32_t c1 = block[2] | (block[3] << 8);
+			std::uint32_t colors[4] = { expand565(c0), expand565(c1) };
+			bool fourColors = c0 > c1 || format != Format::BC1;
+			colors[2] = fourColors ? mix(colors[0], colors[1], 1) : mix(colors[0], colors[1], -1);
+			colors[3] = fourColors ? mix(colors[0], colors[1], 2) : 0;
+
+			std::uint32_t indices = block[4] | (block[5] << 8) | (block[6] << 16) | (std::uint32_t(block[7]) << 24);
+			for(std::uint32_t i = 0; i < 16; ++i)
+			{
+				std::uint32_t x = bx*4 + (i & 3);
+				std::uint32_t y = by*4 + (i >> 2);
+				if(x >= width || y >= height)
+					continue;
+
+				std::uint32_t index = (indices >> (2*i)) & 3;
+				std::uint32_t a = alpha[i];
+				if(format == Format::BC1 && !fourColors && index == 3)
+					a = 0;
+
+				image.Pixels[std::size_t(y)*width + x] = colors[index] | (a << 24);
+			}
+		}
+	}
+
+	return true;
+}
+
+XMFLOAT4 ReferenceRenderer::Sample(const ReferenceImage& image, const XMFLOAT2& texC)
+{
+	XMFLOAT4 color;
+	XMStoreFloat4(&color, SampleWrap(&image, texC.x, texC.y));
+	return color;
+}
+
+ReferenceImageDiff ReferenceRenderer::Compare(const ReferenceImage& a, const ReferenceImage& b, std::uint32_t tolerance)
+{
+	assert(a.Width == b.Width && a.Height == b.Height);
+
+	ReferenceImageDiff diff;
+	double squaredError = 0.0;
+
+	std::size_t count = std::min(a.Pixels.size(), b.Pixels.size());
+	for(std::size_t i = 0; i < count; ++i)
+	{
+		std::uint32_t pixelMax = 0;
+		for(std::uint32_t shift = 0; shift < 24; shift += 8)
+		{
+			int ca = (a.Pixels[i] >> shift) & 0xff;
+			int cb = (b.Pixels[i] >> shift) & 0xff;
+			std::uint32_t d = (std::uint32_t)std::abs(ca - cb);
+
+			pixelMax = std::max(pixelMax, d);
+			squaredError += double(d)*d;
+		}
+
+		diff.MaxDifference = std::max(diff.MaxDifference, pixelMax);
+		if(pixelMax > tolerance)
+			++diff.DifferentPixels;
+	}
+
+	double mse = count > 0 ? squaredError / (3.0*count) : 0.0;
+	diff.Psnr = mse > 0.0 ? 10.0*std::log10(255.0*255.0 / mse) : std::numeric_limits<double>::infinity();
+
+	return diff;
+}
@@ -0,0 +1,263 @@
+//***************************************************************************************
+// ReferenceRenderer.h
+//
+// Software renderer that draws what the Default.hlsl pipeline would, without a GPU.
+// It produces reference images to compare rendering changes against, and times the
+// scene side of a frame on machines with no D3D12 device.  Tools/ReferenceRender draws
+// the castle with it and checks it against Tests/Golden.
+//
+// A frame goes through four stages, all but binning spread over a pool of threads:
+//   -Vertex: Default.hlsl's vertex shader, in blocks of vertices.
+//   -Setup: near plane clipping, back face culling and perspective division in blocks
+//    of triangles, then binning: every triangle is listed, in submission order, in each TileSize x TileSize tile
+//    of the screen its bounds touch.
+//   -Raster: the tiles are rasterized and shaded independently, with Default.hlsl's
+//    pixel shader, LightingUtil.hlsl lighting and fog.  A tile walks its triangles in
+//    submission order, so blending happens in draw order as on the GPU.
+//   -Resolve: the float color buffer is converted to RGBA8.
+//
+// Only standard C++ and DirectXMath are used.  Textures are sampled bilinearly with
+// wrapping and no mipmaps, so minified textures alias where the GPU would filter.
+//***************************************************************************************
+
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Same layout as Light in d3dUtil.h and LightingUtil.hlsl.
+struct ReferenceLight
+{
+	DirectX::XMFLOAT3 Strength = { 0.5f, 0.5f, 0.5f };
+	float FalloffStart = 1.0f;
+	DirectX::XMFLOAT3 Direction = { 0.0f, -1.0f, 0.0f };
+	float FalloffEnd = 10.0f;
+	DirectX::XMFLOAT3 Position = { 0.0f, 0.0f, 0.0f };
+	float SpotPower = 64.0f;
+};
+
+// Size of the light array in the pass constants.
+const std::uint32_t ReferenceMaxLights = 16;
+
+// The parts of PassConstants the shaders read, and the shader's light counts.
+struct ReferencePass
+{
+	DirectX::XMFLOAT4X4 ViewProj;
+	DirectX::XMFLOAT3 EyePosW = { 0.0f, 0.0f, 0.0f };
+	DirectX::XMFLOAT4 AmbientLight = { 0.0f, 0.0f, 0.0f, 1.0f };
+	float TotalTime = 0.0f;
+
+	bool Fog = true;
+	DirectX::XMFLOAT4 FogColor = { 0.7f, 0.7f, 0.7f, 1.0f };
+	float FogStart = 5.0f;
+	float FogRange = 150.0f;
+
+	// NUM_DIR_LIGHTS, NUM_POINT_LIGHTS and NUM_SPOT_LIGHTS of the shader.
+	ReferenceLight Lights[ReferenceMaxLights];
+	std::uint32_t NumDirLights = 3;
+	std::uint32_t NumPointLights = 0;
+	std::uint32_t NumSpotLights = 0;
+
+	DirectX::XMFLOAT4 ClearColor = { 0.7f, 0.7f, 0.7f, 1.0f };
+};
+
+// Width x Height RGBA8 pixels, red in the low byte, top row first.
+struct ReferenceImage
+{
+	std::uint32_t Width = 0;
+	std::uint32_t Height = 0;
+	std::vector<std::uint32_t> Pixels;
+};
+
+// Indexed triangles.  The attributes are read with their own strides, so they can
+// come from one interleaved vertex buffer or from separate arrays.
+struct ReferenceMesh
+{
+	const void* Positions = nullptr;
+	std::uint32_t PositionStride = 0;
+	const void* Normals = nullptr;
+	std::uint32_t NormalStride = 0;
+	const void* TexCoords = nullptr;
+	std::uint32_t TexCStride = 0;
+	std::uint32_t VertexCount = 0;
+
+	const void* Indices = nullptr;
+	bool SixteenBitIndices = true;
+	std::uint32_t IndexCount = 0;
+	std::uint32_t StartIndexLocation = 0;
+	std::int32_t BaseVertexLocation = 0;
+};
+
+enum class ReferenceBlendMode : int
+{
+	Opaque = 0,
+
+	// Pixels with albedo alpha below 0.1 are discarded, as with ALPHA_TEST.
+	AlphaTested,
+
+	// Source alpha blending, as the "transparent" PSO.
+	Transparent
+};
+
+struct ReferenceDrawItem
+{
+	ReferenceMesh Mesh;
+
+	// ObjectConstants.
+	DirectX::XMFLOAT4X4 World;
+	DirectX::XMFLOAT4X4 TexTransform;
+
+	// MaterialConstants.
+	DirectX::XMFLOAT4 DiffuseAlbedo = { 1.0f, 1.0f, 1.0f, 1.0f };
+	DirectX::XMFLOAT3 FresnelR0 = { 0.01f, 0.01f, 0.01f };
+	float Roughness = 0.25f;
+	DirectX::XMFLOAT4X4 MatTransform;
+
+	// Texture coordinate animation as in UvAnimation.hlsl: after MatTransform, a
+	// rotation about UvRotationCenter, then scrolling.
+	DirectX::XMFLOAT2 UvScrollSpeed = { 0.0f, 0.0f };
+	float UvRotationSpeed = 0.0f;
+	DirectX::XMFLOAT2 UvRotationCenter = { 0.5f, 0.5f };
+
+	// Sampled as gDiffuseMap.  White when null.
+	const ReferenceImage* DiffuseMap = nullptr;
+
+	ReferenceBlendMode BlendMode = ReferenceBlendMode::Opaque;
+	bool CullBackFaces = true;
+
+	ReferenceDrawItem();
+};
+
+struct ReferenceStats
+{
+	// Milliseconds spent in each stage of the last frame.
+	double VertexMs = 0.0;
+	double SetupMs = 0.0;
+	double RasterMs = 0.0;
+	double ResolveMs = 0.0;
+	double TotalMs = 0.0;
+
+	std::uint64_t VerticesShaded = 0;
+	std::uint64_t TrianglesSubmitted = 0;
+
+	// Triangles entirely outside the frustum or facing away.
+	std::uint64_t TrianglesCulled = 0;
+
+	// Triangles that crossed the near plane and were clipped.
+	std::uint64_t TrianglesClipped = 0;
+
+	// Triangles left after setup, and how many tile lists they were put in.
+	std::uint64_t TrianglesRasterized = 0;
+	std::uint64_t TileEntries = 0;
+
+	// Pixels that passed the depth test and were shaded.
+	std::uint64_t PixelsShaded = 0;
+};
+
+struct ReferenceImageDiff
+{
+	// Pixels with a channel that differs by more than the tolerance.
+	std::uint32_t DifferentPixels = 0;
+
+	std::uint32_t MaxDifference = 0;
+
+	// Peak signal to noise ratio over the color channels, infinite for equal images.
+	double Psnr = 0.0;
+};
+
+class ReferenceRenderer
+{
+public:
+	// threadCount 0 uses every hardware thread.
+	ReferenceRenderer(std::uint32_t width, std::uint32_t height, std::uint32_t threadCount = 0);
+	ReferenceRenderer(const ReferenceRenderer& rhs) = delete;
+	ReferenceRenderer& operator=(const ReferenceRenderer& rhs) = delete;
+	~ReferenceRenderer();
+
+	void Resize(std::uint32_t width, std::uint32_t height);
+
+	// Clears to pass.ClearColor and draws the items in order.
+	void Render(const ReferencePass& pass, const std::vector<ReferenceDrawItem>& items);
+
+	const ReferenceImage& Image()const;
+	const ReferenceStats& Stats()const;
+	std::uint32_t ThreadCount()const;
+
+	// Uncompressed 32-bit TGA.  ReadTga also takes 24-bit files.
+	static bool WriteTga(const std::string& path, const ReferenceImage& image);
+	static bool ReadTga(const std::string& path, ReferenceImage& image);
+
+	// Top mip of a BC1, BC2, BC3 or 32-bit RGBA/BGRA DDS file, such as the ones in
+	// Textures, decoded to RGBA8.
+	static bool ReadDds(const std::string& path, ReferenceImage& image);
+
+	// The image at texC, filtered as a diffuse map is.
+	static DirectX::XMFLOAT4 Sample(const ReferenceImage& image, const DirectX::XMFLOAT2& texC);
+
+	// Compares the color channels of two images of the same size.
+	static ReferenceImageDiff Compare(const ReferenceImage& a, const ReferenceImage& b,
+		std::uint32_t tolerance = 0);
+
+	static const std::uint32_t TileSize = 32;
+
+private:
+	// Output of the vertex shader.
+	struct ShadedVertex
+	{
+		DirectX::XMFLOAT4 PosH;
+		DirectX::XMFLOAT3 PosW;
+		DirectX::XMFLOAT3 NormalW;
+		DirectX::XMFLOAT2 TexC;
+	};
+
+	// Screen position, depth, 1/w and the attributes divided by w, for perspective
+	// correct interpolation.
+	struct SetupVertex
+	{
+		float X, Y, Z, InvW;
+		float Attributes[8];
+	};
+
+	struct SetupTriangle
+	{
+		SetupVertex V[3];
+		float InvArea;
+		std::uint32_t Item;
+		int MinX, MinY, MaxX, MaxY;
+	};
+
+	struct TileCounters
+	{
+		std::uint64_t PixelsShaded = 0;
+	};
+
+	void ShadeVertices(const ReferencePass& pass, const std::vector<ReferenceDrawItem>& items);
+	void SetupTriangles(const std::vector<ReferenceDrawItem>& items);
+	void EmitTriangle(const ShadedVertex& a, const ShadedVertex& b, const ShadedVertex& c,
+		const ReferenceDrawItem& item, std::uint32_t itemIndex, std::vector<SetupTriangle>& out)const;
+	void RasterizeTile(const ReferencePass& pass, const std::vector<ReferenceDrawItem>& items,
+		std::uint32_t tile, TileCounters& counters);
+	void Resolve();
+
+	std::uint32_t mWidth = 0;
+	std::uint32_t mHeight = 0;
+	std::uint32_t mTilesX = 0;
+	std::uint32_t mTilesY = 0;
+	std::uint32_t mThreadCount = 1;
+
+	std::vector<DirectX::XMFLOAT4> mColor;
+	std::vector<float> mDepth;
+	ReferenceImage mImage;
+
+	// Per item: shaded vertices from index mFirstVertex[i] on.
+	std::vector<std::vector<ShadedVertex>> mShaded;
+	std::vector<std::uint32_t> mFirstVertex;
+
+	// All triangles of the frame in submission order, and the ones in each tile.
+	std::vector<SetupTriangle> mTriangles;
+	std::vector<std::vector<std::uint32_t>> mTileBins;
+
+	ReferenceStats mStats;
+};
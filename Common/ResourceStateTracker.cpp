@@ -0,0 +1,199 @@
+//***************************************************************************************
+// ResourceStateTracker.cpp
+//***************************************************************************************
+
+#include "ResourceStateTracker.h"
+#include <algorithm>
+#include <cassert>
+
+ResourceStateTracker::ResourceStateTracker()
+{
+}
+
+ResourceStateTracker::~ResourceStateTracker()
+{
+}
+
+void ResourceStateTracker::Register(ID3D12Resource* resource, D3D12_RESOURCE_STATES state, UINT subresourceCount)
+{
+	assert(resource != nullptr);
+	assert(subresourceCount > 0);
+
+	TrackedResource& tracked = mResources[resource];
+	tracked.State = state;
+	tracked.SubresourceCount = subresourceCount;
+	tracked.Subresources.clear();
+}
+
+void ResourceStateTracker::Unregister(ID3D12Resource* resource)
+{
+	mResources.erase(resource);
+
+	// Drop anything still queued for it; the resource may be about to be released.
+	mPending.erase(std::remove_if(mPending.begin(), mPending.end(),
+		[resource](const D3D12_RESOURCE_BARRIER& b) { return b.Transition.pResource == resource; }),
+		mPending.end());
+}
+
+bool ResourceStateTracker::IsRegistered(ID3D12Resource* resource)const
+{
+	return mResources.find(resource) != mResources.end();
+}
+
+D3D12_RESOURCE_STATES ResourceStateTracker::GetState(ID3D12Resource* resource, UINT subresource)const
+{
+	auto it = mResources.find(resource);
+	assert(it != mResources.end() && "Resource is not tracked.");
+
+	const TrackedResource& tracked = it->second;
+	if(tracked.Subresources.empty() || subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES)
+		return tracked.State;
+
+	return tracked.Subresources[subresource];
+}
+
+void ResourceStateTracker::Transition(ID3D12Resource* resource, D3D12_RESOURCE_STATES stateAfter, UINT subresource)
+{
+	auto it = mResources.find(resource);
+	assert(it != mResources.end() && "Register a resource before transitioning it.");
+
+	TrackedResource& tracked = it->second;
+	mFrameStats.Requested++;
+
+	if(subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES)
+	{
+		if(tracked.Subresources.empty())
+		{
+			if(tracked.State == stateAfter)
+			{
+				mFrameStats.Elided++;
+				return;
+			}
+
+			QueueBarrier(resource, subresource, tracked.State, stateAfter);
+		}
+		else
+		{
+			// The subresources are in different states, so a single barrier covering
+			// all of them would be invalid.  Move each one on its own.
+			for(UINT i = 0; i < tracked.SubresourceCount; ++i)
+			{
+				if(tracked.Subresources[i] != stateAfter)
+					QueueBarrier(resource, i, tracked.Subresources[i], stateAfter);
+			}
+
+			tracked.Subresources.clear();
+		}
+
+		tracked.State = stateAfter;
+		return;
+	}
+
+	assert(subresource < tracked.SubresourceCount);
+
+	if(tracked.Subresources.empty())
+	{
+		if(tracked.State == stateAfter)
+		{
+			mFrameStats.Elided++;
+			return;
+		}
+
+		tracked.Subresources.assign(tracked.SubresourceCount, tracked.State);
+	}
+
+	if(tracked.Subresources[subresource] == stateAfter)
+	{
+		mFrameStats.Elided++;
+		return;
+	}
+
+	QueueBarrier(resource, subresource, tracked.Subresources[subresource], stateAfter);
+	tracked.Subresources[subresource] = stateAfter;
+
+	// Go back to a single state once every subresource agrees again.
+	bool uniform = std::all_of(tracked.Subresources.begin(), tracked.Subresources.end(),
+		[stateAfter](D3D12_RESOURCE_STATES s) { return s == stateAfter; });
+	if(uniform)
+	{
+		tracked.State = stateAfter;
+		tracked.Subresources.clear();
+	}
+}
+
+void ResourceStateTracker::QueueBarrier(ID3D12Resource* resource, UINT subresource,
+	D3D12_RESOURCE_STATES before, D3D12_RESOURCE_STATES after)
+{
+	// If this subresource already has a barrier waiting, extend it instead of
+	// queuing a second one.
+	for(auto it = mPending.begin(); it != mPending.end(); ++it)
+	{
+		D3D12_RESOURCE_TRANSITION_BARRIER& t = it->Transition;
+		if(t.pResource != resource || t.Subresource != subresource)
+			continue;
+
+		assert(t.StateAfter == before);
+		mFrameStats.Elided++;
+
+		if(t.StateBefore == after)
+		{
+			// The two transitions cancel out.
+			mFrameStats.Elided++;
+			mPending.erase(it);
+		}
+		else
+		{
+			t.StateAfter = after;
+		}
+
+		return;
+	}
+
+	D3D12_RESOURCE_BARRIER barrier = {};
+	barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+	barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+	barrier.Transition.pResource = resource;
+	barrier.Transition.Subresource = subresource;
+	barrier.Transition.StateBefore = before;
+	barrier.Transition.StateAfter = after;
+	mPending.push_back(barrier);
+}
+
+void ResourceStateTracker::Flush(ID3D12GraphicsCommandList* cmdList)
+{
+	CommandListBarrierSink sink(cmdList);
+	Flush(sink);
+}
+
+void ResourceStateTracker::Flush(ResourceBarrierSink& sink)
+{
+	if(mPending.empty())
+		return;
+
+	sink.ResourceBarrier((UINT)mPending.size(), mPending.data());
+
+	mFrameStats.Submitted += (UINT)mPending.size();
+	mFrameStats.Batches++;
+	mPending.clear();
+}
+
+const std::vector<D3D12_RESOURCE_BARRIER>& ResourceStateTracker::PendingBarriers()const
+{
+	return mPending;
+}
+
+void ResourceStateTracker::BeginFrame()
+{
+	mLastFrameStats = mFrameStats;
+	mFrameStats = ResourceBarrierStats();
+}
+
+const ResourceBarrierStats& ResourceStateTracker::FrameStats()const
+{
+	return mFrameStats;
+}
+
+const ResourceBarrierStats& ResourceStateTracker::LastFrameStats()const
+{
+	return mLastFrameStats;
+}
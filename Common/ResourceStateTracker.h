@@ -0,0 +1,111 @@
+//***************************************************************************************
+// ResourceStateTracker.h
+//
+// Remembers the state each resource (or subresource) was last transitioned to, so callers
+// only have to say which state they need next.  Transitions are queued instead of being
+// recorded immediately:
+//   -A transition to the state the resource is already in is dropped.
+//   -Two queued transitions of the same subresource are folded into one (A->B, B->C
+//    becomes A->C), and dropped entirely if they cancel out.
+//   -Flush() records everything queued with a single ResourceBarrier call, so it should
+//    be called right before the commands that depend on the new states.
+//
+// Barriers are recorded through a ResourceBarrierSink, so the tracker only needs the
+// barrier types of d3d12.h and can be driven without a device.
+//***************************************************************************************
+
+#pragma once
+
+#include <d3d12.h>
+#include <unordered_map>
+#include <vector>
+
+struct ResourceBarrierStats
+{
+	// Transitions asked for.
+	UINT Requested = 0;
+
+	// Transitions that were dropped because they were redundant or cancelled out.
+	UINT Elided = 0;
+
+	// Barriers actually recorded, and the number of ResourceBarrier calls used.
+	UINT Submitted = 0;
+	UINT Batches = 0;
+};
+
+// Where Flush() records the queued barriers.
+class ResourceBarrierSink
+{
+public:
+	virtual ~ResourceBarrierSink() {}
+	virtual void ResourceBarrier(UINT count, const D3D12_RESOURCE_BARRIER* barriers) = 0;
+};
+
+class CommandListBarrierSink : public ResourceBarrierSink
+{
+public:
+	explicit CommandListBarrierSink(ID3D12GraphicsCommandList* cmdList) : mCmdList(cmdList) {}
+
+	void ResourceBarrier(UINT count, const D3D12_RESOURCE_BARRIER* barriers) override
+	{
+		mCmdList->ResourceBarrier(count, barriers);
+	}
+
+private:
+	ID3D12GraphicsCommandList* mCmdList;
+};
+
+class ResourceStateTracker
+{
+public:
+	ResourceStateTracker();
+	ResourceStateTracker(const ResourceStateTracker& rhs) = delete;
+	ResourceStateTracker& operator=(const ResourceStateTracker& rhs) = delete;
+	~ResourceStateTracker();
+
+	// Starts tracking a resource that is currently in the given state.  Registering a
+	// resource again overwrites what was known about it.
+	void Register(ID3D12Resource* resource, D3D12_RESOURCE_STATES state, UINT subresourceCount = 1);
+	void Unregister(ID3D12Resource* resource);
+	bool IsRegistered(ID3D12Resource* resource)const;
+
+	// The state the resource will be in once the queued barriers are flushed.
+	D3D12_RESOURCE_STATES GetState(ID3D12Resource* resource,
+		UINT subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES)const;
+
+	void Transition(ID3D12Resource* resource, D3D12_RESOURCE_STATES stateAfter,
+		UINT subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES);
+
+	// Records all queued barriers into the command list, or into the sink.
+	void Flush(ID3D12GraphicsCommandList* cmdList);
+	void Flush(ResourceBarrierSink& sink);
+
+	const std::vector<D3D12_RESOURCE_BARRIER>& PendingBarriers()const;
+
+	// Stats are accumulated per frame; BeginFrame() moves the running totals into
+	// LastFrameStats() and starts counting again.
+	void BeginFrame();
+	const ResourceBarrierStats& FrameStats()const;
+	const ResourceBarrierStats& LastFrameStats()const;
+
+private:
+	struct TrackedResource
+	{
+		// State shared by every subresource while Subresources is empty.
+		D3D12_RESOURCE_STATES State = D3D12_RESOURCE_STATE_COMMON;
+		UINT SubresourceCount = 1;
+
+		// Per-subresource states, only filled in once subresources diverge.
+		std::vector<D3D12_RESOURCE_STATES> Subresources;
+	};
+
+	void QueueBarrier(ID3D12Resource* resource, UINT subresource,
+		D3D12_RESOURCE_STATES before, D3D12_RESOURCE_STATES after);
+
+private:
+	std::unordered_map<ID3D12Resource*, TrackedResource> mResources;
+	std::vector<D3D12_RESOURCE_BARRIER> mPending;
+
+	ResourceBarrierStats mFrameStats;
+	ResourceBarrierStats mLastFrameStats;
+};
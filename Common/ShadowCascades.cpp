@@ -0,0 +1,291 @@
+//***************************************************************************************
+// ShadowCascades.cpp
+//***************************************************************************************
+
+#include "ShadowCascades.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	// Radius given to padding slots.  Large enough that no box can make up for it.
+	const float PaddingRadius = -1.0e30f;
+}
+
+ShadowCascades::ShadowCascades(const ShadowCascadeSettings& settings)
+{
+	assert(settings.CascadeCount >= 1 && settings.CascadeCount <= MaxCascades);
+	assert(settings.Lambda >= 0.0f && settings.Lambda <= 1.0f);
+	assert(settings.MapSize > 2 && settings.CasterDistance >= 0.0f);
+
+	mSettings = settings;
+
+	for(int i = 0; i < 3; ++i)
+		mLightAxes[i] = XMFLOAT3(0.0f, 0.0f, 0.0f);
+
+	for(int i = 0; i < MaxCascades; ++i)
+	{
+		XMStoreFloat4x4(&mCascades[i].LightView, XMMatrixIdentity());
+		XMStoreFloat4x4(&mCascades[i].LightProj, XMMatrixIdentity());
+		XMStoreFloat4x4(&mCascades[i].LightViewProj, XMMatrixIdentity());
+
+		mBoxX[i] = 0.0f;
+		mBoxY[i] = 0.0f;
+		mBoxHalfWidth[i] = 0.0f;
+		mBoxMinZ[i] = 0.0f;
+		mBoxMaxZ[i] = 0.0f;
+	}
+}
+
+const ShadowCascadeSettings& ShadowCascades::Settings()const
+{
+	return mSettings;
+}
+
+void ShadowCascades::ComputeSplits(float nearZ, float farZ, int count, float lambda, float* splits)
+{
+	assert(nearZ > 0.0f && farZ > nearZ && count >= 1);
+
+	splits[0] = nearZ;
+	for(int i = 1; i < count; ++i)
+	{
+		float t = (float)i / count;
+		float uniform = nearZ + (farZ - nearZ)*t;
+		float logarithmic = nearZ*std::pow(farZ / nearZ, t);
+
+		splits[i] = uniform + (logarithmic - uniform)*lambda;
+	}
+	splits[count] = farZ;
+}
+
+void ShadowCascades::Fit(FXMMATRIX view, float fovY, float aspect, float nearZ, float farZ,
+	const XMFLOAT3& lightDirection)
+{
+	int count = mSettings.CascadeCount;
+
+	float shadowFar = farZ;
+	if(mSettings.MaxDistance > 0.0f)
+		shadowFar = std::min(farZ, std::max(mSettings.MaxDistance, 2.0f*nearZ));
+
+	float splits[MaxCascades + 1];
+	ComputeSplits(nearZ, shadowFar, count, mSettings.Lambda, splits);
+
+	// The inverse view matrix's rows are the camera's axes and position in world space.
+	XMVECTOR det = XMMatrixDeterminant(view);
+	XMMATRIX invView = XMMatrixInverse(&det, view);
+	XMVECTOR eye = invView.r[3];
+	XMVECTOR look = XMVector3Normalize(invView.r[2]);
+
+	// A point at depth d on the edge of the frustum is sqrt(k)*d off the view axis.
+	float tanHalfFov = std::tan(0.5f*fovY);
+	float k = tanHalfFov*tanHalfFov*(1.0f + aspect*aspect);
+
+	XMVECTOR dir = XMVector3Normalize(XMLoadFloat3(&lightDirection));
+	XMVECTOR up = XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+	if(std::fabs(XMVectorGetX(XMVector3Dot(dir, up))) > 0.99f)
+		up = XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f);
+
+	XMMATRIX lightRotation = XMMatrixLookToLH(XMVectorZero(), dir, up);
+
+	// lightRotation maps world to light space, so its columns are the light's axes.
+	XMMATRIX axes = XMMatrixTranspose(lightRotation);
+	for(int i = 0; i < 3; ++i)
+		XMStoreFloat3(&mLightAxes[i], axes.r[i]);
+
+	float mapSize = (float)mSettings.MapSize;
+
+	for(int i = 0; i < count; ++i)
+	{
+		ShadowCascade& cascade = mCascades[i];
+
+		float n = splits[i];
+		float f = splits[i + 1];
+
+		// The point on the view axis as far from the near corners as from the far ones,
+		// unless that is beyond the slice, in which case the far cap's center.
+		float c = std::min(0.5f*(n + f)*(1.0f + k), f);
+		float radius = std::max(std::sqrt((c - n)*(c - n) + k*n*n), std::sqrt((f - c)*(f - c) + k*f*f));
+
+		// One texel of margin, so the slice still fits once the center has been snapped.
+		radius *= mapSize / (mapSize - 2.0f);
+		float texel = 2.0f*radius / mapSize;
+
+		XMVECTOR center = XMVectorMultiplyAdd(XMVectorReplicate(c), look, eye);
+		center = XMVectorSetW(center, 1.0f);
+
+		XMFLOAT3 lightCenter;
+		XMStoreFloat3(&lightCenter, XMVector3TransformCoord(center, lightRotation));
+		lightCenter.x = std::floor(lightCenter.x / texel + 0.5f)*texel;
+		lightCenter.y = std::floor(lightCenter.y / texel + 0.5f)*texel;
+
+		XMVECTOR snapped = XMVector3TransformNormal(XMLoadFloat3(&lightCenter), axes);
+
+		// The light's eye sits CasterDistance past the sphere so casters in between are
+		// drawn into the map.
+		float eyeZ = lightCenter.z - radius - mSettings.CasterDistance;
+		XMMATRIX lightView = lightRotation*XMMatrixTranslation(-lightCenter.x, -lightCenter.y, -eyeZ);
+		XMMATRIX lightProj = XMMatrixOrthographicLH(2.0f*radius, 2.0f*radius, 0.0f,
+			2.0f*radius + mSettings.CasterDistance);
+
+		cascade.SplitNear = n;
+		cascade.SplitFar = f;
+		XMStoreFloat3(&cascade.Bounds.Center, snapped);
+		cascade.Bounds.Radius = radius;
+		cascade.TexelSize = texel;
+		XMStoreFloat4x4(&cascade.LightView, lightView);
+		XMStoreFloat4x4(&cascade.LightProj, lightProj);
+		XMStoreFloat4x4(&cascade.LightViewProj, lightView*lightProj);
+
+		mBoxX[i] = lightCenter.x;
+		mBoxY[i] = lightCenter.y;
+		mBoxHalfWidth[i] = radius;
+		mBoxMinZ[i] = eyeZ;
+		mBoxMaxZ[i] = lightCenter.z + radius;
+	}
+}
+
+int ShadowCascades::CascadeCount()const
+{
+	return mSettings.CascadeCount;
+}
+
+const ShadowCascade& ShadowCascades::Cascade(int i)const
+{
+	assert(i >= 0 && i < mSettings.CascadeCount);
+	return mCascades[i];
+}
+
+void ShadowCascades::ClearCasters()
+{
+	mCenterX.clear();
+	mCenterY.clear();
+	mCenterZ.clear();
+	mRadius.clear();
+	mCasterCount = 0;
+}
+
+std::uint32_t ShadowCascades::AddCaster(const BoundingSphere& sphere)
+{
+	std::uint32_t index = mCasterCount++;
+
+	if(index % 4 == 0)
+	{
+		mCenterX.resize(index + 4, 0.0f);
+		mCenterY.resize(index + 4, 0.0f);
+		mCenterZ.resize(index + 4, 0.0f);
+		mRadius.resize(index + 4, PaddingRadius);
+	}
+
+	SetCaster(index, sphere);
+	return index;
+}
+
+void ShadowCascades::SetCaster(std::uint32_t index, const BoundingSphere& sphere)
+{
+	assert(index < mCasterCount);
+
+	mCenterX[index] = sphere.Center.x;
+	mCenterY[index] = sphere.Center.y;
+	mCenterZ[index] = sphere.Center.z;
+	mRadius[index] = sphere.Radius;
+}
+
+std::uint32_t ShadowCascades::CasterCount()const
+{
+	return mCasterCount;
+}
+
+void ShadowCascades::Cull(std::vector<std::vector<std::uint32_t>>& visible)const
+{
+	int count = mSettings.CascadeCount;
+	visible.resize(count);
+
+	XMVECTOR axisX[3], axisY[3], axisZ[3];
+	for(int a = 0; a < 3; ++a)
+	{
+		axisX[a] = XMVectorReplicate(mLightAxes[a].x);
+		axisY[a] = XMVectorReplicate(mLightAxes[a].y);
+		axisZ[a] = XMVectorReplicate(mLightAxes[a].z);
+	}
+
+	XMVECTOR boxX[MaxCascades], boxY[MaxCascades], halfWidth[MaxCascades];
+	XMVECTOR minZ[MaxCascades], maxZ[MaxCascades];
+	for(int i = 0; i < count; ++i)
+	{
+		boxX[i] = XMVectorReplicate(mBoxX[i]);
+		boxY[i] = XMVectorReplicate(mBoxY[i]);
+		halfWidth[i] = XMVectorReplicate(mBoxHalfWidth[i]);
+		minZ[i] = XMVectorReplicate(mBoxMinZ[i]);
+		maxZ[i] = XMVectorReplicate(mBoxMaxZ[i]);
+	}
+
+	for(std::uint32_t base = 0; base < mCasterCount; base += 4)
+	{
+		XMVECTOR x = XMLoadFloat4((const XMFLOAT4*)&mCenterX[base]);
+		XMVECTOR y = XMLoadFloat4((const XMFLOAT4*)&mCenterY[base]);
+		XMVECTOR z = XMLoadFloat4((const XMFLOAT4*)&mCenterZ[base]);
+		XMVECTOR r = XMLoadFloat4((const XMFLOAT4*)&mRadius[base]);
+
+		// Into light space once, for every cascade.
+		XMVECTOR light[3];
+		for(int a = 0; a < 3; ++a)
+		{
+			XMVECTOR d = XMVectorMultiply(x, axisX[a]);
+			d = XMVectorMultiplyAdd(y, axisY[a], d);
+			light[a] = XMVectorMultiplyAdd(z, axisZ[a], d);
+		}
+
+		for(int i = 0; i < count; ++i)
+		{
+			XMVECTOR reach = XMVectorAdd(halfWidth[i], r);
+
+			XMVECTOR inside = XMVectorLessOrEqual(XMVectorAbs(XMVectorSubtract(light[0], boxX[i])), reach);
+			inside = XMVectorAndInt(inside, XMVectorLessOrEqual(XMVectorAbs(XMVectorSubtract(light[1], boxY[i])), reach));
+			inside = XMVectorAndInt(inside, XMVectorGreaterOrEqual(XMVectorAdd(light[2], r), minZ[i]));
+			inside = XMVectorAndInt(inside, XMVectorLessOrEqual(XMVectorSubtract(light[2], r), maxZ[i]));
+
+			XMUINT4 mask;
+			XMStoreUInt4(&mask, inside);
+
+			const std::uint32_t lanes[4] = { mask.x, mask.y, mask.z, mask.w };
+			for(std::uint32_t j = 0; j < 4 && base + j < mCasterCount; ++j)
+			{
+				if(lanes[j] != 0)
+					visible[i].push_back(base + j);
+			}
+		}
+	}
+}
+
+void ShadowCascades::CullReference(std::vector<std::vector<std::uint32_t>>& visible)const
+{
+	int count = mSettings.CascadeCount;
+	visible.resize(count);
+
+	for(std::uint32_t c = 0; c < mCasterCount; ++c)
+	{
+		float light[3];
+		for(int a = 0; a < 3; ++a)
+		{
+			light[a] = mCenterX[c]*mLightAxes[a].x + mCenterY[c]*mLightAxes[a].y +
+				mCenterZ[c]*mLightAxes[a].z;
+		}
+
+		float r = mRadius[c];
+		for(int i = 0; i < count; ++i)
+		{
+			float reach = mBoxHalfWidth[i] + r;
+
+			if(std::fabs(light[0] - mBoxX[i]) <= reach &&
+				std::fabs(light[1] - mBoxY[i]) <= reach &&
+				light[2] + r >= mBoxMinZ[i] &&
+				light[2] - r <= mBoxMaxZ[i])
+			{
+				visible[i].push_back(c);
+			}
+		}
+	}
+}
@@ -0,0 +1,122 @@
+//***************************************************************************************
+// ShadowCascades.h
+//
+// The CPU side of cascaded shadow maps for one directional light.
+//
+// The view frustum is split in depth with the practical split scheme: each split is
+// Lambda of the way from the uniform split to the logarithmic one.  Every slice is
+// enclosed in a sphere, whose size only depends on the projection, so a cascade does
+// not change size as the camera turns.  The sphere's center is snapped to whole shadow
+// map texels in light space, so shadow edges do not crawl as the camera moves.
+//
+// Shadow casters are world space bounding spheres kept in structure-of-arrays form.
+// Cull() rotates four of them at a time into light space and tests them against the
+// box of every cascade, which is open towards the light up to CasterDistance so casters
+// outside a slice that shadow it are kept.  CullReference() does the same one sphere at
+// a time and is there to check the vector path against.
+//
+// Nothing here needs a device, so fitting and culling can be run and timed on their own.
+//***************************************************************************************
+
+#pragma once
+
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+#include <cstdint>
+#include <vector>
+
+struct ShadowCascadeSettings
+{
+	int CascadeCount = 4;
+
+	// 0 splits the depth range uniformly, 1 logarithmically.
+	float Lambda = 0.75f;
+
+	// Width and height in texels of each cascade's shadow map.
+	int MapSize = 2048;
+
+	// How far towards the light from a cascade's sphere casters are still drawn into it.
+	float CasterDistance = 100.0f;
+
+	// Shadows end this far from the eye, or at the far plane if that is closer or this
+	// is 0.
+	float MaxDistance = 0.0f;
+};
+
+struct ShadowCascade
+{
+	// View space depths the cascade covers.
+	float SplitNear = 0.0f;
+	float SplitFar = 0.0f;
+
+	// World space sphere the shadow map covers, around the snapped center.
+	DirectX::BoundingSphere Bounds;
+
+	// World units per shadow map texel.
+	float TexelSize = 0.0f;
+
+	DirectX::XMFLOAT4X4 LightView;
+	DirectX::XMFLOAT4X4 LightProj;
+	DirectX::XMFLOAT4X4 LightViewProj;
+};
+
+class ShadowCascades
+{
+public:
+	ShadowCascades(const ShadowCascadeSettings& settings = ShadowCascadeSettings());
+	ShadowCascades(const ShadowCascades& rhs) = delete;
+	ShadowCascades& operator=(const ShadowCascades& rhs) = delete;
+
+	static const int MaxCascades = 4;
+
+	const ShadowCascadeSettings& Settings()const;
+
+	// Depths of the count + 1 split planes from nearZ to farZ, into splits.
+	static void ComputeSplits(float nearZ, float farZ, int count, float lambda, float* splits);
+
+	// Fits the cascades to a camera with the given view matrix and perspective
+	// projection, for a light shining along lightDirection.
+	void Fit(DirectX::FXMMATRIX view, float fovY, float aspect, float nearZ, float farZ,
+		const DirectX::XMFLOAT3& lightDirection);
+
+	int CascadeCount()const;
+	const ShadowCascade& Cascade(int i)const;
+
+	void ClearCasters();
+
+	// Returns the index the caster was stored at.
+	std::uint32_t AddCaster(const DirectX::BoundingSphere& sphere);
+	void SetCaster(std::uint32_t index, const DirectX::BoundingSphere& sphere);
+
+	std::uint32_t CasterCount()const;
+
+	// Resizes visible to CascadeCount() lists and appends to list i the indices of the
+	// casters that can shadow cascade i, in increasing order.  Uses the last Fit.
+	void Cull(std::vector<std::vector<std::uint32_t>>& visible)const;
+	void CullReference(std::vector<std::vector<std::uint32_t>>& visible)const;
+
+private:
+	ShadowCascadeSettings mSettings;
+
+	ShadowCascade mCascades[MaxCascades];
+
+	// Light space axes as rows: x and y across the shadow map, z along the light.
+	DirectX::XMFLOAT3 mLightAxes[3];
+
+	// Each cascade's box in light space, for culling: its center across the map, its
+	// half width, and the depths it spans along the light including CasterDistance.
+	float mBoxX[MaxCascades];
+	float mBoxY[MaxCascades];
+	float mBoxHalfWidth[MaxCascades];
+	float mBoxMinZ[MaxCascades];
+	float mBoxMaxZ[MaxCascades];
+
+	// Padded to a multiple of four; padding casters have a negative radius so they are
+	// never reported.
+	std::vector<float> mCenterX;
+	std::vector<float> mCenterY;
+	std::vector<float> mCenterZ;
+	std::vector<float> mRadius;
+
+	std::uint32_t mCasterCount = 0;
+};
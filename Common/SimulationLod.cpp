@@ -0,0 +1,179 @@
+//***************************************************************************************
+// SimulationLod.cpp
+//***************************************************************************************
+
+#include "SimulationLod.h"
+#include "FrustumCuller.h"
+#include <algorithm>
+#include <cassert>
+
+using namespace DirectX;
+
+SimulationLod::SimulationLod(float timeStep, int uploadCopies, const SimulationLodSettings& settings)
+{
+	assert(timeStep > 0.0f);
+	assert(uploadCopies > 0);
+	assert(settings.DistantInterval > 0 && settings.HiddenInterval >= 0);
+	assert(settings.MaxCatchUpSteps > 0);
+	assert(settings.MaxLag >= 0.0f);
+
+	mSettings = settings;
+	mTimeStep = timeStep;
+	mUploadCopies = uploadCopies;
+	mPendingUploads = uploadCopies;
+}
+
+const SimulationLodSettings& SimulationLod::Settings()const
+{
+	return mSettings;
+}
+
+float SimulationLod::TimeStep()const
+{
+	return mTimeStep;
+}
+
+SimulationLodLevel SimulationLod::Classify(const BoundingSphere& bounds, FXMMATRIX view, CXMMATRIX proj)const
+{
+	XMFLOAT4 planes[6];
+	FrustumCuller::ExtractPlanes(XMMatrixMultiply(view, proj), planes);
+
+	XMVECTOR center = XMVectorSet(bounds.Center.x, bounds.Center.y, bounds.Center.z, 1.0f);
+	for(int i = 0; i < 6; ++i)
+	{
+		float distance = XMVectorGetX(XMVector4Dot(XMLoadFloat4(&planes[i]), center));
+		if(distance < -bounds.Radius)
+			return SimulationLodLevel::Hidden;
+	}
+
+	if(ScreenFraction(bounds, view, proj) < mSettings.MinScreenFraction)
+		return SimulationLodLevel::Distant;
+
+	return SimulationLodLevel::Full;
+}
+
+float SimulationLod::ScreenFraction(const BoundingSphere& bounds, FXMMATRIX view, CXMMATRIX proj)
+{
+	XMVECTOR center = XMVector3TransformCoord(XMLoadFloat3(&bounds.Center), view);
+
+	// Spheres reaching past the eye plane cover most of the screen.
+	float z = XMVectorGetZ(center);
+	if(z <= bounds.Radius)
+		return 1.0f;
+
+	// The projection scales view space y by proj(1, 1) and divides by z.  Clip space
+	// spans 2 over the height of the viewport.
+	XMFLOAT4X4 p;
+	XMStoreFloat4x4(&p, proj);
+	return std::min(bounds.Radius*p(1, 1) / z, 1.0f);
+}
+
+int SimulationLod::Advance(float dt, SimulationLodLevel level)
+{
+	assert(dt >= 0.0f);
+
+	const SimulationLodSettings& s = mSettings;
+
+	mStats.Level = level;
+	++mStats.Frames;
+
+	mLag += dt;
+	mSinceStep += dt;
+
+	mDueFraction += dt / mTimeStep;
+	std::uint64_t due = (std::uint64_t)mDueFraction;
+	mDueFraction -= due;
+	mStats.StepsDue += due;
+
+	int steps = 0;
+	if(level == SimulationLodLevel::Full)
+	{
+		steps = std::min((int)(mLag / mTimeStep), s.MaxCatchUpSteps);
+	}
+	else
+	{
+		int interval = level == SimulationLodLevel::Distant ? s.DistantInterval : s.HiddenInterval;
+		if(interval > 0 && mSinceStep >= interval*mTimeStep && mLag >= mTimeStep)
+			steps = 1;
+	}
+
+	if(steps > 0)
+	{
+		mLag -= steps*mTimeStep;
+		mSinceStep = 0.0f;
+		mPendingUploads = mUploadCopies;
+
+		mStats.StepsTaken += steps;
+		mStats.CatchUpSteps += steps - 1;
+	}
+
+	// Give up on what is owed beyond MaxLag.
+	if(mLag > s.MaxLag)
+	{
+		mDroppedFraction += (mLag - s.MaxLag) / mTimeStep;
+		mLag = s.MaxLag;
+
+		std::uint64_t dropped = (std::uint64_t)mDroppedFraction;
+		mDroppedFraction -= dropped;
+		mStats.StepsDropped += dropped;
+		mStats.SavedMs += dropped*mStats.StepMs;
+	}
+
+	if(dt > 0.0f)
+		mStats.Rate += s.Smoothing*(steps*mTimeStep / dt - mStats.Rate);
+	mStats.Lag = mLag;
+
+	return steps;
+}
+
+bool SimulationLod::UploadDue()
+{
+	if(mStats.Level == SimulationLodLevel::Hidden || mPendingUploads == 0)
+	{
+		++mStats.UploadsSkipped;
+		return false;
+	}
+
+	--mPendingUploads;
+	return true;
+}
+
+void SimulationLod::InvalidateUploads()
+{
+	mPendingUploads = mUploadCopies;
+}
+
+void SimulationLod::InvalidateUploads(int uploadCopies)
+{
+	assert(uploadCopies > 0);
+	mUploadCopies = uploadCopies;
+	mPendingUploads = uploadCopies;
+}
+
+void SimulationLod::AddStepTime(double milliseconds, int steps)
+{
+	if(steps <= 0)
+		return;
+
+	double perStep = milliseconds / steps;
+	if(mStats.StepMs == 0.0)
+		mStats.StepMs = perStep;
+	else
+		mStats.StepMs += mSettings.Smoothing*(perStep - mStats.StepMs);
+}
+
+const SimulationLodStats& SimulationLod::Stats()const
+{
+	return mStats;
+}
+
+void SimulationLod::ResetStats()
+{
+	// Keep what describes the body now, and start the counts again.
+	SimulationLodStats stats;
+	stats.Level = mStats.Level;
+	stats.Rate = mStats.Rate;
+	stats.Lag = mStats.Lag;
+	stats.StepMs = mStats.StepMs;
+	mStats = stats;
+}
@@ -0,0 +1,140 @@
+//***************************************************************************************
+// SimulationLod.h
+//
+// Decides how often a fixed step simulation, such as a body of water, steps and when its
+// results are uploaded, from how much of it the camera can see:
+//   -Full: on screen and at least MinScreenFraction of the viewport tall.  It steps as
+//    often as real time asks for.
+//   -Distant: on screen but smaller.  It takes one step per DistantInterval steps' worth
+//    of time.
+//   -Hidden: outside the frustum.  It takes one step per HiddenInterval, or none if that
+//    is 0, and nothing is uploaded.
+//
+// Time that is not simulated is owed.  Once the body is back at Full it is caught up with
+// at most MaxCatchUpSteps steps a frame.  No more than MaxLag seconds are owed; anything
+// beyond is dropped, and those dropped steps are the time the policy saves.
+//
+// The caller takes the steps, times them and uploads, so the policy can be driven by
+// recorded camera paths without a simulation.
+//***************************************************************************************
+
+#pragma once
+
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+#include <cstdint>
+
+enum class SimulationLodLevel : int
+{
+	Full = 0,
+	Distant,
+	Hidden
+};
+
+struct SimulationLodSettings
+{
+	// Height of the body's bounding sphere on screen, as a fraction of the viewport height,
+	// below which it is Distant.
+	float MinScreenFraction = 0.1f;
+
+	// A Distant or Hidden body takes one step per this many steps' worth of time.  A
+	// Hidden interval of 0 freezes the body.
+	int DistantInterval = 4;
+	int HiddenInterval = 16;
+
+	// Most steps a Full body takes in one frame while it catches up.
+	int MaxCatchUpSteps = 4;
+
+	// Most seconds the body may fall behind real time.
+	float MaxLag = 0.5f;
+
+	// Weight of the newest frame in the smoothed step rate and step cost.
+	float Smoothing = 0.05f;
+};
+
+struct SimulationLodStats
+{
+	SimulationLodLevel Level = SimulationLodLevel::Full;
+
+	// Steps taken per step real time asked for, smoothed over recent frames.
+	float Rate = 1.0f;
+
+	// Seconds the body is behind real time.
+	float Lag = 0.0f;
+
+	std::uint64_t Frames = 0;
+
+	// Steps taken, of them the ones beyond the first in a frame made to catch up, and the
+	// steps real time asked for.
+	std::uint64_t StepsTaken = 0;
+	std::uint64_t CatchUpSteps = 0;
+	std::uint64_t StepsDue = 0;
+
+	// Steps given up because the body was further than MaxLag behind.
+	std::uint64_t StepsDropped = 0;
+
+	// Frames in which nothing was uploaded.
+	std::uint64_t UploadsSkipped = 0;
+
+	// Smoothed milliseconds per step, and the milliseconds the dropped steps would have
+	// cost at that rate.
+	double StepMs = 0.0;
+	double SavedMs = 0.0;
+};
+
+class SimulationLod
+{
+public:
+	// The simulation's render data is kept in uploadCopies buffers, such as one per frame
+	// resource, each of which has to be written once after every change.
+	SimulationLod(float timeStep, int uploadCopies = 1,
+		const SimulationLodSettings& settings = SimulationLodSettings());
+
+	const SimulationLodSettings& Settings()const;
+	float TimeStep()const;
+
+	// Level of a body with world space bounds seen through view and proj.
+	SimulationLodLevel Classify(const DirectX::BoundingSphere& bounds,
+		DirectX::FXMMATRIX view, DirectX::CXMMATRIX proj)const;
+
+	// Height of the sphere on screen as a fraction of the viewport height, 1 when the eye
+	// is inside it.
+	static float ScreenFraction(const DirectX::BoundingSphere& bounds,
+		DirectX::FXMMATRIX view, DirectX::CXMMATRIX proj);
+
+	// Moves the body's clock on by dt seconds at level, and returns the number of steps
+	// to take now.
+	int Advance(float dt, SimulationLodLevel level);
+
+	// Whether one of the copies should be written this frame, after the steps Advance
+	// asked for.  Answering it counts that copy as written.
+	bool UploadDue();
+
+	// Every copy has to be written again, for instance because the caller starts using
+	// other buffers.  uploadCopies replaces the count given to the constructor.
+	void InvalidateUploads();
+	void InvalidateUploads(int uploadCopies);
+
+	// Feeds the time the caller spent on the steps of this frame.
+	void AddStepTime(double milliseconds, int steps);
+
+	const SimulationLodStats& Stats()const;
+	void ResetStats();
+
+private:
+	SimulationLodSettings mSettings;
+	float mTimeStep = 0.0f;
+
+	// Seconds owed, and seconds since the last step.
+	float mLag = 0.0f;
+	float mSinceStep = 0.0f;
+
+	// Fractions of a step carried over between frames for StepsDue and StepsDropped.
+	float mDueFraction = 0.0f;
+	float mDroppedFraction = 0.0f;
+
+	int mUploadCopies = 1;
+	int mPendingUploads = 0;
+
+	SimulationLodStats mStats;
+};
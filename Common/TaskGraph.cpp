@@ -0,0 +1,136 @@
+//***************************************************************************************
+// TaskGraph.cpp
+//***************************************************************************************
+
+#include "TaskGraph.h"
+#include <ppl.h>
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <memory>
+
+TaskGraph::TaskId TaskGraph::Add(const std::wstring& name, std::function<void()> work,
+	std::initializer_list<TaskId> dependencies)
+{
+	TaskId id = (TaskId)mTasks.size();
+
+	Task task;
+	task.Work = std::move(work);
+	for(TaskId d : dependencies)
+	{
+		assert(d >= 0 && d < id);
+		task.Dependencies.push_back(d);
+		mTasks[d].Dependents.push_back(id);
+	}
+	mTasks.push_back(std::move(task));
+
+	TaskTiming timing;
+	timing.Name = name;
+	mTimings.push_back(timing);
+
+	return id;
+}
+
+int TaskGraph::Count()const
+{
+	return (int)mTasks.size();
+}
+
+void TaskGraph::Run()
+{
+	int count = Count();
+
+	// Dependencies each task is still waiting for.
+	std::unique_ptr<std::atomic<int>[]> waiting(new std::atomic<int>[count]);
+	for(int i = 0; i < count; ++i)
+	{
+		waiting[i] = (int)mTasks[i].Dependencies.size();
+		mTimings[i].StartMs = 0.0;
+		mTimings[i].EndMs = 0.0;
+	}
+
+	auto start = std::chrono::high_resolution_clock::now();
+	auto elapsedMs = [start]()
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	};
+
+	concurrency::task_group group;
+
+	std::function<void(TaskId)> launch = [&](TaskId id)
+	{
+		group.run([&, id]()
+		{
+			mTimings[id].StartMs = elapsedMs();
+			mTasks[id].Work();
+			mTimings[id].EndMs = elapsedMs();
+
+			// The last dependency to finish starts the dependent.
+			for(TaskId d : mTasks[id].Dependents)
+			{
+				if(--waiting[d] == 0)
+					launch(d);
+			}
+		});
+	};
+
+	for(TaskId id = 0; id < count; ++id)
+	{
+		if(mTasks[id].Dependencies.empty())
+			launch(id);
+	}
+
+	group.wait();
+
+	mTotalMs = elapsedMs();
+}
+
+const std::vector<TaskTiming>& TaskGraph::Timings()const
+{
+	return mTimings;
+}
+
+double TaskGraph::TotalMs()const
+{
+	return mTotalMs;
+}
+
+double TaskGraph::TaskMs()const
+{
+	double ms = 0.0;
+	for(const TaskTiming& t : mTimings)
+		ms += t.EndMs - t.StartMs;
+	return ms;
+}
+
+double TaskGraph::CriticalPathMs()const
+{
+	// Dependencies come before their dependents, so one pass in order is enough.
+	std::vector<double> finish(mTasks.size(), 0.0);
+	double longest = 0.0;
+	for(size_t i = 0; i < mTasks.size(); ++i)
+	{
+		double ready = 0.0;
+		for(TaskId d : mTasks[i].Dependencies)
+			ready = std::max(ready, finish[d]);
+
+		finish[i] = ready + (mTimings[i].EndMs - mTimings[i].StartMs);
+		longest = std::max(longest, finish[i]);
+	}
+	return longest;
+}
+
+std::wstring TaskGraph::FormatReport()const
+{
+	std::wstring text;
+	for(const TaskTiming& t : mTimings)
+	{
+		text += L"  " + t.Name + L": " + std::to_wstring(t.EndMs - t.StartMs) + L" ms, from " +
+			std::to_wstring(t.StartMs) + L" to " + std::to_wstring(t.EndMs) + L"\n";
+	}
+
+	text += L"Total: " + std::to_wstring(TotalMs()) + L" ms, " + std::to_wstring(TaskMs()) +
+		L" ms of tasks, longest chain " + std::to_wstring(CriticalPathMs()) + L" ms\n";
+	return text;
+}
@@ -0,0 +1,73 @@
+//***************************************************************************************
+// TaskGraph.h
+//
+// Runs named tasks on the PPL thread pool, each one as soon as the tasks it depends on
+// have finished.  Tasks can only depend on tasks added before them, so the order they
+// were added in is always one that respects the dependencies.
+//
+// When and how long every task ran is kept, so the report shows where the time went
+// and how long the longest chain of dependent tasks took, which is as fast as the
+// graph can run however many threads there are.
+//***************************************************************************************
+
+#pragma once
+
+#include <functional>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+struct TaskTiming
+{
+	std::wstring Name;
+
+	// Milliseconds from the start of Run.
+	double StartMs = 0.0;
+	double EndMs = 0.0;
+};
+
+class TaskGraph
+{
+public:
+	typedef int TaskId;
+
+	TaskGraph() = default;
+	TaskGraph(const TaskGraph& rhs) = delete;
+	TaskGraph& operator=(const TaskGraph& rhs) = delete;
+
+	// Adds a task that runs work once every task in dependencies has finished.
+	TaskId Add(const std::wstring& name, std::function<void()> work,
+		std::initializer_list<TaskId> dependencies = {});
+
+	int Count()const;
+
+	// Runs every task and returns when they are done.  If a task throws, the tasks
+	// that depend on it do not run, and the exception is thrown from here once the
+	// tasks already running have finished.
+	void Run();
+
+	// Of the last Run, in the order the tasks were added.
+	const std::vector<TaskTiming>& Timings()const;
+
+	// Wall time of the last Run, the time of all its tasks added up, and that of its
+	// longest chain of dependent tasks.
+	double TotalMs()const;
+	double TaskMs()const;
+	double CriticalPathMs()const;
+
+	// One line per task, then the totals, for the debug output.
+	std::wstring FormatReport()const;
+
+private:
+	struct Task
+	{
+		std::function<void()> Work;
+		std::vector<TaskId> Dependencies;
+		std::vector<TaskId> Dependents;
+	};
+
+	std::vector<Task> mTasks;
+	std::vector<TaskTiming> mTimings;
+
+	double mTotalMs = 0.0;
+};
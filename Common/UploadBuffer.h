@@ -55,6 +55,21 @@ public:
         memcpy(&mMappedData[elementIndex*mElementByteSize], &data, sizeof(T));
     }
 
+    // Copies count consecutive elements starting at firstElement.  Only for buffers that
+    // are not constant buffers, whose elements are tightly packed.
+    void CopyRange(int firstElement, const T* data, int count)
+    {
+        assert(!mIsConstantBuffer);
+        memcpy(&mMappedData[firstElement*mElementByteSize], data, count*sizeof(T));
+    }
+
+    // For callers that fill the whole buffer in one pass.  The same rule as for CopyData
+    // applies: the GPU must be done with the buffer before it is written.
+    BYTE* MappedData()const
+    {
+        return mMappedData;
+    }
+
 private:
     Microsoft::WRL::ComPtr<ID3D12Resource> mUploadBuffer;
     BYTE* mMappedData = nullptr;
@@ -0,0 +1,72 @@
+//***************************************************************************************
+// VersionedProperty.h
+//
+// A value that counts the writes that changed it.  Whoever copies the value elsewhere,
+// like into a constant buffer slot, remembers the version it copied and only copies
+// again once the version moved on.  Several writes in one frame therefore cost a single
+// copy, and writing back an unchanged value costs none.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+template<typename T>
+class VersionedProperty
+{
+	static_assert(std::is_trivially_copyable<T>::value, "VersionedProperty compares values bytewise.");
+
+public:
+	VersionedProperty() = default;
+	VersionedProperty(const T& value) : mValue(value) {}
+
+	VersionedProperty& operator=(const T& value)
+	{
+		Set(value);
+		return *this;
+	}
+
+	const T& Get()const { return mValue; }
+	operator const T&()const { return mValue; }
+
+	// Stores value and returns true if it differs from the current one.  Writing the
+	// value already stored leaves the version unchanged.
+	bool Set(const T& value)
+	{
+		if(std::memcmp(&mValue, &value, sizeof(T)) == 0)
+			return false;
+
+		mValue = value;
+		++mVersion;
+		return true;
+	}
+
+	// For writing in place, e.g. with XMStoreFloat4x4.  Always counts as a change.
+	T& Edit()
+	{
+		++mVersion;
+		return mValue;
+	}
+
+	// Starts at 1, so a copy that records 0 for "never copied" is always stale.
+	std::uint64_t Version()const { return mVersion; }
+
+private:
+	T mValue = T();
+	std::uint64_t mVersion = 1;
+};
+
+// The sum of the versions of several properties.  Every write that changes one of them
+// moves it on, so it can stand for the version of all of them, like a material's.
+inline std::uint64_t VersionSum()
+{
+	return 0;
+}
+
+template<typename T, typename... Rest>
+std::uint64_t VersionSum(const VersionedProperty<T>& first, const Rest&... rest)
+{
+	return first.Version() + VersionSum(rest...);
+}
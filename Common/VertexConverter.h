@@ -0,0 +1,163 @@
+//***************************************************************************************
+// VertexConverter.h
+//
+// Converts arrays of one vertex type into another from a compile time description of
+// which attributes to carry over and how.  A layout lists attributes as (source member,
+// destination member, conversion), and ConvertVertices runs one loop per attribute over
+// blocks of vertices, so each loop is specialized for its types and has no per-vertex
+// dispatch:
+//   -Copy assigns the member.
+//   -FloatToHalf converts float components to 16-bit floats with
+//    XMConvertFloatToHalfStream, which uses F16C where the CPU has it.
+//   -PackNormal packs a float3 into an XMBYTEN4 (8-bit snorm, w = 0).
+//
+// The source is read with a byte stride, so attributes can be gathered out of larger or
+// interleaved records.  Arrays of ParallelThreshold vertices or more are converted in
+// parallel, a block per task.
+//
+// Example:
+//     using Layout = VertexConversion::Layout<
+//         VERTEX_ATTRIBUTE(GeometryGenerator::Vertex, Position, Vertex, Pos, VertexConversion::Copy),
+//         VERTEX_ATTRIBUTE(GeometryGenerator::Vertex, TexC, Vertex, TexC, VertexConversion::Copy)>;
+//     VertexConversion::ConvertVertices<Layout>(mesh.Vertices, vertices);
+//***************************************************************************************
+
+#pragma once
+
+#include <DirectXMath.h>
+#include <DirectXPackedVector.h>
+#include <ppl.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace VertexConversion
+{
+	const std::size_t BlockSize = 1024;
+	const std::size_t ParallelThreshold = 32 * 1024;
+
+	template<typename T>
+	inline T* Advance(T* p, std::size_t bytes)
+	{
+		return reinterpret_cast<T*>(reinterpret_cast<std::uint8_t*>(p) + bytes);
+	}
+
+	template<typename T>
+	inline const T* Advance(const T* p, std::size_t bytes)
+	{
+		return reinterpret_cast<const T*>(reinterpret_cast<const std::uint8_t*>(p) + bytes);
+	}
+
+	//
+	// Conversions.  Run converts one attribute of count vertices.
+	//
+
+	struct Copy
+	{
+		template<typename Src, typename Dst>
+		static void Run(const Src* src, std::size_t srcStride, Dst* dst, std::size_t dstStride, std::size_t count)
+		{
+			for(std::size_t i = 0; i < count; ++i)
+				*Advance(dst, i*dstStride) = *Advance(src, i*srcStride);
+		}
+	};
+
+	struct FloatToHalf
+	{
+		// Src is a float or a struct of floats (XMFLOAT2, ...), Dst the HALF equivalent.
+		template<typename Src, typename Dst>
+		static void Run(const Src* src, std::size_t srcStride, Dst* dst, std::size_t dstStride, std::size_t count)
+		{
+			static_assert(sizeof(Src) % sizeof(float) == 0, "FloatToHalf needs a source made of floats.");
+			static_assert(2 * sizeof(Dst) == sizeof(Src), "FloatToHalf needs a destination of halves.");
+
+			for(std::size_t c = 0; c < sizeof(Src) / sizeof(float); ++c)
+			{
+				DirectX::PackedVector::XMConvertFloatToHalfStream(
+					reinterpret_cast<DirectX::PackedVector::HALF*>(dst) + c, dstStride,
+					reinterpret_cast<const float*>(src) + c, srcStride, count);
+			}
+		}
+	};
+
+	struct PackNormal
+	{
+		static void Run(const DirectX::XMFLOAT3* src, std::size_t srcStride,
+			DirectX::PackedVector::XMBYTEN4* dst, std::size_t dstStride, std::size_t count)
+		{
+			for(std::size_t i = 0; i < count; ++i)
+			{
+				DirectX::XMVECTOR n = DirectX::XMLoadFloat3(Advance(src, i*srcStride));
+				DirectX::PackedVector::XMStoreByteN4(Advance(dst, i*dstStride), n);
+			}
+		}
+	};
+
+	//
+	// Layout description.  Use VERTEX_ATTRIBUTE to name attributes.
+	//
+
+	template<typename SrcVertex, typename SrcType, SrcType SrcVertex::*SrcMember,
+		typename DstVertex, typename DstType, DstType DstVertex::*DstMember, typename Conversion>
+	struct Attribute
+	{
+		static void Run(const SrcVertex* src, std::size_t srcStride, DstVertex* dst, std::size_t count)
+		{
+			Conversion::Run(&(src->*SrcMember), srcStride, &(dst->*DstMember), sizeof(DstVertex), count);
+		}
+	};
+
+	template<typename... Attributes>
+	struct Layout
+	{
+		template<typename SrcVertex, typename DstVertex>
+		static void Run(const SrcVertex* src, std::size_t srcStride, DstVertex* dst, std::size_t count)
+		{
+			int expand[] = { 0, (Attributes::Run(src, srcStride, dst, count), 0)... };
+			(void)expand;
+		}
+	};
+
+	//
+	// Conversion of whole arrays.
+	//
+
+	template<typename Layout, typename SrcVertex, typename DstVertex>
+	void ConvertVertices(const SrcVertex* src, std::size_t srcStride, DstVertex* dst, std::size_t count)
+	{
+		std::size_t blockCount = (count + BlockSize - 1) / BlockSize;
+
+		// Block by block, so the source is still in the cache for the later attributes.
+		auto convertBlock = [=](std::size_t block)
+		{
+			std::size_t first = block*BlockSize;
+			std::size_t n = std::min(BlockSize, count - first);
+			Layout::Run(Advance(src, first*srcStride), srcStride, dst + first, n);
+		};
+
+		if(count >= ParallelThreshold)
+		{
+			concurrency::parallel_for(std::size_t(0), blockCount, convertBlock);
+		}
+		else
+		{
+			for(std::size_t block = 0; block < blockCount; ++block)
+				convertBlock(block);
+		}
+	}
+
+	// Resizes dst to match src.
+	template<typename Layout, typename SrcVertex, typename DstVertex>
+	void ConvertVertices(const std::vector<SrcVertex>& src, std::vector<DstVertex>& dst)
+	{
+		dst.resize(src.size());
+		if(!src.empty())
+			ConvertVertices<Layout>(src.data(), sizeof(SrcVertex), dst.data(), src.size());
+	}
+}
+
+// Names an attribute for VertexConversion::Layout by its source and destination members.
+#define VERTEX_ATTRIBUTE(SrcVertex, srcMember, DstVertex, dstMember, Conversion) \
+	VertexConversion::Attribute<SrcVertex, decltype(SrcVertex::srcMember), &SrcVertex::srcMember, \
+		DstVertex, decltype(DstVertex::dstMember), &DstVertex::dstMember, Conversion>
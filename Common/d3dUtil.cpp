@@ -1,5 +1,6 @@
 
 #include "d3dUtil.h"
+#include "ResourceStateTracker.h"
 #include <comdef.h>
 #include <fstream>
 
@@ -40,7 +41,8 @@ Microsoft::WRL::ComPtr<ID3D12Resource> d3dUtil::CreateDefaultBuffer(
     ID3D12GraphicsCommandList* cmdList,
     const void* initData,
     UINT64 byteSize,
-    Microsoft::WRL::ComPtr<ID3D12Resource>& uploadBuffer)
+    Microsoft::WRL::ComPtr<ID3D12Resource>& uploadBuffer,
+    ResourceStateTracker* stateTracker)
 {
     ComPtr<ID3D12Resource> defaultBuffer;
 
@@ -73,11 +75,28 @@ Microsoft::WRL::ComPtr<ID3D12Resource> d3dUtil::CreateDefaultBuffer(
     // Schedule to copy the data to the default buffer resource.  At a high level, the helper function UpdateSubresources
     // will copy the CPU memory into the intermediate upload heap.  Then, using ID3D12CommandList::CopySubresourceRegion,
     // the intermediate upload heap data will be copied to mBuffer.
-	cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(defaultBuffer.Get(), 
-		D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_DEST));
+    //
+    // With a tracker, the buffer is left to be promoted from COMMON to COPY_DEST by the
+    // copy itself, and the transition out of COPY_DEST is only queued; it gets recorded
+    // the next time the tracker is flushed.
+    if(stateTracker == nullptr)
+    {
+        cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(defaultBuffer.Get(),
+            D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_DEST));
+    }
+
     UpdateSubresources<1>(cmdList, defaultBuffer.Get(), uploadBuffer.Get(), 0, 0, 1, &subResourceData);
-	cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(defaultBuffer.Get(),
-		D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_GENERIC_READ));
+
+    if(stateTracker == nullptr)
+    {
+        cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(defaultBuffer.Get(),
+            D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_GENERIC_READ));
+    }
+    else
+    {
+        stateTracker->Register(defaultBuffer.Get(), D3D12_RESOURCE_STATE_COPY_DEST);
+        stateTracker->Transition(defaultBuffer.Get(), D3D12_RESOURCE_STATE_GENERIC_READ);
+    }
 
     // Note: uploadBuffer has to be kept alive after the above function calls because
     // the command list has not been executed yet that performs the actual copy.
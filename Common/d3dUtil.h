@@ -24,9 +24,12 @@
 #include "d3dx12.h"
 #include "DDSTextureLoader.h"
 #include "MathHelper.h"
+#include "VersionedProperty.h"
 
 extern const int gNumFrameResources;
 
+class ResourceStateTracker;
+
 inline void d3dSetDebugName(IDXGIObject* obj, const char* name)
 {
 	if (obj)
@@ -110,12 +113,16 @@ public:
 
 	static Microsoft::WRL::ComPtr<ID3DBlob> LoadBinary(const std::wstring& filename);
 
+	// With a stateTracker, the buffer is registered with it and the final transition to
+	// GENERIC_READ is queued there, so the caller can flush the barriers of many buffers
+	// at once.  The caller unregisters the buffer when releasing it.
 	static Microsoft::WRL::ComPtr<ID3D12Resource> CreateDefaultBuffer(
 		ID3D12Device* device,
 		ID3D12GraphicsCommandList* cmdList,
 		const void* initData,
 		UINT64 byteSize,
-		Microsoft::WRL::ComPtr<ID3D12Resource>& uploadBuffer);
+		Microsoft::WRL::ComPtr<ID3D12Resource>& uploadBuffer,
+		ResourceStateTracker* stateTracker = nullptr);
 
 	static Microsoft::WRL::ComPtr<ID3DBlob> CompileShader(
 		const std::wstring& filename,
@@ -171,6 +178,10 @@ struct MeshGeometry
 	Microsoft::WRL::ComPtr<ID3D12Resource> IndexBufferGPU = nullptr;
 	Microsoft::WRL::ComPtr<ID3D12Resource> ColorBufferGPU = nullptr;
 
+	// Optional second stream for vertex attributes that are rewritten every frame,
+	// so the static ones in VertexBufferGPU only need uploading once.  Bound to slot 1.
+	Microsoft::WRL::ComPtr<ID3D12Resource> DynamicVertexBufferGPU = nullptr;
+
 
 	Microsoft::WRL::ComPtr<ID3D12Resource> VertexBufferUploader = nullptr;
 	Microsoft::WRL::ComPtr<ID3D12Resource> IndexBufferUploader = nullptr;
@@ -185,6 +196,8 @@ struct MeshGeometry
 	UINT IndexBufferByteSize = 0;
 	UINT ColorByteStride = 0;
 	UINT ColorBufferByteSize = 0;
+	UINT DynamicVertexByteStride = 0;
+	UINT DynamicVertexBufferByteSize = 0;
 
 
 	// A MeshGeometry may store multiple geometries in one vertex/index buffer.
@@ -226,6 +239,20 @@ struct MeshGeometry
 		return cbv;
 	}
 
+	D3D12_VERTEX_BUFFER_VIEW DynamicVertexBufferView()const
+	{
+		D3D12_VERTEX_BUFFER_VIEW vbv;
+		vbv.BufferLocation = DynamicVertexBufferGPU->GetGPUVirtualAddress();
+		vbv.StrideInBytes = DynamicVertexByteStride;
+		vbv.SizeInBytes = DynamicVertexBufferByteSize;
+
+		return vbv;
+	}
+
+
+	// Nothing reads the CPU copies after the upload unless the mesh is picked against
+	// on the CPU; set this for such meshes so ReleaseCpuCopies keeps them.
+	bool KeepCpuCopy = false;
 
 	// We can free this memory after we finish upload to the GPU.
 	void DisposeUploaders()
@@ -234,6 +261,16 @@ struct MeshGeometry
 		IndexBufferUploader = nullptr;
 		ColorBufferUploader = nullptr;
 	}
+
+	void ReleaseCpuCopies()
+	{
+		if(KeepCpuCopy)
+			return;
+
+		VertexBufferCPU = nullptr;
+		IndexBufferCPU = nullptr;
+		ColorBufferCPU = nullptr;
+	}
 };
 
 
@@ -260,6 +297,32 @@ struct MaterialConstants
 
 	// Used in texture mapping.
 	DirectX::XMFLOAT4X4 MatTransform = MathHelper::Identity4x4();
+
+	// Texture coordinate animation; see UvAnimation.
+	DirectX::XMFLOAT2 UvScrollSpeed = { 0.0f, 0.0f };
+	float UvRotationSpeed = 0.0f;
+	float FlipbookFrameRate = 0.0f;
+	DirectX::XMFLOAT2 UvRotationCenter = { 0.5f, 0.5f };
+	std::uint32_t FlipbookFrameCount = 0;
+	float MaterialPad0 = 0.0f;
+};
+
+// Texture coordinate animation of a material.  The shaders evaluate it from the pass's
+// TotalTime, so an animated material costs no CPU time until its parameters change.
+// It is applied after MatTransform: a rotation about RotationCenter, then scrolling.
+struct UvAnimation
+{
+	// Texture coordinates per second.
+	DirectX::XMFLOAT2 ScrollSpeed = { 0.0f, 0.0f };
+
+	// Radians per second, counterclockwise.
+	float RotationSpeed = 0.0f;
+	DirectX::XMFLOAT2 RotationCenter = { 0.5f, 0.5f };
+
+	// For array textures: steps through FlipbookFrameCount slices at FlipbookFrameRate
+	// slices per second.  A count of 0 leaves the slice alone.
+	float FlipbookFrameRate = 0.0f;
+	std::uint32_t FlipbookFrameCount = 0;
 };
 
 // Simple struct to represent a material for our demos.  A production 3D engine
@@ -282,13 +345,21 @@ struct Material
 	// Because we have a material constant buffer for each FrameResource, we have to apply the
 	// update to each FrameResource.  Thus, when we modify a material we should set 
 	// NumFramesDirty = gNumFrameResources so that each frame resource gets the update.
+	// Apps that compare Version() with the version of each slot do not need it.
 	int NumFramesDirty = gNumFrameResources;
 
 	// Material constant buffer data used for shading.
-	DirectX::XMFLOAT4 DiffuseAlbedo = { 1.0f, 1.0f, 1.0f, 1.0f };
-	DirectX::XMFLOAT3 FresnelR0 = { 0.01f, 0.01f, 0.01f };
-	float Roughness = .25f;
-	DirectX::XMFLOAT4X4 MatTransform = MathHelper::Identity4x4();
+	VersionedProperty<DirectX::XMFLOAT4> DiffuseAlbedo = DirectX::XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
+	VersionedProperty<DirectX::XMFLOAT3> FresnelR0 = DirectX::XMFLOAT3(0.01f, 0.01f, 0.01f);
+	VersionedProperty<float> Roughness = .25f;
+	VersionedProperty<DirectX::XMFLOAT4X4> MatTransform = MathHelper::Identity4x4();
+	VersionedProperty<UvAnimation> Animation;
+
+	// Changes whenever one of the constant buffer properties is written with a new value.
+	std::uint64_t Version()const
+	{
+		return VersionSum(DiffuseAlbedo, FresnelR0, Roughness, MatTransform, Animation);
+	}
 };
 
 struct Texture
@@ -300,6 +371,9 @@ struct Texture
 
 	Microsoft::WRL::ComPtr<ID3D12Resource> Resource = nullptr;
 	Microsoft::WRL::ComPtr<ID3D12Resource> UploadHeap = nullptr;
+
+	// Index into the SRV heap of the view created for this texture.
+	int SrvHeapIndex = -1;
 };
 
 #ifndef ThrowIfFailed
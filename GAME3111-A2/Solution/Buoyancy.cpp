@@ -0,0 +1,141 @@
+//***************************************************************************************
+// Buoyancy.cpp
+//***************************************************************************************
+
+#include "Buoyancy.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+
+using namespace DirectX;
+
+const float Buoyancy::MaxTimeStep = 1.0f / 60.0f;
+
+Buoyancy::Buoyancy(float gravity, float drag)
+{
+	mGravity = gravity;
+	mDrag = drag;
+}
+
+int Buoyancy::Add(const XMFLOAT3& position, float halfHeight, float density)
+{
+	assert(halfHeight > 0.0f && density > 0.0f);
+
+	mPosX.push_back(position.x);
+	mPosY.push_back(position.y);
+	mPosZ.push_back(position.z);
+	mVelX.push_back(0.0f);
+	mVelY.push_back(0.0f);
+	mVelZ.push_back(0.0f);
+	mHalfHeight.push_back(halfHeight);
+	mDensity.push_back(density);
+
+	mSurfaceHeight.push_back(0.0f);
+	mNormalX.push_back(0.0f);
+	mNormalY.push_back(1.0f);
+	mNormalZ.push_back(0.0f);
+	mSurfaceVelocity.push_back(0.0f);
+
+	return Count() - 1;
+}
+
+void Buoyancy::Clear()
+{
+	for(auto v : { &mPosX, &mPosY, &mPosZ, &mVelX, &mVelY, &mVelZ, &mHalfHeight, &mDensity,
+		&mSurfaceHeight, &mNormalX, &mNormalY, &mNormalZ, &mSurfaceVelocity })
+	{
+		v->clear();
+	}
+}
+
+int Buoyancy::Count()const
+{
+	return (int)mPosX.size();
+}
+
+XMFLOAT3 Buoyancy::Position(int i)const
+{
+	return XMFLOAT3(mPosX[i], mPosY[i], mPosZ[i]);
+}
+
+XMFLOAT3 Buoyancy::Velocity(int i)const
+{
+	return XMFLOAT3(mVelX[i], mVelY[i], mVelZ[i]);
+}
+
+XMFLOAT3 Buoyancy::SurfaceNormal(int i)const
+{
+	return XMFLOAT3(mNormalX[i], mNormalY[i], mNormalZ[i]);
+}
+
+const BuoyancyStats& Buoyancy::Stats()const
+{
+	return mStats;
+}
+
+void Buoyancy::Update(const Waves& waves, float dt, float margin)
+{
+	mStats = BuoyancyStats();
+
+	int n = Count();
+	if(n == 0 || dt <= 0.0f)
+		return;
+
+	// The surface only changes when the water steps, so once per update is enough.
+	auto start = std::chrono::high_resolution_clock::now();
+	waves.SampleSurface(n, mPosX.data(), mPosZ.data(), mSurfaceHeight.data(),
+		mNormalX.data(), mNormalY.data(), mNormalZ.data(), mSurfaceVelocity.data());
+	auto sampled = std::chrono::high_resolution_clock::now();
+
+	int substeps = std::max(1, (int)std::ceil(dt / MaxTimeStep));
+	float h = dt / substeps;
+
+	float maxX = 0.5f*waves.Width() - margin;
+	float maxZ = 0.5f*waves.Depth() - margin;
+
+	for(int s = 0; s < substeps; ++s)
+	{
+		for(int i = 0; i < n; ++i)
+		{
+			float height = 2.0f*mHalfHeight[i];
+			float depth = mSurfaceHeight[i] - (mPosY[i] - mHalfHeight[i]);
+			float submerged = std::min(std::max(depth, 0.0f), height) / height;
+
+			float lift = mGravity*submerged / mDensity[i];
+			float drag = mDrag*submerged;
+
+			mVelX[i] += (lift*mNormalX[i] - drag*mVelX[i])*h;
+			mVelY[i] += (lift*mNormalY[i] - mGravity - drag*(mVelY[i] - mSurfaceVelocity[i]))*h;
+			mVelZ[i] += (lift*mNormalZ[i] - drag*mVelZ[i])*h;
+		}
+
+		for(int i = 0; i < n; ++i)
+		{
+			mPosX[i] += mVelX[i]*h;
+			mPosY[i] += mVelY[i]*h;
+			mPosZ[i] += mVelZ[i]*h;
+		}
+	}
+
+	// Bodies that drift to the edge stop there.
+	for(int i = 0; i < n; ++i)
+	{
+		if(std::fabs(mPosX[i]) > maxX)
+		{
+			mPosX[i] = std::min(std::max(mPosX[i], -maxX), maxX);
+			mVelX[i] = 0.0f;
+		}
+		if(std::fabs(mPosZ[i]) > maxZ)
+		{
+			mPosZ[i] = std::min(std::max(mPosZ[i], -maxZ), maxZ);
+			mVelZ[i] = 0.0f;
+		}
+	}
+
+	auto end = std::chrono::high_resolution_clock::now();
+
+	mStats.Substeps = substeps;
+	mStats.SampleMs = std::chrono::duration<double, std::milli>(sampled - start).count();
+	mStats.IntegrateMs = std::chrono::duration<double, std::milli>(end - sampled).count();
+}
@@ -0,0 +1,76 @@
+//***************************************************************************************
+// Buoyancy.h
+//
+// Floats bodies on a Waves surface.  Each body is an upright column of water-relative
+// density Density and height 2*HalfHeight.  The part of it below the surface pushes it
+// along the surface normal with g*submerged/Density, so at rest it sinks to Density of
+// its height.  Drag on the submerged part pulls its velocity towards the water's, which
+// only moves up and down.
+//
+// The bodies are kept as structure-of-arrays so the whole set is sampled with one
+// Waves::SampleSurface call per update, and integrated with semi-implicit Euler in
+// loops over plain float arrays.  Positions are in the frame of the Waves grid.
+//***************************************************************************************
+
+#pragma once
+
+#include "Waves.h"
+#include <vector>
+
+struct BuoyancyStats
+{
+	// Of the last Update.
+	int Substeps = 0;
+	double SampleMs = 0.0;
+	double IntegrateMs = 0.0;
+};
+
+class Buoyancy
+{
+public:
+	Buoyancy(float gravity = 9.8f, float drag = 3.0f);
+	Buoyancy(const Buoyancy& rhs) = delete;
+	Buoyancy& operator=(const Buoyancy& rhs) = delete;
+
+	// Updates take substeps no longer than this.
+	static const float MaxTimeStep;
+
+	// Returns the index of the new body.
+	int Add(const DirectX::XMFLOAT3& position, float halfHeight, float density);
+	void Clear();
+
+	int Count()const;
+	DirectX::XMFLOAT3 Position(int i)const;
+	DirectX::XMFLOAT3 Velocity(int i)const;
+
+	// The surface normal under the body at the last update.
+	DirectX::XMFLOAT3 SurfaceNormal(int i)const;
+
+	// Samples the surface under every body and moves them on by dt.  Bodies stay at
+	// least margin inside the grid.
+	void Update(const Waves& waves, float dt, float margin = 2.0f);
+
+	const BuoyancyStats& Stats()const;
+
+private:
+	float mGravity = 9.8f;
+	float mDrag = 1.5f;
+
+	std::vector<float> mPosX;
+	std::vector<float> mPosY;
+	std::vector<float> mPosZ;
+	std::vector<float> mVelX;
+	std::vector<float> mVelY;
+	std::vector<float> mVelZ;
+	std::vector<float> mHalfHeight;
+	std::vector<float> mDensity;
+
+	// The surface under each body, from the last update.
+	std::vector<float> mSurfaceHeight;
+	std::vector<float> mNormalX;
+	std::vector<float> mNormalY;
+	std::vector<float> mNormalZ;
+	std::vector<float> mSurfaceVelocity;
+
+	BuoyancyStats mStats;
+};
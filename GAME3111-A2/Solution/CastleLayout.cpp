@@ -0,0 +1,123 @@
+//***************************************************************************************
+// CastleLayout.cpp
+//***************************************************************************************
+
+#include "CastleLayout.h"
+#include <cassert>
+#include <cstring>
+
+using namespace DirectX;
+
+const char* CastleLayout::GeometryName(CastleShape shape)
+{
+	const char* names[] = { "boxGeo", "coneGeo", "cylinderGeo" };
+	return names[(int)shape];
+}
+
+const char* CastleLayout::SubmeshName(CastleShape shape)
+{
+	const char* names[] = { "box", "cone", "cylinder" };
+	return names[(int)shape];
+}
+
+GeometryGenerator::MeshData CastleLayout::CreateMesh(CastleShape shape)
+{
+	GeometryGenerator geoGen;
+
+	switch(shape)
+	{
+	case CastleShape::Box:
+		return geoGen.CreateBox(10.0f, 10.0f, 10.0f, 3);
+	case CastleShape::Cone:
+		return geoGen.CreateCylinder(8.0f, 0.0f, 40.0f, 20, 20);
+	default:
+		assert(shape == CastleShape::Cylinder);
+		return geoGen.CreateCylinder(8.0f, 8.0f, 40.0f, 20, 20);
+	}
+}
+
+const std::vector<CastlePart>& CastleLayout::Parts()
+{
+	static const std::vector<CastlePart> parts =
+	{
+		// CASTLE BOX
+		{ CastleShape::Box, "bricks", { 1.0f, 1.8f, 1.0f }, { 0.0f, 11.5f, 10.0f } },
+
+		// TOWER CYLINDERS
+		{ CastleShape::Cylinder, "bricks", { 0.2f, 0.3f, 0.2f }, { 32.0f, 9.0f, 22.0f } },
+		{ CastleShape::Cylinder, "bricks", { 0.2f, 0.3f, 0.2f }, { -32.0f, 9.0f, -15.0f } },
+		{ CastleShape::Cylinder, "bricks", { 0.2f, 0.3f, 0.2f }, { 32.0f, 9.0f, -15.0f } },
+		{ CastleShape::Cylinder, "bricks", { 0.2f, 0.3f, 0.2f }, { -32.0f, 9.0f, 22.0f } },
+
+		// ROOFTOP CONES
+		{ CastleShape::Cone, "tiles", { 0.3f, 0.1f, 0.3f }, { -32.0f, 16.0f, 22.0f } },
+		{ CastleShape::Cone, "tiles", { 0.3f, 0.1f, 0.3f }, { -32.0f, 16.0f, -15.0f } },
+		{ CastleShape::Cone, "tiles", { 0.3f, 0.1f, 0.3f }, { 32.0f, 16.0f, 22.0f } },
+		{ CastleShape::Cone, "tiles", { 0.3f, 0.1f, 0.3f }, { 32.0f, 16.0f, -15.0f } },
+		{ CastleShape::Cone, "tiles", { 0.3f, 0.1f, 0.3f }, { 5.5f, 16.0f, -15.0f } },
+		{ CastleShape::Cone, "tiles", { 0.3f, 0.1f, 0.3f }, { -5.5f, 16.0f, -15.0f } },
+
+		// WALL BOXES
+		{ CastleShape::Box, "bricks", { 2.8f, 0.8f, 0.1f }, { -18.0f, 6.5f, -15.0f } },
+		{ CastleShape::Box, "bricks", { 2.8f, 0.8f, 0.1f }, { 18.0f, 6.5f, -15.0f } },
+		{ CastleShape::Box, "bricks", { 6.2f, 0.8f, 0.1f }, { 0.0f, 6.5f, 22.0f } },
+		{ CastleShape::Box, "bricks", { 0.1f, 0.8f, 3.6f }, { 32.0f, 6.5f, 3.0f } },
+		{ CastleShape::Box, "bricks", { 0.1f, 0.8f, 3.6f }, { -32.0f, 6.5f, 3.0f } },
+
+		// GATE TOWER CYLINDERS
+		{ CastleShape::Cylinder, "bricks", { 0.2f, 0.3f, 0.2f }, { 5.5f, 9.0f, -15.0f } },
+		{ CastleShape::Cylinder, "bricks", { 0.2f, 0.3f, 0.2f }, { -5.5f, 9.0f, -15.0f } },
+
+		// WOODEN BOXES
+		{ CastleShape::Box, "wood", { 0.3f, 0.3f, 0.3f }, { 15.0f, 4.5f, 0.0f } },
+		{ CastleShape::Box, "wood", { 0.3f, 0.3f, 0.3f }, { -15.0f, 4.5f, 0.0f } },
+
+		// CASTLE TOWER CYLINDERS
+		{ CastleShape::Cylinder, "bricks", { 0.2f, 0.5f, 0.2f }, { -5.0f, 12.0f, 5.0f } },
+		{ CastleShape::Cylinder, "bricks", { 0.2f, 0.5f, 0.2f }, { 5.0f, 12.0f, 5.0f } },
+		{ CastleShape::Cylinder, "bricks", { 0.2f, 0.5f, 0.2f }, { -5.0f, 12.0f, 15.0f } },
+		{ CastleShape::Cylinder, "bricks", { 0.2f, 0.5f, 0.2f }, { 5.0f, 12.0f, 15.0f } },
+
+		// CASTLE ROOFTOP CONES
+		{ CastleShape::Cone, "tiles", { 0.3f, 0.1f, 0.3f }, { 5.0f, 24.0f, 5.0f } },
+		{ CastleShape::Cone, "tiles", { 0.3f, 0.1f, 0.3f }, { -5.0f, 24.0f, 5.0f } },
+		{ CastleShape::Cone, "tiles", { 0.3f, 0.1f, 0.3f }, { 5.0f, 24.0f, 15.0f } },
+		{ CastleShape::Cone, "tiles", { 0.3f, 0.1f, 0.3f }, { -5.0f, 24.0f, 15.0f } },
+	};
+
+	return parts;
+}
+
+const char* CastleLayout::DiffuseMapFile(const char* material)
+{
+	// As LoadTextures and BuildMaterials pair them.
+	const char* files[][2] =
+	{
+		{ "bricks", "bricks2.dds" },
+		{ "tiles", "bricks3.dds" },
+		{ "wood", "WoodCrate02.dds" }
+	};
+
+	for(const auto& f : files)
+	{
+		if(std::strcmp(f[0], material) == 0)
+			return f[1];
+	}
+	return nullptr;
+}
+
+XMMATRIX CastleLayout::World(const CastlePart& part)
+{
+	return XMMatrixScaling(part.Scale.x, part.Scale.y, part.Scale.z)*
+		XMMatrixTranslation(part.Position.x, part.Position.y, part.Position.z);
+}
+
+XMFLOAT4X4 CastleLayout::BakeTransform(FXMMATRIX world)
+{
+	XMVECTOR scale, rotation, translation;
+	XMMatrixDecompose(&scale, &rotation, &translation, world);
+
+	XMFLOAT4X4 transform;
+	XMStoreFloat4x4(&transform, XMMatrixMultiply(XMMatrixScalingFromVector(scale), XMMatrixRotationQuaternion(rotation)));
+	return transform;
+}
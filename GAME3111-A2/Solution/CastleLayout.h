@@ -0,0 +1,56 @@
+//***************************************************************************************
+// CastleLayout.h
+//
+// The castle of the tree billboards scene: the meshes its parts are made of, what each
+// part is made of and where it stands.  The app builds its castle render items from
+// this, Tools/ImpostorBake bakes the impostors of the same parts offline and
+// Tools/ReferenceRender draws them without a GPU.
+//
+// Nothing here needs a device.
+//***************************************************************************************
+
+#pragma once
+
+#include "../../Common/GeometryGenerator.h"
+#include <DirectXMath.h>
+#include <vector>
+
+enum class CastleShape : int
+{
+	Box = 0,
+	Cone,
+	Cylinder,
+	Count
+};
+
+struct CastlePart
+{
+	CastleShape Shape;
+
+	// Name of the material in the app, see CastleLayout::DiffuseMapFile.
+	const char* Material;
+
+	DirectX::XMFLOAT3 Scale;
+	DirectX::XMFLOAT3 Position;
+};
+
+namespace CastleLayout
+{
+	// The MeshGeometry name and its one submesh the app gives the shape's mesh.
+	const char* GeometryName(CastleShape shape);
+	const char* SubmeshName(CastleShape shape);
+
+	GeometryGenerator::MeshData CreateMesh(CastleShape shape);
+
+	// The parts in draw order.
+	const std::vector<CastlePart>& Parts();
+
+	// File in Textures of the diffuse map of a castle material, or null.
+	const char* DiffuseMapFile(const char* material);
+
+	DirectX::XMMATRIX World(const CastlePart& part);
+
+	// world without its translation.  Impostors are baked with this transform, so the
+	// atlas normals are in world space and parts that differ only in position share one.
+	DirectX::XMFLOAT4X4 BakeTransform(DirectX::FXMMATRIX world);
+}
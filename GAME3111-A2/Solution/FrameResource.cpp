@@ -1,6 +1,7 @@
 #include "FrameResource.h"
 
-FrameResource::FrameResource(ID3D12Device* device, UINT passCount, UINT objectCount, UINT materialCount, UINT waveVertCount)
+FrameResource::FrameResource(ID3D12Device* device, UINT passCount, UINT objectCount, UINT materialCount, UINT waveVertCount,
+	bool splitWaveStreams, UINT waveSurfaceByteSize, UINT treeInstanceCount, UINT impostorCount)
 {
     ThrowIfFailed(device->CreateCommandAllocator(
         D3D12_COMMAND_LIST_TYPE_DIRECT,
@@ -9,9 +10,26 @@ FrameResource::FrameResource(ID3D12Device* device, UINT passCount, UINT objectCo
   //  FrameCB = std::make_unique<UploadBuffer<FrameConstants>>(device, 1, true);
     PassCB = std::make_unique<UploadBuffer<PassConstants>>(device, passCount, true);
     MaterialCB = std::make_unique<UploadBuffer<MaterialConstants>>(device, materialCount, true);
-    ObjectCB = std::make_unique<UploadBuffer<ObjectConstants>>(device, objectCount, true);
+    ObjectBuffer = std::make_unique<UploadBuffer<ObjectConstants>>(device, objectCount, false);
+    ObjectVersions.assign(objectCount, 0);
+    MaterialCBVersions.assign(materialCount, 0);
 
-    WavesVB = std::make_unique<UploadBuffer<Vertex>>(device, waveVertCount, false);
+    if(splitWaveStreams)
+        WavesDynamicVB = std::make_unique<UploadBuffer<WaveVertex>>(device, waveVertCount, false);
+    else
+        WavesVB = std::make_unique<UploadBuffer<Vertex>>(device, waveVertCount, false);
+
+    if(waveSurfaceByteSize > 0)
+        WavesSurface = std::make_unique<UploadBuffer<std::uint32_t>>(device,
+            waveSurfaceByteSize / (UINT)sizeof(std::uint32_t), false);
+
+    if(treeInstanceCount > 0)
+        TreeInstances = std::make_unique<UploadBuffer<BillboardInstance>>(device, treeInstanceCount, false);
+
+    if(impostorCount > 0)
+        ImpostorInstances = std::make_unique<UploadBuffer<ImpostorInstance>>(device, impostorCount, false);
+
+	IndirectArgs = std::make_unique<UploadBuffer<IndirectDrawCommand>>(device, objectCount, false);
 }
 
 FrameResource::FrameResource(ID3D12Device* device, UINT passCount, UINT objectCount, UINT materialCount)
@@ -23,8 +41,9 @@ FrameResource::FrameResource(ID3D12Device* device, UINT passCount, UINT objectCo
 	//  FrameCB = std::make_unique<UploadBuffer<FrameConstants>>(device, 1, true);
 	PassCB = std::make_unique<UploadBuffer<PassConstants>>(device, passCount, true);
 	MaterialCB = std::make_unique<UploadBuffer<MaterialConstants>>(device, materialCount, true);
-	ObjectCB = std::make_unique<UploadBuffer<ObjectConstants>>(device, objectCount, true);
-
+	ObjectBuffer = std::make_unique<UploadBuffer<ObjectConstants>>(device, objectCount, false);
+	ObjectVersions.assign(objectCount, 0);
+	MaterialCBVersions.assign(materialCount, 0);
 }
 
 FrameResource::~FrameResource()
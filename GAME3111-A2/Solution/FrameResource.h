@@ -3,11 +3,25 @@
 #include "../../Common/d3dUtil.h"
 #include "../../Common/MathHelper.h"
 #include "../../Common/UploadBuffer.h"
+#include "../../Common/GeometryGenerator.h"
+#include "../../Common/VertexConverter.h"
+#include "../../Common/BillboardCuller.h"
+#include "../../Common/ImpostorBaker.h"
+#include "IndirectDrawCommand.h"
 
+// Set in ObjectConstants::Flags when the texture coordinates are scaled and offset by
+// TexScaleOffset.  Must match gObjectFlagTexTransform in Default.hlsl.
+const std::uint32_t ObjectFlagTexTransform = 0x1;
+
+// One render item's record in the frame's ObjectBuffer, which the vertex shader reads
+// at the index given by a root constant.  World matrices are affine, so only their
+// first three columns are kept, stored as rows.  Texture transforms are at most a
+// scale and an offset, and are only applied with ObjectFlagTexTransform set.
 struct ObjectConstants
 {
-    DirectX::XMFLOAT4X4 World = MathHelper::Identity4x4();
-	DirectX::XMFLOAT4X4 TexTransform = MathHelper::Identity4x4();
+	DirectX::XMFLOAT4 World[3];
+	DirectX::XMFLOAT4 TexScaleOffset = { 1.0f, 1.0f, 0.0f, 0.0f };
+	std::uint32_t Flags = 0;
 };
 
 struct PassConstants
@@ -48,13 +62,43 @@ struct Vertex
 	DirectX::XMFLOAT2 TexC;
 };
 
+// Converts GeometryGenerator vertices to Vertex; see VertexConversion::ConvertVertices.
+using StdVertexLayout = VertexConversion::Layout<
+	VERTEX_ATTRIBUTE(GeometryGenerator::Vertex, Position, Vertex, Pos, VertexConversion::Copy),
+	VERTEX_ATTRIBUTE(GeometryGenerator::Vertex, Normal, Vertex, Normal, VertexConversion::Copy),
+	VERTEX_ATTRIBUTE(GeometryGenerator::Vertex, TexC, Vertex, TexC, VertexConversion::Copy)>;
+
+// Per-frame part of a water vertex: the height and the normal packed to 8-bit snorm.
+// The x/z position and texture coordinates never change and live in a static stream.
+struct WaveVertex
+{
+	float Height;
+	DirectX::PackedVector::XMBYTEN4 Normal;
+};
+
+// One distant item drawn as an impostor; see Impostor.hlsl.  The quad spans
+// CenterW +- AxisX +- AxisY and shows the atlas frame whose top-left corner is at
+// (FrameU, FrameV) in slice Slice.
+struct ImpostorInstance
+{
+	DirectX::XMFLOAT3 CenterW;
+	float FrameSize;
+	DirectX::XMFLOAT3 AxisX;
+	float FrameU;
+	DirectX::XMFLOAT3 AxisY;
+	float FrameV;
+	std::uint32_t Slice;
+};
+
 // Stores the resources needed for the CPU to build the command lists
 // for a frame.  
 struct FrameResource
 {
 public:
     
-    FrameResource(ID3D12Device* device, UINT passCount, UINT objectCount, UINT materialCount, UINT waveVertCount);
+    FrameResource(ID3D12Device* device, UINT passCount, UINT objectCount, UINT materialCount, UINT waveVertCount,
+		bool splitWaveStreams = false, UINT waveSurfaceByteSize = 0, UINT treeInstanceCount = 0,
+		UINT impostorCount = 0);
 	FrameResource(ID3D12Device* device, UINT passCount, UINT objectCount, UINT materialCount);
     FrameResource(const FrameResource& rhs) = delete;
     FrameResource& operator=(const FrameResource& rhs) = delete;
@@ -69,12 +113,39 @@ public:
    // std::unique_ptr<UploadBuffer<FrameConstants>> FrameCB = nullptr;
     std::unique_ptr<UploadBuffer<PassConstants>> PassCB = nullptr;
     std::unique_ptr<UploadBuffer<MaterialConstants>> MaterialCB = nullptr;
-    std::unique_ptr<UploadBuffer<ObjectConstants>> ObjectCB = nullptr;
+
+	// Structured buffer of ObjectConstants, one per render item at its ObjCBIndex.
+	std::unique_ptr<UploadBuffer<ObjectConstants>> ObjectBuffer = nullptr;
+
+	// Version of the render item or material each ObjectBuffer and MaterialCB slot was
+	// last written from, 0 for slots never written.  Slots whose owner has a newer
+	// version are stale.
+	std::vector<std::uint64_t> ObjectVersions;
+	std::vector<std::uint64_t> MaterialCBVersions;
 
     // We cannot update a dynamic vertex buffer until the GPU is done processing
     // the commands that reference it.  So each frame needs their own.
     std::unique_ptr<UploadBuffer<Vertex>> WavesVB = nullptr;
 
+	// Used instead of WavesVB when the water's static attributes are in their own
+	// stream; only heights and normals are written each frame.
+	std::unique_ptr<UploadBuffer<WaveVertex>> WavesDynamicVB = nullptr;
+
+	// Packed height/slope texels (see Waves::PackSurfaceTexel), laid out with the row
+	// pitch a texture copy needs.  Copied into a texture the water vertex shader reads.
+	std::unique_ptr<UploadBuffer<std::uint32_t>> WavesSurface = nullptr;
+
+	// Visible tree sprites of the frame, written by the CPU culling pass.
+	std::unique_ptr<UploadBuffer<BillboardInstance>> TreeInstances = nullptr;
+	UINT TreeInstanceCount = 0;
+
+	// Items drawn as impostors this frame.
+	std::unique_ptr<UploadBuffer<ImpostorInstance>> ImpostorInstances = nullptr;
+
+	// Arguments for ExecuteIndirect, one per visible render item, written by the CPU
+	// culling pass each frame.
+	std::unique_ptr<UploadBuffer<IndirectDrawCommand>> IndirectArgs = nullptr;
+
     // Fence value to mark commands up to this fence point.  This lets us
     // check if these frame resources are still in use by the GPU.
     UINT64 Fence = 0;
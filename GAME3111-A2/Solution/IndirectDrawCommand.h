@@ -0,0 +1,28 @@
+//***************************************************************************************
+// IndirectDrawCommand.h
+//
+// One record of the indirect argument buffer.  The members must stay in the order of the
+// arguments in the command signature: material CBV, vertex buffers for slots 0 and 1,
+// index buffer, object index, then the draw itself.  The object index comes after the
+// 8 byte aligned members so nothing needs padding.
+//
+// Kept apart from FrameResource.h so the headless tests lay out commands with it too.
+//***************************************************************************************
+
+#pragma once
+
+#include <d3d12.h>
+#include <cstddef>
+
+struct IndirectDrawCommand
+{
+	D3D12_GPU_VIRTUAL_ADDRESS MaterialCBAddress;
+	D3D12_VERTEX_BUFFER_VIEW VertexBufferView;
+	D3D12_VERTEX_BUFFER_VIEW DynamicVertexBufferView;
+	D3D12_INDEX_BUFFER_VIEW IndexBufferView;
+	UINT ObjectIndex;
+	D3D12_DRAW_INDEXED_ARGUMENTS DrawArgs;
+};
+
+static_assert(sizeof(IndirectDrawCommand) % 16 == 0 && offsetof(IndirectDrawCommand, MaterialCBAddress) == 0,
+	"IndirectArgsPacker needs whole 16 byte blocks starting with the address.");
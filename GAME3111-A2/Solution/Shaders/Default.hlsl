@@ -33,10 +33,23 @@ SamplerState gsamAnisotropicClamp : register(s5);
 // Constant data that varies per frame.
 cbuffer cbPerObject : register(b0)
 {
-    float4x4 gWorld;
-	float4x4 gTexTransform;
+	// Index of the object being drawn in gObjects.
+	uint gObjectIndex;
 };
 
+// Must match ObjectFlagTexTransform in FrameResource.h.
+static const uint gObjectFlagTexTransform = 0x1;
+
+// See ObjectConstants.  World holds the first three columns of the world matrix.
+struct ObjectData
+{
+	float4 World[3];
+	float4 TexScaleOffset;
+	uint   Flags;
+};
+
+StructuredBuffer<ObjectData> gObjects : register(t0, space1);
+
 // Constant data that varies per material.
 cbuffer cbPass : register(b1)
 {
@@ -74,14 +87,48 @@ cbuffer cbMaterial : register(b2)
     float3   gFresnelR0;
     float    gRoughness;
 	float4x4 gMatTransform;
+	float2   gUvScrollSpeed;
+	float    gUvRotationSpeed;
+	float    gFlipbookFrameRate;
+	float2   gUvRotationCenter;
+	uint     gFlipbookFrameCount;
+	float    cbMaterialPad0;
 };
 
+#include "UvAnimation.hlsl"
+
+#if defined(WAVES_DISPLACEMENT)
+// Packed height and slopes of the water, one texel per grid point.  See
+// Waves::PackSurfaceTexel; gWaveMaxSlope must match Waves::SurfaceMaxSlope.
+Texture2D<uint> gWaveSurfaceMap : register(t1);
+static const float gWaveMaxSlope = 2.0f;
+
+// Only x/z and texture coordinates come from the vertex buffer; the grid point is
+// found from the vertex index.
+struct VertexIn
+{
+	float2 PosXZ    : POSITION;
+	float2 TexC     : TEXCOORD;
+	uint   VertexID : SV_VertexID;
+};
+#elif defined(WAVES)
+// The water comes in two streams: x/z and texture coordinates that never change in
+// slot 0, and the height and packed normal written every frame in slot 1.
+struct VertexIn
+{
+	float2 PosXZ   : POSITION;
+	float2 TexC    : TEXCOORD;
+	float  Height  : HEIGHT;
+	float4 NormalL : NORMAL;
+};
+#else
 struct VertexIn
 {
 	float3 PosL    : POSITION;
     float3 NormalL : NORMAL;
 	float2 TexC    : TEXCOORD;
 };
+#endif
 
 struct VertexOut
 {
@@ -94,20 +141,49 @@ struct VertexOut
 VertexOut VS(VertexIn vin)
 {
 	VertexOut vout = (VertexOut)0.0f;
+
+#if defined(WAVES_DISPLACEMENT)
+	uint width, height;
+	gWaveSurfaceMap.GetDimensions(width, height);
+	uint texel = gWaveSurfaceMap.Load(int3(vin.VertexID % width, vin.VertexID / width, 0));
+
+	float3 posL = float3(vin.PosXZ.x, f16tof32(texel), vin.PosXZ.y);
+
+	// Sign extend the two snorm8 slopes.
+	float slopeX = (float)(((int)(texel << 8)) >> 24) * (gWaveMaxSlope / 127.0f);
+	float slopeZ = (float)(((int)texel) >> 24) * (gWaveMaxSlope / 127.0f);
+	float3 normalL = normalize(float3(-slopeX, 1.0f, -slopeZ));
+#elif defined(WAVES)
+	float3 posL = float3(vin.PosXZ.x, vin.Height, vin.PosXZ.y);
+
+	// 8-bit normals are renormalized after interpolation in the pixel shader.
+	float3 normalL = vin.NormalL.xyz;
+#else
+	float3 posL = vin.PosL;
+	float3 normalL = vin.NormalL;
+#endif
+
+	ObjectData obj = gObjects[gObjectIndex];
 	
     // Transform to world space.
-    float4 posW = mul(float4(vin.PosL, 1.0f), gWorld);
+    float4 posW = float4(dot(float4(posL, 1.0f), obj.World[0]),
+                         dot(float4(posL, 1.0f), obj.World[1]),
+                         dot(float4(posL, 1.0f), obj.World[2]), 1.0f);
     vout.PosW = posW.xyz;
 
     // Assumes nonuniform scaling; otherwise, need to use inverse-transpose of world matrix.
-    vout.NormalW = mul(vin.NormalL, (float3x3)gWorld);
+    vout.NormalW = float3(dot(normalL, obj.World[0].xyz),
+                          dot(normalL, obj.World[1].xyz),
+                          dot(normalL, obj.World[2].xyz));
 
     // Transform to homogeneous clip space.
     vout.PosH = mul(posW, gViewProj);
 	
 	// Output vertex attributes for interpolation across triangle.
-	float4 texC = mul(float4(vin.TexC, 0.0f, 1.0f), gTexTransform);
-	vout.TexC = mul(texC, gMatTransform).xy;
+	float2 texC = vin.TexC;
+	if(obj.Flags & gObjectFlagTexTransform)
+		texC = texC*obj.TexScaleOffset.xy + obj.TexScaleOffset.zw;
+	vout.TexC = AnimateTexC(mul(float4(texC, 0.0f, 1.0f), gMatTransform).xy);
 
     return vout;
 }
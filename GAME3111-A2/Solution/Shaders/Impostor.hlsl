@@ -0,0 +1,157 @@
+//***************************************************************************************
+// Impostor.hlsl
+//
+// Draws distant items as quads that show a frame of their baked impostor atlas (see
+// ImpostorBaker).  Slot 0 holds the corners of a unit quad, slot 1 one ImpostorInstance
+// per item.  The atlas stores the textured albedo and world space normals, so the quad
+// is lit like the mesh it stands in for.
+//***************************************************************************************
+
+// Defaults for number of lights.
+#ifndef NUM_DIR_LIGHTS
+    #define NUM_DIR_LIGHTS 3
+#endif
+
+#ifndef NUM_POINT_LIGHTS
+    #define NUM_POINT_LIGHTS 0
+#endif
+
+#ifndef NUM_SPOT_LIGHTS
+    #define NUM_SPOT_LIGHTS 0
+#endif
+
+// Include structures and functions for lighting.
+#include "LightingUtil.hlsl"
+
+Texture2DArray gImpostorAlbedo  : register(t2);
+Texture2DArray gImpostorNormal  : register(t3);
+
+SamplerState gsamPointWrap        : register(s0);
+SamplerState gsamPointClamp       : register(s1);
+SamplerState gsamLinearWrap       : register(s2);
+SamplerState gsamLinearClamp      : register(s3);
+SamplerState gsamAnisotropicWrap  : register(s4);
+SamplerState gsamAnisotropicClamp : register(s5);
+
+// Constant data that varies per frame.
+cbuffer cbPerObject : register(b0)
+{
+	uint gObjectIndex;
+};
+
+// Constant data that varies per material.
+cbuffer cbPass : register(b1)
+{
+    float4x4 gView;
+    float4x4 gInvView;
+    float4x4 gProj;
+    float4x4 gInvProj;
+    float4x4 gViewProj;
+    float4x4 gInvViewProj;
+    float3 gEyePosW;
+    float cbPerObjectPad1;
+    float2 gRenderTargetSize;
+    float2 gInvRenderTargetSize;
+    float gNearZ;
+    float gFarZ;
+    float gTotalTime;
+    float gDeltaTime;
+    float4 gAmbientLight;
+
+	float4 gFogColor;
+	float gFogStart;
+	float gFogRange;
+	float2 cbPerObjectPad2;
+
+    // Indices [0, NUM_DIR_LIGHTS) are directional lights;
+    // indices [NUM_DIR_LIGHTS, NUM_DIR_LIGHTS+NUM_POINT_LIGHTS) are point lights;
+    // indices [NUM_DIR_LIGHTS+NUM_POINT_LIGHTS, NUM_DIR_LIGHTS+NUM_POINT_LIGHT+NUM_SPOT_LIGHTS)
+    // are spot lights for a maximum of MaxLights per object.
+    Light gLights[MaxLights];
+};
+
+cbuffer cbMaterial : register(b2)
+{
+	float4   gDiffuseAlbedo;
+    float3   gFresnelR0;
+    float    gRoughness;
+	float4x4 gMatTransform;
+};
+
+struct VertexIn
+{
+	float2 Corner : CORNER;
+
+	// xyz is the center, w the size of one frame in atlas coordinates.
+	float4 CenterW : POSITION;
+
+	// xyz are the half extents of the quad, w the top-left corner of the frame.
+	float4 AxisX : AXIS0;
+	float4 AxisY : AXIS1;
+
+	uint Slice : ARRAYSLICE;
+};
+
+struct VertexOut
+{
+	float4 PosH   : SV_POSITION;
+	float3 PosW   : POSITION;
+	float2 AtlasC : TEXCOORD;
+	nointerpolation uint Slice : ARRAYSLICE;
+};
+
+VertexOut VS(VertexIn vin)
+{
+	VertexOut vout;
+
+	float3 posW = vin.CenterW.xyz + vin.Corner.x*vin.AxisX.xyz + vin.Corner.y*vin.AxisY.xyz;
+
+	vout.PosH = mul(float4(posW, 1.0f), gViewProj);
+	vout.PosW = posW;
+
+	// Frames are stored with y pointing down.
+	float2 frameC = float2(0.5f + 0.5f*vin.Corner.x, 0.5f - 0.5f*vin.Corner.y);
+	vout.AtlasC = float2(vin.AxisX.w, vin.AxisY.w) + frameC*vin.CenterW.w;
+	vout.Slice = vin.Slice;
+
+	return vout;
+}
+
+float4 PS(VertexOut pin) : SV_Target
+{
+	float3 uvw = float3(pin.AtlasC, pin.Slice);
+
+	float4 bakedAlbedo = gImpostorAlbedo.Sample(gsamLinearClamp, uvw);
+	clip(bakedAlbedo.a - 0.5f);
+
+	// The diffuse map was sampled into the atlas when it was baked; the material's
+	// albedo multiplies it as in Default.hlsl.
+	float4 diffuseAlbedo = bakedAlbedo*gDiffuseAlbedo;
+
+	float3 normalW = normalize(gImpostorNormal.Sample(gsamLinearClamp, uvw).xyz*2.0f - 1.0f);
+
+    // Vector from point being lit to eye.
+	float3 toEyeW = gEyePosW - pin.PosW;
+	float distToEye = length(toEyeW);
+	toEyeW /= distToEye; // normalize
+
+    // Light terms.
+    float4 ambient = gAmbientLight*diffuseAlbedo;
+
+    const float shininess = 1.0f - gRoughness;
+    Material mat = { diffuseAlbedo, gFresnelR0, shininess };
+    float3 shadowFactor = 1.0f;
+    float4 directLight = ComputeLighting(gLights, mat, pin.PosW,
+        normalW, toEyeW, shadowFactor);
+
+    float4 litColor = ambient + directLight;
+
+#ifdef FOG
+	float fogAmount = saturate((distToEye - gFogStart) / gFogRange);
+	litColor = lerp(litColor, gFogColor, fogAmount);
+#endif
+
+    litColor.a = 1.0f;
+
+    return litColor;
+}
@@ -34,8 +34,7 @@ SamplerState gsamAnisotropicClamp : register(s5);
 // Constant data that varies per frame.
 cbuffer cbPerObject : register(b0)
 {
-    float4x4 gWorld;
-	float4x4 gTexTransform;
+	uint gObjectIndex;
 };
 
 // Constant data that varies per material.
@@ -75,8 +74,60 @@ cbuffer cbMaterial : register(b2)
     float3   gFresnelR0;
     float    gRoughness;
 	float4x4 gMatTransform;
+	float2   gUvScrollSpeed;
+	float    gUvRotationSpeed;
+	float    gFlipbookFrameRate;
+	float2   gUvRotationCenter;
+	uint     gFlipbookFrameCount;
+	float    cbMaterialPad0;
 };
+
+#include "UvAnimation.hlsl"
  
+#ifdef INSTANCED
+// A static quad in slot 0 and one BillboardInstance per sprite in slot 1.  The vertex
+// shader does what the geometry shader does below, one corner at a time.
+struct VertexIn
+{
+	float2 Corner     : CORNER;
+	float2 TexC       : TEXCOORD;
+	float3 CenterW    : POSITION;
+	float2 SizeW      : SIZE;
+	uint   ArraySlice : ARRAYSLICE;
+};
+
+struct GeoOut
+{
+	float4 PosH    : SV_POSITION;
+    float3 PosW    : POSITION;
+    float3 NormalW : NORMAL;
+    float2 TexC    : TEXCOORD;
+    nointerpolation uint ArraySlice : ARRAYSLICE;
+};
+
+GeoOut VS(VertexIn vin)
+{
+	// Same y-axis aligned frame as the geometry shader.
+	float3 up = float3(0.0f, 1.0f, 0.0f);
+	float3 look = gEyePosW - vin.CenterW;
+	look.y = 0.0f;
+	look = normalize(look);
+	float3 right = cross(up, look);
+
+	float3 posW = vin.CenterW +
+		(0.5f*vin.SizeW.x*vin.Corner.x)*right +
+		(0.5f*vin.SizeW.y*vin.Corner.y)*up;
+
+	GeoOut vout;
+	vout.PosH       = mul(float4(posW, 1.0f), gViewProj);
+	vout.PosW       = posW;
+	vout.NormalW    = look;
+	vout.TexC       = vin.TexC;
+	vout.ArraySlice = vin.ArraySlice;
+
+	return vout;
+}
+#else
 struct VertexIn
 {
 	float3 PosW  : POSITION;
@@ -166,11 +217,16 @@ void GS(point VertexOut gin[1], //PrimitiveType InputVertexType InputName[NumEle
 		triStream.Append(gout);
 	}
 }
+#endif
 
 //step6
 float4 PS(GeoOut pin) : SV_Target
 {
-	float3 uvw = float3(pin.TexC, pin.PrimID%3);
+#ifdef INSTANCED
+	float3 uvw = float3(AnimateTexC(pin.TexC), FlipbookSlice(pin.ArraySlice));
+#else
+	float3 uvw = float3(AnimateTexC(pin.TexC), FlipbookSlice(pin.PrimID%3));
+#endif
     float4 diffuseAlbedo = gTreeMapArray.Sample(gsamAnisotropicWrap, uvw) * gDiffuseAlbedo;
 
     //using dynamic indexing
@@ -0,0 +1,41 @@
+//***************************************************************************************
+// Upscale.hlsl
+//
+// Stretches the part of the scene render target that was actually rendered to over the
+// whole back buffer.  Drawn as a single triangle covering the screen; no vertex buffer.
+//***************************************************************************************
+
+Texture2D gSceneMap : register(t0);
+
+SamplerState gsamLinearClamp : register(s0);
+
+cbuffer cbUpscale : register(b0)
+{
+	// Rendered size divided by the size of the scene render target.
+	float2 gUVScale;
+
+	// Center of the last rendered texel, so filtering never reads past it.
+	float2 gUVMax;
+};
+
+struct VertexOut
+{
+	float4 PosH : SV_POSITION;
+	float2 TexC : TEXCOORD;
+};
+
+VertexOut VS(uint vid : SV_VertexID)
+{
+	VertexOut vout;
+
+	// (0,0), (2,0), (0,2) in texture space covers the [0,1] square.
+	vout.TexC = float2((vid << 1) & 2, vid & 2);
+	vout.PosH = float4(vout.TexC.x*2.0f - 1.0f, 1.0f - vout.TexC.y*2.0f, 0.0f, 1.0f);
+
+	return vout;
+}
+
+float4 PS(VertexOut pin) : SV_Target
+{
+	return gSceneMap.Sample(gsamLinearClamp, min(pin.TexC*gUVScale, gUVMax));
+}
@@ -0,0 +1,36 @@
+//***************************************************************************************
+// UvAnimation.hlsl
+//
+// Texture coordinate animation of the current material (see UvAnimation in d3dUtil.h),
+// evaluated from gTotalTime.  Include after cbPass and cbMaterial.
+//***************************************************************************************
+
+// Rotates texC about gUvRotationCenter, then scrolls it.
+float2 AnimateTexC(float2 texC)
+{
+	if(gUvRotationSpeed != 0.0f)
+	{
+		// Keep the angle small so it stays precise however long the app runs.
+		float angle = fmod(gUvRotationSpeed*gTotalTime, 6.28318530f);
+
+		float s, c;
+		sincos(angle, s, c);
+
+		float2 d = texC - gUvRotationCenter;
+		texC = gUvRotationCenter + float2(c*d.x - s*d.y, s*d.x + c*d.y);
+	}
+
+	// Wrap addressing repeats every unit, so only the fraction of the offset matters.
+	return texC + frac(gUvScrollSpeed*gTotalTime);
+}
+
+// Slice of an array texture to sample: with a flipbook, the frame due at gTotalTime,
+// counted from firstSlice so items can play out of step.
+uint FlipbookSlice(uint firstSlice)
+{
+	if(gFlipbookFrameCount == 0)
+		return firstSlice;
+
+	uint frame = (uint)(gTotalTime*gFlipbookFrameRate);
+	return (firstSlice + frame) % gFlipbookFrameCount;
+}
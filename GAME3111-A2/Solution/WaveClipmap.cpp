@@ -0,0 +1,280 @@
+//***************************************************************************************
+// WaveClipmap.cpp
+//***************************************************************************************
+
+#include "WaveClipmap.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+using namespace DirectX;
+
+WaveClipmap::WaveClipmap(int levelCount, int size, float dx, float dt, float speed, float damping, int spongeWidth)
+{
+	assert(levelCount > 0);
+	assert(size >= 9 && (size - 1) % 4 == 0);
+
+	mSize = size;
+	mTimeStep = dt;
+
+	for(int level = 0; level < levelCount; ++level)
+	{
+		float scale = (float)(1 << level);
+		int sponge = level == levelCount - 1 ? spongeWidth : 0;
+		mLevels.push_back(std::make_unique<Waves>(size, size, dx*scale, dt*scale, speed, damping, sponge));
+	}
+
+	mCenterX.assign(levelCount, 0);
+	mCenterZ.assign(levelCount, 0);
+	mStepCounts.assign(levelCount, 0);
+}
+
+int WaveClipmap::LevelCount()const
+{
+	return (int)mLevels.size();
+}
+
+const Waves& WaveClipmap::Level(int level)const
+{
+	return *mLevels[level];
+}
+
+XMFLOAT2 WaveClipmap::LevelCenter(int level)const
+{
+	float spacing = LevelSpacing(level);
+	return XMFLOAT2(mCenterX[level]*spacing, mCenterZ[level]*spacing);
+}
+
+float WaveClipmap::LevelSpacing(int level)const
+{
+	return mLevels[level]->SpatialStep();
+}
+
+float WaveClipmap::Extent()const
+{
+	return (mSize - 1)*LevelSpacing(LevelCount() - 1);
+}
+
+const WaveClipmapStats& WaveClipmap::Stats()const
+{
+	return mStats;
+}
+
+void WaveClipmap::Update(const XMFLOAT3& eye, float dt)
+{
+	mStats = WaveClipmapStats();
+
+	Recenter(eye);
+
+	mTime += dt;
+	if(mTime < mTimeStep)
+		return;
+	mTime = 0.0f;
+
+	// Level l steps on every 2^l-th level 0 step.  Coarser levels go first, so a finer
+	// level always has the next coarser one at or ahead of its own time to drive its
+	// boundary from.
+	std::uint64_t step = mStepCounts[0];
+	std::uint64_t interior = (std::uint64_t)(mSize - 2)*(mSize - 2);
+	for(int level = LevelCount() - 1; level >= 0; --level)
+	{
+		if(step % (1ull << level) != 0)
+			continue;
+
+		if(level + 1 < LevelCount())
+			BlendBoundary(level);
+
+		mLevels[level]->Update(mLevels[level]->TimeStep());
+		++mStepCounts[level];
+		mStats.CellsSimulated += interior;
+
+		if(level + 1 < LevelCount() && mStepCounts[level] == 2*mStepCounts[level + 1])
+			Restrict(level);
+	}
+
+	std::uint64_t uniformSize = (std::uint64_t)(mSize - 1)*(1ull << (LevelCount() - 1)) + 1;
+	mStats.Steps = 1;
+	mStats.UniformCells = (uniformSize - 2)*(uniformSize - 2);
+}
+
+void WaveClipmap::GridPoint(int level, float x, float z, float& i, float& j)const
+{
+	// Point (i, j) is at x = (centerX - h + j)*spacing and z = (centerZ + h - i)*spacing,
+	// with h the index of the center.
+	float spacing = LevelSpacing(level);
+	float h = 0.5f*(mSize - 1);
+	i = h - (z / spacing - mCenterZ[level]);
+	j = x / spacing - mCenterX[level] + h;
+}
+
+float WaveClipmap::Sample(int level, float i, float j, float t)const
+{
+	const Waves& waves = *mLevels[level];
+
+	float last = (float)(mSize - 1);
+	i = std::min(std::max(i, 0.0f), last);
+	j = std::min(std::max(j, 0.0f), last);
+
+	int i0 = std::min((int)i, mSize - 2);
+	int j0 = std::min((int)j, mSize - 2);
+	float fi = i - i0;
+	float fj = j - j0;
+
+	auto height = [&](int r, int c)
+	{
+		return waves.PreviousHeight(r, c) + t*(waves.Height(r, c) - waves.PreviousHeight(r, c));
+	};
+
+	float top = height(i0, j0) + fj*(height(i0, j0 + 1) - height(i0, j0));
+	float bottom = height(i0 + 1, j0) + fj*(height(i0 + 1, j0 + 1) - height(i0 + 1, j0));
+	return top + fi*(bottom - top);
+}
+
+float WaveClipmap::CoarserTime(int level)const
+{
+	// The coarser level's step is two of this level's, and it is 0..2 of them ahead.
+	std::uint64_t lag = 2*mStepCounts[level + 1] - mStepCounts[level];
+	return 1.0f - 0.5f*lag;
+}
+
+void WaveClipmap::Recenter(const XMFLOAT3& eye)
+{
+	int h = (mSize - 1) / 2;
+
+	// Coarser levels first, so uncovered points can be filled from their new position.
+	for(int level = LevelCount() - 1; level >= 0; --level)
+	{
+		float spacing = LevelSpacing(level);
+		int centerX = 2*(int)std::floor(eye.x / (2.0f*spacing) + 0.5f);
+		int centerZ = 2*(int)std::floor(eye.z / (2.0f*spacing) + 0.5f);
+
+		int columns = centerX - mCenterX[level];
+		int rows = mCenterZ[level] - centerZ;
+		if(rows == 0 && columns == 0)
+			continue;
+
+		Waves& waves = *mLevels[level];
+		waves.Scroll(rows, columns);
+		mCenterX[level] = centerX;
+		mCenterZ[level] = centerZ;
+		++mStats.LevelsScrolled;
+
+		// The coarsest level starts calm where it uncovers water.
+		if(level + 1 == LevelCount())
+			continue;
+
+		float t = CoarserTime(level);
+		for(int i = 0; i < mSize; ++i)
+		{
+			for(int j = 0; j < mSize; ++j)
+			{
+				int si = i + rows;
+				int sj = j + columns;
+				if(si >= 0 && si < mSize && sj >= 0 && sj < mSize)
+					continue;
+
+				float x = (centerX - h + j)*spacing;
+				float z = (centerZ + h - i)*spacing;
+				float ci, cj;
+				GridPoint(level + 1, x, z, ci, cj);
+				waves.SetHeight(i, j, Sample(level + 1, ci, cj, t), Sample(level + 1, ci, cj, t - 0.5f));
+			}
+		}
+	}
+}
+
+void WaveClipmap::BlendBoundary(int level)
+{
+	Waves& waves = *mLevels[level];
+	float spacing = LevelSpacing(level);
+	float t = CoarserTime(level);
+	int h = (mSize - 1) / 2;
+
+	// Points d < BlendWidth from the edge move towards the coarser level's heights and
+	// velocities by ((BlendWidth - d) / BlendWidth)^2, so the edge itself takes them
+	// over.  Waves too short for the coarser level fade out in the band instead of
+	// reflecting off a hard edge.
+	for(int i = 0; i < mSize; ++i)
+	{
+		int rowDistance = std::min(i, mSize - 1 - i);
+		for(int j = 0; j < mSize; ++j)
+		{
+			int d = std::min(rowDistance, std::min(j, mSize - 1 - j));
+			if(d >= BlendWidth)
+			{
+				// On to the band at the end of the row.
+				j = mSize - 1 - BlendWidth;
+				continue;
+			}
+
+			float x = (mCenterX[level] - h + j)*spacing;
+			float z = (mCenterZ[level] + h - i)*spacing;
+			float ci, cj;
+			GridPoint(level + 1, x, z, ci, cj);
+
+			float w = (float)(BlendWidth - d) / BlendWidth;
+			w *= w;
+			float curr = waves.Height(i, j) + w*(Sample(level + 1, ci, cj, t) - waves.Height(i, j));
+			float prev = waves.PreviousHeight(i, j) + w*(Sample(level + 1, ci, cj, t - 0.5f) - waves.PreviousHeight(i, j));
+			waves.SetHeight(i, j, curr, prev);
+		}
+	}
+}
+
+void WaveClipmap::Restrict(int level)
+{
+	const Waves& fine = *mLevels[level];
+	Waves& coarse = *mLevels[level + 1];
+
+	// Every other point of the finer level is a point of the coarser one.  Skip the
+	// band along the edge, which follows the coarser level, and filter out what the
+	// coarser level cannot represent.
+	float ci, cj;
+	GridPoint(level + 1, LevelCenter(level).x, LevelCenter(level).y, ci, cj);
+	int h = (mSize - 1) / 2;
+	int originI = (int)std::floor(ci + 0.5f) - h / 2;
+	int originJ = (int)std::floor(cj + 0.5f) - h / 2;
+
+	const int margin = (BlendWidth + 1) / 2 * 2;
+	for(int i = margin; i <= mSize - 1 - margin; i += 2)
+	{
+		for(int j = margin; j <= mSize - 1 - margin; j += 2)
+		{
+			float filtered = 0.25f*fine.Height(i, j) +
+				0.125f*(fine.Height(i-1, j) + fine.Height(i+1, j) + fine.Height(i, j-1) + fine.Height(i, j+1)) +
+				0.0625f*(fine.Height(i-1, j-1) + fine.Height(i-1, j+1) + fine.Height(i+1, j-1) + fine.Height(i+1, j+1));
+			coarse.SetHeight(originI + i / 2, originJ + j / 2, filtered);
+		}
+	}
+}
+
+void WaveClipmap::Disturb(float x, float z, float magnitude)
+{
+	for(int level = 0; level < LevelCount(); ++level)
+	{
+		float fi, fj;
+		GridPoint(level, x, z, fi, fj);
+		int i = (int)std::floor(fi + 0.5f);
+		int j = (int)std::floor(fj + 0.5f);
+
+		if(i > 1 && i < mSize - 2 && j > 1 && j < mSize - 2)
+		{
+			mLevels[level]->Disturb(i, j, magnitude);
+			return;
+		}
+	}
+}
+
+float WaveClipmap::Height(float x, float z)const
+{
+	float last = (float)(mSize - 1);
+	for(int level = 0; level < LevelCount(); ++level)
+	{
+		float i, j;
+		GridPoint(level, x, z, i, j);
+		if(i >= 0.0f && i <= last && j >= 0.0f && j <= last)
+			return Sample(level, i, j, 1.0f);
+	}
+
+	return 0.0f;
+}
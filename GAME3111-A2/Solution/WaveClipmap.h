@@ -0,0 +1,101 @@
+//***************************************************************************************
+// WaveClipmap.h
+//
+// Water simulated on nested Waves grids that follow the camera.  Level 0 is the finest;
+// every further level has twice the spacing and twice the time step, so with the same
+// number of points it covers four times the area and steps half as often.
+//
+// A level is centered on a multiple of twice its spacing nearest the camera, and
+// scrolls its heights when that moves, filling the points it uncovers from the next
+// coarser level.  Before a level steps, a band along its edge is blended towards the
+// next coarser level, interpolated in space and time.  When it has caught up with that
+// level in time, its filtered heights are copied into the points the two have in
+// common.  The coarsest level has a sponge, so waves leave the simulated area instead
+// of coming back.
+//***************************************************************************************
+
+#pragma once
+
+#include "Waves.h"
+#include <memory>
+#include <vector>
+
+struct WaveClipmapStats
+{
+	// Level 0 steps taken by the last Update.
+	int Steps = 0;
+
+	// Grid points advanced by the last Update over all levels, and what one grid with
+	// level 0's spacing and time step covering the coarsest level would have advanced.
+	std::uint64_t CellsSimulated = 0;
+	std::uint64_t UniformCells = 0;
+
+	// Levels that moved with the camera in the last Update.
+	int LevelsScrolled = 0;
+};
+
+class WaveClipmap
+{
+public:
+	// Each level is a size x size grid, where size must be 4k + 1 so a level's corners
+	// and center are points of the next level.  dx and dt are level 0's.
+	WaveClipmap(int levelCount, int size, float dx, float dt, float speed, float damping, int spongeWidth = 8);
+	WaveClipmap(const WaveClipmap& rhs) = delete;
+	WaveClipmap& operator=(const WaveClipmap& rhs) = delete;
+
+	// Width in points of the band along a level's edge that follows the next level.
+	static const int BlendWidth = 4;
+
+	int LevelCount()const;
+	const Waves& Level(int level)const;
+
+	// World x and z of a level's center point, and its spacing.
+	DirectX::XMFLOAT2 LevelCenter(int level)const;
+	float LevelSpacing(int level)const;
+
+	// Side of the square the coarsest level covers.
+	float Extent()const;
+
+	// Moves the levels with eye.x and eye.z, then advances the water by dt.  Like
+	// Waves::Update, it takes at most one level 0 step.
+	void Update(const DirectX::XMFLOAT3& eye, float dt);
+
+	// Disturbs the finest level that has x, z away from its edge.
+	void Disturb(float x, float z, float magnitude);
+
+	// Height at x, z from the finest level that covers it, 0 outside all of them.
+	float Height(float x, float z)const;
+
+	const WaveClipmapStats& Stats()const;
+
+private:
+	// Fractional grid point of level at world x, z.
+	void GridPoint(int level, float x, float z, float& i, float& j)const;
+
+	// Bilinear height of level at fractional point (i, j), t of the way from its
+	// previous to its current heights.
+	float Sample(int level, float i, float j, float t)const;
+
+	// Where the current and previous heights of level fall between those of the next
+	// coarser level, for Sample's t.
+	float CoarserTime(int level)const;
+
+	void Recenter(const DirectX::XMFLOAT3& eye);
+	void BlendBoundary(int level);
+	void Restrict(int level);
+
+	int mSize = 0;
+	float mTimeStep = 0.0f;
+	float mTime = 0.0f;
+
+	std::vector<std::unique_ptr<Waves>> mLevels;
+
+	// Centers in units of the level's spacing, always even.
+	std::vector<int> mCenterX;
+	std::vector<int> mCenterZ;
+
+	// Steps each level has taken.
+	std::vector<std::uint64_t> mStepCounts;
+
+	WaveClipmapStats mStats;
+};
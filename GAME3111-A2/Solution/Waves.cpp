@@ -3,14 +3,170 @@
 //***************************************************************************************
 
 #include "Waves.h"
+#include <DirectXPackedVector.h>
 #include <ppl.h>
 #include <algorithm>
 #include <vector>
 #include <cassert>
+#include <cmath>
 
 using namespace DirectX;
+using namespace DirectX::PackedVector;
 
-Waves::Waves(int m, int n, float dx, float dt, float speed, float damping)
+const float Waves::SurfaceMaxSlope = 2.0f;
+const float Waves::SpongeReflection = 0.001f;
+
+namespace
+{
+	// Steps columns [first, last) of one row, four at a time, writing the new heights
+	// over prev.  With PerColumn, k1..k3 hold a coefficient for every column; otherwise
+	// k1[0]..k3[0] apply to the whole row.  Returns true if a height changed.
+	template<bool PerColumn>
+	bool StepRow(float* prev, const float* curr, const float* above, const float* below,
+		const float* k1, const float* k2, const float* k3, int first, int last)
+	{
+		XMVECTOR c1 = XMVectorReplicate(k1[0]);
+		XMVECTOR c2 = XMVectorReplicate(k2[0]);
+		XMVECTOR c3 = XMVectorReplicate(k3[0]);
+
+		bool changed = false;
+		int j = first;
+		for(; j + 4 <= last; j += 4)
+		{
+			if(PerColumn)
+			{
+				c1 = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(k1 + j));
+				c2 = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(k2 + j));
+				c3 = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(k3 + j));
+			}
+
+			XMVECTOR p = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(prev + j));
+			XMVECTOR c = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(curr + j));
+			XMVECTOR neighbors = XMVectorAdd(
+				XMVectorAdd(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(above + j)),
+				            XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(below + j))),
+				XMVectorAdd(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(curr + j + 1)),
+				            XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(curr + j - 1))));
+
+			XMVECTOR h = XMVectorMultiplyAdd(c1, p, XMVectorMultiplyAdd(c2, c, XMVectorMultiply(c3, neighbors)));
+			changed |= XMVector4NotEqual(h, c);
+
+			XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(prev + j), h);
+		}
+
+		for(; j < last; ++j)
+		{
+			int k = PerColumn ? j : 0;
+			float h = k1[k]*prev[j] + k2[k]*curr[j] + k3[k]*(above[j] + below[j] + curr[j+1] + curr[j-1]);
+			changed |= (h != curr[j]);
+			prev[j] = h;
+		}
+
+		return changed;
+	}
+
+	// Solves (1 - s*second difference) x = d in place down the interior columns of a
+	// rows x cols array, with x = 0 on the first and last row.  inv and back are the
+	// factors from Waves::LineSolver.  Neighboring columns are independent systems with
+	// the same factors, so they are solved four at a time, in strips of Strip columns
+	// that run in parallel.
+	void SolveColumns(float* d, int rows, int cols, const float* inv, const float* back, float s)
+	{
+		const int Strip = 16;
+		int length = rows - 2;
+		int stripCount = (cols - 2 + Strip - 1) / Strip;
+
+		concurrency::parallel_for(0, stripCount, [=](int strip)
+		{
+			int first = 1 + strip*Strip;
+			int last = std::min(first + Strip, cols - 1);
+			int vectorEnd = first + (last - first) / 4 * 4;
+
+			XMVECTOR sv = XMVectorReplicate(s);
+
+			// Forward elimination: d'[k] = (d[k] + s*d'[k-1]) * inv[k].
+			for(int j = first; j < vectorEnd; j += 4)
+			{
+				XMVECTOR prev = XMVectorZero();
+				for(int k = 0; k < length; ++k)
+				{
+					auto p = reinterpret_cast<XMFLOAT4*>(d + (k+1)*cols + j);
+					prev = XMVectorMultiply(XMVectorMultiplyAdd(sv, prev, XMLoadFloat4(p)), XMVectorReplicate(inv[k]));
+					XMStoreFloat4(p, prev);
+				}
+
+				// Back substitution: x[k] = d'[k] + back[k]*x[k+1].
+				XMVECTOR next = prev;
+				for(int k = length - 2; k >= 0; --k)
+				{
+					auto p = reinterpret_cast<XMFLOAT4*>(d + (k+1)*cols + j);
+					next = XMVectorMultiplyAdd(XMVectorReplicate(back[k]), next, XMLoadFloat4(p));
+					XMStoreFloat4(p, next);
+				}
+			}
+
+			for(int j = vectorEnd; j < last; ++j)
+			{
+				float prev = 0.0f;
+				for(int k = 0; k < length; ++k)
+				{
+					float& x = d[(k+1)*cols + j];
+					x = (x + s*prev)*inv[k];
+					prev = x;
+				}
+
+				float next = prev;
+				for(int k = length - 2; k >= 0; --k)
+				{
+					float& x = d[(k+1)*cols + j];
+					x += back[k]*next;
+					next = x;
+				}
+			}
+		});
+	}
+
+	// dst (cols x rows) = transpose of src (rows x cols), in blocks that stay in cache.
+	void Transpose(const float* src, float* dst, int rows, int cols)
+	{
+		const int Block = 32;
+		int blockRows = (rows + Block - 1) / Block;
+
+		concurrency::parallel_for(0, blockRows, [=](int b)
+		{
+			int i0 = b*Block;
+			int i1 = std::min(i0 + Block, rows);
+			for(int j0 = 0; j0 < cols; j0 += Block)
+			{
+				int j1 = std::min(j0 + Block, cols);
+				for(int i = i0; i < i1; ++i)
+				{
+					for(int j = j0; j < j1; ++j)
+						dst[j*rows + i] = src[i*cols + j];
+				}
+			}
+		});
+	}
+}
+
+void Waves::LineSolver::Build(int length, float s)
+{
+	// Diagonal 1 + 2s, off diagonals -s.  The matrix is diagonally dominant, so the
+	// elimination needs no pivoting.
+	S = s;
+	Inv.resize(std::max(length, 0));
+	Back.resize(std::max(length, 0));
+
+	float prevBack = 0.0f;
+	for(int k = 0; k < length; ++k)
+	{
+		Inv[k] = 1.0f / (1.0f + 2.0f*s - s*prevBack);
+		Back[k] = s*Inv[k];
+		prevBack = Back[k];
+	}
+}
+
+Waves::Waves(int m, int n, float dx, float dt, float speed, float damping, int spongeWidth)
 {
     mNumRows = m;
     mNumCols = n;
@@ -20,17 +176,22 @@ Waves::Waves(int m, int n, float dx, float dt, float speed, float damping)
 
     mTimeStep = dt;
     mSpatialStep = dx;
+    mSpeed = speed;
 
     float d = damping*dt + 2.0f;
     float e = (speed*speed)*(dt*dt) / (dx*dx);
     mK1 = (damping*dt - 2.0f) / d;
     mK2 = (4.0f - 8.0f*e) / d;
     mK3 = (2.0f*e) / d;
+    mDecay = std::exp(-damping*dt);
 
-    mPrevSolution.resize(m*n);
+    mPrevHeights.resize(m*n);
+    mCurrHeights.resize(m*n);
     mCurrSolution.resize(m*n);
     mNormals.resize(m*n);
     mTangentX.resize(m*n);
+    mHeightChanged.resize(m);
+    mRowChanged.resize(m);
 
     // Generate grid vertices in system memory.
 
@@ -43,12 +204,107 @@ Waves::Waves(int m, int n, float dx, float dt, float speed, float damping)
         {
             float x = -halfWidth + j*dx;
 
-            mPrevSolution[i*n + j] = XMFLOAT3(x, 0.0f, z);
             mCurrSolution[i*n + j] = XMFLOAT3(x, 0.0f, z);
             mNormals[i*n + j] = XMFLOAT3(0.0f, 1.0f, 0.0f);
             mTangentX[i*n + j] = XMFLOAT3(1.0f, 0.0f, 0.0f);
         }
     }
+
+    // The sponge has to leave interior cells, or there is nothing to see.
+    mSpongeWidth = std::max(0, std::min(spongeWidth, (std::min(m, n) - 1) / 2 - 1));
+    if(mSpongeWidth > 0)
+        BuildSpongeCoefficients(speed, damping);
+
+    BuildSpans();
+
+    // Steps too long for the explicit integrator are taken implicitly.
+    SetIntegrator(Integrator::Explicit);
+}
+
+float Waves::MaxExplicitTimeStep(float dx, float speed)
+{
+	// Stable while (speed*dt/dx)^2 <= 1/2.
+	return dx / (speed*std::sqrt(2.0f));
+}
+
+void Waves::SetIntegrator(Integrator integrator)
+{
+	if(mTimeStep > MaxExplicitTimeStep(mSpatialStep, mSpeed))
+		integrator = Integrator::Implicit;
+
+	mIntegrator = integrator;
+
+	if(mIntegrator == Integrator::Implicit && mColumnSolver.Inv.empty())
+		BuildImplicitSolvers();
+}
+
+Waves::Integrator Waves::GetIntegrator()const
+{
+	return mIntegrator;
+}
+
+void Waves::BuildImplicitSolvers()
+{
+	// The scheme (Lees' ADI for the wave equation) with D = h[n+1] - 2h[n] + h[n-1]:
+	//
+	//   (1 - a*dxx)(1 - a*dzz) D = dt^2 c^2 (dxx + dzz) h[n],   a = beta dt^2 c^2
+	//
+	// where dxx and dzz are second differences.  With beta >= 1/4 it is stable for any
+	// dt.  Damping is applied to the resulting velocity.
+	const float beta = 0.25f;
+	float s = beta*(mSpeed*mSpeed)*(mTimeStep*mTimeStep) / (mSpatialStep*mSpatialStep);
+
+	mColumnSolver.Build(mNumRows - 2, s);
+	mRowSolver.Build(mNumCols - 2, s);
+
+	mRhs.assign(mNumRows*mNumCols, 0.0f);
+	mTransposed.assign(mNumRows*mNumCols, 0.0f);
+}
+
+void Waves::BuildSpongeCoefficients(float speed, float damping)
+{
+	int n = mNumCols;
+	int w = mSpongeWidth;
+	float dt = mTimeStep;
+	float dx = mSpatialStep;
+	float e = (speed*speed)*(dt*dt) / (dx*dx);
+
+	// A wave crossing the sponge and back is damped by exp(-0.5*integral of the added
+	// damping over the path / speed).  A quadratic profile reflects little at its
+	// start, and its peak is chosen so the round trip leaves sqrt(SpongeReflection)
+	// of the amplitude, so SpongeReflection of the energy.  Stronger damping turns the
+	// sponge into a wall for the longer waves.  The scheme stops damping and starts
+	// freezing the surface past damping*dt = 2.
+	float depth = w*dx;
+	float peak = 3.0f*speed*std::log(1.0f / std::sqrt(SpongeReflection)) / depth;
+	peak = std::min(peak, 2.0f / dt - damping);
+
+	mSpongeCoefficients.resize((w + 1)*4*n);
+	for(int row = 0; row <= w; ++row)
+	{
+		float* k1 = &mSpongeCoefficients[(row*4 + 0)*n];
+		float* k2 = &mSpongeCoefficients[(row*4 + 1)*n];
+		float* k3 = &mSpongeCoefficients[(row*4 + 2)*n];
+		float* decay = &mSpongeCoefficients[(row*4 + 3)*n];
+		for(int j = 0; j < n; ++j)
+		{
+			// Cells from the edge, counting the fixed boundary as 0.
+			int cells = std::min(row, std::min(j, n - 1 - j));
+
+			float mu = damping;
+			if(cells < w)
+			{
+				float s = (float)(w - cells) / w;
+				mu += peak*s*s;
+			}
+
+			float d = mu*dt + 2.0f;
+			k1[j] = (mu*dt - 2.0f) / d;
+			k2[j] = (4.0f - 8.0f*e) / d;
+			k3[j] = (2.0f*e) / d;
+			decay[j] = std::exp(-mu*dt);
+		}
+	}
 }
 
 Waves::~Waves()
@@ -85,60 +341,102 @@ float Waves::Depth()const
 	return mNumRows*mSpatialStep;
 }
 
+float Waves::SpatialStep()const
+{
+	return mSpatialStep;
+}
+
+float Waves::TimeStep()const
+{
+	return mTimeStep;
+}
+
+int Waves::SpongeWidth()const
+{
+	return mSpongeWidth;
+}
+
 void Waves::Update(float dt)
 {
-	static float t = 0;
+	Update(dt, nullptr, 0);
+}
 
+void Waves::Update(float dt, void* surface, std::size_t surfaceRowPitch)
+{
 	// Accumulate time.
-	t += dt;
+	mTime += dt;
 
 	// Only update the simulation at the specified time step.
-	if( t >= mTimeStep )
+	if( mTime >= mTimeStep )
 	{
-		// Only update interior points; we use zero boundary conditions.
-		concurrency::parallel_for(1, mNumRows - 1, [this](int i)
-		//for(int i = 1; i < mNumRows-1; ++i)
+		Step(surface, surfaceRowPitch);
+
+		mTime = 0.0f; // reset time
+	}
+	else if(surface != nullptr)
+	{
+		WriteSurface(surface, surfaceRowPitch);
+	}
+}
+
+void Waves::Step()
+{
+	Step(nullptr, 0);
+}
+
+void Waves::Step(void* surface, std::size_t surfaceRowPitch)
+{
+	if(mIntegrator == Integrator::Implicit)
+		StepImplicit();
+	else
+		StepExplicit();
+
+	int interior = (mNumRows - 2)*(mNumCols - 2);
+	++mStats.Steps;
+	mStats.CellsStepped += mWetCount;
+	mStats.CellsSkipped += interior - mWetCount;
+
+	// A normal depends on the heights of the rows above and below.
+	for(int i = 1; i < mNumRows - 1; ++i)
+	{
+		if(mHeightChanged[i])
 		{
-			for(int j = 1; j < mNumCols-1; ++j)
-			{
-				// After this update we will be discarding the old previous
-				// buffer, so overwrite that buffer with the new update.
-				// Note how we can do this inplace (read/write to same element) 
-				// because we won't need prev_ij again and the assignment happens last.
-
-				// Note j indexes x and i indexes z: h(x_j, z_i, t_k)
-				// Moreover, our +z axis goes "down"; this is just to 
-				// keep consistent with our row indices going down.
-
-				mPrevSolution[i*mNumCols+j].y = 
-					mK1*mPrevSolution[i*mNumCols+j].y +
-					mK2*mCurrSolution[i*mNumCols+j].y +
-					mK3*(mCurrSolution[(i+1)*mNumCols+j].y + 
-					     mCurrSolution[(i-1)*mNumCols+j].y + 
-					     mCurrSolution[i*mNumCols+j+1].y + 
-						 mCurrSolution[i*mNumCols+j-1].y);
-			}
-		});
+			mRowChanged[i-1] = 1;
+			mRowChanged[i] = 1;
+			mRowChanged[i+1] = 1;
+		}
+	}
 
-		// We just overwrote the previous buffer with the new data, so
-		// this data needs to become the current solution and the old
-		// current solution becomes the new previous solution.
-		std::swap(mPrevSolution, mCurrSolution);
+	// We just overwrote the previous buffer with the new data, so
+	// this data needs to become the current solution and the old
+	// current solution becomes the new previous solution.
+	std::swap(mPrevHeights, mCurrHeights);
+
+	//
+	// Compute normals using finite difference scheme.
+	//
+	concurrency::parallel_for(1, mNumRows - 1, [this, surface, surfaceRowPitch](int i)
+	//for(int i = 1; i < mNumRows - 1; ++i)
+	{
+		std::uint32_t* texels = nullptr;
+		if(surface != nullptr)
+			texels = reinterpret_cast<std::uint32_t*>(static_cast<std::uint8_t*>(surface) + i*surfaceRowPitch);
 
-		t = 0.0f; // reset time
+		// Dry points are flat.  The wet ones are overwritten below.
+		if(texels != nullptr && !mWet.empty())
+			std::fill(texels, texels + mNumCols, PackSurfaceTexel(0.0f, 0.0f, 0.0f));
 
-		//
-		// Compute normals using finite difference scheme.
-		//
-		concurrency::parallel_for(1, mNumRows - 1, [this](int i)
-		//for(int i = 1; i < mNumRows - 1; ++i)
+		for(int s = mRowSpans[i]; s < mRowSpans[i+1]; ++s)
 		{
-			for(int j = 1; j < mNumCols-1; ++j)
+			for(int j = mSpans[s].Begin; j < mSpans[s].End; ++j)
 			{
-				float l = mCurrSolution[i*mNumCols+j-1].y;
-				float r = mCurrSolution[i*mNumCols+j+1].y;
-				float t = mCurrSolution[(i-1)*mNumCols+j].y;
-				float b = mCurrSolution[(i+1)*mNumCols+j].y;
+				float h = mCurrHeights[i*mNumCols+j];
+				mCurrSolution[i*mNumCols+j].y = h;
+
+				float l = mCurrHeights[i*mNumCols+j-1];
+				float r = mCurrHeights[i*mNumCols+j+1];
+				float t = mCurrHeights[(i-1)*mNumCols+j];
+				float b = mCurrHeights[(i+1)*mNumCols+j];
 				mNormals[i*mNumCols+j].x = -r+l;
 				mNormals[i*mNumCols+j].y = 2.0f*mSpatialStep;
 				mNormals[i*mNumCols+j].z = b-t;
@@ -149,24 +447,543 @@ void Waves::Update(float dt)
 				mTangentX[i*mNumCols+j] = XMFLOAT3(2.0f*mSpatialStep, r-l, 0.0f);
 				XMVECTOR T = XMVector3Normalize(XMLoadFloat3(&mTangentX[i*mNumCols+j]));
 				XMStoreFloat3(&mTangentX[i*mNumCols+j], T);
+
+				if(texels != nullptr)
+				{
+					texels[j] = PackSurfaceTexel(h, (r-l) / (2.0f*mSpatialStep), (t-b) / (2.0f*mSpatialStep));
+				}
 			}
-		});
+		}
+
+		// The boundary stays flat.
+		if(texels != nullptr)
+		{
+			texels[0] = PackSurfaceTexel(mCurrSolution[i*mNumCols].y, 0.0f, 0.0f);
+			texels[mNumCols-1] = PackSurfaceTexel(mCurrSolution[i*mNumCols+mNumCols-1].y, 0.0f, 0.0f);
+		}
+	});
+
+	if(surface != nullptr)
+	{
+		for(int i = 0; i < mNumRows; i += mNumRows - 1)
+		{
+			auto texels = reinterpret_cast<std::uint32_t*>(static_cast<std::uint8_t*>(surface) + i*surfaceRowPitch);
+			for(int j = 0; j < mNumCols; ++j)
+				texels[j] = PackSurfaceTexel(mCurrSolution[i*mNumCols+j].y, 0.0f, 0.0f);
+		}
 	}
 }
 
+void Waves::StepExplicit()
+{
+	assert(mTimeStep <= MaxExplicitTimeStep(mSpatialStep, mSpeed));
+
+	// Only update interior points; we use zero boundary conditions.
+	concurrency::parallel_for(1, mNumRows - 1, [this](int i)
+	//for(int i = 1; i < mNumRows-1; ++i)
+	{
+		// After this update we will be discarding the old previous
+		// buffer, so overwrite that buffer with the new update.
+		// Note how we can do this inplace (read/write to same element) 
+		// because we won't need prev_ij again and the assignment happens last.
+
+		// Note j indexes x and i indexes z: h(x_j, z_i, t_k)
+		// Moreover, our +z axis goes "down"; this is just to 
+		// keep consistent with our row indices going down.
+		float* prev = &mPrevHeights[i*mNumCols];
+		const float* curr = &mCurrHeights[i*mNumCols];
+		const float* above = &mCurrHeights[(i-1)*mNumCols];
+		const float* below = &mCurrHeights[(i+1)*mNumCols];
+
+		// Only the runs of wet points; dry ones stay 0.
+		bool changed = false;
+		for(int s = mRowSpans[i]; s < mRowSpans[i+1]; ++s)
+		{
+			const ColumnSpan& span = mSpans[s];
+			if(mSpongeWidth > 0)
+			{
+				int row = std::min(std::min(i, mNumRows - 1 - i), mSpongeWidth);
+				const float* k = &mSpongeCoefficients[row*4*mNumCols];
+				changed |= StepRow<true>(prev, curr, above, below, k, k + mNumCols, k + 2*mNumCols, span.Begin, span.End);
+			}
+			else
+			{
+				changed |= StepRow<false>(prev, curr, above, below, &mK1, &mK2, &mK3, span.Begin, span.End);
+			}
+		}
+
+		mHeightChanged[i] = changed ? 1 : 0;
+	});
+}
+
+void Waves::StepImplicit()
+{
+	int m = mNumRows;
+	int n = mNumCols;
+	float e = (mSpeed*mSpeed)*(mTimeStep*mTimeStep) / (mSpatialStep*mSpatialStep);
+
+	// Right hand side dt^2 c^2 (dxx + dzz) h[n] over the wet interior; the boundary of
+	// mRhs stays 0.  The solves below do not know about dry points, so walls only hold
+	// the water back approximately with this integrator.
+	concurrency::parallel_for(1, m - 1, [this, n, e](int i)
+	{
+		const float* curr = &mCurrHeights[i*n];
+		const float* above = &mCurrHeights[(i-1)*n];
+		const float* below = &mCurrHeights[(i+1)*n];
+		float* rhs = &mRhs[i*n];
+
+		XMVECTOR ev = XMVectorReplicate(e);
+		XMVECTOR four = XMVectorReplicate(4.0f);
+
+		if(!mWet.empty())
+			std::fill(rhs + 1, rhs + n - 1, 0.0f);
+
+		for(int s = mRowSpans[i]; s < mRowSpans[i+1]; ++s)
+		{
+			int j = mSpans[s].Begin;
+			int last = mSpans[s].End;
+			for(; j + 4 <= last; j += 4)
+			{
+				XMVECTOR h = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(curr + j));
+				XMVECTOR neighbors = XMVectorAdd(
+					XMVectorAdd(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(above + j)),
+					            XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(below + j))),
+					XMVectorAdd(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(curr + j + 1)),
+					            XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(curr + j - 1))));
+
+				XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(rhs + j),
+					XMVectorMultiply(ev, XMVectorNegativeMultiplySubtract(four, h, neighbors)));
+			}
+
+			for(; j < last; ++j)
+				rhs[j] = e*(above[j] + below[j] + curr[j+1] + curr[j-1] - 4.0f*curr[j]);
+		}
+	});
+
+	// D = (1 - a*dxx)^-1 (1 - a*dzz)^-1 rhs.  The row systems are solved as the columns
+	// of the transpose, so both sweeps run four lines at a time.
+	SolveColumns(mRhs.data(), m, n, mColumnSolver.Inv.data(), mColumnSolver.Back.data(), mColumnSolver.S);
+	Transpose(mRhs.data(), mTransposed.data(), m, n);
+	SolveColumns(mTransposed.data(), n, m, mRowSolver.Inv.data(), mRowSolver.Back.data(), mRowSolver.S);
+	Transpose(mTransposed.data(), mRhs.data(), n, m);
+
+	// h[n+1] = h[n] + decay*(h[n] - h[n-1] + D), written over the previous heights.
+	concurrency::parallel_for(1, m - 1, [this, m, n](int i)
+	{
+		float* prev = &mPrevHeights[i*n];
+		const float* curr = &mCurrHeights[i*n];
+		const float* delta = &mRhs[i*n];
+
+		const float* decay = &mDecay;
+		bool perColumn = mSpongeWidth > 0;
+		if(perColumn)
+		{
+			int row = std::min(std::min(i, m - 1 - i), mSpongeWidth);
+			decay = &mSpongeCoefficients[(row*4 + 3)*n];
+		}
+
+		XMVECTOR dv = XMVectorReplicate(*decay);
+		bool changed = false;
+
+		for(int s = mRowSpans[i]; s < mRowSpans[i+1]; ++s)
+		{
+			int j = mSpans[s].Begin;
+			int last = mSpans[s].End;
+			for(; j + 4 <= last; j += 4)
+			{
+				if(perColumn)
+					dv = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(decay + j));
+
+				XMVECTOR h = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(curr + j));
+				XMVECTOR v = XMVectorAdd(XMVectorSubtract(h, XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(prev + j))),
+					XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(delta + j)));
+				XMVECTOR next = XMVectorMultiplyAdd(dv, v, h);
+				changed |= XMVector4NotEqual(next, h);
+
+				XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(prev + j), next);
+			}
+
+			for(; j < last; ++j)
+			{
+				float next = curr[j] + decay[perColumn ? j : 0]*(curr[j] - prev[j] + delta[j]);
+				changed |= (next != curr[j]);
+				prev[j] = next;
+			}
+		}
+
+		mHeightChanged[i] = changed ? 1 : 0;
+	});
+}
+
+void Waves::ClearChangedRows()
+{
+	std::fill(mRowChanged.begin(), mRowChanged.end(), (std::uint8_t)0);
+}
+
+void Waves::WriteSurface(void* surface, std::size_t surfaceRowPitch)const
+{
+	assert(surfaceRowPitch >= mNumCols*sizeof(std::uint32_t));
+
+	concurrency::parallel_for(0, mNumRows, [this, surface, surfaceRowPitch](int i)
+	{
+		auto texels = reinterpret_cast<std::uint32_t*>(static_cast<std::uint8_t*>(surface) + i*surfaceRowPitch);
+		for(int j = 0; j < mNumCols; ++j)
+		{
+			// The stored normal is (-dh/dx, 1, -dh/dz) normalized.
+			const XMFLOAT3& n = mNormals[i*mNumCols+j];
+			texels[j] = PackSurfaceTexel(mCurrSolution[i*mNumCols+j].y, -n.x / n.y, -n.z / n.y);
+		}
+	});
+}
+
+std::uint32_t Waves::PackSurfaceTexel(float height, float slopeX, float slopeZ)
+{
+	auto packSlope = [](float s)
+	{
+		float v = std::min(std::max(s / SurfaceMaxSlope, -1.0f), 1.0f);
+		return (std::uint32_t)(std::uint8_t)(std::int8_t)(v*127.0f + (v < 0.0f ? -0.5f : 0.5f));
+	};
+
+	return (std::uint32_t)XMConvertFloatToHalf(height) | (packSlope(slopeX) << 16) | (packSlope(slopeZ) << 24);
+}
+
 void Waves::Disturb(int i, int j, float magnitude)
 {
 	// Don't disturb boundaries.
 	assert(i > 1 && i < mNumRows-2);
 	assert(j > 1 && j < mNumCols-2);
 
+	// Nor land.
+	if(!IsWet(i, j))
+		return;
+
 	float halfMag = 0.5f*magnitude;
 
+	// The heights of rows i-1..i+1 change, and with them the normals one row further.
+	for(int k = std::max(i-2, 0); k <= std::min(i+2, mNumRows-1); ++k)
+		mRowChanged[k] = 1;
+
 	// Disturb the ijth vertex height and its neighbors.
-	mCurrSolution[i*mNumCols+j].y     += magnitude;
-	mCurrSolution[i*mNumCols+j+1].y   += halfMag;
-	mCurrSolution[i*mNumCols+j-1].y   += halfMag;
-	mCurrSolution[(i+1)*mNumCols+j].y += halfMag;
-	mCurrSolution[(i-1)*mNumCols+j].y += halfMag;
+	auto raise = [this](int k, float amount)
+	{
+		if(!mWet.empty() && !mWet[k])
+			return;
+
+		mCurrHeights[k] += amount;
+		mCurrSolution[k].y = mCurrHeights[k];
+	};
+	raise(i*mNumCols+j, magnitude);
+	raise(i*mNumCols+j+1, halfMag);
+	raise(i*mNumCols+j-1, halfMag);
+	raise((i+1)*mNumCols+j, halfMag);
+	raise((i-1)*mNumCols+j, halfMag);
+}
+
+void Waves::SetHeight(int i, int j, float height)
+{
+	SetHeight(i, j, height, mPrevHeights[i*mNumCols + j]);
+}
+
+void Waves::SetHeight(int i, int j, float height, float previousHeight)
+{
+	int k = i*mNumCols + j;
+	if(mCurrHeights[k] != height)
+	{
+		// The normals of the neighboring rows use this height too.
+		for(int r = std::max(i-1, 0); r <= std::min(i+1, mNumRows-1); ++r)
+			mRowChanged[r] = 1;
+	}
+
+	mCurrHeights[k] = height;
+	mPrevHeights[k] = previousHeight;
+	mCurrSolution[k].y = height;
+}
+
+void Waves::Scroll(int rows, int columns)
+{
+	assert(mWet.empty());
+
+	if(rows == 0 && columns == 0)
+		return;
+
+	auto scroll = [this, rows, columns](auto& values, auto empty)
+	{
+		auto source = values;
+		for(int i = 0; i < mNumRows; ++i)
+		{
+			for(int j = 0; j < mNumCols; ++j)
+			{
+				int si = i + rows;
+				int sj = j + columns;
+				bool inside = si >= 0 && si < mNumRows && sj >= 0 && sj < mNumCols;
+				values[i*mNumCols + j] = inside ? source[si*mNumCols + sj] : empty;
+			}
+		}
+	};
+
+	scroll(mCurrHeights, 0.0f);
+	scroll(mPrevHeights, 0.0f);
+	scroll(mNormals, XMFLOAT3(0.0f, 1.0f, 0.0f));
+	scroll(mTangentX, XMFLOAT3(1.0f, 0.0f, 0.0f));
+
+	for(int k = 0; k < mVertexCount; ++k)
+		mCurrSolution[k].y = mCurrHeights[k];
+
+	std::fill(mRowChanged.begin(), mRowChanged.end(), (std::uint8_t)1);
+}
+
+void Waves::SetWetMask(const std::vector<std::uint8_t>& wet)
+{
+	assert((int)wet.size() == mVertexCount);
+	mWet = wet;
+
+	for(int k = 0; k < mVertexCount; ++k)
+	{
+		if(mWet[k])
+			continue;
+
+		mCurrHeights[k] = 0.0f;
+		mPrevHeights[k] = 0.0f;
+		mCurrSolution[k].y = 0.0f;
+		mNormals[k] = XMFLOAT3(0.0f, 1.0f, 0.0f);
+		mTangentX[k] = XMFLOAT3(1.0f, 0.0f, 0.0f);
+	}
+
+	std::fill(mRowChanged.begin(), mRowChanged.end(), (std::uint8_t)1);
+
+	BuildSpans();
+}
+
+bool Waves::IsWet(int i, int j)const
+{
+	return mWet.empty() || mWet[i*mNumCols + j] != 0;
+}
+
+int Waves::WetCount()const
+{
+	return mWetCount;
+}
+
+const WavesStats& Waves::Stats()const
+{
+	return mStats;
+}
+
+void Waves::BuildSpans()
+{
+	mSpans.clear();
+	mRowSpans.assign(mNumRows + 1, 0);
+	mWetCount = 0;
+
+	for(int i = 0; i < mNumRows; ++i)
+	{
+		mRowSpans[i] = (int)mSpans.size();
+		if(i == 0 || i == mNumRows - 1)
+			continue;
+
+		int j = 1;
+		while(j < mNumCols - 1)
+		{
+			while(j < mNumCols - 1 && !IsWet(i, j))
+				++j;
+
+			int begin = j;
+			while(j < mNumCols - 1 && IsWet(i, j))
+				++j;
+
+			if(j > begin)
+			{
+				mSpans.push_back({ begin, j });
+				mWetCount += j - begin;
+			}
+		}
+	}
+	mRowSpans[mNumRows] = (int)mSpans.size();
+}
+
+float Waves::Energy()const
+{
+	return Energy(0, mNumRows, 0, mNumCols);
+}
+
+float Waves::Energy(int row0, int row1, int col0, int col1)const
+{
+	assert(row0 >= 0 && row1 <= mNumRows && col0 >= 0 && col1 <= mNumCols);
+
+	// Per cell: 0.5*v^2 with v the height change over a step, and 0.5*c^2*|grad h|^2 with
+	// forward differences, times the cell area.
+	double kinetic = 0.0;
+	double potential = 0.0;
+	for(int i = row0; i < row1; ++i)
+	{
+		for(int j = col0; j < col1; ++j)
+		{
+			int k = i*mNumCols + j;
+			double v = (mCurrHeights[k] - mPrevHeights[k]) / mTimeStep;
+			kinetic += v*v;
+
+			if(j + 1 < mNumCols)
+			{
+				double s = (mCurrHeights[k+1] - mCurrHeights[k]) / mSpatialStep;
+				potential += s*s;
+			}
+			if(i + 1 < mNumRows)
+			{
+				double s = (mCurrHeights[k+mNumCols] - mCurrHeights[k]) / mSpatialStep;
+				potential += s*s;
+			}
+		}
+	}
+
+	double area = mSpatialStep*mSpatialStep;
+	return (float)(0.5*(kinetic + mSpeed*mSpeed*potential)*area);
 }
 	
+
+void Waves::SampleSurface(std::size_t count, const float* x, const float* z, float* height,
+	float* normalX, float* normalY, float* normalZ, float* velocity)const
+{
+	std::size_t k = 0;
+	for(; k + 8 <= count; k += 8)
+		SampleEight(x + k, z + k, height + k, normalX + k, normalY + k, normalZ + k, velocity + k);
+
+	if(k == count)
+		return;
+
+	// The last few points go through a padded copy.
+	float px[8] = {}, pz[8] = {};
+	float h[8], nx[8], ny[8], nz[8], v[8];
+	std::size_t rest = count - k;
+	std::copy(x + k, x + count, px);
+	std::copy(z + k, z + count, pz);
+
+	SampleEight(px, pz, h, nx, ny, nz, v);
+
+	std::copy(h, h + rest, height + k);
+	std::copy(nx, nx + rest, normalX + k);
+	std::copy(ny, ny + rest, normalY + k);
+	std::copy(nz, nz + rest, normalZ + k);
+	std::copy(v, v + rest, velocity + k);
+}
+
+void Waves::SampleEight(const float* x, const float* z, float* height,
+	float* normalX, float* normalY, float* normalZ, float* velocity)const
+{
+	// Point (i, j) is at x = -halfWidth + j*dx and z = halfDepth - i*dx.
+	const XMVECTOR halfWidth = XMVectorReplicate(0.5f*(mNumCols - 1)*mSpatialStep);
+	const XMVECTOR halfDepth = XMVectorReplicate(0.5f*(mNumRows - 1)*mSpatialStep);
+	const XMVECTOR invDx = XMVectorReplicate(1.0f / mSpatialStep);
+	const XMVECTOR invDt = XMVectorReplicate(1.0f / mTimeStep);
+	const XMVECTOR lastRow = XMVectorReplicate((float)(mNumRows - 1));
+	const XMVECTOR lastCol = XMVectorReplicate((float)(mNumCols - 1));
+	const XMVECTOR one = XMVectorSplatOne();
+	const XMVECTOR zero = XMVectorZero();
+
+	// Cell of each point, and where the point lies in it.
+	XMVECTOR fi[2], fj[2];
+	alignas(16) float cellI[8];
+	alignas(16) float cellJ[8];
+	for(int h = 0; h < 2; ++h)
+	{
+		XMVECTOR px = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(x + 4*h));
+		XMVECTOR pz = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(z + 4*h));
+
+		XMVECTOR j = XMVectorClamp(XMVectorMultiply(XMVectorAdd(px, halfWidth), invDx), zero, lastCol);
+		XMVECTOR i = XMVectorClamp(XMVectorMultiply(XMVectorSubtract(halfDepth, pz), invDx), zero, lastRow);
+
+		XMVECTOR j0 = XMVectorMin(XMVectorFloor(j), XMVectorSubtract(lastCol, one));
+		XMVECTOR i0 = XMVectorMin(XMVectorFloor(i), XMVectorSubtract(lastRow, one));
+		fj[h] = XMVectorSubtract(j, j0);
+		fi[h] = XMVectorSubtract(i, i0);
+
+		XMStoreFloat4A(reinterpret_cast<XMFLOAT4A*>(cellI + 4*h), i0);
+		XMStoreFloat4A(reinterpret_cast<XMFLOAT4A*>(cellJ + 4*h), j0);
+	}
+
+	// There is no gather, so the corners are read one point at a time.
+	alignas(16) float c00[8], c01[8], c10[8], c11[8];
+	alignas(16) float p00[8], p01[8], p10[8], p11[8];
+	for(int p = 0; p < 8; ++p)
+	{
+		int k = (int)cellI[p]*mNumCols + (int)cellJ[p];
+
+		c00[p] = mCurrHeights[k];
+		c01[p] = mCurrHeights[k + 1];
+		c10[p] = mCurrHeights[k + mNumCols];
+		c11[p] = mCurrHeights[k + mNumCols + 1];
+
+		p00[p] = mPrevHeights[k];
+		p01[p] = mPrevHeights[k + 1];
+		p10[p] = mPrevHeights[k + mNumCols];
+		p11[p] = mPrevHeights[k + mNumCols + 1];
+	}
+
+	auto load = [](const float* lanes) { return XMLoadFloat4A(reinterpret_cast<const XMFLOAT4A*>(lanes)); };
+
+	for(int h = 0; h < 2; ++h)
+	{
+		XMVECTOR h00 = load(c00 + 4*h);
+		XMVECTOR h01 = load(c01 + 4*h);
+		XMVECTOR h10 = load(c10 + 4*h);
+		XMVECTOR h11 = load(c11 + 4*h);
+
+		XMVECTOR top = XMVectorLerpV(h00, h01, fj[h]);
+		XMVECTOR bottom = XMVectorLerpV(h10, h11, fj[h]);
+		XMVECTOR curr = XMVectorLerpV(top, bottom, fi[h]);
+
+		XMVECTOR prevTop = XMVectorLerpV(load(p00 + 4*h), load(p01 + 4*h), fj[h]);
+		XMVECTOR prevBottom = XMVectorLerpV(load(p10 + 4*h), load(p11 + 4*h), fj[h]);
+		XMVECTOR prev = XMVectorLerpV(prevTop, prevBottom, fi[h]);
+
+		// i runs towards -z, so dh/dz is minus the change down the cell.
+		XMVECTOR slopeX = XMVectorMultiply(XMVectorLerpV(XMVectorSubtract(h01, h00), XMVectorSubtract(h11, h10), fi[h]), invDx);
+		XMVECTOR slopeZ = XMVectorMultiply(XMVectorSubtract(top, bottom), invDx);
+
+		// n = (-dh/dx, 1, -dh/dz) / |(-dh/dx, 1, -dh/dz)|
+		XMVECTOR invLength = XMVectorReciprocalSqrt(
+			XMVectorMultiplyAdd(slopeX, slopeX, XMVectorMultiplyAdd(slopeZ, slopeZ, one)));
+
+		XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(height + 4*h), curr);
+		XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(normalX + 4*h), XMVectorNegate(XMVectorMultiply(slopeX, invLength)));
+		XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(normalY + 4*h), invLength);
+		XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(normalZ + 4*h), XMVectorNegate(XMVectorMultiply(slopeZ, invLength)));
+		XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(velocity + 4*h), XMVectorMultiply(XMVectorSubtract(curr, prev), invDt));
+	}
+}
+
+void Waves::SampleSurfaceReference(std::size_t count, const float* x, const float* z, float* height,
+	float* normalX, float* normalY, float* normalZ, float* velocity)const
+{
+	float halfWidth = 0.5f*(mNumCols - 1)*mSpatialStep;
+	float halfDepth = 0.5f*(mNumRows - 1)*mSpatialStep;
+
+	for(std::size_t k = 0; k < count; ++k)
+	{
+		float j = std::min(std::max((x[k] + halfWidth) / mSpatialStep, 0.0f), (float)(mNumCols - 1));
+		float i = std::min(std::max((halfDepth - z[k]) / mSpatialStep, 0.0f), (float)(mNumRows - 1));
+		int j0 = std::min((int)j, mNumCols - 2);
+		int i0 = std::min((int)i, mNumRows - 2);
+		float fj = j - j0;
+		float fi = i - i0;
+
+		float h00 = Height(i0, j0), h01 = Height(i0, j0 + 1);
+		float h10 = Height(i0 + 1, j0), h11 = Height(i0 + 1, j0 + 1);
+		float top = h00 + fj*(h01 - h00);
+		float bottom = h10 + fj*(h11 - h10);
+		float curr = top + fi*(bottom - top);
+
+		float prevTop = PreviousHeight(i0, j0) + fj*(PreviousHeight(i0, j0 + 1) - PreviousHeight(i0, j0));
+		float prevBottom = PreviousHeight(i0 + 1, j0) + fj*(PreviousHeight(i0 + 1, j0 + 1) - PreviousHeight(i0 + 1, j0));
+		float prev = prevTop + fi*(prevBottom - prevTop);
+
+		float slopeX = ((h01 - h00) + fi*((h11 - h10) - (h01 - h00))) / mSpatialStep;
+		float slopeZ = (top - bottom) / mSpatialStep;
+		float invLength = 1.0f / std::sqrt(1.0f + slopeX*slopeX + slopeZ*slopeZ);
+
+		height[k] = curr;
+		normalX[k] = -slopeX*invLength;
+		normalY[k] = invLength;
+		normalZ[k] = -slopeZ*invLength;
+		velocity[k] = (curr - prev) / mTimeStep;
+	}
+}
@@ -2,20 +2,51 @@
 // Waves.h by Frank Luna (C) 2011 All Rights Reserved.
 //
 // Performs the calculations for the wave simulation.  After the simulation has been
-// updated, the client must copy the current solution into vertex buffers for rendering.
+// updated, the client must copy the current solution into vertex buffers for rendering,
+// or have Update write it as a packed height/slope texture (see PackSurfaceTexel).
 // This class only does the calculations, it does not do any drawing.
+//
+// The outer ring of the grid is held at zero, which reflects waves back in.  Giving the
+// constructor a sponge width surrounds the grid with a zone of that many cells whose
+// damping rises towards the edge, so waves fade out there instead and the grid behaves
+// like a window onto open water.  Waves much longer than the sponge is wide are damped
+// less and reflected more: at the scene's speed and time step a 20 cell sponge sends
+// back less than SpongeReflection of the energy of a pulse made by Disturb.
+//
+// The original explicit integrator is only stable while speed*dt/dx <= sqrt(0.5).  The
+// implicit one solves for the new heights with alternating direction sweeps, one
+// tridiagonal system per row and per column, and is stable at any time step.  It costs a
+// few explicit steps per step, and at large steps waves a few cells long travel slower
+// than they should.
+//
+// A wet mask marks the points that are water.  Dry points, under land or walls, hold
+// height 0 like the edge of the grid, so shores reflect waves, and the update only
+// visits the runs of wet points in each row.
 //***************************************************************************************
 
 #ifndef WAVES_H
 #define WAVES_H
 
 #include <vector>
+#include <cstddef>
+#include <cstdint>
 #include <DirectXMath.h>
 
+struct WavesStats
+{
+	std::uint64_t Steps = 0;
+
+	// Interior points updated, and skipped because they are dry, over all steps.
+	std::uint64_t CellsStepped = 0;
+	std::uint64_t CellsSkipped = 0;
+};
+
 class Waves
 {
 public:
-    Waves(int m, int n, float dx, float dt, float speed, float damping);
+    enum class Integrator { Explicit, Implicit };
+
+    Waves(int m, int n, float dx, float dt, float speed, float damping, int spongeWidth = 0);
     Waves(const Waves& rhs) = delete;
     Waves& operator=(const Waves& rhs) = delete;
     ~Waves();
@@ -26,6 +57,18 @@ public:
 	int TriangleCount()const;
 	float Width()const;
 	float Depth()const;
+	float SpatialStep()const;
+	float TimeStep()const;
+	int SpongeWidth()const;
+
+	// Both integrators keep the same state, so they can be switched at any time.  A grid
+	// whose time step is above MaxExplicitTimeStep always uses the implicit one, and
+	// starts with it; others start with the explicit one.
+	void SetIntegrator(Integrator integrator);
+	Integrator GetIntegrator()const;
+
+	// The largest time step the explicit integrator is stable at.
+	static float MaxExplicitTimeStep(float dx, float speed);
 
 	// Returns the solution at the ith grid point.
     const DirectX::XMFLOAT3& Position(int i)const { return mCurrSolution[i]; }
@@ -39,7 +82,102 @@ public:
 	void Update(float dt);
 	void Disturb(int i, int j, float magnitude);
 
+	// Height of grid point (i, j) now and one step ago.
+	float Height(int i, int j)const { return mCurrHeights[i*mNumCols + j]; }
+	float PreviousHeight(int i, int j)const { return mPrevHeights[i*mNumCols + j]; }
+
+	// Overwrites the height of grid point (i, j), and optionally the one of the last
+	// step, which sets its velocity.  The update never writes the outer ring, so
+	// setting it before each step drives the edge of the grid.
+	void SetHeight(int i, int j, float height);
+	void SetHeight(int i, int j, float height, float previousHeight);
+
+	// Moves the water by whole cells, for a grid that follows a point: afterwards point
+	// (i, j) holds what (i + rows, j + columns) held.  Points that had no source are 0.
+	// Not for grids with a wet mask, which belongs to the ground.
+	void Scroll(int rows, int columns);
+
+	// wet holds RowCount() x ColumnCount() values, nonzero for water.  Dry points are
+	// flattened and left alone from then on; Disturb ignores them.
+	void SetWetMask(const std::vector<std::uint8_t>& wet);
+	bool IsWet(int i, int j)const;
+
+	// Interior points that are water.
+	int WetCount()const;
+
+	const WavesStats& Stats()const;
+
+	// True if a position or normal in row i changed since the last ClearChangedRows().
+	// Lets the client rewrite only those rows of its vertex buffers.
+	bool RowChanged(int i)const { return mRowChanged[i] != 0; }
+	void ClearChangedRows();
+
+	// Same as Update(dt), but also writes the surface to a RowCount() x ColumnCount()
+	// image of packed texels with surfaceRowPitch bytes per row, such as mapped upload
+	// memory.  When the simulation steps the normal pass writes the texels as it goes;
+	// otherwise they are packed from the current solution.
+	void Update(float dt, void* surface, std::size_t surfaceRowPitch);
+	void WriteSurface(void* surface, std::size_t surfaceRowPitch)const;
+
+	// Takes one step now, whatever time Update has accumulated, for clients that decide
+	// themselves when the water steps.  The surface is written as by Update.
+	void Step();
+	void Step(void* surface, std::size_t surfaceRowPitch);
+
+	// A surface texel holds the height as a 16-bit float in the low half, then the
+	// slopes dh/dx and dh/dz as 8-bit snorm values in units of SurfaceMaxSlope.
+	// Read as DXGI_FORMAT_R32_UINT.
+	static const float SurfaceMaxSlope;
+	static std::uint32_t PackSurfaceTexel(float height, float slopeX, float slopeZ);
+
+	// Kinetic plus potential energy of the surface per unit density, over the whole grid
+	// or the rows [row0, row1) and columns [col0, col1).  The kinetic part uses the
+	// height change of the last step.
+	float Energy()const;
+	float Energy(int row0, int row1, int col0, int col1)const;
+
+	// Fraction of a wave's energy the sponge is designed to send back.
+	static const float SpongeReflection;
+
+	// The surface at count points, given by x and z in the frame of Position().  Each is
+	// interpolated bilinearly from the four grid points around it: the height, the unit
+	// normal of the interpolated surface, and the vertical velocity over the last step.
+	// Points off the grid take the values at its edge.  Eight points are done at a time,
+	// as two vectors of four.
+	void SampleSurface(std::size_t count, const float* x, const float* z, float* height,
+		float* normalX, float* normalY, float* normalZ, float* velocity)const;
+
+	// Same, one point at a time, to check SampleSurface against.
+	void SampleSurfaceReference(std::size_t count, const float* x, const float* z, float* height,
+		float* normalX, float* normalY, float* normalZ, float* velocity)const;
+
 private:
+	// Factors of the Thomas algorithm for (1 - S*second difference) x = d on lines of
+	// Inv.size() unknowns, with x = 0 at both ends.
+	struct LineSolver
+	{
+		float S = 0.0f;
+		std::vector<float> Inv;
+		std::vector<float> Back;
+
+		void Build(int length, float s);
+	};
+
+	// The wet interior points of a row, columns [Begin, End).
+	struct ColumnSpan
+	{
+		int Begin;
+		int End;
+	};
+
+	void BuildSpans();
+	void SampleEight(const float* x, const float* z, float* height,
+		float* normalX, float* normalY, float* normalZ, float* velocity)const;
+	void BuildSpongeCoefficients(float speed, float damping);
+	void BuildImplicitSolvers();
+	void StepExplicit();
+	void StepImplicit();
+
     int mNumRows = 0;
     int mNumCols = 0;
 
@@ -53,11 +191,50 @@ private:
 
     float mTimeStep = 0.0f;
     float mSpatialStep = 0.0f;
+    float mSpeed = 0.0f;
+
+    Integrator mIntegrator = Integrator::Explicit;
+
+    // Implicit integrator: the factor the velocity is damped by in a step, the solvers
+    // for columns (mNumRows-2 unknowns) and rows (mNumCols-2 unknowns), and scratch
+    // for the right hand side and its transpose.
+    float mDecay = 1.0f;
+    LineSolver mColumnSolver;
+    LineSolver mRowSolver;
+    std::vector<float> mRhs;
+    std::vector<float> mTransposed;
+
+    // Time accumulated towards the next step.
+    float mTime = 0.0f;
+
+    // The heights the update reads and writes, kept apart from the positions so the
+    // stencil can load four neighboring columns at once.
+    std::vector<float> mPrevHeights;
+    std::vector<float> mCurrHeights;
+
+    // With a sponge: mK1..mK3 and mDecay for every column of a row, as four rows of
+    // mNumCols values, for the rows 0..mSpongeWidth cells from the edge.  Rows further in
+    // use the coefficients of row mSpongeWidth.
+    int mSpongeWidth = 0;
+    std::vector<float> mSpongeCoefficients;
 
-    std::vector<DirectX::XMFLOAT3> mPrevSolution;
     std::vector<DirectX::XMFLOAT3> mCurrSolution;
     std::vector<DirectX::XMFLOAT3> mNormals;
     std::vector<DirectX::XMFLOAT3> mTangentX;
+
+    // Per row: whether a height changed in the last step, and whether any vertex data
+    // changed since ClearChangedRows().
+    std::vector<std::uint8_t> mHeightChanged;
+    std::vector<std::uint8_t> mRowChanged;
+
+    // Empty while every point is wet.  Row i's spans are mSpans[mRowSpans[i]] up to
+    // mSpans[mRowSpans[i+1]].
+    std::vector<std::uint8_t> mWet;
+    std::vector<ColumnSpan> mSpans;
+    std::vector<int> mRowSpans;
+    int mWetCount = 0;
+
+    WavesStats mStats;
 };
 
 #endif // WAVES_H
\ No newline at end of file
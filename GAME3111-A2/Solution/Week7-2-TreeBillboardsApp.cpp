@@ -11,8 +11,25 @@
 #include "../../Common/MathHelper.h"
 #include "../../Common/UploadBuffer.h"
 #include "../../Common/GeometryGenerator.h"
+#include "../../Common/DescriptorHeap.h"
+#include "../../Common/ResourceStateTracker.h"
+#include "../../Common/D3D12FrameFence.h"
+#include "../../Common/FrustumCuller.h"
+#include "../../Common/IndirectArgsPacker.h"
+#include "../../Common/DynamicResolution.h"
+#include "../../Common/DirtyRowTracker.h"
+#include "../../Common/MemoryBudget.h"
+#include "../../Common/BillboardCuller.h"
+#include "../../Common/SimulationLod.h"
+#include "../../Common/TaskGraph.h"
+#include "../../Common/ShadowCascades.h"
 #include "FrameResource.h"
 #include "Waves.h"
+#include "Buoyancy.h"
+#include "CastleLayout.h"
+#include <chrono>
+#include <mutex>
+#include <ppl.h>
 
 using Microsoft::WRL::ComPtr;
 using namespace DirectX;
@@ -21,7 +38,9 @@ using namespace DirectX::PackedVector;
 #pragma comment(lib, "d3dcompiler.lib")
 #pragma comment(lib, "D3D12.lib")
 
-const int gNumFrameResources = 3;
+// Frame resources allocated.  How many of them are actually cycled through is decided
+// at runtime by the frame pacer.
+const int gNumFrameResources = 4;
 
 // Lightweight structure stores parameters to draw a shape.  This will
 // vary from app-to-app.
@@ -32,17 +51,26 @@ struct RenderItem
     // World matrix of the shape that describes the object's local space
     // relative to the world space, which defines the position, orientation,
     // and scale of the object in the world.
-    XMFLOAT4X4 World = MathHelper::Identity4x4();
+    VersionedProperty<XMFLOAT4X4> World = MathHelper::Identity4x4();
 
-	XMFLOAT4X4 TexTransform = MathHelper::Identity4x4();
+	VersionedProperty<XMFLOAT4X4> TexTransform = MathHelper::Identity4x4();
 
-	// Dirty flag indicating the object data has changed and we need to update the constant buffer.
-	// Because we have an object cbuffer for each FrameResource, we have to apply the
-	// update to each FrameResource.  Thus, when we modify obect data we should set 
-	// NumFramesDirty = gNumFrameResources so that each frame resource gets the update.
-	int NumFramesDirty = gNumFrameResources;
+	// Changes whenever World or TexTransform is written with a new value.  Each frame
+	// resource rewrites the item's ObjectBuffer record when it was written from an
+	// older version.
+	std::uint64_t Version()const { return VersionSum(World, TexTransform); }
 
-	// Index into GPU constant buffer corresponding to the ObjectCB for this render item.
+	// Draws the whole of the named submesh of Geo, whose bounds it takes for culling.
+	void SetSubmesh(const std::string& name)
+	{
+		const SubmeshGeometry& submesh = Geo->DrawArgs.at(name);
+		IndexCount = submesh.IndexCount;
+		StartIndexLocation = submesh.StartIndexLocation;
+		BaseVertexLocation = submesh.BaseVertexLocation;
+		Bounds = submesh.Bounds;
+	}
+
+	// Index of the item's record in the frame resource's ObjectBuffer.
 	UINT ObjCBIndex = -1;
 
 	Material* Mat = nullptr;
@@ -55,6 +83,15 @@ struct RenderItem
     UINT IndexCount = 0;
     UINT StartIndexLocation = 0;
     int BaseVertexLocation = 0;
+
+	// Bounding box of the submesh in local space, used for frustum culling.
+	BoundingBox Bounds;
+
+	// Slice of the impostor atlas baked for the item, or -1 if it has none.
+	int ImpostorSlice = -1;
+
+	// Set each frame the item is far enough away to be drawn as its impostor.
+	bool DrawAsImpostor = false;
 };
 
 enum class RenderLayer : int
@@ -63,9 +100,49 @@ enum class RenderLayer : int
 	Transparent,
 	AlphaTested,
 	AlphaTestedTreeSprites,
+	AlphaTestedFlagSprites,
+	Waves,
 	Count
 };
 
+// A range of consecutive commands in the indirect argument buffer that can be issued
+// with one ExecuteIndirect.  The texture is bound through a descriptor table, which a
+// command signature can not change, so a run ends wherever the texture changes.
+struct IndirectDrawRun
+{
+	UINT FirstCommand = 0;
+	UINT CommandCount = 0;
+	int DiffuseSrvHeapIndex = -1;
+	D3D12_PRIMITIVE_TOPOLOGY PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+};
+
+// Impostors that share a material, drawn with one instanced draw.
+struct ImpostorRun
+{
+	UINT FirstInstance = 0;
+	UINT InstanceCount = 0;
+	Material* Mat = nullptr;
+};
+
+struct IndirectDrawStats
+{
+	UINT ItemsTotal = 0;
+	UINT ItemsVisible = 0;
+
+	// Draw calls the visible items would need on their own, against the
+	// ExecuteIndirect calls used instead.
+	UINT DirectDrawCalls = 0;
+	UINT ExecuteIndirectCalls = 0;
+};
+
+// Constant buffer slots UpdateObjectCBs and UpdateMaterialCBs rewrote in a frame.
+struct ConstantBufferWriteStats
+{
+	UINT ObjectSlots = 0;
+	UINT MaterialSlots = 0;
+	UINT64 BytesWritten = 0;
+};
+
 class TreeBillboardsApp : public D3DApp
 {
 public:
@@ -77,6 +154,7 @@ public:
     virtual bool Initialize()override;
 
 private:
+    virtual void CreateRtvAndDsvDescriptorHeaps()override;
     virtual void OnResize()override;
     virtual void Update(const GameTimer& gt)override;
     virtual void Draw(const GameTimer& gt)override;
@@ -87,27 +165,84 @@ private:
 
     void OnKeyboardInput(const GameTimer& gt);
 	void UpdateCamera(const GameTimer& gt);
-	void AnimateMaterials(const GameTimer& gt);
+	void UpdateRenderScale(const GameTimer& gt);
 	void UpdateObjectCBs(const GameTimer& gt);
 	void UpdateMaterialCBs(const GameTimer& gt);
 	void UpdateMainPassCB(const GameTimer& gt);
 	void UpdateWaves(const GameTimer& gt); 
+	void UpdateFloatingCrates(const GameTimer& gt);
+	void UpdateIndirectArgs(const GameTimer& gt);
+	void UpdateTreeInstances(const GameTimer& gt);
+	void UpdateImpostors(const GameTimer& gt);
+	void UpdateShadowCascades(const GameTimer& gt);
 
+	// Reads the texture files, and UploadTextures creates the textures from them.
 	void LoadTextures();
+	void UploadTextures();
     void BuildRootSignature();
+	void BuildCommandSignature();
+	void BuildUpscaleRootSignature();
 	void BuildDescriptorHeaps();
+	void CreateTextureSrv(Texture* tex);
+	void BuildSceneTarget();
+	void CreateSceneTargetSrv();
+	void BuildWavesSurfaceMap();
+	void CopyWavesSurface(ID3D12GraphicsCommandList* cmdList);
+
+	// Memory accounting.  TrackInitialMemory records everything Initialize created, and
+	// ReleaseUploadMemory drops what is only needed until the first upload finished.
+	void TrackResource(const void* key, ID3D12Resource* resource, MemoryCategory category);
+	void TrackBlob(ID3DBlob* blob);
+	void TrackInitialMemory();
+	void ReleaseUploadMemory();
     void BuildShadersAndInputLayouts();
+
+	// The Build*Geometry functions only fill the CPU copies and may run at the same
+	// time.  UploadGeometries creates the default buffers of the geometries that have
+	// none yet.
+	void AddGeometry(std::unique_ptr<MeshGeometry> geo);
+	void UploadGeometries();
     void BuildLandGeometry();
     void BuildWavesGeometry();
 	void BuildBoxGeometry();
 	void BuildConeGeometry();
 	void BuildCylinderGeometry();
 	void BuildTreeSpritesGeometry();
+	void BuildFlagSpritesGeometry();
+	void BuildTreeQuadGeometry();
+
+	// Reads the atlases Tools/ImpostorBake baked of the castle parts, and
+	// UploadImpostors makes texture arrays of them.
+	void LoadImpostors();
+	void UploadImpostors();
     void BuildPSOs();
     void BuildFrameResources();
     void BuildMaterials();
     void BuildRenderItems();
+
+	// Marks the water points under opaque scenery that rises above the water as dry.
+	void BuildWavesWetMask();
+
+	// Crates floating on the water.  Built after the wet mask and the impostors, which
+	// are for the fixed scenery.
+	void BuildFloatingCrates();
+
+	// Builds the indirect command of every item and the order each layer's items are
+	// packed in, once the geometry is on the GPU.
+	void BuildIndirectCommands();
+	IndirectDrawCommand IndirectCommand(const RenderItem* ri)const;
+
+	// Checks the packed arguments against what DrawRenderItems would draw.
+	void CheckIndirectArgs(const std::vector<bool>& visible)const;
     void DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems);
+	void DrawLayer(ID3D12GraphicsCommandList* cmdList, RenderLayer layer);
+	void DrawTreeInstances(ID3D12GraphicsCommandList* cmdList);
+	void DrawImpostors(ID3D12GraphicsCommandList* cmdList);
+
+	// True when the scene is rendered into mSceneTarget and upscaled, false when it is
+	// rendered straight into the back buffer.
+	bool UseSceneTarget()const;
+	D3D12_CPU_DESCRIPTOR_HANDLE SceneTargetView()const;
 
 	std::array<const CD3DX12_STATIC_SAMPLER_DESC, 6> GetStaticSamplers();
 
@@ -120,29 +255,134 @@ private:
     FrameResource* mCurrFrameResource = nullptr;
     int mCurrFrameResourceIndex = 0;
 
-    UINT mCbvSrvDescriptorSize = 0;
+	std::unique_ptr<D3D12FrameFence> mFrameFence;
+	std::unique_ptr<FramePacer> mFramePacer;
 
     ComPtr<ID3D12RootSignature> mRootSignature = nullptr;
+	ComPtr<ID3D12CommandSignature> mCommandSignature = nullptr;
+	ComPtr<ID3D12RootSignature> mUpscaleRootSignature = nullptr;
+
+	std::unique_ptr<DescriptorHeap> mSrvHeap;
 
-	ComPtr<ID3D12DescriptorHeap> mSrvDescriptorHeap = nullptr;
+	ResourceStateTracker mResourceStates;
+
+	MemoryBudget mMemory;
 
 	std::unordered_map<std::string, std::unique_ptr<MeshGeometry>> mGeometries;
 	std::unordered_map<std::string, std::unique_ptr<Material>> mMaterials;
 	std::unordered_map<std::string, std::unique_ptr<Texture>> mTextures;
+
+	// Contents of the texture files from LoadTextures until UploadTextures.
+	std::unordered_map<std::string, ComPtr<ID3DBlob>> mTextureFiles;
+
+	// Held while adding to mGeometries, which the geometry tasks of Initialize do at
+	// the same time.  The tasks that run alongside UploadGeometries only look meshes up
+	// with at(), which leaves the map as it is.
+	std::mutex mGeometriesMutex;
 	std::unordered_map<std::string, ComPtr<ID3DBlob>> mShaders;
 	std::unordered_map<std::string, ComPtr<ID3D12PipelineState>> mPSOs;
 
     std::vector<D3D12_INPUT_ELEMENT_DESC> mStdInputLayout;
 	std::vector<D3D12_INPUT_ELEMENT_DESC> mTreeSpriteInputLayout;
+	std::vector<D3D12_INPUT_ELEMENT_DESC> mTreeInstanceInputLayout;
+	std::vector<D3D12_INPUT_ELEMENT_DESC> mImpostorInputLayout;
+	std::vector<D3D12_INPUT_ELEMENT_DESC> mWavesInputLayout;
+	std::vector<D3D12_INPUT_ELEMENT_DESC> mWavesDisplacedInputLayout;
 
     RenderItem* mWavesRitem = nullptr;
 
+	// Bytes written for the water in the last frame, to its dynamic vertex stream or
+	// its surface texture.
+	UINT mWavesUploadBytes = 0;
+
+	// Rows of each frame resource's WavesDynamicVB that are out of date, and a row of
+	// vertices to pack them in before copying.
+	std::unique_ptr<DirtyRowTracker> mWavesDirtyRows;
+	std::vector<WaveVertex> mWavesRowScratch;
+
+	// With the surface texture on, Waves packs its heights and slopes into the frame's
+	// upload buffer, which is copied to mWavesSurfaceMap and displaces a static grid.
+	ComPtr<ID3D12Resource> mWavesSurfaceMap = nullptr;
+	int mWavesSurfaceSrvHeapIndex = -1;
+	UINT mWavesSurfaceRowPitch = 0;
+
+	bool mUseWavesSurfaceMap = true;
+	bool mWavesModeKeyDown = false;
+
+	// Steps the water less often while it is off screen or small on it, and says when its
+	// vertex streams or surface texture need writing.  mWavesSurfaceWritten is set when
+	// this frame's upload buffer holds new texels for Draw to copy.
+	std::unique_ptr<SimulationLod> mWavesLod;
+	bool mWavesSurfaceWritten = false;
+
+	// Floating crate i is body i of mCrateBuoyancy.  The water's world matrix is the
+	// identity, so the bodies' positions are world positions.
+	std::unique_ptr<Buoyancy> mCrateBuoyancy;
+	std::vector<RenderItem*> mCrateItems;
+	bool mMemoryKeyDown = false;
+
 	// List of all the render items.
 	std::vector<std::unique_ptr<RenderItem>> mAllRitems;
 
 	// Render items divided by PSO.
 	std::vector<RenderItem*> mRitemLayer[(int)RenderLayer::Count];
 
+	// Visible items of each layer as ranges of the current frame's indirect arguments.
+	std::vector<IndirectDrawRun> mIndirectRuns[(int)RenderLayer::Count];
+	IndirectDrawStats mIndirectStats;
+
+	// Commands of every item, indexed by ObjCBIndex, with material addresses relative to
+	// the frame resource's material buffer.  Each layer's items are packed in the order
+	// of mIndirectOrder, and mIndirectPackOrder is the current frame's visible part of it.
+	IndirectArgsPacker mIndirectPacker{ sizeof(IndirectDrawCommand) };
+	std::vector<RenderItem*> mIndirectItems;
+	std::vector<RenderItem*> mIndirectDynamicItems;
+	std::vector<std::uint32_t> mIndirectOrder[(int)RenderLayer::Count];
+	std::vector<std::uint32_t> mIndirectPackOrder;
+	ConstantBufferWriteStats mCBWriteStats;
+	FrustumCuller mCuller;
+	std::vector<std::uint32_t> mVisibleItems;
+
+	bool mUseIndirectDraws = true;
+	bool mIndirectKeyDown = false;
+
+	// With instanced trees on, the tree sprites are culled on the CPU and drawn as
+	// instances of one quad instead of being expanded by the geometry shader.
+	RenderItem* mTreeSpritesRitem = nullptr;
+	BillboardCuller mTreeCuller;
+
+	bool mUseInstancedTrees = true;
+	bool mTreesModeKeyDown = false;
+
+	// Cascades of the main light's shadow, fitted to the camera every frame, and for
+	// each cascade the indices into mShadowCasters of the items that can shadow it.
+	// Nothing draws into shadow maps yet; this is the CPU side a shadow pass needs.
+	std::unique_ptr<ShadowCascades> mShadowCascades;
+	std::vector<RenderItem*> mShadowCasters;
+	std::vector<std::vector<std::uint32_t>> mShadowCasterLists;
+
+	// Castle parts farther than mImpostorDistance from the eye are drawn as impostors.
+	// Atlas slice i is mImpostorAtlases[i]; their texels only live on the GPU.
+	std::vector<ImpostorAtlas> mImpostorAtlases;
+	std::vector<RenderItem*> mImpostorItems;
+	std::vector<ImpostorRun> mImpostorRuns;
+	int mImpostorSrvHeapIndex = -1;
+	float mImpostorDistance = 90.0f;
+
+	bool mUseImpostors = true;
+	bool mImpostorKeyDown = false;
+
+	// The scene is drawn into the top-left mRenderWidth x mRenderHeight of a window sized
+	// target, then stretched over the back buffer.
+	DynamicResolution mDynamicResolution;
+	ComPtr<ID3D12Resource> mSceneTarget = nullptr;
+	int mSceneSrvHeapIndex = -1;
+	UINT mRenderWidth = 0;
+	UINT mRenderHeight = 0;
+
+	bool mUseDynamicResolution = true;
+	bool mResolutionKeyDown = false;
+
 	std::unique_ptr<Waves> mWaves;
 
     PassConstants mMainPassCB;
@@ -194,32 +434,87 @@ TreeBillboardsApp::~TreeBillboardsApp()
 
 bool TreeBillboardsApp::Initialize()
 {
+	auto start = std::chrono::high_resolution_clock::now();
+
     if(!D3DApp::Initialize())
         return false;
 
+	mFrameFence = std::make_unique<D3D12FrameFence>(mFence.Get());
+	mFramePacer = std::make_unique<FramePacer>(mFrameFence.get(), gNumFrameResources, 3);
+
     // Reset the command list to prep for initialization commands.
     ThrowIfFailed(mCommandList->Reset(mDirectCmdListAlloc.Get(), nullptr));
 
-    // Get the increment size of a descriptor in this heap type.  This is hardware specific, 
-	// so we have to query this information.
-    mCbvSrvDescriptorSize = md3dDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+	// The grid is all the sea the scene shows and stays put, so its size is set by how
+	// far the water reaches around the island.  The sponge quiets its outer 20 cells.
+    mWaves = std::make_unique<Waves>(128, 128, 1.0f, 0.03f, 4.0f, 0.2f, 20);
+	mWavesLod = std::make_unique<SimulationLod>(mWaves->TimeStep(), mUseWavesSurfaceMap ? 1 : gNumFrameResources);
 
-    mWaves = std::make_unique<Waves>(128, 128, 1.0f, 0.03f, 4.0f, 0.2f);
+	// Shadows end well before the far plane, which leaves the near cascades more of
+	// the maps.
+	ShadowCascadeSettings shadowSettings;
+	shadowSettings.MaxDistance = 300.0f;
+	mShadowCascades = std::make_unique<ShadowCascades>(shadowSettings);
  
-	LoadTextures();
-    BuildRootSignature();
-	BuildDescriptorHeaps();
-    BuildShadersAndInputLayouts();
-    BuildLandGeometry();
-    BuildWavesGeometry();
-	BuildBoxGeometry();
-	BuildConeGeometry();
-	BuildCylinderGeometry();
-	BuildTreeSpritesGeometry();
-	BuildMaterials();
-    BuildRenderItems();
-    BuildFrameResources();
-    BuildPSOs();
+	//
+	// File reads, shader compilation, mesh generation and pipeline creation only need
+	// the CPU or the device, so they run at the same time.  Everything that records
+	// into the command list is chained after them: texture uploads, then the geometry
+	// uploads, then the impostor atlases.
+	//
+	TaskGraph init;
+
+	auto textureFiles = init.Add(L"Texture files", [this] { LoadTextures(); });
+	auto rootSignatures = init.Add(L"Root signatures", [this]
+	{
+		BuildRootSignature();
+		BuildCommandSignature();
+		BuildUpscaleRootSignature();
+	});
+	auto shaders = init.Add(L"Shaders", [this] { BuildShadersAndInputLayouts(); });
+
+	auto land = init.Add(L"Land mesh", [this] { BuildLandGeometry(); });
+	auto water = init.Add(L"Water mesh", [this] { BuildWavesGeometry(); });
+	auto box = init.Add(L"Box mesh", [this] { BuildBoxGeometry(); });
+	auto cone = init.Add(L"Cone mesh", [this] { BuildConeGeometry(); });
+	auto cylinder = init.Add(L"Cylinder mesh", [this] { BuildCylinderGeometry(); });
+	auto treeSprites = init.Add(L"Tree sprite mesh", [this] { BuildTreeSpritesGeometry(); });
+	auto treeQuad = init.Add(L"Tree quad mesh", [this] { BuildTreeQuadGeometry(); });
+	auto flagSprites = init.Add(L"Flag sprite mesh", [this] { BuildFlagSpritesGeometry(); });
+
+	init.Add(L"PSOs", [this] { BuildPSOs(); }, { rootSignatures, shaders });
+
+	auto textureUploads = init.Add(L"Texture uploads", [this]
+	{
+		UploadTextures();
+		BuildDescriptorHeaps();
+		BuildWavesSurfaceMap();
+	}, { textureFiles });
+	auto materials = init.Add(L"Materials", [this] { BuildMaterials(); }, { textureUploads });
+
+	auto renderItems = init.Add(L"Render items", [this]
+	{
+		BuildRenderItems();
+		BuildWavesWetMask();
+	}, { materials, land, water, box, cone, cylinder, treeSprites, treeQuad, flagSprites });
+
+	auto geometryUploads = init.Add(L"Geometry uploads", [this] { UploadGeometries(); },
+		{ textureUploads, land, water, box, cone, cylinder, treeSprites, treeQuad, flagSprites });
+
+	// Crates are added after the impostors are baked, so they get none.
+	auto impostors = init.Add(L"Impostor loading", [this] { LoadImpostors(); }, { renderItems });
+	auto crates = init.Add(L"Floating crates", [this] { BuildFloatingCrates(); }, { impostors });
+	init.Add(L"Impostor uploads", [this] { UploadImpostors(); }, { impostors, geometryUploads });
+
+	init.Add(L"Frame resources", [this] { BuildFrameResources(); }, { crates });
+	init.Add(L"Indirect commands", [this] { BuildIndirectCommands(); }, { crates, geometryUploads });
+
+	auto graphStart = std::chrono::high_resolution_clock::now();
+	init.Run();
+	auto graphEnd = std::chrono::high_resolution_clock::now();
+
+	// Move every geometry buffer to GENERIC_READ with one barrier call.
+	mResourceStates.Flush(mCommandList.Get());
 
     // Execute the initialization commands.
     ThrowIfFailed(mCommandList->Close());
@@ -229,13 +524,62 @@ bool TreeBillboardsApp::Initialize()
     // Wait until initialization is complete.
     FlushCommandQueue();
 
+	auto end = std::chrono::high_resolution_clock::now();
+
+	std::wstring text = L"Initialization tasks:\n" + init.FormatReport() +
+		L"Device, window and simulations: " + std::to_wstring(std::chrono::duration<double, std::milli>(graphStart - start).count()) +
+		L" ms, GPU uploads: " + std::to_wstring(std::chrono::duration<double, std::milli>(end - graphEnd).count()) +
+		L" ms, startup: " + std::to_wstring(std::chrono::duration<double, std::milli>(end - start).count()) + L" ms\n";
+	::OutputDebugString(text.c_str());
+
+	TrackInitialMemory();
+	ReleaseUploadMemory();
+
+	::OutputDebugString((L"Memory after initialization:\n" + mMemory.FormatReport()).c_str());
+
     return true;
 }
  
+void TreeBillboardsApp::CreateRtvAndDsvDescriptorHeaps()
+{
+	// One RTV past the swap chain buffers for the scene target.
+    D3D12_DESCRIPTOR_HEAP_DESC rtvHeapDesc;
+    rtvHeapDesc.NumDescriptors = SwapChainBufferCount + 1;
+    rtvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
+    rtvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+	rtvHeapDesc.NodeMask = 0;
+    ThrowIfFailed(md3dDevice->CreateDescriptorHeap(
+        &rtvHeapDesc, IID_PPV_ARGS(mRtvHeap.GetAddressOf())));
+
+    D3D12_DESCRIPTOR_HEAP_DESC dsvHeapDesc;
+    dsvHeapDesc.NumDescriptors = 1;
+    dsvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_DSV;
+    dsvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+	dsvHeapDesc.NodeMask = 0;
+    ThrowIfFailed(md3dDevice->CreateDescriptorHeap(
+        &dsvHeapDesc, IID_PPV_ARGS(mDsvHeap.GetAddressOf())));
+}
+
 void TreeBillboardsApp::OnResize()
 {
+	// The swap chain and depth buffers are about to be recreated.
+	for(int i = 0; i < SwapChainBufferCount; ++i)
+		mResourceStates.Unregister(mSwapChainBuffer[i].Get());
+	mResourceStates.Unregister(mDepthStencilBuffer.Get());
+
     D3DApp::OnResize();
 
+	for(int i = 0; i < SwapChainBufferCount; ++i)
+		mResourceStates.Register(mSwapChainBuffer[i].Get(), D3D12_RESOURCE_STATE_PRESENT);
+	mResourceStates.Register(mDepthStencilBuffer.Get(), D3D12_RESOURCE_STATE_DEPTH_WRITE);
+
+	// Keyed by member, so the new buffers replace the old ones in the accounting.
+	for(int i = 0; i < SwapChainBufferCount; ++i)
+		TrackResource(&mSwapChainBuffer[i], mSwapChainBuffer[i].Get(), MemoryCategory::Textures);
+	TrackResource(&mDepthStencilBuffer, mDepthStencilBuffer.Get(), MemoryCategory::Textures);
+
+	BuildSceneTarget();
+
     // The window resized, so update the aspect ratio and recompute the projection matrix.
     XMMATRIX P = XMMatrixPerspectiveFovLH(0.25f*MathHelper::Pi, AspectRatio(), 1.0f, 1000.0f);
     XMStoreFloat4x4(&mProj, P);
@@ -247,24 +591,31 @@ void TreeBillboardsApp::Update(const GameTimer& gt)
 	UpdateCamera(gt);
 
     // Cycle through the circular frame resource array.
-    mCurrFrameResourceIndex = (mCurrFrameResourceIndex + 1) % gNumFrameResources;
+    mCurrFrameResourceIndex = (mCurrFrameResourceIndex + 1) % mFramePacer->FramesInFlight();
     mCurrFrameResource = mFrameResources[mCurrFrameResourceIndex].get();
 
     // Has the GPU finished processing the commands of the current frame resource?
     // If not, wait until the GPU has completed commands up to this fence point.
-    if(mCurrFrameResource->Fence != 0 && mFence->GetCompletedValue() < mCurrFrameResource->Fence)
-    {
-        HANDLE eventHandle = CreateEventEx(nullptr, nullptr, false, EVENT_ALL_ACCESS);
-        ThrowIfFailed(mFence->SetEventOnCompletion(mCurrFrameResource->Fence, eventHandle));
-        WaitForSingleObject(eventHandle, INFINITE);
-        CloseHandle(eventHandle);
-    }
+	// The pacer may also change the number of frames in flight here.  Frame resources
+	// that were not cycled through catch up on the constants changed in the meantime
+	// by themselves, as they know the versions their slots were written from.
+	mFramePacer->BeginFrame(mCurrFrameResource->Fence);
 
-	AnimateMaterials(gt);
+	UpdateRenderScale(gt);
+
+	// Transient descriptors written by frames the GPU has finished can be reused.
+	mSrvHeap->ReleaseCompleted(mFence->GetCompletedValue());
+
+	mCBWriteStats = ConstantBufferWriteStats();
+	UpdateFloatingCrates(gt);
 	UpdateObjectCBs(gt);
 	UpdateMaterialCBs(gt);
 	UpdateMainPassCB(gt);
+	UpdateShadowCascades(gt);
     UpdateWaves(gt);
+	UpdateImpostors(gt);
+	UpdateIndirectArgs(gt);
+	UpdateTreeInstances(gt);
 }
 
 void TreeBillboardsApp::Draw(const GameTimer& gt)
@@ -279,42 +630,115 @@ void TreeBillboardsApp::Draw(const GameTimer& gt)
     // Reusing the command list reuses memory.
     ThrowIfFailed(mCommandList->Reset(cmdListAlloc.Get(), mPSOs["opaque"].Get()));
 
-    mCommandList->RSSetViewports(1, &mScreenViewport);
-    mCommandList->RSSetScissorRects(1, &mScissorRect);
+	mResourceStates.BeginFrame();
+
+	if(mUseWavesSurfaceMap && mWavesSurfaceWritten)
+		CopyWavesSurface(mCommandList.Get());
+
+	bool upscale = UseSceneTarget();
+	ID3D12Resource* sceneTarget = upscale ? mSceneTarget.Get() : CurrentBackBuffer();
+	D3D12_CPU_DESCRIPTOR_HANDLE sceneTargetView = upscale ? SceneTargetView() : CurrentBackBufferView();
+
+	// Only the top-left mRenderWidth x mRenderHeight of the target is rendered to.
+	D3D12_VIEWPORT sceneViewport = mScreenViewport;
+	sceneViewport.Width = (float)mRenderWidth;
+	sceneViewport.Height = (float)mRenderHeight;
+	D3D12_RECT sceneScissorRect = { 0, 0, (LONG)mRenderWidth, (LONG)mRenderHeight };
+
+    mCommandList->RSSetViewports(1, &sceneViewport);
+    mCommandList->RSSetScissorRects(1, &sceneScissorRect);
 
     // Indicate a state transition on the resource usage.
-	mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(CurrentBackBuffer(),
-		D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET));
+	mResourceStates.Transition(sceneTarget, D3D12_RESOURCE_STATE_RENDER_TARGET);
+	mResourceStates.Flush(mCommandList.Get());
 
     // Clear the back buffer and depth buffer.
-    mCommandList->ClearRenderTargetView(CurrentBackBufferView(), (float*)&mMainPassCB.FogColor, 0, nullptr);
+    mCommandList->ClearRenderTargetView(sceneTargetView, (float*)&mMainPassCB.FogColor, 0, nullptr);
     mCommandList->ClearDepthStencilView(DepthStencilView(), D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0f, 0, 0, nullptr);
 
     // Specify the buffers we are going to render to.
-    mCommandList->OMSetRenderTargets(1, &CurrentBackBufferView(), true, &DepthStencilView());
+    mCommandList->OMSetRenderTargets(1, &sceneTargetView, true, &DepthStencilView());
 
-	ID3D12DescriptorHeap* descriptorHeaps[] = { mSrvDescriptorHeap.Get() };
+	ID3D12DescriptorHeap* descriptorHeaps[] = { mSrvHeap->Heap() };
 	mCommandList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
 
 	mCommandList->SetGraphicsRootSignature(mRootSignature.Get());
 
 	auto passCB = mCurrFrameResource->PassCB->Resource();
 	mCommandList->SetGraphicsRootConstantBufferView(2, passCB->GetGPUVirtualAddress());
+	mCommandList->SetGraphicsRootShaderResourceView(6, mCurrFrameResource->ObjectBuffer->Resource()->GetGPUVirtualAddress());
 
-    DrawRenderItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::Opaque]);
+    DrawLayer(mCommandList.Get(), RenderLayer::Opaque);
+
+	if(!mImpostorRuns.empty())
+	{
+		mCommandList->SetPipelineState(mPSOs["impostors"].Get());
+		DrawImpostors(mCommandList.Get());
+	}
 
 	mCommandList->SetPipelineState(mPSOs["alphaTested"].Get());
-	DrawRenderItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::AlphaTested]);
+	DrawLayer(mCommandList.Get(), RenderLayer::AlphaTested);
 
-	mCommandList->SetPipelineState(mPSOs["treeSprites"].Get());
-	DrawRenderItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::AlphaTestedTreeSprites]);
+	if(mUseInstancedTrees)
+	{
+		mCommandList->SetPipelineState(mPSOs["treeSpritesInstanced"].Get());
+		DrawTreeInstances(mCommandList.Get());
+		mCommandList->SetPipelineState(mPSOs["treeSprites"].Get());
+	}
+	else
+	{
+		mCommandList->SetPipelineState(mPSOs["treeSprites"].Get());
+		DrawLayer(mCommandList.Get(), RenderLayer::AlphaTestedTreeSprites);
+	}
+
+	// The few flags always go through the geometry shader.
+	DrawLayer(mCommandList.Get(), RenderLayer::AlphaTestedFlagSprites);
 
 	mCommandList->SetPipelineState(mPSOs["transparent"].Get());
-	DrawRenderItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::Transparent]);
+	DrawLayer(mCommandList.Get(), RenderLayer::Transparent);
+
+	if(mUseWavesSurfaceMap)
+	{
+		mCommandList->SetPipelineState(mPSOs["wavesDisplaced"].Get());
+		mCommandList->SetGraphicsRootDescriptorTable(4, mSrvHeap->GpuHandle(mWavesSurfaceSrvHeapIndex));
+	}
+	else
+	{
+		mCommandList->SetPipelineState(mPSOs["waves"].Get());
+	}
+	DrawLayer(mCommandList.Get(), RenderLayer::Waves);
+
+	if(upscale)
+	{
+		// Both transitions go out in one batch.
+		mResourceStates.Transition(mSceneTarget.Get(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+		mResourceStates.Transition(CurrentBackBuffer(), D3D12_RESOURCE_STATE_RENDER_TARGET);
+		mResourceStates.Flush(mCommandList.Get());
+
+		mCommandList->RSSetViewports(1, &mScreenViewport);
+		mCommandList->RSSetScissorRects(1, &mScissorRect);
+		mCommandList->OMSetRenderTargets(1, &CurrentBackBufferView(), true, nullptr);
+
+		mCommandList->SetGraphicsRootSignature(mUpscaleRootSignature.Get());
+		mCommandList->SetPipelineState(mPSOs["upscale"].Get());
+		mCommandList->SetGraphicsRootDescriptorTable(0, mSrvHeap->GpuHandle(mSceneSrvHeapIndex));
+
+		float upscaleConstants[4] =
+		{
+			(float)mRenderWidth / mClientWidth,
+			(float)mRenderHeight / mClientHeight,
+			(mRenderWidth - 0.5f) / mClientWidth,
+			(mRenderHeight - 0.5f) / mClientHeight
+		};
+		mCommandList->SetGraphicsRoot32BitConstants(1, 4, upscaleConstants, 0);
+
+		mCommandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+		mCommandList->DrawInstanced(3, 1, 0, 0);
+	}
 
     // Indicate a state transition on the resource usage.
-	mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(CurrentBackBuffer(),
-		D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT));
+	mResourceStates.Transition(CurrentBackBuffer(), D3D12_RESOURCE_STATE_PRESENT);
+	mResourceStates.Flush(mCommandList.Get());
 
     // Done recording commands.
     ThrowIfFailed(mCommandList->Close());
@@ -329,11 +753,13 @@ void TreeBillboardsApp::Draw(const GameTimer& gt)
 
     // Advance the fence value to mark commands up to this fence point.
     mCurrFrameResource->Fence = ++mCurrentFence;
+	mSrvHeap->FinishFrame(mCurrentFence);
 
     // Add an instruction to the command queue to set a new fence point. 
     // Because we are on the GPU timeline, the new fence point won't be 
     // set until the GPU finishes processing all the commands prior to this Signal().
     mCommandQueue->Signal(mFence.Get(), mCurrentFence);
+	mFramePacer->EndFrame(mCurrentFence);
 }
 
 void TreeBillboardsApp::OnMouseDown(WPARAM btnState, int x, int y)
@@ -383,6 +809,107 @@ void TreeBillboardsApp::OnMouseMove(WPARAM btnState, int x, int y)
  
 void TreeBillboardsApp::OnKeyboardInput(const GameTimer& gt)
 {
+	// 'I' switches between ExecuteIndirect and one draw call per item.
+	bool indirectKeyDown = d3dUtil::IsKeyDown('I');
+	if(indirectKeyDown && !mIndirectKeyDown)
+	{
+		mUseIndirectDraws = !mUseIndirectDraws;
+
+		std::wstring text = std::wstring(mUseIndirectDraws ? L"Indirect draws on" : L"Indirect draws off") +
+			L": " + std::to_wstring(mIndirectStats.ItemsVisible) + L"/" + std::to_wstring(mIndirectStats.ItemsTotal) +
+			L" items visible, " + std::to_wstring(mIndirectStats.DirectDrawCalls) + L" draw calls as " +
+			std::to_wstring(mIndirectStats.ExecuteIndirectCalls) + L" ExecuteIndirect calls, " +
+			std::to_wstring(mWavesUploadBytes) + L" water bytes uploaded (" +
+			std::to_wstring(mWavesDirtyRows->Stats().TotalBytesUploaded) + L" of " +
+			std::to_wstring(mWavesDirtyRows->Stats().TotalBytesFull) + L" for the vertex stream so far)\n";
+		::OutputDebugString(text.c_str());
+	}
+	mIndirectKeyDown = indirectKeyDown;
+
+	// 'R' switches dynamic resolution on and off.
+	bool resolutionKeyDown = d3dUtil::IsKeyDown('R');
+	if(resolutionKeyDown && !mResolutionKeyDown)
+		mUseDynamicResolution = !mUseDynamicResolution;
+	mResolutionKeyDown = resolutionKeyDown;
+
+	// 'V' switches the water between the per-frame vertex stream and the surface texture.
+	bool wavesModeKeyDown = d3dUtil::IsKeyDown('V');
+	if(wavesModeKeyDown && !mWavesModeKeyDown)
+	{
+		mUseWavesSurfaceMap = !mUseWavesSurfaceMap;
+
+		// The one surface texture, or each frame resource's vertex stream, is out of date.
+		mWavesLod->InvalidateUploads(mUseWavesSurfaceMap ? 1 : gNumFrameResources);
+	}
+	mWavesModeKeyDown = wavesModeKeyDown;
+
+	// 'M' prints the memory report.
+	bool memoryKeyDown = d3dUtil::IsKeyDown('M');
+	if(memoryKeyDown && !mMemoryKeyDown)
+	{
+		::OutputDebugString(mMemory.FormatReport().c_str());
+
+		std::wstring text = L"Constant buffers, last frame: " + std::to_wstring(mCBWriteStats.ObjectSlots) +
+			L" object and " + std::to_wstring(mCBWriteStats.MaterialSlots) + L" material slots rewritten, " +
+			std::to_wstring(mCBWriteStats.BytesWritten) + L" bytes\n";
+		::OutputDebugString(text.c_str());
+
+		const WavesStats& wavesStats = mWaves->Stats();
+		text = L"Water: " + std::to_wstring(wavesStats.CellsStepped) + L" cells stepped, " +
+			std::to_wstring(wavesStats.CellsSkipped) + L" skipped as dry, in " + std::to_wstring(wavesStats.Steps) + L" steps\n";
+		::OutputDebugString(text.c_str());
+
+		// Since startup, like the cell counts above.  Reading them leaves them alone.
+		const wchar_t* levelNames[] = { L"full", L"distant", L"hidden" };
+		const SimulationLodStats& lodStats = mWavesLod->Stats();
+		text = L"Water LOD: " + std::wstring(levelNames[(int)lodStats.Level]) + L", rate " + std::to_wstring(lodStats.Rate) +
+			L", " + std::to_wstring(lodStats.Lag) + L" s behind, " + std::to_wstring(lodStats.StepsTaken) + L" of " +
+			std::to_wstring(lodStats.StepsDue) + L" steps taken (" + std::to_wstring(lodStats.CatchUpSteps) + L" catching up), " +
+			std::to_wstring(lodStats.StepsDropped) + L" dropped saving " + std::to_wstring(lodStats.SavedMs) + L" ms, " +
+			std::to_wstring(lodStats.UploadsSkipped) + L"/" + std::to_wstring(lodStats.Frames) + L" frames without uploads\n";
+		::OutputDebugString(text.c_str());
+
+		text = L"Shadow cascades, last frame:";
+		for(size_t i = 0; i < mShadowCasterLists.size(); ++i)
+		{
+			const ShadowCascade& cascade = mShadowCascades->Cascade((int)i);
+			text += L" " + std::to_wstring(cascade.SplitNear) + L"-" + std::to_wstring(cascade.SplitFar) +
+				L" (" + std::to_wstring(mShadowCasterLists[i].size()) + L" casters)";
+		}
+		text += L" of " + std::to_wstring(mShadowCasters.size()) + L"\n";
+		::OutputDebugString(text.c_str());
+	}
+	mMemoryKeyDown = memoryKeyDown;
+
+	// 'T' switches the tree sprites between the instanced quads and the geometry shader.
+	bool treesModeKeyDown = d3dUtil::IsKeyDown('T');
+	if(treesModeKeyDown && !mTreesModeKeyDown)
+	{
+		mUseInstancedTrees = !mUseInstancedTrees;
+
+		const BillboardCullStats& stats = mTreeCuller.LastStats();
+		std::wstring text = std::wstring(mUseInstancedTrees ? L"Instanced trees on" : L"Instanced trees off") +
+			L": " + std::to_wstring(stats.Visible) + L"/" + std::to_wstring(stats.Tested) + L" sprites visible\n";
+		::OutputDebugString(text.c_str());
+	}
+	mTreesModeKeyDown = treesModeKeyDown;
+
+	// 'P' switches impostors for distant castle parts on and off.
+	bool impostorKeyDown = d3dUtil::IsKeyDown('P');
+	if(impostorKeyDown && !mImpostorKeyDown)
+	{
+		mUseImpostors = !mUseImpostors;
+
+		UINT impostorCount = 0;
+		for(const ImpostorRun& run : mImpostorRuns)
+			impostorCount += run.InstanceCount;
+
+		std::wstring text = std::wstring(mUseImpostors ? L"Impostors on" : L"Impostors off") +
+			L": " + std::to_wstring(impostorCount) + L"/" + std::to_wstring(mImpostorItems.size()) +
+			L" castle parts were impostors last frame\n";
+		::OutputDebugString(text.c_str());
+	}
+	mImpostorKeyDown = impostorKeyDown;
 }
  
 void TreeBillboardsApp::UpdateCamera(const GameTimer& gt)
@@ -401,50 +928,59 @@ void TreeBillboardsApp::UpdateCamera(const GameTimer& gt)
 	XMStoreFloat4x4(&mView, view);
 }
 
-void TreeBillboardsApp::AnimateMaterials(const GameTimer& gt)
+void TreeBillboardsApp::UpdateRenderScale(const GameTimer& gt)
 {
-	// Scroll the water material texture coordinates.
-	auto waterMat = mMaterials["water"].get();
-
-	float& tu = waterMat->MatTransform(3, 0);
-	float& tv = waterMat->MatTransform(3, 1);
-
-	tu += 0.1f * gt.DeltaTime();
-	tv += 0.02f * gt.DeltaTime();
-
-	if(tu >= 1.0f)
-		tu -= 1.0f;
-
-	if(tv >= 1.0f)
-		tv -= 1.0f;
-
-	waterMat->MatTransform(3, 0) = tu;
-	waterMat->MatTransform(3, 1) = tv;
+	if(mUseDynamicResolution && UseSceneTarget())
+	{
+		// The frame time includes the wait on the GPU; leave it out for the CPU's share.
+		double cpuTime = std::max(0.0, (double)gt.DeltaTime() - mFramePacer->LastCpuWait());
+		mDynamicResolution.Update(mFramePacer->LastGpuBusy(), cpuTime);
+	}
+	else
+	{
+		mDynamicResolution.Reset();
+	}
 
-	// Material has changed, so need to update cbuffer.
-	waterMat->NumFramesDirty = gNumFrameResources;
+	mRenderWidth = mDynamicResolution.ScaledSize((UINT)mClientWidth);
+	mRenderHeight = mDynamicResolution.ScaledSize((UINT)mClientHeight);
 }
 
 void TreeBillboardsApp::UpdateObjectCBs(const GameTimer& gt)
 {
-	auto currObjectCB = mCurrFrameResource->ObjectCB.get();
+	auto currObjects = mCurrFrameResource->ObjectBuffer.get();
+	auto& slotVersions = mCurrFrameResource->ObjectVersions;
 	for(auto& e : mAllRitems)
 	{
-		// Only update the cbuffer data if the constants have changed.  
-		// This needs to be tracked per frame resource.
-		if(e->NumFramesDirty > 0)
+		// Only update the record if the constants changed since this frame resource's
+		// slot was last written.
+		std::uint64_t version = e->Version();
+		if(slotVersions[e->ObjCBIndex] != version)
 		{
-			XMMATRIX world = XMLoadFloat4x4(&e->World);
-			XMMATRIX texTransform = XMLoadFloat4x4(&e->TexTransform);
-
 			ObjectConstants objConstants;
-			XMStoreFloat4x4(&objConstants.World, XMMatrixTranspose(world));
-			XMStoreFloat4x4(&objConstants.TexTransform, XMMatrixTranspose(texTransform));
-
-			currObjectCB->CopyData(e->ObjCBIndex, objConstants);
 
-			// Next FrameResource need to be updated too.
-			e->NumFramesDirty--;
+			// The last column of an affine matrix is always (0, 0, 0, 1).
+			XMMATRIX world = XMMatrixTranspose(XMLoadFloat4x4(&e->World.Get()));
+			XMStoreFloat4(&objConstants.World[0], world.r[0]);
+			XMStoreFloat4(&objConstants.World[1], world.r[1]);
+			XMStoreFloat4(&objConstants.World[2], world.r[2]);
+
+			// The shader skips identity texture transforms.
+			const XMFLOAT4X4& texTransform = e->TexTransform.Get();
+			if(!XMMatrixIsIdentity(XMLoadFloat4x4(&texTransform)))
+			{
+				assert(texTransform._12 == 0.0f && texTransform._21 == 0.0f &&
+					"Texture transforms can only scale and offset.");
+
+				objConstants.TexScaleOffset = XMFLOAT4(texTransform._11, texTransform._22,
+					texTransform._41, texTransform._42);
+				objConstants.Flags |= ObjectFlagTexTransform;
+			}
+
+			currObjects->CopyData(e->ObjCBIndex, objConstants);
+			slotVersions[e->ObjCBIndex] = version;
+
+			++mCBWriteStats.ObjectSlots;
+			mCBWriteStats.BytesWritten += sizeof(ObjectConstants);
 		}
 	}
 }
@@ -452,14 +988,16 @@ void TreeBillboardsApp::UpdateObjectCBs(const GameTimer& gt)
 void TreeBillboardsApp::UpdateMaterialCBs(const GameTimer& gt)
 {
 	auto currMaterialCB = mCurrFrameResource->MaterialCB.get();
+	auto& slotVersions = mCurrFrameResource->MaterialCBVersions;
 	for(auto& e : mMaterials)
 	{
-		// Only update the cbuffer data if the constants have changed.  If the cbuffer
-		// data changes, it needs to be updated for each FrameResource.
+		// Only update the cbuffer data if the constants changed since this frame
+		// resource's slot was last written.
 		Material* mat = e.second.get();
-		if(mat->NumFramesDirty > 0)
+		std::uint64_t version = mat->Version();
+		if(slotVersions[mat->MatCBIndex] != version)
 		{
-			XMMATRIX matTransform = XMLoadFloat4x4(&mat->MatTransform);
+			XMMATRIX matTransform = XMLoadFloat4x4(&mat->MatTransform.Get());
 
 			MaterialConstants matConstants;
 			matConstants.DiffuseAlbedo = mat->DiffuseAlbedo;
@@ -467,10 +1005,18 @@ void TreeBillboardsApp::UpdateMaterialCBs(const GameTimer& gt)
 			matConstants.Roughness = mat->Roughness;
 			XMStoreFloat4x4(&matConstants.MatTransform, XMMatrixTranspose(matTransform));
 
+			const UvAnimation& animation = mat->Animation;
+			matConstants.UvScrollSpeed = animation.ScrollSpeed;
+			matConstants.UvRotationSpeed = animation.RotationSpeed;
+			matConstants.UvRotationCenter = animation.RotationCenter;
+			matConstants.FlipbookFrameRate = animation.FlipbookFrameRate;
+			matConstants.FlipbookFrameCount = animation.FlipbookFrameCount;
+
 			currMaterialCB->CopyData(mat->MatCBIndex, matConstants);
+			slotVersions[mat->MatCBIndex] = version;
 
-			// Next FrameResource need to be updated too.
-			mat->NumFramesDirty--;
+			++mCBWriteStats.MaterialSlots;
+			mCBWriteStats.BytesWritten += sizeof(MaterialConstants);
 		}
 	}
 }
@@ -492,8 +1038,8 @@ void TreeBillboardsApp::UpdateMainPassCB(const GameTimer& gt)
 	XMStoreFloat4x4(&mMainPassCB.ViewProj, XMMatrixTranspose(viewProj));
 	XMStoreFloat4x4(&mMainPassCB.InvViewProj, XMMatrixTranspose(invViewProj));
 	mMainPassCB.EyePosW = mEyePos;
-	mMainPassCB.RenderTargetSize = XMFLOAT2((float)mClientWidth, (float)mClientHeight);
-	mMainPassCB.InvRenderTargetSize = XMFLOAT2(1.0f / mClientWidth, 1.0f / mClientHeight);
+	mMainPassCB.RenderTargetSize = XMFLOAT2((float)mRenderWidth, (float)mRenderHeight);
+	mMainPassCB.InvRenderTargetSize = XMFLOAT2(1.0f / mRenderWidth, 1.0f / mRenderHeight);
 	mMainPassCB.NearZ = 1.0f;
 	mMainPassCB.FarZ = 1000.0f;
 	mMainPassCB.TotalTime = gt.TotalTime();
@@ -529,88 +1075,506 @@ void TreeBillboardsApp::UpdateWaves(const GameTimer& gt)
 		mWaves->Disturb(i, j, r);
 	}
 
-	// Update the wave simulation.
-	mWaves->Update(gt.DeltaTime());
+	//
+	// Step the water as often as how much of it is on screen calls for.
+	//
+	BoundingBox worldBounds;
+	mWavesRitem->Bounds.Transform(worldBounds, XMLoadFloat4x4(&mWavesRitem->World.Get()));
+
+	BoundingSphere sphere;
+	BoundingSphere::CreateFromBoundingBox(sphere, worldBounds);
 
-	// Update the wave vertex buffer with the new solution.
-	auto currWavesVB = mCurrFrameResource->WavesVB.get();
-	for(int i = 0; i < mWaves->VertexCount(); ++i)
+	SimulationLodLevel level = mWavesLod->Classify(sphere, XMLoadFloat4x4(&mView), XMLoadFloat4x4(&mProj));
+	int steps = mWavesLod->Advance(gt.DeltaTime(), level);
+	bool upload = mWavesLod->UploadDue();
+
+	void* surface = mCurrFrameResource->WavesSurface->MappedData();
+	bool writeSurface = upload && mUseWavesSurfaceMap;
+
+	auto start = std::chrono::high_resolution_clock::now();
+	for(int k = 0; k < steps; ++k)
 	{
-		Vertex v;
+		// The normal pass of the last step writes the surface texels straight into this
+		// frame's upload buffer; Draw copies them to mWavesSurfaceMap.
+		if(writeSurface && k == steps - 1)
+			mWaves->Step(surface, mWavesSurfaceRowPitch);
+		else
+			mWaves->Step();
+	}
+	auto end = std::chrono::high_resolution_clock::now();
+	mWavesLod->AddStepTime(std::chrono::duration<double, std::milli>(end - start).count(), steps);
 
-		v.Pos = mWaves->Position(i);
-		v.Normal = mWaves->Normal(i);
-		
-		// Derive tex-coords from position by 
-		// mapping [-w/2,w/2] --> [0,1]
-		v.TexC.x = 0.5f + v.Pos.x / mWaves->Width();
-		v.TexC.y = 0.5f - v.Pos.z / mWaves->Depth();
+	// Back on screen without a step to write the texels.
+	if(writeSurface && steps == 0)
+		mWaves->WriteSurface(surface, mWavesSurfaceRowPitch);
+
+	mWavesSurfaceWritten = writeSurface;
+	mWavesUploadBytes = writeSurface ? mWaves->RowCount()*mWaves->ColumnCount()*sizeof(std::uint32_t) : 0;
+
+	// Changed rows are out of date in every frame resource's vertex stream.  Keep
+	// marking them while the surface texture is used, so switching back works.
+	for(int i = 0; i < mWaves->RowCount(); ++i)
+	{
+		if(mWaves->RowChanged(i))
+			mWavesDirtyRows->MarkRows(i);
+	}
+	mWaves->ClearChangedRows();
+
+	if(mUseWavesSurfaceMap)
+		return;
 
-		currWavesVB->CopyData(i, v);
+	// Rewrite the rows of this frame's vertex buffer that changed since it was last
+	// written.  Only the heights and normals change; x/z and the texture coordinates
+	// are in the static stream.  While no upload is due the rows stay marked, and are
+	// written once the water is back on screen.
+	auto currWavesVB = mCurrFrameResource->WavesDynamicVB.get();
+	if(upload)
+	{
+		int n = mWaves->ColumnCount();
+		mWavesRowScratch.resize(n);
+		mWavesDirtyRows->Collect(mCurrFrameResourceIndex, [&](std::uint32_t firstRow, std::uint32_t rowCount)
+		{
+			for(int i = (int)firstRow; i < (int)(firstRow + rowCount); ++i)
+			{
+				// Gather the heights out of the positions and pack the normals.
+				VertexConversion::Copy::Run(&mWaves->Position(i*n).y, sizeof(XMFLOAT3),
+					&mWavesRowScratch[0].Height, sizeof(WaveVertex), n);
+				VertexConversion::PackNormal::Run(&mWaves->Normal(i*n), sizeof(XMFLOAT3),
+					&mWavesRowScratch[0].Normal, sizeof(WaveVertex), n);
+
+				currWavesVB->CopyRange(i*n, mWavesRowScratch.data(), n);
+			}
+		});
+		mWavesUploadBytes = (UINT)mWavesDirtyRows->Stats().BytesUploaded;
 	}
 
 	// Set the dynamic VB of the wave renderitem to the current frame VB.
-	mWavesRitem->Geo->VertexBufferGPU = currWavesVB->Resource();
+	mWavesRitem->Geo->DynamicVertexBufferGPU = currWavesVB->Resource();
+}
+
+void TreeBillboardsApp::UpdateFloatingCrates(const GameTimer& gt)
+{
+	// After a stall, let the crates skip ahead rather than integrate a long step.
+	mCrateBuoyancy->Update(*mWaves, std::min(gt.DeltaTime(), 0.1f));
+
+	for(size_t i = 0; i < mCrateItems.size(); ++i)
+	{
+		XMFLOAT3 p = mCrateBuoyancy->Position((int)i);
+		XMFLOAT3 n = mCrateBuoyancy->SurfaceNormal((int)i);
+
+		// Tilt the crate's up axis onto the surface normal under it.
+		XMMATRIX tilt = XMMatrixIdentity();
+		XMVECTOR axis = XMVector3Cross(XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f), XMLoadFloat3(&n));
+		if(XMVectorGetX(XMVector3LengthSq(axis)) > 1e-8f)
+			tilt = XMMatrixRotationAxis(XMVector3Normalize(axis), acosf(std::min(n.y, 1.0f)));
+
+		XMMATRIX world = XMMatrixScaling(0.2f, 0.2f, 0.2f) * XMMatrixRotationY(0.7f*i) * tilt *
+			XMMatrixTranslation(p.x, p.y, p.z);
+		XMStoreFloat4x4(&mCrateItems[i]->World.Edit(), world);
+	}
+}
+
+void TreeBillboardsApp::UpdateShadowCascades(const GameTimer& gt)
+{
+	// The same projection OnResize builds.
+	mShadowCascades->Fit(XMLoadFloat4x4(&mView), 0.25f*MathHelper::Pi, AspectRatio(), 1.0f, 1000.0f,
+		mMainPassCB.Lights[0].Direction);
+
+	// The floating crates move, so the casters are gathered again every frame.
+	mShadowCascades->ClearCasters();
+	mShadowCasters.clear();
+	for(RenderLayer layer : { RenderLayer::Opaque, RenderLayer::AlphaTested })
+	{
+		for(RenderItem* ri : mRitemLayer[(int)layer])
+		{
+			BoundingBox worldBounds;
+			ri->Bounds.Transform(worldBounds, XMLoadFloat4x4(&ri->World.Get()));
+
+			BoundingSphere sphere;
+			BoundingSphere::CreateFromBoundingBox(sphere, worldBounds);
+			mShadowCascades->AddCaster(sphere);
+			mShadowCasters.push_back(ri);
+		}
+	}
+
+	for(auto& list : mShadowCasterLists)
+		list.clear();
+	mShadowCascades->Cull(mShadowCasterLists);
+
+#if defined(DEBUG) || defined(_DEBUG)
+	std::vector<std::vector<std::uint32_t>> reference;
+	mShadowCascades->CullReference(reference);
+	if(reference != mShadowCasterLists)
+		::OutputDebugString(L"ShadowCascades: vector and reference culling disagree.\n");
+#endif
+}
+
+void TreeBillboardsApp::UpdateIndirectArgs(const GameTimer& gt)
+{
+	//
+	// Cull.  Culler slot i holds the world space bounding sphere of the item with
+	// ObjCBIndex i.
+	//
+	mCuller.Clear();
+	for(size_t i = 0; i < mAllRitems.size(); ++i)
+		mCuller.Add(BoundingSphere());
+
+	for(auto& e : mAllRitems)
+	{
+		BoundingBox worldBounds;
+		e->Bounds.Transform(worldBounds, XMLoadFloat4x4(&e->World.Get()));
+
+		BoundingSphere sphere;
+		BoundingSphere::CreateFromBoundingBox(sphere, worldBounds);
+		mCuller.Set(e->ObjCBIndex, sphere);
+	}
+
+	XMMATRIX viewProj = XMMatrixMultiply(XMLoadFloat4x4(&mView), XMLoadFloat4x4(&mProj));
+
+	mVisibleItems.clear();
+	mCuller.Cull(viewProj, mVisibleItems);
+
+	std::vector<bool> visible(mAllRitems.size(), false);
+	for(std::uint32_t index : mVisibleItems)
+		visible[index] = true;
+
+#if defined(DEBUG) || defined(_DEBUG)
+	// Check the vector path against the one-sphere-at-a-time test.
+	std::vector<std::uint32_t> reference;
+	mCuller.CullReference(viewProj, reference);
+	if(reference != mVisibleItems)
+		::OutputDebugString(L"FrustumCuller: vector and reference culling disagree.\n");
+#endif
+
+	//
+	// Pick the visible items of each layer in their packing order, split them into runs
+	// and pack all of their arguments in one go.
+	//
+	D3D12_GPU_VIRTUAL_ADDRESS matCB = mCurrFrameResource->MaterialCB->Resource()->GetGPUVirtualAddress();
+	auto currArgs = mCurrFrameResource->IndirectArgs.get();
+
+	// UpdateWaves points the water's second vertex buffer at the current frame
+	// resource's copy.
+	for(RenderItem* ri : mIndirectDynamicItems)
+	{
+		IndirectDrawCommand cmd = IndirectCommand(ri);
+		mIndirectPacker.Set(ri->ObjCBIndex, &cmd);
+	}
+
+	mIndirectStats = IndirectDrawStats();
+	mIndirectStats.ItemsTotal = (UINT)mAllRitems.size();
+
+	mIndirectPackOrder.clear();
+	for(int layer = 0; layer < (int)RenderLayer::Count; ++layer)
+	{
+		auto& runs = mIndirectRuns[layer];
+		runs.clear();
+
+		UINT layerStart = (UINT)mIndirectPackOrder.size();
+		for(std::uint32_t index : mIndirectOrder[layer])
+		{
+			const RenderItem* ri = mIndirectItems[index];
+			if(!visible[index] || ri->DrawAsImpostor)
+				continue;
+
+			if(runs.empty() || runs.back().DiffuseSrvHeapIndex != ri->Mat->DiffuseSrvHeapIndex ||
+				runs.back().PrimitiveType != ri->PrimitiveType)
+			{
+				IndirectDrawRun run;
+				run.FirstCommand = (UINT)mIndirectPackOrder.size();
+				run.DiffuseSrvHeapIndex = ri->Mat->DiffuseSrvHeapIndex;
+				run.PrimitiveType = ri->PrimitiveType;
+				runs.push_back(run);
+			}
+			runs.back().CommandCount++;
+
+			mIndirectPackOrder.push_back(index);
+		}
+
+		UINT layerCount = (UINT)mIndirectPackOrder.size() - layerStart;
+		mIndirectStats.ItemsVisible += layerCount;
+		mIndirectStats.DirectDrawCalls += layerCount;
+		mIndirectStats.ExecuteIndirectCalls += (UINT)runs.size();
+	}
+
+	mIndirectPacker.Pack(mIndirectPackOrder.data(), (std::uint32_t)mIndirectPackOrder.size(), matCB,
+		currArgs->MappedData());
+
+#if defined(DEBUG) || defined(_DEBUG)
+	CheckIndirectArgs(visible);
+#endif
+}
+
+void TreeBillboardsApp::BuildIndirectCommands()
+{
+	mIndirectItems.assign(mAllRitems.size(), nullptr);
+	mIndirectDynamicItems.clear();
+	mIndirectPacker.Resize((std::uint32_t)mAllRitems.size());
+
+	for(auto& e : mAllRitems)
+	{
+		mIndirectItems[e->ObjCBIndex] = e.get();
+		if(e->Geo == mWavesRitem->Geo)
+			mIndirectDynamicItems.push_back(e.get());
+
+		IndirectDrawCommand cmd = IndirectCommand(e.get());
+		mIndirectPacker.Set(e->ObjCBIndex, &cmd);
+	}
+
+	for(int layer = 0; layer < (int)RenderLayer::Count; ++layer)
+	{
+		std::vector<RenderItem*> items = mRitemLayer[layer];
+
+		// Group by texture so runs are as long as possible.  Transparent items keep their
+		// order since it decides how they blend.
+		if(layer != (int)RenderLayer::Transparent && layer != (int)RenderLayer::Waves)
+		{
+			std::stable_sort(items.begin(), items.end(), [](const RenderItem* a, const RenderItem* b)
+			{
+				if(a->Mat->DiffuseSrvHeapIndex != b->Mat->DiffuseSrvHeapIndex)
+					return a->Mat->DiffuseSrvHeapIndex < b->Mat->DiffuseSrvHeapIndex;
+				if(a->Mat->MatCBIndex != b->Mat->MatCBIndex)
+					return a->Mat->MatCBIndex < b->Mat->MatCBIndex;
+				return a->Geo < b->Geo;
+			});
+		}
+
+		mIndirectOrder[layer].clear();
+		for(RenderItem* ri : items)
+			mIndirectOrder[layer].push_back(ri->ObjCBIndex);
+	}
+}
+
+IndirectDrawCommand TreeBillboardsApp::IndirectCommand(const RenderItem* ri)const
+{
+	UINT matCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(MaterialConstants));
+
+	IndirectDrawCommand cmd = {};
+	cmd.MaterialCBAddress = ri->Mat->MatCBIndex*matCBByteSize;
+	cmd.VertexBufferView = ri->Geo->VertexBufferView();
+	if(ri->Geo->DynamicVertexBufferGPU != nullptr)
+		cmd.DynamicVertexBufferView = ri->Geo->DynamicVertexBufferView();
+	cmd.IndexBufferView = ri->Geo->IndexBufferView();
+	cmd.ObjectIndex = ri->ObjCBIndex;
+	cmd.DrawArgs.IndexCountPerInstance = ri->IndexCount;
+	cmd.DrawArgs.InstanceCount = 1;
+	cmd.DrawArgs.StartIndexLocation = ri->StartIndexLocation;
+	cmd.DrawArgs.BaseVertexLocation = ri->BaseVertexLocation;
+	cmd.DrawArgs.StartInstanceLocation = 0;
+
+	UINT indexSize = cmd.IndexBufferView.Format == DXGI_FORMAT_R16_UINT ? 2 : 4;
+	assert(cmd.DrawArgs.StartIndexLocation + cmd.DrawArgs.IndexCountPerInstance <=
+		cmd.IndexBufferView.SizeInBytes / indexSize);
+	(void)indexSize;
+
+	return cmd;
+}
+
+void TreeBillboardsApp::CheckIndirectArgs(const std::vector<bool>& visible)const
+{
+	// Reads the arguments back from the upload heap, which is slow, so debug builds only.
+	UINT matCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(MaterialConstants));
+	D3D12_GPU_VIRTUAL_ADDRESS matCB = mCurrFrameResource->MaterialCB->Resource()->GetGPUVirtualAddress();
+	auto packed = reinterpret_cast<const IndirectDrawCommand*>(mCurrFrameResource->IndirectArgs->MappedData());
+
+	bool match = true;
+	for(int layer = 0; layer < (int)RenderLayer::Count; ++layer)
+	{
+		// What DrawRenderItems draws, by object index.
+		std::vector<const RenderItem*> direct;
+		for(const RenderItem* ri : mRitemLayer[layer])
+		{
+			if(visible[ri->ObjCBIndex] && !ri->DrawAsImpostor)
+				direct.push_back(ri);
+		}
+
+		// The packed commands of the layer and the runs they were issued in.
+		typedef std::pair<const IndirectDrawCommand*, const IndirectDrawRun*> PackedCommand;
+		std::vector<PackedCommand> commands;
+		for(const IndirectDrawRun& run : mIndirectRuns[layer])
+		{
+			for(UINT i = 0; i < run.CommandCount; ++i)
+				commands.push_back(std::make_pair(&packed[run.FirstCommand + i], &run));
+		}
+
+		if(commands.size() != direct.size())
+		{
+			match = false;
+			continue;
+		}
+
+		std::sort(direct.begin(), direct.end(), [](const RenderItem* a, const RenderItem* b)
+		{
+			return a->ObjCBIndex < b->ObjCBIndex;
+		});
+		std::sort(commands.begin(), commands.end(), [](const PackedCommand& a, const PackedCommand& b)
+		{
+			return a.first->ObjectIndex < b.first->ObjectIndex;
+		});
+
+		for(size_t i = 0; i < direct.size(); ++i)
+		{
+			const RenderItem* ri = direct[i];
+			const IndirectDrawCommand& cmd = *commands[i].first;
+			const IndirectDrawRun& run = *commands[i].second;
+
+			D3D12_VERTEX_BUFFER_VIEW vbv = ri->Geo->VertexBufferView();
+			D3D12_INDEX_BUFFER_VIEW ibv = ri->Geo->IndexBufferView();
+
+			match = match &&
+				cmd.ObjectIndex == ri->ObjCBIndex &&
+				cmd.MaterialCBAddress == matCB + ri->Mat->MatCBIndex*matCBByteSize &&
+				cmd.VertexBufferView.BufferLocation == vbv.BufferLocation &&
+				cmd.VertexBufferView.SizeInBytes == vbv.SizeInBytes &&
+				cmd.VertexBufferView.StrideInBytes == vbv.StrideInBytes &&
+				cmd.IndexBufferView.BufferLocation == ibv.BufferLocation &&
+				cmd.IndexBufferView.SizeInBytes == ibv.SizeInBytes &&
+				cmd.IndexBufferView.Format == ibv.Format &&
+				cmd.DrawArgs.IndexCountPerInstance == ri->IndexCount &&
+				cmd.DrawArgs.InstanceCount == 1 &&
+				cmd.DrawArgs.StartIndexLocation == ri->StartIndexLocation &&
+				cmd.DrawArgs.BaseVertexLocation == ri->BaseVertexLocation &&
+				run.DiffuseSrvHeapIndex == ri->Mat->DiffuseSrvHeapIndex &&
+				run.PrimitiveType == ri->PrimitiveType;
+
+			if(ri->Geo->DynamicVertexBufferGPU != nullptr)
+			{
+				D3D12_VERTEX_BUFFER_VIEW dynamicVbv = ri->Geo->DynamicVertexBufferView();
+				match = match && cmd.DynamicVertexBufferView.BufferLocation == dynamicVbv.BufferLocation &&
+					cmd.DynamicVertexBufferView.SizeInBytes == dynamicVbv.SizeInBytes;
+			}
+		}
+	}
+
+	if(!match)
+		::OutputDebugString(L"Indirect arguments do not match the direct draws.\n");
+}
+
+void TreeBillboardsApp::UpdateTreeInstances(const GameTimer& gt)
+{
+	if(!mUseInstancedTrees)
+		return;
+
+	XMMATRIX view = XMLoadFloat4x4(&mView);
+	XMMATRIX proj = XMLoadFloat4x4(&mProj);
+	XMMATRIX viewProj = XMMatrixMultiply(view, proj);
+
+	// The sprites are placed in world space, so the culler needs no world matrix.
+	auto treeInstances = mCurrFrameResource->TreeInstances.get();
+	mCurrFrameResource->TreeInstanceCount = mTreeCuller.Cull(viewProj,
+		reinterpret_cast<BillboardInstance*>(treeInstances->MappedData()), mTreeCuller.Count());
+}
+
+void TreeBillboardsApp::UpdateImpostors(const GameTimer& gt)
+{
+	mImpostorRuns.clear();
+
+	auto currInstances = mCurrFrameResource->ImpostorInstances.get();
+	XMVECTOR eye = XMLoadFloat3(&mEyePos);
+
+	// mImpostorItems is sorted by material, so each material gives one run.
+	UINT instanceCount = 0;
+	for(RenderItem* ri : mImpostorItems)
+	{
+		const ImpostorAtlas& atlas = mImpostorAtlases[ri->ImpostorSlice];
+
+		// The atlas center is relative to the item's position.
+		XMVECTOR center = XMVectorAdd(XMLoadFloat3(&atlas.Center),
+			XMVectorSet(ri->World.Get()._41, ri->World.Get()._42, ri->World.Get()._43, 0.0f));
+		XMVECTOR toEye = XMVectorSubtract(eye, center);
+
+		ri->DrawAsImpostor = mUseImpostors && XMVectorGetX(XMVector3Length(toEye)) > mImpostorDistance;
+		if(!ri->DrawAsImpostor)
+			continue;
+
+		// Show the frame baked closest to the view direction, on a quad facing the
+		// direction it was baked from.
+		XMFLOAT3 viewDir;
+		XMStoreFloat3(&viewDir, toEye);
+
+		std::uint32_t frameX, frameY;
+		ImpostorBaker::NearestFrame(viewDir, atlas.FramesPerSide, frameX, frameY);
+
+		XMFLOAT3 right, up;
+		ImpostorBaker::FrameBasis(ImpostorBaker::FrameDirection(frameX, frameY, atlas.FramesPerSide), right, up);
+
+		float frameSize = 1.0f / atlas.FramesPerSide;
+
+		ImpostorInstance instance;
+		XMStoreFloat3(&instance.CenterW, center);
+		instance.FrameSize = frameSize;
+		XMStoreFloat3(&instance.AxisX, XMVectorScale(XMLoadFloat3(&right), atlas.Radius));
+		instance.FrameU = frameX*frameSize;
+		XMStoreFloat3(&instance.AxisY, XMVectorScale(XMLoadFloat3(&up), atlas.Radius));
+		instance.FrameV = frameY*frameSize;
+		instance.Slice = (std::uint32_t)ri->ImpostorSlice;
+
+		currInstances->CopyData(instanceCount, instance);
+
+		if(mImpostorRuns.empty() || mImpostorRuns.back().Mat != ri->Mat)
+		{
+			ImpostorRun run;
+			run.FirstInstance = instanceCount;
+			run.Mat = ri->Mat;
+			mImpostorRuns.push_back(run);
+		}
+		mImpostorRuns.back().InstanceCount++;
+
+		instanceCount++;
+	}
 }
 
 void TreeBillboardsApp::LoadTextures()
 {
-	auto grassTex = std::make_unique<Texture>();
-	grassTex->Name = "grassTex";
-	grassTex->Filename = L"../../Textures/grass.dds";
-	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(md3dDevice.Get(),
-		mCommandList.Get(), grassTex->Filename.c_str(),
-		grassTex->Resource, grassTex->UploadHeap));
-
-	auto waterTex = std::make_unique<Texture>();
-	waterTex->Name = "waterTex";
-	waterTex->Filename = L"../../Textures/water1.dds";
-	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(md3dDevice.Get(),
-		mCommandList.Get(), waterTex->Filename.c_str(),
-		waterTex->Resource, waterTex->UploadHeap));
-
-	auto fenceTex = std::make_unique<Texture>();
-	fenceTex->Name = "fenceTex";
-	fenceTex->Filename = L"../../Textures/WireFence.dds";
-	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(md3dDevice.Get(),
-		mCommandList.Get(), fenceTex->Filename.c_str(),
-		fenceTex->Resource, fenceTex->UploadHeap));
-
-	auto brickTex = std::make_unique<Texture>();
-	brickTex->Name = "brickTex";
-	brickTex->Filename = L"../../Textures/bricks2.dds";
-	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(md3dDevice.Get(),
-		mCommandList.Get(), brickTex->Filename.c_str(),
-		brickTex->Resource, brickTex->UploadHeap));
-
-	auto tileTex = std::make_unique<Texture>();
-	tileTex->Name = "tileTex";
-	tileTex->Filename = L"../../Textures/bricks3.dds";
-	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(md3dDevice.Get(),
-		mCommandList.Get(), tileTex->Filename.c_str(),
-		tileTex->Resource, tileTex->UploadHeap));
-
-	auto woodTex = std::make_unique<Texture>();
-	woodTex->Name = "woodTex";
-	woodTex->Filename = L"../../Textures/WoodCrate02.dds";
-	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(md3dDevice.Get(),
-		mCommandList.Get(), woodTex->Filename.c_str(),
-		woodTex->Resource, woodTex->UploadHeap));
-
-	auto treeArrayTex = std::make_unique<Texture>();
-	treeArrayTex->Name = "treeArrayTex";
-	treeArrayTex->Filename = L"../../Textures/treeArray.dds";
-	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(md3dDevice.Get(),
-		mCommandList.Get(), treeArrayTex->Filename.c_str(),
-		treeArrayTex->Resource, treeArrayTex->UploadHeap));
-
-	mTextures[grassTex->Name] = std::move(grassTex);
-	mTextures[waterTex->Name] = std::move(waterTex);
-	mTextures[fenceTex->Name] = std::move(fenceTex);
-	mTextures[brickTex->Name] = std::move(brickTex);
-	mTextures[tileTex->Name] = std::move(tileTex);
-	mTextures[woodTex->Name] = std::move(woodTex);
-	mTextures[treeArrayTex->Name] = std::move(treeArrayTex);
+	struct TextureFile
+	{
+		const char* Name;
+		const wchar_t* Filename;
+	};
+
+	const TextureFile files[] =
+	{
+		{ "grassTex", L"../../Textures/grass.dds" },
+		{ "waterTex", L"../../Textures/water1.dds" },
+		{ "fenceTex", L"../../Textures/WireFence.dds" },
+		{ "brickTex", L"../../Textures/bricks2.dds" },
+		{ "tileTex", L"../../Textures/bricks3.dds" },
+		{ "woodTex", L"../../Textures/WoodCrate02.dds" },
+		{ "treeArrayTex", L"../../Textures/treeArray.dds" },
+		{ "flagArrayTex", L"../../Textures/flagArray.dds" }
+	};
+	const UINT fileCount = _countof(files);
+
+	// Reading the files needs neither the device nor the command list.
+	std::vector<ComPtr<ID3DBlob>> contents(fileCount);
+	concurrency::parallel_for(0u, fileCount, [&](UINT i)
+	{
+		contents[i] = d3dUtil::LoadBinary(files[i].Filename);
+	});
+
+	for(UINT i = 0; i < fileCount; ++i)
+	{
+		auto tex = std::make_unique<Texture>();
+		tex->Name = files[i].Name;
+		tex->Filename = files[i].Filename;
+
+		mTextureFiles[tex->Name] = contents[i];
+		mTextures[tex->Name] = std::move(tex);
+	}
+}
+
+void TreeBillboardsApp::UploadTextures()
+{
+	for(auto& e : mTextureFiles)
+	{
+		Texture* tex = mTextures[e.first].get();
+		ThrowIfFailed(DirectX::CreateDDSTextureFromMemory12(md3dDevice.Get(),
+			mCommandList.Get(), (const uint8_t*)e.second->GetBufferPointer(), e.second->GetBufferSize(),
+			tex->Resource, tex->UploadHeap));
+	}
+
+	// The upload heaps have the texels now.
+	mTextureFiles.clear();
 }
 
 void TreeBillboardsApp::BuildRootSignature()
@@ -618,19 +1582,31 @@ void TreeBillboardsApp::BuildRootSignature()
 	CD3DX12_DESCRIPTOR_RANGE texTable;
 	texTable.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0);
 
+	CD3DX12_DESCRIPTOR_RANGE waveSurfaceTable;
+	waveSurfaceTable.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 1);
+
+	// Impostor albedo and normal atlases.
+	CD3DX12_DESCRIPTOR_RANGE impostorTable;
+	impostorTable.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 2, 2);
+
     // Root parameter can be a table, root descriptor or root constants.
-    CD3DX12_ROOT_PARAMETER slotRootParameter[4];
+    CD3DX12_ROOT_PARAMETER slotRootParameter[7];
 
 	// Perfomance TIP: Order from most frequent to least frequent.
+	// Parameter 1 is the index of the object being drawn into the structured buffer of
+	// parameter 6.
 	slotRootParameter[0].InitAsDescriptorTable(1, &texTable, D3D12_SHADER_VISIBILITY_PIXEL);
-    slotRootParameter[1].InitAsConstantBufferView(0);
+    slotRootParameter[1].InitAsConstants(1, 0);
     slotRootParameter[2].InitAsConstantBufferView(1);
     slotRootParameter[3].InitAsConstantBufferView(2);
+	slotRootParameter[4].InitAsDescriptorTable(1, &waveSurfaceTable, D3D12_SHADER_VISIBILITY_VERTEX);
+	slotRootParameter[5].InitAsDescriptorTable(1, &impostorTable, D3D12_SHADER_VISIBILITY_PIXEL);
+	slotRootParameter[6].InitAsShaderResourceView(0, 1, D3D12_SHADER_VISIBILITY_VERTEX);
 
 	auto staticSamplers = GetStaticSamplers();
 
     // A root signature is an array of root parameters.
-	CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc(4, slotRootParameter,
+	CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc(7, slotRootParameter,
 		(UINT)staticSamplers.size(), staticSamplers.data(),
 		D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
 
@@ -653,81 +1629,350 @@ void TreeBillboardsApp::BuildRootSignature()
         IID_PPV_ARGS(mRootSignature.GetAddressOf())));
 }
 
+void TreeBillboardsApp::BuildCommandSignature()
+{
+	// Each command sets the material constant buffer, the vertex and index buffers and
+	// the object index, and then draws.  See IndirectDrawCommand.  Slot 1 gets an empty
+	// view for items with a single vertex stream.
+	D3D12_INDIRECT_ARGUMENT_DESC argumentDescs[6] = {};
+	argumentDescs[0].Type = D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT_BUFFER_VIEW;
+	argumentDescs[0].ConstantBufferView.RootParameterIndex = 3;
+	argumentDescs[1].Type = D3D12_INDIRECT_ARGUMENT_TYPE_VERTEX_BUFFER_VIEW;
+	argumentDescs[1].VertexBuffer.Slot = 0;
+	argumentDescs[2].Type = D3D12_INDIRECT_ARGUMENT_TYPE_VERTEX_BUFFER_VIEW;
+	argumentDescs[2].VertexBuffer.Slot = 1;
+	argumentDescs[3].Type = D3D12_INDIRECT_ARGUMENT_TYPE_INDEX_BUFFER_VIEW;
+	argumentDescs[4].Type = D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT;
+	argumentDescs[4].Constant.RootParameterIndex = 1;
+	argumentDescs[4].Constant.DestOffsetIn32BitValues = 0;
+	argumentDescs[4].Constant.Num32BitValuesToSet = 1;
+	argumentDescs[5].Type = D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED;
+
+	D3D12_COMMAND_SIGNATURE_DESC signatureDesc = {};
+	signatureDesc.ByteStride = sizeof(IndirectDrawCommand);
+	signatureDesc.NumArgumentDescs = _countof(argumentDescs);
+	signatureDesc.pArgumentDescs = argumentDescs;
+
+	// The root signature is needed since the commands change root arguments.
+	ThrowIfFailed(md3dDevice->CreateCommandSignature(&signatureDesc, mRootSignature.Get(),
+		IID_PPV_ARGS(mCommandSignature.GetAddressOf())));
+}
+
+void TreeBillboardsApp::BuildUpscaleRootSignature()
+{
+	CD3DX12_DESCRIPTOR_RANGE sceneTable;
+	sceneTable.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0);
+
+	CD3DX12_ROOT_PARAMETER slotRootParameter[2];
+	slotRootParameter[0].InitAsDescriptorTable(1, &sceneTable, D3D12_SHADER_VISIBILITY_PIXEL);
+	slotRootParameter[1].InitAsConstants(4, 0, 0, D3D12_SHADER_VISIBILITY_PIXEL);
+
+	const CD3DX12_STATIC_SAMPLER_DESC linearClamp(
+		0, // shaderRegister
+		D3D12_FILTER_MIN_MAG_MIP_LINEAR, // filter
+		D3D12_TEXTURE_ADDRESS_MODE_CLAMP,  // addressU
+		D3D12_TEXTURE_ADDRESS_MODE_CLAMP,  // addressV
+		D3D12_TEXTURE_ADDRESS_MODE_CLAMP); // addressW
+
+	CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc(2, slotRootParameter, 1, &linearClamp,
+		D3D12_ROOT_SIGNATURE_FLAG_NONE);
+
+	ComPtr<ID3DBlob> serializedRootSig = nullptr;
+	ComPtr<ID3DBlob> errorBlob = nullptr;
+	HRESULT hr = D3D12SerializeRootSignature(&rootSigDesc, D3D_ROOT_SIGNATURE_VERSION_1,
+		serializedRootSig.GetAddressOf(), errorBlob.GetAddressOf());
+
+	if(errorBlob != nullptr)
+	{
+		::OutputDebugStringA((char*)errorBlob->GetBufferPointer());
+	}
+	ThrowIfFailed(hr);
+
+	ThrowIfFailed(md3dDevice->CreateRootSignature(
+		0,
+		serializedRootSig->GetBufferPointer(),
+		serializedRootSig->GetBufferSize(),
+		IID_PPV_ARGS(mUpscaleRootSignature.GetAddressOf())));
+}
+
 void TreeBillboardsApp::BuildDescriptorHeaps()
 {
 	//
-	// Create the SRV heap.
+	// Create the SRV heap.  Textures live in the persistent region; the transient
+	// ring is for descriptors that only need to survive the frame being recorded.
 	//
-	D3D12_DESCRIPTOR_HEAP_DESC srvHeapDesc = {};
-	srvHeapDesc.NumDescriptors = 7;
-	srvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-	srvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
-	ThrowIfFailed(md3dDevice->CreateDescriptorHeap(&srvHeapDesc, IID_PPV_ARGS(&mSrvDescriptorHeap)));
+	const UINT persistentCount = 32;
+	const UINT transientCountPerFrame = 16;
+	mSrvHeap = std::make_unique<DescriptorHeap>(md3dDevice.Get(), D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV,
+		persistentCount, transientCountPerFrame * gNumFrameResources, true);
 
 	//
-	// Fill out the heap with actual descriptors.
+	// Fill out the heap with actual descriptors.  Each texture remembers the slot it
+	// was given, so materials look it up by texture instead of depending on the
+	// order the views were created in.
 	//
-	CD3DX12_CPU_DESCRIPTOR_HANDLE hDescriptor(mSrvDescriptorHeap->GetCPUDescriptorHandleForHeapStart());
+	for(auto& e : mTextures)
+		CreateTextureSrv(e.second.get());
 
-	auto grassTex = mTextures["grassTex"]->Resource;
-	auto waterTex = mTextures["waterTex"]->Resource;
-	auto fenceTex = mTextures["fenceTex"]->Resource;
-	auto brickTex = mTextures["brickTex"]->Resource;
-	auto tileTex = mTextures["tileTex"]->Resource;
-	auto woodTex = mTextures["woodTex"]->Resource;
-	auto treeArrayTex = mTextures["treeArrayTex"]->Resource;
+	// The scene target already exists since OnResize ran during D3DApp::Initialize.
+	mSceneSrvHeapIndex = (int)mSrvHeap->AllocatePersistent().Offset;
+	CreateSceneTargetSrv();
+
+	DescriptorHeapStats stats = mSrvHeap->Stats();
+	std::wstring text = L"SRV heap: " + std::to_wstring(stats.PersistentUsed) + L"/" +
+		std::to_wstring(stats.PersistentCapacity) + L" persistent, " +
+		std::to_wstring(stats.TransientCapacity) + L" transient, fragmentation " +
+		std::to_wstring(stats.Fragmentation) + L"\n";
+	::OutputDebugString(text.c_str());
+}
+
+void TreeBillboardsApp::CreateTextureSrv(Texture* tex)
+{
+	auto resource = tex->Resource;
+	D3D12_RESOURCE_DESC desc = resource->GetDesc();
 
 	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
 	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-	srvDesc.Format = grassTex->GetDesc().Format;
-	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-	srvDesc.Texture2D.MostDetailedMip = 0;
-	srvDesc.Texture2D.MipLevels = -1;
-	md3dDevice->CreateShaderResourceView(grassTex.Get(), &srvDesc, hDescriptor);
+	srvDesc.Format = desc.Format;
 
-	// next descriptor
-	hDescriptor.Offset(1, mCbvSrvDescriptorSize);
+	if(desc.DepthOrArraySize > 1)
+	{
+		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
+		srvDesc.Texture2DArray.MostDetailedMip = 0;
+		srvDesc.Texture2DArray.MipLevels = -1;
+		srvDesc.Texture2DArray.FirstArraySlice = 0;
+		srvDesc.Texture2DArray.ArraySize = desc.DepthOrArraySize;
+	}
+	else
+	{
+		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+		srvDesc.Texture2D.MostDetailedMip = 0;
+		srvDesc.Texture2D.MipLevels = -1;
+	}
 
-	srvDesc.Format = waterTex->GetDesc().Format;
-	md3dDevice->CreateShaderResourceView(waterTex.Get(), &srvDesc, hDescriptor);
+	DescriptorRange srv = mSrvHeap->AllocatePersistent();
+	md3dDevice->CreateShaderResourceView(resource.Get(), &srvDesc, mSrvHeap->CpuHandle(srv.Offset));
 
-	// next descriptor
-	hDescriptor.Offset(1, mCbvSrvDescriptorSize);
+	tex->SrvHeapIndex = (int)srv.Offset;
+}
+
+void TreeBillboardsApp::BuildSceneTarget()
+{
+	// Called from OnResize, after the GPU was flushed, so the old target is unused.
+	mResourceStates.Unregister(mSceneTarget.Get());
+	mSceneTarget.Reset();
 
-	srvDesc.Format = fenceTex->GetDesc().Format;
-	md3dDevice->CreateShaderResourceView(fenceTex.Get(), &srvDesc, hDescriptor);
+	D3D12_RESOURCE_DESC texDesc;
+	ZeroMemory(&texDesc, sizeof(D3D12_RESOURCE_DESC));
+	texDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+	texDesc.Alignment = 0;
+	texDesc.Width = mClientWidth;
+	texDesc.Height = mClientHeight;
+	texDesc.DepthOrArraySize = 1;
+	texDesc.MipLevels = 1;
+	texDesc.Format = mBackBufferFormat;
+	texDesc.SampleDesc.Count = 1;
+	texDesc.SampleDesc.Quality = 0;
+	texDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+	texDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET;
 
-	// next descriptor
-	hDescriptor.Offset(1, mCbvSrvDescriptorSize);
+	D3D12_CLEAR_VALUE optClear;
+	optClear.Format = mBackBufferFormat;
+	optClear.Color[0] = mMainPassCB.FogColor.x;
+	optClear.Color[1] = mMainPassCB.FogColor.y;
+	optClear.Color[2] = mMainPassCB.FogColor.z;
+	optClear.Color[3] = mMainPassCB.FogColor.w;
 
-	srvDesc.Format = brickTex->GetDesc().Format;
-	md3dDevice->CreateShaderResourceView(brickTex.Get(), &srvDesc, hDescriptor);
+	ThrowIfFailed(md3dDevice->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+		D3D12_HEAP_FLAG_NONE,
+		&texDesc,
+		D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
+		&optClear,
+		IID_PPV_ARGS(mSceneTarget.GetAddressOf())));
 
-	//next descriptor
-	hDescriptor.Offset(1, mCbvSrvDescriptorSize);
+	mResourceStates.Register(mSceneTarget.Get(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+	TrackResource(&mSceneTarget, mSceneTarget.Get(), MemoryCategory::Textures);
 
-	srvDesc.Format = tileTex->GetDesc().Format;
-	md3dDevice->CreateShaderResourceView(tileTex.Get(), &srvDesc, hDescriptor);
+	md3dDevice->CreateRenderTargetView(mSceneTarget.Get(), nullptr, SceneTargetView());
 
-	// next descriptor
-	hDescriptor.Offset(1, mCbvSrvDescriptorSize);
+	if(mSceneSrvHeapIndex >= 0)
+		CreateSceneTargetSrv();
+}
 
-	srvDesc.Format = woodTex->GetDesc().Format;
-	md3dDevice->CreateShaderResourceView(woodTex.Get(), &srvDesc, hDescriptor);
+void TreeBillboardsApp::CreateSceneTargetSrv()
+{
+	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+	srvDesc.Format = mBackBufferFormat;
+	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+	srvDesc.Texture2D.MostDetailedMip = 0;
+	srvDesc.Texture2D.MipLevels = 1;
+
+	md3dDevice->CreateShaderResourceView(mSceneTarget.Get(), &srvDesc, mSrvHeap->CpuHandle(mSceneSrvHeapIndex));
+}
+
+void TreeBillboardsApp::BuildWavesSurfaceMap()
+{
+	UINT width = (UINT)mWaves->ColumnCount();
+	UINT height = (UINT)mWaves->RowCount();
 
-	hDescriptor.Offset(1, mCbvSrvDescriptorSize);
+	// Rows of a texture copy source must start on a D3D12_TEXTURE_DATA_PITCH_ALIGNMENT
+	// boundary.
+	const UINT pitchAlignment = D3D12_TEXTURE_DATA_PITCH_ALIGNMENT;
+	mWavesSurfaceRowPitch = (width*(UINT)sizeof(std::uint32_t) + pitchAlignment - 1) & ~(pitchAlignment - 1);
 
-	auto desc = treeArrayTex->GetDesc();
-	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
-	srvDesc.Format = treeArrayTex->GetDesc().Format;
-	srvDesc.Texture2DArray.MostDetailedMip = 0;
-	srvDesc.Texture2DArray.MipLevels = -1;
-	srvDesc.Texture2DArray.FirstArraySlice = 0;
-	srvDesc.Texture2DArray.ArraySize = treeArrayTex->GetDesc().DepthOrArraySize;
-	md3dDevice->CreateShaderResourceView(treeArrayTex.Get(), &srvDesc, hDescriptor);
+	D3D12_RESOURCE_DESC texDesc;
+	ZeroMemory(&texDesc, sizeof(D3D12_RESOURCE_DESC));
+	texDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+	texDesc.Alignment = 0;
+	texDesc.Width = width;
+	texDesc.Height = height;
+	texDesc.DepthOrArraySize = 1;
+	texDesc.MipLevels = 1;
+	texDesc.Format = DXGI_FORMAT_R32_UINT;
+	texDesc.SampleDesc.Count = 1;
+	texDesc.SampleDesc.Quality = 0;
+	texDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+	texDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
 
+	ThrowIfFailed(md3dDevice->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+		D3D12_HEAP_FLAG_NONE,
+		&texDesc,
+		D3D12_RESOURCE_STATE_COPY_DEST,
+		nullptr,
+		IID_PPV_ARGS(mWavesSurfaceMap.GetAddressOf())));
+
+	mResourceStates.Register(mWavesSurfaceMap.Get(), D3D12_RESOURCE_STATE_COPY_DEST);
+
+	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+	srvDesc.Format = DXGI_FORMAT_R32_UINT;
+	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+	srvDesc.Texture2D.MostDetailedMip = 0;
+	srvDesc.Texture2D.MipLevels = 1;
+
+	mWavesSurfaceSrvHeapIndex = (int)mSrvHeap->AllocatePersistent().Offset;
+	md3dDevice->CreateShaderResourceView(mWavesSurfaceMap.Get(), &srvDesc, mSrvHeap->CpuHandle(mWavesSurfaceSrvHeapIndex));
+}
+
+void TreeBillboardsApp::TrackResource(const void* key, ID3D12Resource* resource, MemoryCategory category)
+{
+	if(resource == nullptr)
+		return;
+
+	D3D12_RESOURCE_DESC desc = resource->GetDesc();
+	D3D12_RESOURCE_ALLOCATION_INFO info = md3dDevice->GetResourceAllocationInfo(0, 1, &desc);
+	mMemory.Track(key, category, info.SizeInBytes);
+}
+
+void TreeBillboardsApp::TrackBlob(ID3DBlob* blob)
+{
+	if(blob != nullptr)
+		mMemory.Track(blob, MemoryCategory::GeometryCpu, blob->GetBufferSize());
+}
+
+void TreeBillboardsApp::TrackInitialMemory()
+{
+	for(auto& e : mGeometries)
+	{
+		MeshGeometry* geo = e.second.get();
+
+		TrackBlob(geo->VertexBufferCPU.Get());
+		TrackBlob(geo->IndexBufferCPU.Get());
+		TrackBlob(geo->ColorBufferCPU.Get());
+
+		TrackResource(geo->VertexBufferGPU.Get(), geo->VertexBufferGPU.Get(), MemoryCategory::GeometryGpu);
+		TrackResource(geo->IndexBufferGPU.Get(), geo->IndexBufferGPU.Get(), MemoryCategory::GeometryGpu);
+		TrackResource(geo->ColorBufferGPU.Get(), geo->ColorBufferGPU.Get(), MemoryCategory::GeometryGpu);
+
+		TrackResource(geo->VertexBufferUploader.Get(), geo->VertexBufferUploader.Get(), MemoryCategory::Staging);
+		TrackResource(geo->IndexBufferUploader.Get(), geo->IndexBufferUploader.Get(), MemoryCategory::Staging);
+		TrackResource(geo->ColorBufferUploader.Get(), geo->ColorBufferUploader.Get(), MemoryCategory::Staging);
+	}
+
+	for(auto& e : mTextures)
+	{
+		Texture* tex = e.second.get();
+		TrackResource(tex->Resource.Get(), tex->Resource.Get(), MemoryCategory::Textures);
+		TrackResource(tex->UploadHeap.Get(), tex->UploadHeap.Get(), MemoryCategory::Staging);
+	}
+
+	TrackResource(mWavesSurfaceMap.Get(), mWavesSurfaceMap.Get(), MemoryCategory::Textures);
+
+	for(auto& frameResource : mFrameResources)
+	{
+		FrameResource* fr = frameResource.get();
+
+		TrackResource(fr->PassCB->Resource(), fr->PassCB->Resource(), MemoryCategory::Constants);
+		TrackResource(fr->ObjectBuffer->Resource(), fr->ObjectBuffer->Resource(), MemoryCategory::Constants);
+		TrackResource(fr->MaterialCB->Resource(), fr->MaterialCB->Resource(), MemoryCategory::Constants);
+
+		if(fr->WavesDynamicVB != nullptr)
+			TrackResource(fr->WavesDynamicVB->Resource(), fr->WavesDynamicVB->Resource(), MemoryCategory::Staging);
+		if(fr->WavesSurface != nullptr)
+			TrackResource(fr->WavesSurface->Resource(), fr->WavesSurface->Resource(), MemoryCategory::Staging);
+		if(fr->TreeInstances != nullptr)
+			TrackResource(fr->TreeInstances->Resource(), fr->TreeInstances->Resource(), MemoryCategory::Staging);
+		if(fr->ImpostorInstances != nullptr)
+			TrackResource(fr->ImpostorInstances->Resource(), fr->ImpostorInstances->Resource(), MemoryCategory::Staging);
+		TrackResource(fr->IndirectArgs->Resource(), fr->IndirectArgs->Resource(), MemoryCategory::Staging);
+	}
+}
+
+void TreeBillboardsApp::ReleaseUploadMemory()
+{
+	// Only call once the initialization commands have finished on the GPU.
+	for(auto& e : mGeometries)
+	{
+		MeshGeometry* geo = e.second.get();
+
+		mMemory.Untrack(geo->VertexBufferUploader.Get());
+		mMemory.Untrack(geo->IndexBufferUploader.Get());
+		mMemory.Untrack(geo->ColorBufferUploader.Get());
+		geo->DisposeUploaders();
+
+		if(!geo->KeepCpuCopy)
+		{
+			mMemory.Untrack(geo->VertexBufferCPU.Get());
+			mMemory.Untrack(geo->IndexBufferCPU.Get());
+			mMemory.Untrack(geo->ColorBufferCPU.Get());
+			geo->ReleaseCpuCopies();
+		}
+	}
+
+	for(auto& e : mTextures)
+	{
+		Texture* tex = e.second.get();
+		mMemory.Untrack(tex->UploadHeap.Get());
+		tex->UploadHeap = nullptr;
+	}
 }
 
+void TreeBillboardsApp::CopyWavesSurface(ID3D12GraphicsCommandList* cmdList)
+{
+	// One texture is shared by all frame resources.  Commands run in order on the one
+	// queue, so the copy can not overtake the draws of the previous frame.
+	mResourceStates.Transition(mWavesSurfaceMap.Get(), D3D12_RESOURCE_STATE_COPY_DEST);
+	mResourceStates.Flush(cmdList);
+
+	D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprint = {};
+	footprint.Offset = 0;
+	footprint.Footprint.Format = DXGI_FORMAT_R32_UINT;
+	footprint.Footprint.Width = (UINT)mWaves->ColumnCount();
+	footprint.Footprint.Height = (UINT)mWaves->RowCount();
+	footprint.Footprint.Depth = 1;
+	footprint.Footprint.RowPitch = mWavesSurfaceRowPitch;
+
+	CD3DX12_TEXTURE_COPY_LOCATION dst(mWavesSurfaceMap.Get(), 0);
+	CD3DX12_TEXTURE_COPY_LOCATION src(mCurrFrameResource->WavesSurface->Resource(), footprint);
+	cmdList->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
+
+	// Goes out together with the render target transition in Draw.
+	mResourceStates.Transition(mWavesSurfaceMap.Get(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+}
+
 void TreeBillboardsApp::BuildShadersAndInputLayouts()
 {
 	const D3D_SHADER_MACRO defines[] =
@@ -743,13 +1988,69 @@ void TreeBillboardsApp::BuildShadersAndInputLayouts()
 		NULL, NULL
 	};
 
-	mShaders["standardVS"] = d3dUtil::CompileShader(L"Shaders\\Default.hlsl", nullptr, "VS", "vs_5_1");
-	mShaders["opaquePS"] = d3dUtil::CompileShader(L"Shaders\\Default.hlsl", nullptr, "PS", "ps_5_1");
-	mShaders["alphaTestedPS"] = d3dUtil::CompileShader(L"Shaders\\Default.hlsl", alphaTestDefines, "PS", "ps_5_1");
-	
-	mShaders["treeSpriteVS"] = d3dUtil::CompileShader(L"Shaders\\TreeSprite.hlsl", nullptr, "VS", "vs_5_1");
-	mShaders["treeSpriteGS"] = d3dUtil::CompileShader(L"Shaders\\TreeSprite.hlsl", nullptr, "GS", "gs_5_1");
-	mShaders["treeSpritePS"] = d3dUtil::CompileShader(L"Shaders\\TreeSprite.hlsl", alphaTestDefines, "PS", "ps_5_1");
+	const D3D_SHADER_MACRO treeInstancedDefines[] =
+	{
+		"FOG", "1",
+		"ALPHA_TEST", "1",
+		"INSTANCED", "1",
+		NULL, NULL
+	};
+
+	const D3D_SHADER_MACRO wavesDefines[] =
+	{
+		"FOG", "1",
+		"WAVES", "1",
+		NULL, NULL
+	};
+
+	const D3D_SHADER_MACRO wavesDisplacedDefines[] =
+	{
+		"FOG", "1",
+		"WAVES_DISPLACEMENT", "1",
+		NULL, NULL
+	};
+
+	struct ShaderSource
+	{
+		const char* Name;
+		const wchar_t* Filename;
+		const D3D_SHADER_MACRO* Defines;
+		const char* EntryPoint;
+		const char* Target;
+	};
+
+	const ShaderSource sources[] =
+	{
+		{ "standardVS", L"Shaders\\Default.hlsl", nullptr, "VS", "vs_5_1" },
+		{ "opaquePS", L"Shaders\\Default.hlsl", nullptr, "PS", "ps_5_1" },
+		{ "alphaTestedPS", L"Shaders\\Default.hlsl", alphaTestDefines, "PS", "ps_5_1" },
+		{ "wavesVS", L"Shaders\\Default.hlsl", wavesDefines, "VS", "vs_5_1" },
+		{ "wavesDisplacedVS", L"Shaders\\Default.hlsl", wavesDisplacedDefines, "VS", "vs_5_1" },
+
+		{ "treeSpriteVS", L"Shaders\\TreeSprite.hlsl", nullptr, "VS", "vs_5_1" },
+		{ "treeSpriteGS", L"Shaders\\TreeSprite.hlsl", nullptr, "GS", "gs_5_1" },
+		{ "treeSpritePS", L"Shaders\\TreeSprite.hlsl", alphaTestDefines, "PS", "ps_5_1" },
+		{ "treeSpriteInstancedVS", L"Shaders\\TreeSprite.hlsl", treeInstancedDefines, "VS", "vs_5_1" },
+		{ "treeSpriteInstancedPS", L"Shaders\\TreeSprite.hlsl", treeInstancedDefines, "PS", "ps_5_1" },
+
+		{ "impostorVS", L"Shaders\\Impostor.hlsl", defines, "VS", "vs_5_1" },
+		{ "impostorPS", L"Shaders\\Impostor.hlsl", defines, "PS", "ps_5_1" },
+
+		{ "upscaleVS", L"Shaders\\Upscale.hlsl", nullptr, "VS", "vs_5_1" },
+		{ "upscalePS", L"Shaders\\Upscale.hlsl", nullptr, "PS", "ps_5_1" }
+	};
+	const UINT sourceCount = _countof(sources);
+
+	// The compiler is free threaded, so every shader gets its own task.
+	std::vector<ComPtr<ID3DBlob>> byteCode(sourceCount);
+	concurrency::parallel_for(0u, sourceCount, [&](UINT i)
+	{
+		byteCode[i] = d3dUtil::CompileShader(sources[i].Filename, sources[i].Defines,
+			sources[i].EntryPoint, sources[i].Target);
+	});
+
+	for(UINT i = 0; i < sourceCount; ++i)
+		mShaders[sources[i].Name] = byteCode[i];
 
     mStdInputLayout =
     {
@@ -758,13 +2059,77 @@ void TreeBillboardsApp::BuildShadersAndInputLayouts()
 		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 24, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
     };
 
-	mTreeSpriteInputLayout =
+	mTreeSpriteInputLayout =
+	{
+		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "SIZE", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+	};
+
+	// Slot 0 is the quad corner, slot 1 the BillboardInstance of the sprite.
+	mTreeInstanceInputLayout =
+	{
+		{ "CORNER", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 8, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 1, 0, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
+		{ "SIZE", 0, DXGI_FORMAT_R32G32_FLOAT, 1, 12, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
+		{ "ARRAYSLICE", 0, DXGI_FORMAT_R32_UINT, 1, 20, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
+	};
+
+	// Slot 0 is the quad corner, slot 1 the ImpostorInstance of the item.
+	mImpostorInputLayout =
+	{
+		{ "CORNER", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "POSITION", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 0, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
+		{ "AXIS", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 16, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
+		{ "AXIS", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 32, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
+		{ "ARRAYSLICE", 0, DXGI_FORMAT_R32_UINT, 1, 48, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
+	};
+
+	// Slot 0 is the static part of the water vertex, slot 1 the WaveVertex written each frame.
+	mWavesInputLayout =
+	{
+		{ "POSITION", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 8, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "HEIGHT", 0, DXGI_FORMAT_R32_FLOAT, 1, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "NORMAL", 0, DXGI_FORMAT_R8G8B8A8_SNORM, 1, 4, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+	};
+
+	// Just the static stream; heights and normals come from the surface texture.
+	mWavesDisplacedInputLayout =
 	{
-		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-		{ "SIZE", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "POSITION", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 8, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
 	};
 }
 
+void TreeBillboardsApp::AddGeometry(std::unique_ptr<MeshGeometry> geo)
+{
+	std::lock_guard<std::mutex> lock(mGeometriesMutex);
+	mGeometries[geo->Name] = std::move(geo);
+}
+
+void TreeBillboardsApp::UploadGeometries()
+{
+	for(auto& e : mGeometries)
+	{
+		MeshGeometry* geo = e.second.get();
+
+		if(geo->VertexBufferCPU != nullptr && geo->VertexBufferGPU == nullptr)
+		{
+			geo->VertexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(), mCommandList.Get(),
+				geo->VertexBufferCPU->GetBufferPointer(), geo->VertexBufferCPU->GetBufferSize(),
+				geo->VertexBufferUploader, &mResourceStates);
+		}
+
+		if(geo->IndexBufferCPU != nullptr && geo->IndexBufferGPU == nullptr)
+		{
+			geo->IndexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(), mCommandList.Get(),
+				geo->IndexBufferCPU->GetBufferPointer(), geo->IndexBufferCPU->GetBufferSize(),
+				geo->IndexBufferUploader, &mResourceStates);
+		}
+	}
+}
+
 void TreeBillboardsApp::BuildLandGeometry()
 {
     GeometryGenerator geoGen;
@@ -776,14 +2141,13 @@ void TreeBillboardsApp::BuildLandGeometry()
     // sandy looking beaches, grassy low hills, and snow mountain peaks.
     //
 
-    std::vector<Vertex> vertices(grid.Vertices.size());
-    for(size_t i = 0; i < grid.Vertices.size(); ++i)
+    std::vector<Vertex> vertices;
+	VertexConversion::ConvertVertices<StdVertexLayout>(grid.Vertices, vertices);
+    for(size_t i = 0; i < vertices.size(); ++i)
     {
-        auto& p = grid.Vertices[i].Position;
-        vertices[i].Pos = p;
-		vertices[i].Pos.y = 3;//GetHillsHeight(p.x, p.z);
+        auto& p = vertices[i].Pos;
 		vertices[i].Normal = GetHillsNormal(p.x, p.z);
-		vertices[i].TexC = grid.Vertices[i].TexC;
+		p.y = 3;//GetHillsHeight(p.x, p.z);
     }
 
     const UINT vbByteSize = (UINT)vertices.size() * sizeof(Vertex);
@@ -800,12 +2164,6 @@ void TreeBillboardsApp::BuildLandGeometry()
 	ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
 	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
 
-	geo->VertexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
-		mCommandList.Get(), vertices.data(), vbByteSize, geo->VertexBufferUploader);
-
-	geo->IndexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
-		mCommandList.Get(), indices.data(), ibByteSize, geo->IndexBufferUploader);
-
 	geo->VertexByteStride = sizeof(Vertex);
 	geo->VertexBufferByteSize = vbByteSize;
 	geo->IndexFormat = DXGI_FORMAT_R16_UINT;
@@ -816,9 +2174,11 @@ void TreeBillboardsApp::BuildLandGeometry()
 	submesh.StartIndexLocation = 0;
 	submesh.BaseVertexLocation = 0;
 
+	BoundingBox::CreateFromPoints(submesh.Bounds, vertices.size(), &vertices[0].Pos, sizeof(Vertex));
+
 	geo->DrawArgs["grid"] = submesh;
 
-	mGeometries["landGeo"] = std::move(geo);
+	AddGeometry(std::move(geo));
 }
 
 void TreeBillboardsApp::BuildWavesGeometry()
@@ -846,24 +2206,50 @@ void TreeBillboardsApp::BuildWavesGeometry()
         }
     }
 
-	UINT vbByteSize = mWaves->VertexCount()*sizeof(Vertex);
+	// The grid's x/z and texture coordinates never change, so they go in a default
+	// buffer once.  Heights and normals are written each frame by UpdateWaves.
+	struct WaveStaticVertex
+	{
+		XMFLOAT2 PosXZ;
+		XMFLOAT2 TexC;
+	};
+
+	std::vector<WaveStaticVertex> vertices(mWaves->VertexCount());
+	for(int i = 0; i < mWaves->VertexCount(); ++i)
+	{
+		XMFLOAT3 p = mWaves->Position(i);
+		vertices[i].PosXZ = XMFLOAT2(p.x, p.z);
+
+		// Derive tex-coords from position by 
+		// mapping [-w/2,w/2] --> [0,1]
+		vertices[i].TexC.x = 0.5f + p.x / mWaves->Width();
+		vertices[i].TexC.y = 0.5f - p.z / mWaves->Depth();
+	}
+
+	UINT vbByteSize = (UINT)vertices.size()*sizeof(WaveStaticVertex);
 	UINT ibByteSize = (UINT)indices.size()*sizeof(std::uint16_t);
 
 	auto geo = std::make_unique<MeshGeometry>();
 	geo->Name = "waterGeo";
 
-	// Set dynamically.
-	geo->VertexBufferCPU = nullptr;
-	geo->VertexBufferGPU = nullptr;
+	ThrowIfFailed(D3DCreateBlob(vbByteSize, &geo->VertexBufferCPU));
+	CopyMemory(geo->VertexBufferCPU->GetBufferPointer(), vertices.data(), vbByteSize);
 
 	ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
 	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
 
-	geo->IndexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
-		mCommandList.Get(), indices.data(), ibByteSize, geo->IndexBufferUploader);
-
-	geo->VertexByteStride = sizeof(Vertex);
+	geo->VertexByteStride = sizeof(WaveStaticVertex);
 	geo->VertexBufferByteSize = vbByteSize;
+
+	// Set dynamically.
+	geo->DynamicVertexBufferGPU = nullptr;
+	geo->DynamicVertexByteStride = sizeof(WaveVertex);
+	geo->DynamicVertexBufferByteSize = mWaves->VertexCount()*sizeof(WaveVertex);
+
+	// One slot per frame resource.
+	mWavesDirtyRows = std::make_unique<DirtyRowTracker>(mWaves->RowCount(), gNumFrameResources,
+		mWaves->ColumnCount()*(UINT)sizeof(WaveVertex));
+
 	geo->IndexFormat = DXGI_FORMAT_R16_UINT;
 	geo->IndexBufferByteSize = ibByteSize;
 
@@ -872,24 +2258,26 @@ void TreeBillboardsApp::BuildWavesGeometry()
 	submesh.StartIndexLocation = 0;
 	submesh.BaseVertexLocation = 0;
 
+	// The surface moves, so leave room above and below the rest height.
+	submesh.Bounds = BoundingBox(XMFLOAT3(0.0f, 0.0f, 0.0f),
+		XMFLOAT3(0.5f*mWaves->Width(), 4.0f, 0.5f*mWaves->Depth()));
+
 	geo->DrawArgs["grid"] = submesh;
 
-	mGeometries["waterGeo"] = std::move(geo);
+	std::wstring text = L"Waves: " + std::to_wstring(geo->DynamicVertexBufferByteSize) +
+		L" bytes per frame at most, " + std::to_wstring(mWaves->VertexCount()*sizeof(Vertex)) +
+		L" with a single vertex stream\n";
+	::OutputDebugString(text.c_str());
+
+	AddGeometry(std::move(geo));
 }
 
 void TreeBillboardsApp::BuildBoxGeometry()
 {
-	GeometryGenerator geoGen;
-	GeometryGenerator::MeshData box = geoGen.CreateBox(10.0f, 10.0f, 10.0f, 3);
+	GeometryGenerator::MeshData box = CastleLayout::CreateMesh(CastleShape::Box);
 
-	std::vector<Vertex> vertices(box.Vertices.size());
-	for (size_t i = 0; i < box.Vertices.size(); ++i)
-	{
-		auto& p = box.Vertices[i].Position;
-		vertices[i].Pos = p;
-		vertices[i].Normal = box.Vertices[i].Normal;
-		vertices[i].TexC = box.Vertices[i].TexC;
-	}
+	std::vector<Vertex> vertices;
+	VertexConversion::ConvertVertices<StdVertexLayout>(box.Vertices, vertices);
 
 	const UINT vbByteSize = (UINT)vertices.size() * sizeof(Vertex);
 
@@ -905,12 +2293,6 @@ void TreeBillboardsApp::BuildBoxGeometry()
 	ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
 	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
 
-	geo->VertexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
-		mCommandList.Get(), vertices.data(), vbByteSize, geo->VertexBufferUploader);
-
-	geo->IndexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
-		mCommandList.Get(), indices.data(), ibByteSize, geo->IndexBufferUploader);
-
 	geo->VertexByteStride = sizeof(Vertex);
 	geo->VertexBufferByteSize = vbByteSize;
 	geo->IndexFormat = DXGI_FORMAT_R16_UINT;
@@ -921,24 +2303,19 @@ void TreeBillboardsApp::BuildBoxGeometry()
 	submesh.StartIndexLocation = 0;
 	submesh.BaseVertexLocation = 0;
 
+	BoundingBox::CreateFromPoints(submesh.Bounds, vertices.size(), &vertices[0].Pos, sizeof(Vertex));
+
 	geo->DrawArgs["box"] = submesh;
 
-	mGeometries["boxGeo"] = std::move(geo);
+	AddGeometry(std::move(geo));
 }
 
 void TreeBillboardsApp::BuildConeGeometry()
 {
-	GeometryGenerator geoGen;
-	GeometryGenerator::MeshData cone = geoGen.CreateCylinder(8.0f, 0.0f, 40.0f, 20, 20);
+	GeometryGenerator::MeshData cone = CastleLayout::CreateMesh(CastleShape::Cone);
 
-	std::vector<Vertex> vertices(cone.Vertices.size());
-	for (size_t i = 0; i < cone.Vertices.size(); ++i)
-	{
-		auto& p = cone.Vertices[i].Position;
-		vertices[i].Pos = p;
-		vertices[i].Normal = cone.Vertices[i].Normal;
-		vertices[i].TexC = cone.Vertices[i].TexC;
-	}
+	std::vector<Vertex> vertices;
+	VertexConversion::ConvertVertices<StdVertexLayout>(cone.Vertices, vertices);
 
 	const UINT vbByteSize = (UINT)vertices.size() * sizeof(Vertex);
 
@@ -954,12 +2331,6 @@ void TreeBillboardsApp::BuildConeGeometry()
 	ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
 	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
 
-	geo->VertexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
-		mCommandList.Get(), vertices.data(), vbByteSize, geo->VertexBufferUploader);
-
-	geo->IndexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
-		mCommandList.Get(), indices.data(), ibByteSize, geo->IndexBufferUploader);
-
 	geo->VertexByteStride = sizeof(Vertex);
 	geo->VertexBufferByteSize = vbByteSize;
 	geo->IndexFormat = DXGI_FORMAT_R16_UINT;
@@ -970,24 +2341,19 @@ void TreeBillboardsApp::BuildConeGeometry()
 	submesh.StartIndexLocation = 0;
 	submesh.BaseVertexLocation = 0;
 
+	BoundingBox::CreateFromPoints(submesh.Bounds, vertices.size(), &vertices[0].Pos, sizeof(Vertex));
+
 	geo->DrawArgs["cone"] = submesh;
 
-	mGeometries["coneGeo"] = std::move(geo);
+	AddGeometry(std::move(geo));
 }
 
 void TreeBillboardsApp::BuildCylinderGeometry()
 {
-	GeometryGenerator geoGen;
-	GeometryGenerator::MeshData cylinder = geoGen.CreateCylinder(8.0f, 8.0f, 40.0f, 20, 20);
+	GeometryGenerator::MeshData cylinder = CastleLayout::CreateMesh(CastleShape::Cylinder);
 
-	std::vector<Vertex> vertices(cylinder.Vertices.size());
-	for (size_t i = 0; i < cylinder.Vertices.size(); ++i)
-	{
-		auto& p = cylinder.Vertices[i].Position;
-		vertices[i].Pos = p;
-		vertices[i].Normal = cylinder.Vertices[i].Normal;
-		vertices[i].TexC = cylinder.Vertices[i].TexC;
-	}
+	std::vector<Vertex> vertices;
+	VertexConversion::ConvertVertices<StdVertexLayout>(cylinder.Vertices, vertices);
 
 	const UINT vbByteSize = (UINT)vertices.size() * sizeof(Vertex);
 
@@ -1003,12 +2369,6 @@ void TreeBillboardsApp::BuildCylinderGeometry()
 	ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
 	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
 
-	geo->VertexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
-		mCommandList.Get(), vertices.data(), vbByteSize, geo->VertexBufferUploader);
-
-	geo->IndexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
-		mCommandList.Get(), indices.data(), ibByteSize, geo->IndexBufferUploader);
-
 	geo->VertexByteStride = sizeof(Vertex);
 	geo->VertexBufferByteSize = vbByteSize;
 	geo->IndexFormat = DXGI_FORMAT_R16_UINT;
@@ -1019,9 +2379,11 @@ void TreeBillboardsApp::BuildCylinderGeometry()
 	submesh.StartIndexLocation = 0;
 	submesh.BaseVertexLocation = 0;
 
+	BoundingBox::CreateFromPoints(submesh.Bounds, vertices.size(), &vertices[0].Pos, sizeof(Vertex));
+
 	geo->DrawArgs["cylinder"] = submesh;
 
-	mGeometries["cylinderGeo"] = std::move(geo);
+	AddGeometry(std::move(geo));
 }
 
 void TreeBillboardsApp::BuildTreeSpritesGeometry()
@@ -1066,13 +2428,76 @@ void TreeBillboardsApp::BuildTreeSpritesGeometry()
 	ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
 	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
 
-	geo->VertexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
-		mCommandList.Get(), vertices.data(), vbByteSize, geo->VertexBufferUploader);
+	geo->VertexByteStride = sizeof(TreeSpriteVertex);
+	geo->VertexBufferByteSize = vbByteSize;
+	geo->IndexFormat = DXGI_FORMAT_R16_UINT;
+	geo->IndexBufferByteSize = ibByteSize;
+
+	SubmeshGeometry submesh;
+	submesh.IndexCount = (UINT)indices.size();
+	submesh.StartIndexLocation = 0;
+	submesh.BaseVertexLocation = 0;
+
+	// Only the first treeCount sprites are placed.  Grow the box by half a sprite so
+	// the quads expanded in the geometry shader stay inside it.
+	BoundingBox::CreateFromPoints(submesh.Bounds, treeCount, &vertices[0].Pos, sizeof(TreeSpriteVertex));
+	submesh.Bounds.Extents.x += 10.0f;
+	submesh.Bounds.Extents.y += 10.0f;
+	submesh.Bounds.Extents.z += 10.0f;
 
-	geo->IndexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
-		mCommandList.Get(), indices.data(), ibByteSize, geo->IndexBufferUploader);
+	geo->DrawArgs["points"] = submesh;
 
-	geo->VertexByteStride = sizeof(TreeSpriteVertex);
+	AddGeometry(std::move(geo));
+
+	// The same sprites for the instanced path.
+	mTreeCuller.Clear();
+	mTreeCuller.Reserve(treeCount);
+	for(UINT i = 0; i < treeCount; ++i)
+		mTreeCuller.Add(vertices[i].Pos, vertices[i].Size, i % 3);
+}
+
+void TreeBillboardsApp::BuildFlagSpritesGeometry()
+{
+	// Same vertex as the tree sprites, so they share the pipeline.
+	struct FlagSpriteVertex
+	{
+		XMFLOAT3 Pos;
+		XMFLOAT2 Size;
+	};
+
+	// A flag above the tip of every rooftop cone.  The cone mesh is 40 tall about its
+	// center before the part's scale.
+	const float flagSize = 5.0f;
+	std::vector<FlagSpriteVertex> vertices;
+	for(const CastlePart& part : CastleLayout::Parts())
+	{
+		if(part.Shape != CastleShape::Cone)
+			continue;
+
+		FlagSpriteVertex v;
+		v.Pos = part.Position;
+		v.Pos.y += 20.0f*part.Scale.y + 0.5f*flagSize;
+		v.Size = XMFLOAT2(flagSize, flagSize);
+		vertices.push_back(v);
+	}
+
+	std::vector<std::uint16_t> indices(vertices.size());
+	for(size_t i = 0; i < indices.size(); ++i)
+		indices[i] = (std::uint16_t)i;
+
+	const UINT vbByteSize = (UINT)vertices.size() * sizeof(FlagSpriteVertex);
+	const UINT ibByteSize = (UINT)indices.size() * sizeof(std::uint16_t);
+
+	auto geo = std::make_unique<MeshGeometry>();
+	geo->Name = "flagSpritesGeo";
+
+	ThrowIfFailed(D3DCreateBlob(vbByteSize, &geo->VertexBufferCPU));
+	CopyMemory(geo->VertexBufferCPU->GetBufferPointer(), vertices.data(), vbByteSize);
+
+	ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
+	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
+
+	geo->VertexByteStride = sizeof(FlagSpriteVertex);
 	geo->VertexBufferByteSize = vbByteSize;
 	geo->IndexFormat = DXGI_FORMAT_R16_UINT;
 	geo->IndexBufferByteSize = ibByteSize;
@@ -1082,9 +2507,279 @@ void TreeBillboardsApp::BuildTreeSpritesGeometry()
 	submesh.StartIndexLocation = 0;
 	submesh.BaseVertexLocation = 0;
 
+	// Grown by half a sprite, as the tree sprites' bounds are.
+	BoundingBox::CreateFromPoints(submesh.Bounds, vertices.size(), &vertices[0].Pos, sizeof(FlagSpriteVertex));
+	submesh.Bounds.Extents.x += 0.5f*flagSize;
+	submesh.Bounds.Extents.y += 0.5f*flagSize;
+	submesh.Bounds.Extents.z += 0.5f*flagSize;
+
 	geo->DrawArgs["points"] = submesh;
 
-	mGeometries["treeSpritesGeo"] = std::move(geo);
+	AddGeometry(std::move(geo));
+}
+
+void TreeBillboardsApp::BuildTreeQuadGeometry()
+{
+	struct TreeQuadVertex
+	{
+		XMFLOAT2 Corner;
+		XMFLOAT2 TexC;
+	};
+
+	// A triangle strip, in the order the geometry shader emits its quad.
+	std::array<TreeQuadVertex, 4> vertices =
+	{
+		TreeQuadVertex{ XMFLOAT2(+1.0f, -1.0f), XMFLOAT2(0.0f, 1.0f) },
+		TreeQuadVertex{ XMFLOAT2(+1.0f, +1.0f), XMFLOAT2(0.0f, 0.0f) },
+		TreeQuadVertex{ XMFLOAT2(-1.0f, -1.0f), XMFLOAT2(1.0f, 1.0f) },
+		TreeQuadVertex{ XMFLOAT2(-1.0f, +1.0f), XMFLOAT2(1.0f, 0.0f) }
+	};
+
+	const UINT vbByteSize = (UINT)vertices.size() * sizeof(TreeQuadVertex);
+
+	auto geo = std::make_unique<MeshGeometry>();
+	geo->Name = "treeQuadGeo";
+
+	ThrowIfFailed(D3DCreateBlob(vbByteSize, &geo->VertexBufferCPU));
+	CopyMemory(geo->VertexBufferCPU->GetBufferPointer(), vertices.data(), vbByteSize);
+
+	geo->VertexByteStride = sizeof(TreeQuadVertex);
+	geo->VertexBufferByteSize = vbByteSize;
+
+	SubmeshGeometry submesh;
+	submesh.IndexCount = 0;
+	submesh.StartIndexLocation = 0;
+	submesh.BaseVertexLocation = 0;
+
+	geo->DrawArgs["quad"] = submesh;
+
+	AddGeometry(std::move(geo));
+}
+
+void TreeBillboardsApp::BuildWavesWetMask()
+{
+	// The water lies at y = 0 in world space.
+	XMMATRIX waterWorld = XMLoadFloat4x4(&mWavesRitem->World.Get());
+
+	std::vector<BoundingBox> footprints;
+	for(RenderItem* ri : mRitemLayer[(int)RenderLayer::Opaque])
+	{
+		BoundingBox worldBounds;
+		ri->Bounds.Transform(worldBounds, XMLoadFloat4x4(&ri->World.Get()));
+		if(worldBounds.Center.y + worldBounds.Extents.y > 0.0f)
+			footprints.push_back(worldBounds);
+	}
+
+	int n = mWaves->ColumnCount();
+	std::vector<std::uint8_t> wet(mWaves->VertexCount(), 1);
+	for(int k = 0; k < mWaves->VertexCount(); ++k)
+	{
+		XMFLOAT3 p;
+		XMStoreFloat3(&p, XMVector3TransformCoord(XMLoadFloat3(&mWaves->Position(k)), waterWorld));
+
+		for(const BoundingBox& box : footprints)
+		{
+			if(fabsf(p.x - box.Center.x) <= box.Extents.x && fabsf(p.z - box.Center.z) <= box.Extents.z)
+			{
+				wet[k] = 0;
+				break;
+			}
+		}
+	}
+	mWaves->SetWetMask(wet);
+
+	int interior = (mWaves->RowCount() - 2)*(n - 2);
+	std::wstring text = L"Water: " + std::to_wstring(mWaves->WetCount()) + L" of " + std::to_wstring(interior) +
+		L" interior points wet\n";
+	::OutputDebugString(text.c_str());
+}
+
+void TreeBillboardsApp::LoadImpostors()
+{
+	const std::string path = "../../Textures/castleImpostors.bin";
+
+	// The atlases are uploaded as the slices of one texture array, so they must match.
+	std::vector<ImpostorFileEntry> entries;
+	bool read = ImpostorBaker::ReadFile(path, entries);
+	for(const ImpostorFileEntry& e : entries)
+		read = read && e.Atlas.Width == entries[0].Atlas.Width;
+
+	if(!read)
+	{
+		std::wstring text = L"Impostors: " + AnsiToWString(path) + L" could not be read, castle parts are drawn "
+			L"as meshes.  Run Tools/ImpostorBake to make it.\n";
+		::OutputDebugString(text.c_str());
+		return;
+	}
+
+	// Castle parts with an atlas baked from the same mesh, material, scale and rotation.
+	// The ground, the water and the fence are too large or too flat for a single quad.
+	UINT missing = 0;
+	for(RenderItem* ri : mRitemLayer[(int)RenderLayer::Opaque])
+	{
+		bool castle = false;
+		for(int shape = 0; shape < (int)CastleShape::Count; ++shape)
+			castle = castle || ri->Geo->Name == CastleLayout::GeometryName((CastleShape)shape);
+		if(!castle)
+			continue;
+
+		XMFLOAT4X4 transform = CastleLayout::BakeTransform(XMLoadFloat4x4(&ri->World.Get()));
+
+		int slice = ImpostorBaker::FindEntry(entries, ri->Geo->Name, ri->Mat->Name, transform);
+		if(slice < 0)
+		{
+			++missing;
+			continue;
+		}
+
+		ri->ImpostorSlice = slice;
+		mImpostorItems.push_back(ri);
+	}
+
+	// Every atlas is a slice, so the slice of an item is its entry's index.
+	for(ImpostorFileEntry& e : entries)
+		mImpostorAtlases.push_back(std::move(e.Atlas));
+
+	if(missing > 0)
+	{
+		std::wstring text = L"Impostors: " + std::to_wstring(missing) + L" castle parts have no atlas in the file "
+			L"and are drawn as meshes.  Rerun Tools/ImpostorBake.\n";
+		::OutputDebugString(text.c_str());
+	}
+
+	// Runs of one material are drawn together.
+	std::stable_sort(mImpostorItems.begin(), mImpostorItems.end(), [](const RenderItem* a, const RenderItem* b)
+	{
+		return a->Mat->MatCBIndex < b->Mat->MatCBIndex;
+	});
+}
+
+void TreeBillboardsApp::UploadImpostors()
+{
+	if(mImpostorItems.empty())
+		return;
+
+	//
+	// Upload the atlases as two texture arrays with a slice per baked impostor.
+	//
+	UINT width = mImpostorAtlases[0].Width;
+	UINT sliceCount = (UINT)mImpostorAtlases.size();
+
+	auto createAtlasTexture = [&](const std::string& name, std::vector<std::uint32_t> ImpostorAtlas::*channel)
+	{
+		auto tex = std::make_unique<Texture>();
+		tex->Name = name;
+
+		D3D12_RESOURCE_DESC texDesc;
+		ZeroMemory(&texDesc, sizeof(D3D12_RESOURCE_DESC));
+		texDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+		texDesc.Alignment = 0;
+		texDesc.Width = width;
+		texDesc.Height = width;
+		texDesc.DepthOrArraySize = (UINT16)sliceCount;
+		texDesc.MipLevels = 1;
+		texDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+		texDesc.SampleDesc.Count = 1;
+		texDesc.SampleDesc.Quality = 0;
+		texDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+		texDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+		ThrowIfFailed(md3dDevice->CreateCommittedResource(
+			&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+			D3D12_HEAP_FLAG_NONE,
+			&texDesc,
+			D3D12_RESOURCE_STATE_COPY_DEST,
+			nullptr,
+			IID_PPV_ARGS(tex->Resource.GetAddressOf())));
+
+		UINT64 uploadByteSize = GetRequiredIntermediateSize(tex->Resource.Get(), 0, sliceCount);
+		ThrowIfFailed(md3dDevice->CreateCommittedResource(
+			&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+			D3D12_HEAP_FLAG_NONE,
+			&CD3DX12_RESOURCE_DESC::Buffer(uploadByteSize),
+			D3D12_RESOURCE_STATE_GENERIC_READ,
+			nullptr,
+			IID_PPV_ARGS(tex->UploadHeap.GetAddressOf())));
+
+		std::vector<D3D12_SUBRESOURCE_DATA> slices(sliceCount);
+		for(UINT i = 0; i < sliceCount; ++i)
+		{
+			slices[i].pData = (mImpostorAtlases[i].*channel).data();
+			slices[i].RowPitch = width*sizeof(std::uint32_t);
+			slices[i].SlicePitch = slices[i].RowPitch*width;
+		}
+		UpdateSubresources(mCommandList.Get(), tex->Resource.Get(), tex->UploadHeap.Get(), 0, 0, sliceCount, slices.data());
+
+		mResourceStates.Register(tex->Resource.Get(), D3D12_RESOURCE_STATE_COPY_DEST);
+		mResourceStates.Transition(tex->Resource.Get(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+
+		mTextures[name] = std::move(tex);
+	};
+
+	createAtlasTexture("impostorAlbedoTex", &ImpostorAtlas::Albedo);
+	createAtlasTexture("impostorNormalTex", &ImpostorAtlas::Normal);
+
+	// The texels are in the upload heaps now.
+	for(ImpostorAtlas& atlas : mImpostorAtlases)
+	{
+		std::vector<std::uint32_t>().swap(atlas.Albedo);
+		std::vector<std::uint32_t>().swap(atlas.Normal);
+	}
+
+	// Both views in one range, for the impostor descriptor table.
+	DescriptorRange srvs = mSrvHeap->AllocatePersistent(2);
+	mImpostorSrvHeapIndex = (int)srvs.Offset;
+
+	const char* texNames[] = { "impostorAlbedoTex", "impostorNormalTex" };
+	for(UINT i = 0; i < 2; ++i)
+	{
+		Texture* tex = mTextures[texNames[i]].get();
+
+		D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+		srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+		srvDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
+		srvDesc.Texture2DArray.MostDetailedMip = 0;
+		srvDesc.Texture2DArray.MipLevels = 1;
+		srvDesc.Texture2DArray.FirstArraySlice = 0;
+		srvDesc.Texture2DArray.ArraySize = sliceCount;
+
+		tex->SrvHeapIndex = (int)(srvs.Offset + i);
+		md3dDevice->CreateShaderResourceView(tex->Resource.Get(), &srvDesc, mSrvHeap->CpuHandle(srvs.Offset + i));
+	}
+
+	std::wstring text = L"Impostors: " + std::to_wstring(sliceCount) + L" atlases of " +
+		std::to_wstring(width) + L"x" + std::to_wstring(width) + L" for " + std::to_wstring(mImpostorItems.size()) +
+		L" castle parts\n";
+	::OutputDebugString(text.c_str());
+}
+
+void TreeBillboardsApp::BuildFloatingCrates()
+{
+	mCrateBuoyancy = std::make_unique<Buoyancy>();
+
+	// A ring of crates in the open water around the island, dropped in from just above
+	// it.  The box is 10 units on a side, so at a fifth of that a crate is 2 high.
+	const int crateCount = 8;
+	for(int i = 0; i < crateCount; ++i)
+	{
+		float angle = i*XM_2PI / crateCount;
+		XMFLOAT3 position(48.0f*cosf(angle), 2.0f, 48.0f*sinf(angle));
+		mCrateBuoyancy->Add(position, 1.0f, MathHelper::RandF(0.4f, 0.8f));
+
+		auto crateRitem = std::make_unique<RenderItem>();
+		XMStoreFloat4x4(&crateRitem->World.Edit(), XMMatrixScaling(0.2f, 0.2f, 0.2f) *
+			XMMatrixTranslation(position.x, position.y, position.z));
+		crateRitem->ObjCBIndex = (UINT)mAllRitems.size();
+		crateRitem->Geo = mGeometries.at("boxGeo").get();
+		crateRitem->Mat = mMaterials["wood"].get();
+		crateRitem->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+		crateRitem->SetSubmesh("box");
+
+		mCrateItems.push_back(crateRitem.get());
+		mRitemLayer[(int)RenderLayer::Opaque].push_back(crateRitem.get());
+		mAllRitems.push_back(std::move(crateRitem));
+	}
 }
 
 void TreeBillboardsApp::BuildPSOs()
@@ -1147,6 +2842,28 @@ void TreeBillboardsApp::BuildPSOs()
 	transparentPsoDesc.BlendState.RenderTarget[0] = transparencyBlendDesc;
 	ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&transparentPsoDesc, IID_PPV_ARGS(&mPSOs["transparent"])));
 
+	//
+	// PSO for the water, which is transparent and reads two vertex streams.
+	//
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC wavesPsoDesc = transparentPsoDesc;
+	wavesPsoDesc.InputLayout = { mWavesInputLayout.data(), (UINT)mWavesInputLayout.size() };
+	wavesPsoDesc.VS =
+	{
+		reinterpret_cast<BYTE*>(mShaders["wavesVS"]->GetBufferPointer()),
+		mShaders["wavesVS"]->GetBufferSize()
+	};
+	ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&wavesPsoDesc, IID_PPV_ARGS(&mPSOs["waves"])));
+
+	// Same, but displacing the static stream by the surface texture.
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC wavesDisplacedPsoDesc = transparentPsoDesc;
+	wavesDisplacedPsoDesc.InputLayout = { mWavesDisplacedInputLayout.data(), (UINT)mWavesDisplacedInputLayout.size() };
+	wavesDisplacedPsoDesc.VS =
+	{
+		reinterpret_cast<BYTE*>(mShaders["wavesDisplacedVS"]->GetBufferPointer()),
+		mShaders["wavesDisplacedVS"]->GetBufferSize()
+	};
+	ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&wavesDisplacedPsoDesc, IID_PPV_ARGS(&mPSOs["wavesDisplaced"])));
+
 	//
 	// PSO for alpha tested objects
 	//
@@ -1185,6 +2902,68 @@ void TreeBillboardsApp::BuildPSOs()
 	treeSpritePsoDesc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
 
 	ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&treeSpritePsoDesc, IID_PPV_ARGS(&mPSOs["treeSprites"])));
+
+	//
+	// PSO for tree sprites drawn as instanced quads
+	//
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC treeInstancedPsoDesc = opaquePsoDesc;
+	treeInstancedPsoDesc.VS =
+	{
+		reinterpret_cast<BYTE*>(mShaders["treeSpriteInstancedVS"]->GetBufferPointer()),
+		mShaders["treeSpriteInstancedVS"]->GetBufferSize()
+	};
+	treeInstancedPsoDesc.PS =
+	{
+		reinterpret_cast<BYTE*>(mShaders["treeSpriteInstancedPS"]->GetBufferPointer()),
+		mShaders["treeSpriteInstancedPS"]->GetBufferSize()
+	};
+	treeInstancedPsoDesc.InputLayout = { mTreeInstanceInputLayout.data(), (UINT)mTreeInstanceInputLayout.size() };
+	treeInstancedPsoDesc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
+
+	ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&treeInstancedPsoDesc, IID_PPV_ARGS(&mPSOs["treeSpritesInstanced"])));
+
+	//
+	// PSO for impostors
+	//
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC impostorPsoDesc = opaquePsoDesc;
+	impostorPsoDesc.VS =
+	{
+		reinterpret_cast<BYTE*>(mShaders["impostorVS"]->GetBufferPointer()),
+		mShaders["impostorVS"]->GetBufferSize()
+	};
+	impostorPsoDesc.PS =
+	{
+		reinterpret_cast<BYTE*>(mShaders["impostorPS"]->GetBufferPointer()),
+		mShaders["impostorPS"]->GetBufferSize()
+	};
+	impostorPsoDesc.InputLayout = { mImpostorInputLayout.data(), (UINT)mImpostorInputLayout.size() };
+	impostorPsoDesc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
+
+	ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&impostorPsoDesc, IID_PPV_ARGS(&mPSOs["impostors"])));
+
+	//
+	// PSO for stretching the scene target over the back buffer
+	//
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC upscalePsoDesc = opaquePsoDesc;
+	upscalePsoDesc.InputLayout = { nullptr, 0 };
+	upscalePsoDesc.pRootSignature = mUpscaleRootSignature.Get();
+	upscalePsoDesc.VS =
+	{
+		reinterpret_cast<BYTE*>(mShaders["upscaleVS"]->GetBufferPointer()),
+		mShaders["upscaleVS"]->GetBufferSize()
+	};
+	upscalePsoDesc.PS =
+	{
+		reinterpret_cast<BYTE*>(mShaders["upscalePS"]->GetBufferPointer()),
+		mShaders["upscalePS"]->GetBufferSize()
+	};
+	upscalePsoDesc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
+	upscalePsoDesc.DepthStencilState.DepthEnable = false;
+	upscalePsoDesc.DepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ZERO;
+	upscalePsoDesc.DSVFormat = DXGI_FORMAT_UNKNOWN;
+	upscalePsoDesc.SampleDesc.Count = 1;
+	upscalePsoDesc.SampleDesc.Quality = 0;
+	ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&upscalePsoDesc, IID_PPV_ARGS(&mPSOs["upscale"])));
 }
 
 void TreeBillboardsApp::BuildFrameResources()
@@ -1192,7 +2971,8 @@ void TreeBillboardsApp::BuildFrameResources()
     for(int i = 0; i < gNumFrameResources; ++i)
     {
         mFrameResources.push_back(std::make_unique<FrameResource>(md3dDevice.Get(),
-            1, (UINT)mAllRitems.size(), (UINT)mMaterials.size(), mWaves->VertexCount()));
+            1, (UINT)mAllRitems.size(), (UINT)mMaterials.size(), mWaves->VertexCount(), true,
+            mWavesSurfaceRowPitch*mWaves->RowCount(), mTreeCuller.Count(), (UINT)mImpostorItems.size()));
     }
 }
 
@@ -1201,7 +2981,7 @@ void TreeBillboardsApp::BuildMaterials()
 	auto grass = std::make_unique<Material>();
 	grass->Name = "grass";
 	grass->MatCBIndex = 0;
-	grass->DiffuseSrvHeapIndex = 0;
+	grass->DiffuseSrvHeapIndex = mTextures["grassTex"]->SrvHeapIndex;
 	grass->DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
 	grass->FresnelR0 = XMFLOAT3(0.01f, 0.01f, 0.01f);
 	grass->Roughness = 0.125f;
@@ -1211,15 +2991,20 @@ void TreeBillboardsApp::BuildMaterials()
 	auto water = std::make_unique<Material>();
 	water->Name = "water";
 	water->MatCBIndex = 1;
-	water->DiffuseSrvHeapIndex = 1;
+	water->DiffuseSrvHeapIndex = mTextures["waterTex"]->SrvHeapIndex;
 	water->DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 0.5f);
 	water->FresnelR0 = XMFLOAT3(0.1f, 0.1f, 0.1f);
 	water->Roughness = 0.0f;
 
+	// The water's texture scrolls; the shaders move it with the pass time.
+	UvAnimation waterAnimation;
+	waterAnimation.ScrollSpeed = XMFLOAT2(0.1f, 0.02f);
+	water->Animation = waterAnimation;
+
 	auto wirefence = std::make_unique<Material>();
 	wirefence->Name = "wirefence";
 	wirefence->MatCBIndex = 2;
-	wirefence->DiffuseSrvHeapIndex = 2;
+	wirefence->DiffuseSrvHeapIndex = mTextures["fenceTex"]->SrvHeapIndex;
 	wirefence->DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
 	wirefence->FresnelR0 = XMFLOAT3(0.02f, 0.02f, 0.02f);
 	wirefence->Roughness = 0.25f;
@@ -1227,15 +3012,29 @@ void TreeBillboardsApp::BuildMaterials()
 	auto treeSprites = std::make_unique<Material>();
 	treeSprites->Name = "treeSprites";
 	treeSprites->MatCBIndex = 6;
-	treeSprites->DiffuseSrvHeapIndex = 6;
+	treeSprites->DiffuseSrvHeapIndex = mTextures["treeArrayTex"]->SrvHeapIndex;
 	treeSprites->DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
 	treeSprites->FresnelR0 = XMFLOAT3(0.01f, 0.01f, 0.01f);
 	treeSprites->Roughness = 0.125f;
 
+	// Each flag flips through the three flags of flagArray.dds, starting at its own.
+	auto flags = std::make_unique<Material>();
+	flags->Name = "flags";
+	flags->MatCBIndex = 7;
+	flags->DiffuseSrvHeapIndex = mTextures["flagArrayTex"]->SrvHeapIndex;
+	flags->DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
+	flags->FresnelR0 = XMFLOAT3(0.01f, 0.01f, 0.01f);
+	flags->Roughness = 0.125f;
+
+	UvAnimation flipbook;
+	flipbook.FlipbookFrameRate = 0.5f;
+	flipbook.FlipbookFrameCount = 3;
+	flags->Animation = flipbook;
+
 	auto bricks = std::make_unique<Material>();
 	bricks->Name = "bricks";
 	bricks->MatCBIndex = 3;
-	bricks->DiffuseSrvHeapIndex = 3;
+	bricks->DiffuseSrvHeapIndex = mTextures["brickTex"]->SrvHeapIndex;
 	bricks->DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
 	bricks->FresnelR0 = XMFLOAT3(0.02f, 0.02f, 0.02f);
 	bricks->Roughness = 0.25f;
@@ -1243,7 +3042,7 @@ void TreeBillboardsApp::BuildMaterials()
 	auto tiles = std::make_unique<Material>();
 	tiles->Name = "tiles";
 	tiles->MatCBIndex = 4;
-	tiles->DiffuseSrvHeapIndex = 4;
+	tiles->DiffuseSrvHeapIndex = mTextures["tileTex"]->SrvHeapIndex;
 	tiles->DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
 	tiles->FresnelR0 = XMFLOAT3(0.02f, 0.02f, 0.02f);
 	tiles->Roughness = 0.25f;
@@ -1251,7 +3050,7 @@ void TreeBillboardsApp::BuildMaterials()
 	auto wood = std::make_unique<Material>();
 	wood->Name = "wood";
 	wood->MatCBIndex = 5;
-	wood->DiffuseSrvHeapIndex = 5;
+	wood->DiffuseSrvHeapIndex = mTextures["woodTex"]->SrvHeapIndex;
 	wood->DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
 	wood->FresnelR0 = XMFLOAT3(0.01f, 0.01f, 0.01f);
 	wood->Roughness = 0.125f;
@@ -1260,6 +3059,7 @@ void TreeBillboardsApp::BuildMaterials()
 	mMaterials["water"] = std::move(water);
 	mMaterials["wirefence"] = std::move(wirefence);
 	mMaterials["treeSprites"] = std::move(treeSprites);
+	mMaterials["flags"] = std::move(flags);
 	mMaterials["bricks"] = std::move(bricks);
 	mMaterials["tiles"] = std::move(tiles);
 	mMaterials["wood"] = std::move(wood);
@@ -1270,387 +3070,53 @@ void TreeBillboardsApp::BuildRenderItems()
 	// WATER
     auto wavesRitem = std::make_unique<RenderItem>();
     wavesRitem->World = MathHelper::Identity4x4();
-	XMStoreFloat4x4(&wavesRitem->TexTransform, XMMatrixScaling(5.0f, 5.0f, 1.0f));
+	XMStoreFloat4x4(&wavesRitem->TexTransform.Edit(), XMMatrixScaling(5.0f, 5.0f, 1.0f));
 	wavesRitem->ObjCBIndex = 0;
 	wavesRitem->Mat = mMaterials["water"].get();
-	wavesRitem->Geo = mGeometries["waterGeo"].get();
+	wavesRitem->Geo = mGeometries.at("waterGeo").get();
 	wavesRitem->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	wavesRitem->IndexCount = wavesRitem->Geo->DrawArgs["grid"].IndexCount;
-	wavesRitem->StartIndexLocation = wavesRitem->Geo->DrawArgs["grid"].StartIndexLocation;
-	wavesRitem->BaseVertexLocation = wavesRitem->Geo->DrawArgs["grid"].BaseVertexLocation;
+	wavesRitem->SetSubmesh("grid");
     mWavesRitem = wavesRitem.get();
-	mRitemLayer[(int)RenderLayer::Transparent].push_back(wavesRitem.get());
+	mRitemLayer[(int)RenderLayer::Waves].push_back(wavesRitem.get());
 
 	// GROUND
     auto gridRitem = std::make_unique<RenderItem>();
     gridRitem->World = MathHelper::Identity4x4();
-	XMStoreFloat4x4(&gridRitem->TexTransform, XMMatrixScaling(5.0f, 5.0f, 1.0f));
+	XMStoreFloat4x4(&gridRitem->TexTransform.Edit(), XMMatrixScaling(5.0f, 5.0f, 1.0f));
 	gridRitem->ObjCBIndex = 1;
 	gridRitem->Mat = mMaterials["grass"].get();
-	gridRitem->Geo = mGeometries["landGeo"].get();
+	gridRitem->Geo = mGeometries.at("landGeo").get();
 	gridRitem->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-    gridRitem->IndexCount = gridRitem->Geo->DrawArgs["grid"].IndexCount;
-    gridRitem->StartIndexLocation = gridRitem->Geo->DrawArgs["grid"].StartIndexLocation;
-    gridRitem->BaseVertexLocation = gridRitem->Geo->DrawArgs["grid"].BaseVertexLocation;
+	gridRitem->SetSubmesh("grid");
 	mRitemLayer[(int)RenderLayer::Opaque].push_back(gridRitem.get());
 
 	// FENCED GATE
 	auto boxRitem = std::make_unique<RenderItem>();
-	XMStoreFloat4x4(&boxRitem->World, XMMatrixScaling(1.0f, 0.6f, 0.0f) * XMMatrixTranslation(0.0f, 6.0f, -15.0f));
+	XMStoreFloat4x4(&boxRitem->World.Edit(), XMMatrixScaling(1.0f, 0.6f, 0.0f) * XMMatrixTranslation(0.0f, 6.0f, -15.0f));
 	boxRitem->ObjCBIndex = 2;
 	boxRitem->Mat = mMaterials["wirefence"].get();
-	boxRitem->Geo = mGeometries["boxGeo"].get();
+	boxRitem->Geo = mGeometries.at("boxGeo").get();
 	boxRitem->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	boxRitem->IndexCount = boxRitem->Geo->DrawArgs["box"].IndexCount;
-	boxRitem->StartIndexLocation = boxRitem->Geo->DrawArgs["box"].StartIndexLocation;
-	boxRitem->BaseVertexLocation = boxRitem->Geo->DrawArgs["box"].BaseVertexLocation;
+	boxRitem->SetSubmesh("box");
 	mRitemLayer[(int)RenderLayer::AlphaTested].push_back(boxRitem.get());
 
 	//////////////////////////////////////////////////////////////
 	
-	// CASTLE BOX
-	auto boxRitem1 = std::make_unique<RenderItem>();
-	XMStoreFloat4x4(&boxRitem1->World, XMMatrixScaling(1.0f, 1.8f, 1.0f) * XMMatrixTranslation(0.0f, 11.5f, 10.0f));
-	boxRitem1->ObjCBIndex = 3;
-	boxRitem1->Geo = mGeometries["boxGeo"].get();
-	boxRitem1->Mat = mMaterials["bricks"].get();
-	boxRitem1->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	boxRitem1->IndexCount = boxRitem1->Geo->DrawArgs["box"].IndexCount;  // 36
-	boxRitem1->StartIndexLocation = boxRitem1->Geo->DrawArgs["box"].StartIndexLocation; // 0
-	boxRitem1->BaseVertexLocation = boxRitem1->Geo->DrawArgs["box"].BaseVertexLocation; // 0
-	mRitemLayer[(int)RenderLayer::Opaque].push_back(boxRitem1.get());
-	mAllRitems.push_back(std::move(boxRitem1));
-
-	// TOWER CYLINDERS
-	auto cylinderRitem1 = std::make_unique<RenderItem>();
-	XMStoreFloat4x4(&cylinderRitem1->World, XMMatrixScaling(0.2f, 0.3f, 0.2f) * XMMatrixTranslation(32.0f, 9.0f, 22.0f));
-	cylinderRitem1->ObjCBIndex = 4;
-	cylinderRitem1->Geo = mGeometries["cylinderGeo"].get();
-	cylinderRitem1->Mat = mMaterials["bricks"].get();
-	cylinderRitem1->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	cylinderRitem1->IndexCount = cylinderRitem1->Geo->DrawArgs["cylinder"].IndexCount;  // 36
-	cylinderRitem1->StartIndexLocation = cylinderRitem1->Geo->DrawArgs["cylinder"].StartIndexLocation; // 0
-	cylinderRitem1->BaseVertexLocation = cylinderRitem1->Geo->DrawArgs["cylinder"].BaseVertexLocation; // 0
-	mRitemLayer[(int)RenderLayer::Opaque].push_back(cylinderRitem1.get());
-	mAllRitems.push_back(std::move(cylinderRitem1));
-
-	auto cylinderRitem2 = std::make_unique<RenderItem>();
-	XMStoreFloat4x4(&cylinderRitem2->World, XMMatrixScaling(0.2f, 0.3f, 0.2f) * XMMatrixTranslation(-32.0f, 9.0f, -15.0f));
-	cylinderRitem2->ObjCBIndex = 5;
-	cylinderRitem2->Geo = mGeometries["cylinderGeo"].get();
-	cylinderRitem2->Mat = mMaterials["bricks"].get();
-	cylinderRitem2->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	cylinderRitem2->IndexCount = cylinderRitem2->Geo->DrawArgs["cylinder"].IndexCount;  // 36
-	cylinderRitem2->StartIndexLocation = cylinderRitem2->Geo->DrawArgs["cylinder"].StartIndexLocation; // 0
-	cylinderRitem2->BaseVertexLocation = cylinderRitem2->Geo->DrawArgs["cylinder"].BaseVertexLocation; // 0
-	mRitemLayer[(int)RenderLayer::Opaque].push_back(cylinderRitem2.get());
-	mAllRitems.push_back(std::move(cylinderRitem2));
-
-	auto cylinderRitem3 = std::make_unique<RenderItem>();
-	XMStoreFloat4x4(&cylinderRitem3->World, XMMatrixScaling(0.2f, 0.3f, 0.2f) * XMMatrixTranslation(32.0f, 9.0f, -15.0f));
-	cylinderRitem3->ObjCBIndex = 6;
-	cylinderRitem3->Geo = mGeometries["cylinderGeo"].get();
-	cylinderRitem3->Mat = mMaterials["bricks"].get();
-	cylinderRitem3->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	cylinderRitem3->IndexCount = cylinderRitem3->Geo->DrawArgs["cylinder"].IndexCount;  // 36
-	cylinderRitem3->StartIndexLocation = cylinderRitem3->Geo->DrawArgs["cylinder"].StartIndexLocation; // 0
-	cylinderRitem3->BaseVertexLocation = cylinderRitem3->Geo->DrawArgs["cylinder"].BaseVertexLocation; // 0
-	mRitemLayer[(int)RenderLayer::Opaque].push_back(cylinderRitem3.get());
-	mAllRitems.push_back(std::move(cylinderRitem3));
-
-	auto cylinderRitem4 = std::make_unique<RenderItem>();
-	XMStoreFloat4x4(&cylinderRitem4->World, XMMatrixScaling(0.2f, 0.3f, 0.2f) * XMMatrixTranslation(-32.0f, 9.0f, 22.0f));
-	cylinderRitem4->ObjCBIndex = 7;
-	cylinderRitem4->Geo = mGeometries["cylinderGeo"].get();
-	cylinderRitem4->Mat = mMaterials["bricks"].get();
-	cylinderRitem4->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	cylinderRitem4->IndexCount = cylinderRitem4->Geo->DrawArgs["cylinder"].IndexCount;  // 36
-	cylinderRitem4->StartIndexLocation = cylinderRitem4->Geo->DrawArgs["cylinder"].StartIndexLocation; // 0
-	cylinderRitem4->BaseVertexLocation = cylinderRitem4->Geo->DrawArgs["cylinder"].BaseVertexLocation; // 0
-	mRitemLayer[(int)RenderLayer::Opaque].push_back(cylinderRitem4.get());
-	mAllRitems.push_back(std::move(cylinderRitem4));
-
-	// ROOFTOP CONES
-	auto coneRitem1 = std::make_unique<RenderItem>();
-	XMStoreFloat4x4(&coneRitem1->World, XMMatrixScaling(0.3f, 0.1f, 0.3f)* XMMatrixTranslation(-32.0f, 16.0f, 22.0f));
-	coneRitem1->ObjCBIndex = 8;
-	coneRitem1->Geo = mGeometries["coneGeo"].get();
-	coneRitem1->Mat = mMaterials["tiles"].get();
-	coneRitem1->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	coneRitem1->IndexCount = coneRitem1->Geo->DrawArgs["cone"].IndexCount;  // 36
-	coneRitem1->StartIndexLocation = coneRitem1->Geo->DrawArgs["cone"].StartIndexLocation; // 0
-	coneRitem1->BaseVertexLocation = coneRitem1->Geo->DrawArgs["cone"].BaseVertexLocation; // 0
-	mRitemLayer[(int)RenderLayer::Opaque].push_back(coneRitem1.get());
-	mAllRitems.push_back(std::move(coneRitem1));
-
-	auto coneRitem2 = std::make_unique<RenderItem>();
-	XMStoreFloat4x4(&coneRitem2->World, XMMatrixScaling(0.3f, 0.1f, 0.3f)* XMMatrixTranslation(-32.0f, 16.0f, -15.0f));
-	coneRitem2->ObjCBIndex = 9;
-	coneRitem2->Geo = mGeometries["coneGeo"].get();
-	coneRitem2->Mat = mMaterials["tiles"].get();
-	coneRitem2->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	coneRitem2->IndexCount = coneRitem2->Geo->DrawArgs["cone"].IndexCount;  // 36
-	coneRitem2->StartIndexLocation = coneRitem2->Geo->DrawArgs["cone"].StartIndexLocation; // 0
-	coneRitem2->BaseVertexLocation = coneRitem2->Geo->DrawArgs["cone"].BaseVertexLocation; // 0
-	mRitemLayer[(int)RenderLayer::Opaque].push_back(coneRitem2.get());
-	mAllRitems.push_back(std::move(coneRitem2));
-
-	auto coneRitem3 = std::make_unique<RenderItem>();
-	XMStoreFloat4x4(&coneRitem3->World, XMMatrixScaling(0.3f, 0.1f, 0.3f)* XMMatrixTranslation(32.0f, 16.0f, 22.0f));
-	coneRitem3->ObjCBIndex = 10;
-	coneRitem3->Geo = mGeometries["coneGeo"].get();
-	coneRitem3->Mat = mMaterials["tiles"].get();
-	coneRitem3->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	coneRitem3->IndexCount = coneRitem3->Geo->DrawArgs["cone"].IndexCount;  // 36
-	coneRitem3->StartIndexLocation = coneRitem3->Geo->DrawArgs["cone"].StartIndexLocation; // 0
-	coneRitem3->BaseVertexLocation = coneRitem3->Geo->DrawArgs["cone"].BaseVertexLocation; // 0
-	mRitemLayer[(int)RenderLayer::Opaque].push_back(coneRitem3.get());
-	mAllRitems.push_back(std::move(coneRitem3));
-
-	auto coneRitem4 = std::make_unique<RenderItem>();
-	XMStoreFloat4x4(&coneRitem4->World, XMMatrixScaling(0.3f, 0.1f, 0.3f)* XMMatrixTranslation(32.0f, 16.0f, -15.0f));
-	coneRitem4->ObjCBIndex = 11;
-	coneRitem4->Geo = mGeometries["coneGeo"].get();
-	coneRitem4->Mat = mMaterials["tiles"].get();
-	coneRitem4->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	coneRitem4->IndexCount = coneRitem4->Geo->DrawArgs["cone"].IndexCount;  // 36
-	coneRitem4->StartIndexLocation = coneRitem4->Geo->DrawArgs["cone"].StartIndexLocation; // 0
-	coneRitem4->BaseVertexLocation = coneRitem4->Geo->DrawArgs["cone"].BaseVertexLocation; // 0
-	mRitemLayer[(int)RenderLayer::Opaque].push_back(coneRitem4.get());
-	mAllRitems.push_back(std::move(coneRitem4));
-
-	auto coneRitem5 = std::make_unique<RenderItem>();
-	XMStoreFloat4x4(&coneRitem5->World, XMMatrixScaling(0.3f, 0.1f, 0.3f)* XMMatrixTranslation(5.5f, 16.0f, -15.0f));
-	coneRitem5->ObjCBIndex = 12;
-	coneRitem5->Geo = mGeometries["coneGeo"].get();
-	coneRitem5->Mat = mMaterials["tiles"].get();
-	coneRitem5->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	coneRitem5->IndexCount = coneRitem5->Geo->DrawArgs["cone"].IndexCount;  // 36
-	coneRitem5->StartIndexLocation = coneRitem5->Geo->DrawArgs["cone"].StartIndexLocation; // 0
-	coneRitem5->BaseVertexLocation = coneRitem5->Geo->DrawArgs["cone"].BaseVertexLocation; // 0
-	mRitemLayer[(int)RenderLayer::Opaque].push_back(coneRitem5.get());
-	mAllRitems.push_back(std::move(coneRitem5));
-
-	auto coneRitem6 = std::make_unique<RenderItem>();
-	XMStoreFloat4x4(&coneRitem6->World, XMMatrixScaling(0.3f, 0.1f, 0.3f)* XMMatrixTranslation(-5.5f, 16.0f, -15.0f));
-	coneRitem6->ObjCBIndex = 13;
-	coneRitem6->Geo = mGeometries["coneGeo"].get();
-	coneRitem6->Mat = mMaterials["tiles"].get();
-	coneRitem6->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	coneRitem6->IndexCount = coneRitem6->Geo->DrawArgs["cone"].IndexCount;  // 36
-	coneRitem6->StartIndexLocation = coneRitem6->Geo->DrawArgs["cone"].StartIndexLocation; // 0
-	coneRitem6->BaseVertexLocation = coneRitem6->Geo->DrawArgs["cone"].BaseVertexLocation; // 0
-	mRitemLayer[(int)RenderLayer::Opaque].push_back(coneRitem6.get());
-	mAllRitems.push_back(std::move(coneRitem6));
-
-	// WALL BOXES
-	auto boxRitem3 = std::make_unique<RenderItem>();
-	XMStoreFloat4x4(&boxRitem3->World, XMMatrixScaling(2.8f, 0.8f, 0.1f)* XMMatrixTranslation(-18.0f, 6.5f, -15.0f));
-	boxRitem3->ObjCBIndex = 14;
-	boxRitem3->Geo = mGeometries["boxGeo"].get();
-	boxRitem3->Mat = mMaterials["bricks"].get();
-	boxRitem3->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	boxRitem3->IndexCount = boxRitem3->Geo->DrawArgs["box"].IndexCount;  // 36
-	boxRitem3->StartIndexLocation = boxRitem3->Geo->DrawArgs["box"].StartIndexLocation; // 0
-	boxRitem3->BaseVertexLocation = boxRitem3->Geo->DrawArgs["box"].BaseVertexLocation; // 0
-	mRitemLayer[(int)RenderLayer::Opaque].push_back(boxRitem3.get());
-	mAllRitems.push_back(std::move(boxRitem3));
-
-	auto boxRitem4 = std::make_unique<RenderItem>();
-	XMStoreFloat4x4(&boxRitem4->World, XMMatrixScaling(2.8f, 0.8f, 0.1f)* XMMatrixTranslation(18.0f, 6.5f, -15.0f));
-	boxRitem4->ObjCBIndex = 15;
-	boxRitem4->Geo = mGeometries["boxGeo"].get();
-	boxRitem4->Mat = mMaterials["bricks"].get();
-	boxRitem4->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	boxRitem4->IndexCount = boxRitem4->Geo->DrawArgs["box"].IndexCount;  // 36
-	boxRitem4->StartIndexLocation = boxRitem4->Geo->DrawArgs["box"].StartIndexLocation; // 0
-	boxRitem4->BaseVertexLocation = boxRitem4->Geo->DrawArgs["box"].BaseVertexLocation; // 0
-	mRitemLayer[(int)RenderLayer::Opaque].push_back(boxRitem4.get());
-	mAllRitems.push_back(std::move(boxRitem4));
-
-	auto boxRitem5 = std::make_unique<RenderItem>();
-	XMStoreFloat4x4(&boxRitem5->World, XMMatrixScaling(6.2f, 0.8f, 0.1f)* XMMatrixTranslation(0.0f, 6.5f, 22.0f));
-	boxRitem5->ObjCBIndex = 16;
-	boxRitem5->Geo = mGeometries["boxGeo"].get();
-	boxRitem5->Mat = mMaterials["bricks"].get();
-	boxRitem5->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	boxRitem5->IndexCount = boxRitem5->Geo->DrawArgs["box"].IndexCount;  // 36
-	boxRitem5->StartIndexLocation = boxRitem5->Geo->DrawArgs["box"].StartIndexLocation; // 0
-	boxRitem5->BaseVertexLocation = boxRitem5->Geo->DrawArgs["box"].BaseVertexLocation; // 0
-	mRitemLayer[(int)RenderLayer::Opaque].push_back(boxRitem5.get());
-	mAllRitems.push_back(std::move(boxRitem5));
-
-	auto boxRitem6 = std::make_unique<RenderItem>();
-	XMStoreFloat4x4(&boxRitem6->World, XMMatrixScaling(0.1f, 0.8f, 3.6f)* XMMatrixTranslation(32.0f, 6.5f, 3.0f));
-	boxRitem6->ObjCBIndex = 17;
-	boxRitem6->Geo = mGeometries["boxGeo"].get();
-	boxRitem6->Mat = mMaterials["bricks"].get();
-	boxRitem6->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	boxRitem6->IndexCount = boxRitem6->Geo->DrawArgs["box"].IndexCount;  // 36
-	boxRitem6->StartIndexLocation = boxRitem6->Geo->DrawArgs["box"].StartIndexLocation; // 0
-	boxRitem6->BaseVertexLocation = boxRitem6->Geo->DrawArgs["box"].BaseVertexLocation; // 0
-	mRitemLayer[(int)RenderLayer::Opaque].push_back(boxRitem6.get());
-	mAllRitems.push_back(std::move(boxRitem6));
-
-	auto boxRitem7 = std::make_unique<RenderItem>();
-	XMStoreFloat4x4(&boxRitem7->World, XMMatrixScaling(0.1f, 0.8f, 3.6f)* XMMatrixTranslation(-32.0f, 6.5f, 3.0f));
-	boxRitem7->ObjCBIndex = 18;
-	boxRitem7->Geo = mGeometries["boxGeo"].get();
-	boxRitem7->Mat = mMaterials["bricks"].get();
-	boxRitem7->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	boxRitem7->IndexCount = boxRitem7->Geo->DrawArgs["box"].IndexCount;  // 36
-	boxRitem7->StartIndexLocation = boxRitem7->Geo->DrawArgs["box"].StartIndexLocation; // 0
-	boxRitem7->BaseVertexLocation = boxRitem7->Geo->DrawArgs["box"].BaseVertexLocation; // 0
-	mRitemLayer[(int)RenderLayer::Opaque].push_back(boxRitem7.get());
-	mAllRitems.push_back(std::move(boxRitem7));
-
-	// GATE TOWER CYLINDERS
-	auto cylinderRitem5 = std::make_unique<RenderItem>();
-	XMStoreFloat4x4(&cylinderRitem5->World, XMMatrixScaling(0.2f, 0.3f, 0.2f)* XMMatrixTranslation(5.5f, 9.0f, -15.0f));
-	cylinderRitem5->ObjCBIndex = 19;
-	cylinderRitem5->Geo = mGeometries["cylinderGeo"].get();
-	cylinderRitem5->Mat = mMaterials["bricks"].get();
-	cylinderRitem5->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	cylinderRitem5->IndexCount = cylinderRitem5->Geo->DrawArgs["cylinder"].IndexCount;  // 36
-	cylinderRitem5->StartIndexLocation = cylinderRitem5->Geo->DrawArgs["cylinder"].StartIndexLocation; // 0
-	cylinderRitem5->BaseVertexLocation = cylinderRitem5->Geo->DrawArgs["cylinder"].BaseVertexLocation; // 0
-	mRitemLayer[(int)RenderLayer::Opaque].push_back(cylinderRitem5.get());
-	mAllRitems.push_back(std::move(cylinderRitem5));
-
-	auto cylinderRitem6 = std::make_unique<RenderItem>();
-	XMStoreFloat4x4(&cylinderRitem6->World, XMMatrixScaling(0.2f, 0.3f, 0.2f)* XMMatrixTranslation(-5.5f, 9.0f, -15.0f));
-	cylinderRitem6->ObjCBIndex = 20;
-	cylinderRitem6->Geo = mGeometries["cylinderGeo"].get();
-	cylinderRitem6->Mat = mMaterials["bricks"].get();
-	cylinderRitem6->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	cylinderRitem6->IndexCount = cylinderRitem6->Geo->DrawArgs["cylinder"].IndexCount;  // 36
-	cylinderRitem6->StartIndexLocation = cylinderRitem6->Geo->DrawArgs["cylinder"].StartIndexLocation; // 0
-	cylinderRitem6->BaseVertexLocation = cylinderRitem6->Geo->DrawArgs["cylinder"].BaseVertexLocation; // 0
-	mRitemLayer[(int)RenderLayer::Opaque].push_back(cylinderRitem6.get());
-	mAllRitems.push_back(std::move(cylinderRitem6));
-
-	// WOODEN BOXES
-	auto boxRitem8 = std::make_unique<RenderItem>();
-	XMStoreFloat4x4(&boxRitem8->World, XMMatrixScaling(0.3f, 0.3f, 0.3f)* XMMatrixTranslation(15.0f, 4.5f, 0.0f));
-	boxRitem8->ObjCBIndex = 21;
-	boxRitem8->Geo = mGeometries["boxGeo"].get();
-	boxRitem8->Mat = mMaterials["wood"].get();
-	boxRitem8->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	boxRitem8->IndexCount = boxRitem8->Geo->DrawArgs["box"].IndexCount;  // 36
-	boxRitem8->StartIndexLocation = boxRitem8->Geo->DrawArgs["box"].StartIndexLocation; // 0
-	boxRitem8->BaseVertexLocation = boxRitem8->Geo->DrawArgs["box"].BaseVertexLocation; // 0
-	mRitemLayer[(int)RenderLayer::Opaque].push_back(boxRitem8.get());
-	mAllRitems.push_back(std::move(boxRitem8));
-
-	auto boxRitem9 = std::make_unique<RenderItem>();
-	XMStoreFloat4x4(&boxRitem9->World, XMMatrixScaling(0.3f, 0.3f, 0.3f)* XMMatrixTranslation(-15.0f, 4.5f, 0.0f));
-	boxRitem9->ObjCBIndex = 22;
-	boxRitem9->Geo = mGeometries["boxGeo"].get();
-	boxRitem9->Mat = mMaterials["wood"].get();
-	boxRitem9->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	boxRitem9->IndexCount = boxRitem9->Geo->DrawArgs["box"].IndexCount;  // 36
-	boxRitem9->StartIndexLocation = boxRitem9->Geo->DrawArgs["box"].StartIndexLocation; // 0
-	boxRitem9->BaseVertexLocation = boxRitem9->Geo->DrawArgs["box"].BaseVertexLocation; // 0
-	mRitemLayer[(int)RenderLayer::Opaque].push_back(boxRitem9.get());
-	mAllRitems.push_back(std::move(boxRitem9));
-
-	// CASTLE TOWER CYLINDERS
-	auto cylinderRitem7 = std::make_unique<RenderItem>();
-	XMStoreFloat4x4(&cylinderRitem7->World, XMMatrixScaling(0.2f, 0.5f, 0.2f)* XMMatrixTranslation(-5.0f, 12.0f, 5.0f));
-	cylinderRitem7->ObjCBIndex = 23;
-	cylinderRitem7->Geo = mGeometries["cylinderGeo"].get();
-	cylinderRitem7->Mat = mMaterials["bricks"].get();
-	cylinderRitem7->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	cylinderRitem7->IndexCount = cylinderRitem7->Geo->DrawArgs["cylinder"].IndexCount;  // 36
-	cylinderRitem7->StartIndexLocation = cylinderRitem7->Geo->DrawArgs["cylinder"].StartIndexLocation; // 0
-	cylinderRitem7->BaseVertexLocation = cylinderRitem7->Geo->DrawArgs["cylinder"].BaseVertexLocation; // 0
-	mRitemLayer[(int)RenderLayer::Opaque].push_back(cylinderRitem7.get());
-	mAllRitems.push_back(std::move(cylinderRitem7));
-
-	auto cylinderRitem8 = std::make_unique<RenderItem>();
-	XMStoreFloat4x4(&cylinderRitem8->World, XMMatrixScaling(0.2f, 0.5f, 0.2f)* XMMatrixTranslation(5.0f, 12.0f, 5.0f));
-	cylinderRitem8->ObjCBIndex = 24;
-	cylinderRitem8->Geo = mGeometries["cylinderGeo"].get();
-	cylinderRitem8->Mat = mMaterials["bricks"].get();
-	cylinderRitem8->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	cylinderRitem8->IndexCount = cylinderRitem8->Geo->DrawArgs["cylinder"].IndexCount;  // 36
-	cylinderRitem8->StartIndexLocation = cylinderRitem8->Geo->DrawArgs["cylinder"].StartIndexLocation; // 0
-	cylinderRitem8->BaseVertexLocation = cylinderRitem8->Geo->DrawArgs["cylinder"].BaseVertexLocation; // 0
-	mRitemLayer[(int)RenderLayer::Opaque].push_back(cylinderRitem8.get());
-	mAllRitems.push_back(std::move(cylinderRitem8));
-
-	auto cylinderRitem9 = std::make_unique<RenderItem>();
-	XMStoreFloat4x4(&cylinderRitem9->World, XMMatrixScaling(0.2f, 0.5f, 0.2f)* XMMatrixTranslation(-5.0f, 12.0f, 15.0f));
-	cylinderRitem9->ObjCBIndex = 25;
-	cylinderRitem9->Geo = mGeometries["cylinderGeo"].get();
-	cylinderRitem9->Mat = mMaterials["bricks"].get();
-	cylinderRitem9->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	cylinderRitem9->IndexCount = cylinderRitem9->Geo->DrawArgs["cylinder"].IndexCount;  // 36
-	cylinderRitem9->StartIndexLocation = cylinderRitem9->Geo->DrawArgs["cylinder"].StartIndexLocation; // 0
-	cylinderRitem9->BaseVertexLocation = cylinderRitem9->Geo->DrawArgs["cylinder"].BaseVertexLocation; // 0
-	mRitemLayer[(int)RenderLayer::Opaque].push_back(cylinderRitem9.get());
-	mAllRitems.push_back(std::move(cylinderRitem9));
-
-	auto cylinderRitem10 = std::make_unique<RenderItem>();
-	XMStoreFloat4x4(&cylinderRitem10->World, XMMatrixScaling(0.2f, 0.5f, 0.2f)* XMMatrixTranslation(5.0f, 12.0f, 15.0f));
-	cylinderRitem10->ObjCBIndex = 26;
-	cylinderRitem10->Geo = mGeometries["cylinderGeo"].get();
-	cylinderRitem10->Mat = mMaterials["bricks"].get();
-	cylinderRitem10->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	cylinderRitem10->IndexCount = cylinderRitem10->Geo->DrawArgs["cylinder"].IndexCount;  // 36
-	cylinderRitem10->StartIndexLocation = cylinderRitem10->Geo->DrawArgs["cylinder"].StartIndexLocation; // 0
-	cylinderRitem10->BaseVertexLocation = cylinderRitem10->Geo->DrawArgs["cylinder"].BaseVertexLocation; // 0
-	mRitemLayer[(int)RenderLayer::Opaque].push_back(cylinderRitem10.get());
-	mAllRitems.push_back(std::move(cylinderRitem10));
-
-	// CASTLE ROOFTOP CONES
-	auto coneRitem7 = std::make_unique<RenderItem>();
-	XMStoreFloat4x4(&coneRitem7->World, XMMatrixScaling(0.3f, 0.1f, 0.3f)* XMMatrixTranslation(5.0f, 24.0f, 5.0f));
-	coneRitem7->ObjCBIndex = 27;
-	coneRitem7->Geo = mGeometries["coneGeo"].get();
-	coneRitem7->Mat = mMaterials["tiles"].get();
-	coneRitem7->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	coneRitem7->IndexCount = coneRitem7->Geo->DrawArgs["cone"].IndexCount;  // 36
-	coneRitem7->StartIndexLocation = coneRitem7->Geo->DrawArgs["cone"].StartIndexLocation; // 0
-	coneRitem7->BaseVertexLocation = coneRitem7->Geo->DrawArgs["cone"].BaseVertexLocation; // 0
-	mRitemLayer[(int)RenderLayer::Opaque].push_back(coneRitem7.get());
-	mAllRitems.push_back(std::move(coneRitem7));
-
-	auto coneRitem8 = std::make_unique<RenderItem>();
-	XMStoreFloat4x4(&coneRitem8->World, XMMatrixScaling(0.3f, 0.1f, 0.3f)* XMMatrixTranslation(-5.0f, 24.0f, 5.0f));
-	coneRitem8->ObjCBIndex = 28;
-	coneRitem8->Geo = mGeometries["coneGeo"].get();
-	coneRitem8->Mat = mMaterials["tiles"].get();
-	coneRitem8->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	coneRitem8->IndexCount = coneRitem8->Geo->DrawArgs["cone"].IndexCount;  // 36
-	coneRitem8->StartIndexLocation = coneRitem8->Geo->DrawArgs["cone"].StartIndexLocation; // 0
-	coneRitem8->BaseVertexLocation = coneRitem8->Geo->DrawArgs["cone"].BaseVertexLocation; // 0
-	mRitemLayer[(int)RenderLayer::Opaque].push_back(coneRitem8.get());
-	mAllRitems.push_back(std::move(coneRitem8));
-
-	auto coneRitem9 = std::make_unique<RenderItem>();
-	XMStoreFloat4x4(&coneRitem9->World, XMMatrixScaling(0.3f, 0.1f, 0.3f)* XMMatrixTranslation(5.0f, 24.0f, 15.0f));
-	coneRitem9->ObjCBIndex = 29;
-	coneRitem9->Geo = mGeometries["coneGeo"].get();
-	coneRitem9->Mat = mMaterials["tiles"].get();
-	coneRitem9->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	coneRitem9->IndexCount = coneRitem9->Geo->DrawArgs["cone"].IndexCount;  // 36
-	coneRitem9->StartIndexLocation = coneRitem9->Geo->DrawArgs["cone"].StartIndexLocation; // 0
-	coneRitem9->BaseVertexLocation = coneRitem9->Geo->DrawArgs["cone"].BaseVertexLocation; // 0
-	mRitemLayer[(int)RenderLayer::Opaque].push_back(coneRitem9.get());
-	mAllRitems.push_back(std::move(coneRitem9));
-
-	auto coneRitem10 = std::make_unique<RenderItem>();
-	XMStoreFloat4x4(&coneRitem10->World, XMMatrixScaling(0.3f, 0.1f, 0.3f)* XMMatrixTranslation(-5.0f, 24.0f, 15.0f));
-	coneRitem10->ObjCBIndex = 30;
-	coneRitem10->Geo = mGeometries["coneGeo"].get();
-	coneRitem10->Mat = mMaterials["tiles"].get();
-	coneRitem10->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	coneRitem10->IndexCount = coneRitem10->Geo->DrawArgs["cone"].IndexCount;  // 36
-	coneRitem10->StartIndexLocation = coneRitem10->Geo->DrawArgs["cone"].StartIndexLocation; // 0
-	coneRitem10->BaseVertexLocation = coneRitem10->Geo->DrawArgs["cone"].BaseVertexLocation; // 0
-	mRitemLayer[(int)RenderLayer::Opaque].push_back(coneRitem10.get());
-	mAllRitems.push_back(std::move(coneRitem10));
+	// CASTLE
+	// From CastleLayout, which Tools/ImpostorBake bakes the impostors of.
+	UINT objCBIndex = 3;
+	for(const CastlePart& part : CastleLayout::Parts())
+	{
+		auto castleRitem = std::make_unique<RenderItem>();
+		XMStoreFloat4x4(&castleRitem->World.Edit(), CastleLayout::World(part));
+		castleRitem->ObjCBIndex = objCBIndex++;
+		castleRitem->Geo = mGeometries.at(CastleLayout::GeometryName(part.Shape)).get();
+		castleRitem->Mat = mMaterials[part.Material].get();
+		castleRitem->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+		castleRitem->SetSubmesh(CastleLayout::SubmeshName(part.Shape));
+		mRitemLayer[(int)RenderLayer::Opaque].push_back(castleRitem.get());
+		mAllRitems.push_back(std::move(castleRitem));
+	}
 
 	//////////////////////////////////////////////////////////
 	
@@ -1658,53 +3124,154 @@ void TreeBillboardsApp::BuildRenderItems()
 	treeSpritesRitem->World = MathHelper::Identity4x4();
 	treeSpritesRitem->ObjCBIndex = 31;
 	treeSpritesRitem->Mat = mMaterials["treeSprites"].get();
-	treeSpritesRitem->Geo = mGeometries["treeSpritesGeo"].get();
+	treeSpritesRitem->Geo = mGeometries.at("treeSpritesGeo").get();
 	//step2
 	treeSpritesRitem->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_POINTLIST;
-	treeSpritesRitem->IndexCount = treeSpritesRitem->Geo->DrawArgs["points"].IndexCount;
-	treeSpritesRitem->StartIndexLocation = treeSpritesRitem->Geo->DrawArgs["points"].StartIndexLocation;
-	treeSpritesRitem->BaseVertexLocation = treeSpritesRitem->Geo->DrawArgs["points"].BaseVertexLocation;
+	treeSpritesRitem->SetSubmesh("points");
 
 	mRitemLayer[(int)RenderLayer::AlphaTestedTreeSprites].push_back(treeSpritesRitem.get());
+	mTreeSpritesRitem = treeSpritesRitem.get();
+
+	auto flagSpritesRitem = std::make_unique<RenderItem>();
+	flagSpritesRitem->World = MathHelper::Identity4x4();
+	flagSpritesRitem->ObjCBIndex = 32;
+	flagSpritesRitem->Mat = mMaterials["flags"].get();
+	flagSpritesRitem->Geo = mGeometries.at("flagSpritesGeo").get();
+	flagSpritesRitem->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_POINTLIST;
+	flagSpritesRitem->SetSubmesh("points");
+	mRitemLayer[(int)RenderLayer::AlphaTestedFlagSprites].push_back(flagSpritesRitem.get());
 
     mAllRitems.push_back(std::move(wavesRitem));
     mAllRitems.push_back(std::move(gridRitem));
 	mAllRitems.push_back(std::move(boxRitem));
 	mAllRitems.push_back(std::move(treeSpritesRitem));
+	mAllRitems.push_back(std::move(flagSpritesRitem));
 }
 
 void TreeBillboardsApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems)
 {
-    UINT objCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants));
     UINT matCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(MaterialConstants));
 
-	auto objectCB = mCurrFrameResource->ObjectCB->Resource();
 	auto matCB = mCurrFrameResource->MaterialCB->Resource();
 
     // For each render item...
     for(size_t i = 0; i < ritems.size(); ++i)
     {
         auto ri = ritems[i];
+		if(ri->DrawAsImpostor)
+			continue;
 
         cmdList->IASetVertexBuffers(0, 1, &ri->Geo->VertexBufferView());
+		if(ri->Geo->DynamicVertexBufferGPU != nullptr)
+			cmdList->IASetVertexBuffers(1, 1, &ri->Geo->DynamicVertexBufferView());
         cmdList->IASetIndexBuffer(&ri->Geo->IndexBufferView());
 		//step3
         cmdList->IASetPrimitiveTopology(ri->PrimitiveType);
 
-		CD3DX12_GPU_DESCRIPTOR_HANDLE tex(mSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
-		tex.Offset(ri->Mat->DiffuseSrvHeapIndex, mCbvSrvDescriptorSize);
+		CD3DX12_GPU_DESCRIPTOR_HANDLE tex = mSrvHeap->GpuHandle(ri->Mat->DiffuseSrvHeapIndex);
 
-        D3D12_GPU_VIRTUAL_ADDRESS objCBAddress = objectCB->GetGPUVirtualAddress() + ri->ObjCBIndex*objCBByteSize;
 		D3D12_GPU_VIRTUAL_ADDRESS matCBAddress = matCB->GetGPUVirtualAddress() + ri->Mat->MatCBIndex*matCBByteSize;
 
 		cmdList->SetGraphicsRootDescriptorTable(0, tex);
-        cmdList->SetGraphicsRootConstantBufferView(1, objCBAddress);
+        cmdList->SetGraphicsRoot32BitConstant(1, ri->ObjCBIndex, 0);
         cmdList->SetGraphicsRootConstantBufferView(3, matCBAddress);
 
         cmdList->DrawIndexedInstanced(ri->IndexCount, 1, ri->StartIndexLocation, ri->BaseVertexLocation, 0);
     }
 }
 
+bool TreeBillboardsApp::UseSceneTarget()const
+{
+	// The scene target is single sampled, so with 4X MSAA on the scene goes straight
+	// into the back buffer at full resolution.
+	return !m4xMsaaState;
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE TreeBillboardsApp::SceneTargetView()const
+{
+	return CD3DX12_CPU_DESCRIPTOR_HANDLE(mRtvHeap->GetCPUDescriptorHandleForHeapStart(),
+		SwapChainBufferCount, mRtvDescriptorSize);
+}
+
+void TreeBillboardsApp::DrawLayer(ID3D12GraphicsCommandList* cmdList, RenderLayer layer)
+{
+	if(!mUseIndirectDraws)
+	{
+		DrawRenderItems(cmdList, mRitemLayer[(int)layer]);
+		return;
+	}
+
+	auto argsBuffer = mCurrFrameResource->IndirectArgs->Resource();
+
+	for(const IndirectDrawRun& run : mIndirectRuns[(int)layer])
+	{
+		cmdList->IASetPrimitiveTopology(run.PrimitiveType);
+		cmdList->SetGraphicsRootDescriptorTable(0, mSrvHeap->GpuHandle(run.DiffuseSrvHeapIndex));
+
+		cmdList->ExecuteIndirect(mCommandSignature.Get(), run.CommandCount, argsBuffer,
+			run.FirstCommand*sizeof(IndirectDrawCommand), nullptr, 0);
+	}
+}
+
+void TreeBillboardsApp::DrawTreeInstances(ID3D12GraphicsCommandList* cmdList)
+{
+	UINT instanceCount = mCurrFrameResource->TreeInstanceCount;
+	if(instanceCount == 0)
+		return;
+
+	UINT matCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(MaterialConstants));
+
+	auto matCB = mCurrFrameResource->MaterialCB->Resource();
+	auto treeInstances = mCurrFrameResource->TreeInstances->Resource();
+
+	RenderItem* ri = mTreeSpritesRitem;
+	MeshGeometry* quad = mGeometries["treeQuadGeo"].get();
+
+	D3D12_VERTEX_BUFFER_VIEW instanceView;
+	instanceView.BufferLocation = treeInstances->GetGPUVirtualAddress();
+	instanceView.StrideInBytes = sizeof(BillboardInstance);
+	instanceView.SizeInBytes = instanceCount * sizeof(BillboardInstance);
+
+	cmdList->IASetVertexBuffers(0, 1, &quad->VertexBufferView());
+	cmdList->IASetVertexBuffers(1, 1, &instanceView);
+	cmdList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+
+	cmdList->SetGraphicsRootDescriptorTable(0, mSrvHeap->GpuHandle(ri->Mat->DiffuseSrvHeapIndex));
+	cmdList->SetGraphicsRoot32BitConstant(1, ri->ObjCBIndex, 0);
+	cmdList->SetGraphicsRootConstantBufferView(3, matCB->GetGPUVirtualAddress() + ri->Mat->MatCBIndex*matCBByteSize);
+
+	cmdList->DrawInstanced(4, instanceCount, 0, 0);
+}
+
+void TreeBillboardsApp::DrawImpostors(ID3D12GraphicsCommandList* cmdList)
+{
+	UINT matCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(MaterialConstants));
+
+	auto matCB = mCurrFrameResource->MaterialCB->Resource();
+	auto impostorInstances = mCurrFrameResource->ImpostorInstances->Resource();
+	MeshGeometry* quad = mGeometries["treeQuadGeo"].get();
+
+	UINT instanceCount = mImpostorRuns.back().FirstInstance + mImpostorRuns.back().InstanceCount;
+
+	D3D12_VERTEX_BUFFER_VIEW instanceView;
+	instanceView.BufferLocation = impostorInstances->GetGPUVirtualAddress();
+	instanceView.StrideInBytes = sizeof(ImpostorInstance);
+	instanceView.SizeInBytes = instanceCount * sizeof(ImpostorInstance);
+
+	cmdList->IASetVertexBuffers(0, 1, &quad->VertexBufferView());
+	cmdList->IASetVertexBuffers(1, 1, &instanceView);
+	cmdList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+
+	cmdList->SetGraphicsRootDescriptorTable(5, mSrvHeap->GpuHandle(mImpostorSrvHeapIndex));
+
+	for(const ImpostorRun& run : mImpostorRuns)
+	{
+		cmdList->SetGraphicsRootConstantBufferView(3, matCB->GetGPUVirtualAddress() + run.Mat->MatCBIndex*matCBByteSize);
+
+		cmdList->DrawInstanced(4, run.InstanceCount, 0, run.FirstInstance);
+	}
+}
+
 std::array<const CD3DX12_STATIC_SAMPLER_DESC, 6> TreeBillboardsApp::GetStaticSamplers()
 {
 	// Applications usually only need a handful of samplers.  So just define them all up front
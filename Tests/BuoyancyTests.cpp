@@ -0,0 +1,129 @@
+//***************************************************************************************
+// BuoyancyTests.cpp
+//
+// Bodies floating on a Waves surface, and the batched surface sampling they use.
+//***************************************************************************************
+
+#include "Buoyancy.h"
+#include "TestUtil.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	void TestBodiesSettleAtTheirDraft()
+	{
+		// Calm water at height 0.
+		Waves waves(64, 64, 1.0f, 0.03f, 4.0f, 0.2f);
+
+		struct Body
+		{
+			XMFLOAT3 Start;
+			float HalfHeight;
+			float Density;
+		};
+		const Body bodies[] =
+		{
+			{ XMFLOAT3(0.0f, 3.0f, 0.0f), 1.0f, 0.6f },
+			{ XMFLOAT3(5.0f, -2.0f, 5.0f), 0.5f, 0.25f },
+			{ XMFLOAT3(-10.0f, 0.0f, 12.0f), 2.0f, 0.9f },
+		};
+
+		Buoyancy buoyancy;
+		for(const Body& body : bodies)
+			buoyancy.Add(body.Start, body.HalfHeight, body.Density);
+
+		for(int frame = 0; frame < 30*60; ++frame)
+			buoyancy.Update(waves, 1.0f / 60.0f);
+
+		for(int i = 0; i < buoyancy.Count(); ++i)
+		{
+			// Density of the column's height is under water.
+			const Body& body = bodies[i];
+			float draft = 2.0f*body.HalfHeight*body.Density;
+			XMFLOAT3 p = buoyancy.Position(i);
+
+			CHECK_NEAR(p.y, body.HalfHeight - draft, 1e-3);
+			CHECK_NEAR(p.x, body.Start.x, 1e-4);
+			CHECK_NEAR(p.z, body.Start.z, 1e-4);
+			CHECK_NEAR(buoyancy.Velocity(i).y, 0.0, 1e-3);
+		}
+	}
+
+	void TestBatchedSamplingMatchesScalar()
+	{
+		Waves waves(128, 128, 1.0f, 0.03f, 4.0f, 0.2f, 20);
+		for(int k = 0; k < 40; ++k)
+		{
+			waves.Disturb(10 + 2*k, 20 + k, 0.4f);
+			for(int s = 0; s < 5; ++s)
+				waves.Step();
+		}
+
+		// Not a multiple of eight, and some points off the grid.
+		const int count = 4099;
+		std::vector<float> x(count), z(count);
+		std::srand(1);
+		for(int k = 0; k < count; ++k)
+		{
+			x[k] = ((float)std::rand() / RAND_MAX - 0.5f)*140.0f;
+			z[k] = ((float)std::rand() / RAND_MAX - 0.5f)*140.0f;
+		}
+
+		std::vector<float> batched[5], scalar[5];
+		for(int a = 0; a < 5; ++a)
+		{
+			batched[a].resize(count);
+			scalar[a].resize(count);
+		}
+
+		waves.SampleSurface(count, x.data(), z.data(), batched[0].data(), batched[1].data(),
+			batched[2].data(), batched[3].data(), batched[4].data());
+		waves.SampleSurfaceReference(count, x.data(), z.data(), scalar[0].data(), scalar[1].data(),
+			scalar[2].data(), scalar[3].data(), scalar[4].data());
+
+		// Heights, and velocities times the time step, which is the height change they
+		// come from, agree to 1e-7.  The batched normals are scaled by a vector reciprocal
+		// square root, which rounds differently, and agree to two roundings of a unit
+		// vector.
+		const float tolerance[5] = { 1e-7f, 2.0f*FLT_EPSILON, 2.0f*FLT_EPSILON, 2.0f*FLT_EPSILON, 1e-7f };
+		const float scale[5] = { 1.0f, 1.0f, 1.0f, 1.0f, waves.TimeStep() };
+		int different = 0;
+		float highest = 0.0f;
+		for(int k = 0; k < count; ++k)
+		{
+			for(int a = 0; a < 5; ++a)
+			{
+				if(!(std::fabs(batched[a][k] - scalar[a][k])*scale[a] <= tolerance[a]))
+					++different;
+			}
+			highest = std::max(highest, std::fabs(scalar[0][k]));
+		}
+
+		CHECK(different == 0);
+		CHECK(highest > 0.01f);
+
+		// At a grid point the height is the grid's.
+		float px = -63.5f + 40.0f;
+		float pz = 63.5f - 50.0f;
+		float h, nx, ny, nz, v;
+		waves.SampleSurface(1, &px, &pz, &h, &nx, &ny, &nz, &v);
+		CHECK_NEAR(h, waves.Height(50, 40), 1e-6);
+	}
+}
+
+int main()
+{
+	const TestUtil::TestCase tests[] =
+	{
+		{ "BodiesSettleAtTheirDraft", TestBodiesSettleAtTheirDraft },
+		{ "BatchedSamplingMatchesScalar", TestBatchedSamplingMatchesScalar },
+	};
+
+	return TestUtil::RunTests(tests);
+}
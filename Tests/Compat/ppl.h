@@ -0,0 +1,132 @@
+//***************************************************************************************
+// ppl.h
+//
+// The part of the Parallel Patterns Library the headless code uses, on std::thread, for
+// building it where the real header does not exist.
+//***************************************************************************************
+
+#pragma once
+
+#include <algorithm>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace concurrency
+{
+	// Splits [first, last) into one contiguous range per hardware thread.
+	template<typename Index, typename Function>
+	void parallel_for(Index first, Index last, const Function& func)
+	{
+		if(last <= first)
+			return;
+
+		Index count = last - first;
+		Index threadCount = (Index)std::max(1u, std::thread::hardware_concurrency());
+		threadCount = std::min(threadCount, count);
+
+		std::exception_ptr error;
+		std::mutex errorMutex;
+
+		auto runRange = [&](Index begin, Index end)
+		{
+			try
+			{
+				for(Index i = begin; i < end; ++i)
+					func(i);
+			}
+			catch(...)
+			{
+				std::lock_guard<std::mutex> lock(errorMutex);
+				if(!error)
+					error = std::current_exception();
+			}
+		};
+
+		std::vector<std::thread> threads;
+		for(Index t = 1; t < threadCount; ++t)
+			threads.emplace_back(runRange, first + count*t/threadCount, first + count*(t + 1)/threadCount);
+
+		runRange(first, first + count/threadCount);
+
+		for(std::thread& thread : threads)
+			thread.join();
+
+		if(error)
+			std::rethrow_exception(error);
+	}
+
+	// Runs every task on its own thread; wait() joins them and rethrows the first
+	// exception a task threw.
+	class task_group
+	{
+	public:
+		task_group() {}
+		task_group(const task_group& rhs) = delete;
+		task_group& operator=(const task_group& rhs) = delete;
+
+		~task_group()
+		{
+			Join();
+		}
+
+		template<typename Function>
+		void run(const Function& func)
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mThreads.emplace_back([this, func]()
+			{
+				try
+				{
+					func();
+				}
+				catch(...)
+				{
+					std::lock_guard<std::mutex> errorLock(mMutex);
+					if(!mError)
+						mError = std::current_exception();
+				}
+			});
+		}
+
+		void wait()
+		{
+			Join();
+
+			std::exception_ptr error;
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+				std::swap(error, mError);
+			}
+
+			if(error)
+				std::rethrow_exception(error);
+		}
+
+	private:
+		// Tasks may run more tasks, so keep joining until none are left.
+		void Join()
+		{
+			for(;;)
+			{
+				std::thread thread;
+				{
+					std::lock_guard<std::mutex> lock(mMutex);
+					if(mThreads.empty())
+						return;
+
+					thread = std::move(mThreads.back());
+					mThreads.pop_back();
+				}
+				thread.join();
+			}
+		}
+
+	private:
+		std::mutex mMutex;
+		std::vector<std::thread> mThreads;
+		std::exception_ptr mError;
+	};
+}
@@ -0,0 +1,225 @@
+//***************************************************************************************
+// DescriptorAllocatorTests.cpp
+//
+// The persistent free list and the fence-driven transient ring, without a heap: the
+// ranges handed out are checked against each other and against the frames the
+// simulated GPU still holds.
+//***************************************************************************************
+
+#include "DescriptorAllocator.h"
+#include "TestUtil.h"
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+namespace
+{
+	struct Lcg
+	{
+		std::uint32_t State = 7u;
+
+		std::uint32_t Next()
+		{
+			State = State*1664525u + 1013904223u;
+			return State >> 8;
+		}
+	};
+
+	bool Overlap(const DescriptorRange& a, const DescriptorRange& b)
+	{
+		return a.Offset < b.Offset + b.Count && b.Offset < a.Offset + a.Count;
+	}
+
+	void TestFreeListCoalesces()
+	{
+		DescriptorAllocator allocator(16, 0);
+
+		DescriptorRange blocks[4];
+		for(int i = 0; i < 4; ++i)
+		{
+			blocks[i] = allocator.AllocatePersistent(4);
+			CHECK(blocks[i].IsValid() && blocks[i].Offset == 4u*i && blocks[i].Count == 4);
+		}
+		CHECK(!allocator.AllocatePersistent(1).IsValid());
+		CHECK(allocator.Stats().PersistentUsed == 16);
+		CHECK(allocator.Stats().PersistentFreeBlocks == 0);
+		CHECK(allocator.Stats().Fragmentation == 0.0f);
+
+		// Two holes of four: half the free space is outside the largest block.
+		allocator.FreePersistent(blocks[0]);
+		allocator.FreePersistent(blocks[2]);
+		DescriptorHeapStats stats = allocator.Stats();
+		CHECK(stats.PersistentUsed == 8);
+		CHECK(stats.PersistentFreeBlocks == 2);
+		CHECK(stats.LargestFreeBlock == 4);
+		CHECK_NEAR(stats.Fragmentation, 0.5, 1e-6);
+		CHECK(!allocator.AllocatePersistent(8).IsValid());
+
+		// Freeing the block between them merges all three.
+		allocator.FreePersistent(blocks[1]);
+		stats = allocator.Stats();
+		CHECK(stats.PersistentFreeBlocks == 1);
+		CHECK(stats.LargestFreeBlock == 12);
+		CHECK(stats.Fragmentation == 0.0f);
+
+		DescriptorRange large = allocator.AllocatePersistent(12);
+		CHECK(large.IsValid() && large.Offset == 0);
+
+		// Freeing in the other order merges with the block before as well as after.
+		allocator.FreePersistent(blocks[3]);
+		allocator.FreePersistent(large);
+		stats = allocator.Stats();
+		CHECK(stats.PersistentUsed == 0);
+		CHECK(stats.PersistentFreeBlocks == 1);
+		CHECK(stats.LargestFreeBlock == 16);
+	}
+
+	void TestRingWaitsForTheFence()
+	{
+		// Transient offsets follow the persistent region.
+		DescriptorAllocator allocator(8, 24);
+
+		DescriptorRange a = allocator.AllocateTransient(10);
+		CHECK(a.IsValid() && a.Offset == 8 && a.Count == 10);
+		allocator.FinishFrame(1);
+
+		DescriptorRange b = allocator.AllocateTransient(10);
+		CHECK(b.IsValid() && b.Offset == 18);
+		allocator.FinishFrame(2);
+
+		// Four slots left before the end, and frame 1 still holds the start.
+		CHECK(!allocator.AllocateTransient(5).IsValid());
+		CHECK(allocator.Stats().TransientUsed == 20);
+
+		allocator.ReleaseCompleted(1);
+		CHECK(allocator.Stats().TransientUsed == 10);
+
+		// Too long for the end of the ring, so it wraps and skips the last four slots.
+		DescriptorRange c = allocator.AllocateTransient(5);
+		CHECK(c.IsValid() && c.Offset == 8);
+		CHECK(allocator.Stats().TransientUsed == 19);
+		CHECK(allocator.Stats().TransientPeak == 20);
+		allocator.FinishFrame(3);
+
+		// Frame 2 holds [10, 20) of the ring.
+		CHECK(!allocator.AllocateTransient(6).IsValid());
+		DescriptorRange d = allocator.AllocateTransient(5);
+		CHECK(d.IsValid() && d.Offset == 13);
+		CHECK(!allocator.AllocateTransient(1).IsValid());
+		allocator.FinishFrame(4);
+
+		allocator.ReleaseCompleted(4);
+		CHECK(allocator.Stats().TransientUsed == 0);
+	}
+
+	void TestRewindMovesPendingFrames()
+	{
+		// Frame 2 allocated nothing, so when the ring empties and starts again from 0 its
+		// marker has to move too, or releasing it would free C while frame 3 holds it.
+		DescriptorAllocator allocator(0, 24);
+
+		DescriptorRange a = allocator.AllocateTransient(5);
+		CHECK(a.IsValid() && a.Offset == 0);
+		allocator.FinishFrame(1);
+		allocator.FinishFrame(2);
+		allocator.ReleaseCompleted(1);
+
+		DescriptorRange c = allocator.AllocateTransient(20);
+		CHECK(c.IsValid() && c.Offset == 0);
+		allocator.FinishFrame(3);
+		allocator.ReleaseCompleted(2);
+		CHECK(allocator.Stats().TransientUsed == 20);
+
+		DescriptorRange d = allocator.AllocateTransient(4);
+		CHECK(d.IsValid() && d.Offset == 20);
+		DescriptorRange e = allocator.AllocateTransient(4);
+		CHECK(!e.IsValid());
+		CHECK(!Overlap(d, c));
+
+		allocator.FinishFrame(4);
+		allocator.ReleaseCompleted(3);
+		e = allocator.AllocateTransient(4);
+		CHECK(e.IsValid() && e.Offset == 0);
+	}
+
+	void TestRandomFramesNeverShareSlots()
+	{
+		const std::uint32_t ringSize = 64;
+		DescriptorAllocator allocator(16, ringSize);
+		Lcg random;
+
+		struct Frame
+		{
+			std::uint64_t Fence;
+			std::vector<DescriptorRange> Ranges;
+		};
+		std::deque<Frame> inFlight;
+		std::uint64_t fence = 0;
+		int failures = 0;
+
+		for(int frame = 0; frame < 5000; ++frame)
+		{
+			// Some frames allocate nothing, which lets the ring empty and rewind.
+			Frame current;
+			current.Fence = ++fence;
+			std::uint32_t allocations = random.Next() % 4;
+			for(std::uint32_t i = 0; i < allocations; ++i)
+			{
+				DescriptorRange range = allocator.AllocateTransient(1 + random.Next() % 20);
+				if(!range.IsValid())
+				{
+					failures++;
+					continue;
+				}
+
+				CHECK(range.Offset >= 16 && range.Offset + range.Count <= 16 + ringSize);
+				for(const Frame& held : inFlight)
+				{
+					for(const DescriptorRange& other : held.Ranges)
+						CHECK(!Overlap(range, other));
+				}
+				for(const DescriptorRange& other : current.Ranges)
+					CHECK(!Overlap(range, other));
+
+				current.Ranges.push_back(range);
+			}
+
+			allocator.FinishFrame(current.Fence);
+			inFlight.push_back(current);
+
+			// The GPU finishes none, some or all of the frames in flight.
+			std::uint32_t completed = random.Next() % 3 == 0 ? 0 : random.Next() % (inFlight.size() + 1);
+			if(completed > 0)
+			{
+				allocator.ReleaseCompleted(inFlight[completed - 1].Fence);
+				inFlight.erase(inFlight.begin(), inFlight.begin() + completed);
+			}
+
+			std::uint32_t held = 0;
+			for(const Frame& f : inFlight)
+			{
+				for(const DescriptorRange& r : f.Ranges)
+					held += r.Count;
+			}
+			CHECK(allocator.Stats().TransientUsed >= held);
+			if(inFlight.empty())
+				CHECK(allocator.Stats().TransientUsed == 0);
+		}
+
+		// The ring was small enough to fill now and then.
+		CHECK(failures > 0);
+	}
+}
+
+int main()
+{
+	const TestUtil::TestCase tests[] =
+	{
+		{ "FreeListCoalesces", TestFreeListCoalesces },
+		{ "RingWaitsForTheFence", TestRingWaitsForTheFence },
+		{ "RewindMovesPendingFrames", TestRewindMovesPendingFrames },
+		{ "RandomFramesNeverShareSlots", TestRandomFramesNeverShareSlots },
+	};
+
+	return TestUtil::RunTests(tests);
+}
@@ -0,0 +1,139 @@
+//***************************************************************************************
+// DirtyRowTrackerTests.cpp
+//
+// Rows marked as they change, collected one slot at a time the way the frame resources
+// are cycled, and the runs they are handed out in.
+//***************************************************************************************
+
+#include "DirtyRowTracker.h"
+#include "TestUtil.h"
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace
+{
+	typedef std::vector<std::pair<std::uint32_t, std::uint32_t>> Runs;
+
+	Runs Collect(DirtyRowTracker& tracker, std::uint32_t slot)
+	{
+		Runs runs;
+		tracker.Collect(slot, [&](std::uint32_t firstRow, std::uint32_t rowCount)
+		{
+			runs.push_back(std::make_pair(firstRow, rowCount));
+		});
+		return runs;
+	}
+
+	void CollectAll(DirtyRowTracker& tracker)
+	{
+		for(std::uint32_t slot = 0; slot < tracker.SlotCount(); ++slot)
+			Collect(tracker, slot);
+	}
+
+	void TestEverythingStartsPending()
+	{
+		DirtyRowTracker tracker(100, 3, 64);
+
+		for(std::uint32_t slot = 0; slot < 3; ++slot)
+		{
+			Runs runs = Collect(tracker, slot);
+			CHECK(runs == Runs({ { 0u, 100u } }));
+			CHECK(tracker.Stats().BytesUploaded == 100*64);
+			CHECK(tracker.Stats().BytesFull == 100*64);
+		}
+
+		for(std::uint32_t slot = 0; slot < 3; ++slot)
+			CHECK(Collect(tracker, slot).empty());
+	}
+
+	void TestMarkedRowReachesEverySlotOnce()
+	{
+		for(std::uint32_t slotCount : { 1u, 3u, 32u })
+		{
+			DirtyRowTracker tracker(50, slotCount, 16);
+			CollectAll(tracker);
+
+			tracker.MarkRows(17);
+			for(std::uint32_t slot = 0; slot < slotCount; ++slot)
+				CHECK(tracker.IsPending(slot, 17) && !tracker.IsPending(slot, 16));
+
+			// Cycle through the slots as the frame resources are, a few times over.
+			std::vector<int> received(slotCount, 0);
+			for(std::uint32_t frame = 0; frame < 3*slotCount; ++frame)
+			{
+				std::uint32_t slot = frame % slotCount;
+				for(const auto& run : Collect(tracker, slot))
+				{
+					CHECK(run.first == 17 && run.second == 1);
+					received[slot]++;
+				}
+
+				// Only the first visit to a slot finds the row.
+				CHECK(tracker.Stats().RowsUploaded == (frame < slotCount ? 1u : 0u));
+			}
+
+			for(int count : received)
+				CHECK(count == 1);
+		}
+	}
+
+	void TestRemarkingAfterACollect()
+	{
+		DirtyRowTracker tracker(20, 3, 16);
+		CollectAll(tracker);
+
+		// Slot 0 writes the row, then it changes again before slots 1 and 2 get to it:
+		// slot 0 needs it again, and the others still need it only once.
+		tracker.MarkRows(5);
+		CHECK(Collect(tracker, 0).size() == 1);
+		tracker.MarkRows(5);
+
+		CHECK(Collect(tracker, 1) == Runs({ { 5u, 1u } }));
+		CHECK(Collect(tracker, 2) == Runs({ { 5u, 1u } }));
+		CHECK(Collect(tracker, 0) == Runs({ { 5u, 1u } }));
+		CHECK(Collect(tracker, 1).empty());
+	}
+
+	void TestCollectMergesNeighbours()
+	{
+		DirtyRowTracker tracker(64, 2, 100);
+		CollectAll(tracker);
+		std::uint64_t totalBefore = tracker.Stats().TotalBytesUploaded;
+
+		// Marked out of order and overlapping, at both ends of the mesh.
+		tracker.MarkRows(4, 2);
+		tracker.MarkRows(3);
+		tracker.MarkRows(5);
+		tracker.MarkRows(9, 2);
+		tracker.MarkRows(20);
+		tracker.MarkRows(0);
+		tracker.MarkRows(62, 2);
+
+		Runs runs = Collect(tracker, 1);
+		CHECK(runs == Runs({ { 0u, 1u }, { 3u, 3u }, { 9u, 2u }, { 20u, 1u }, { 62u, 2u } }));
+
+		const DirtyRowStats& stats = tracker.Stats();
+		CHECK(stats.Runs == 5);
+		CHECK(stats.RowsUploaded == 9);
+		CHECK(stats.BytesUploaded == 9*100);
+		CHECK(stats.BytesFull == 64*100);
+		CHECK(stats.TotalBytesUploaded == totalBefore + 9*100);
+
+		// The other slot still has the same runs to collect.
+		CHECK(Collect(tracker, 0) == runs);
+	}
+}
+
+int main()
+{
+	const TestUtil::TestCase tests[] =
+	{
+		{ "EverythingStartsPending", TestEverythingStartsPending },
+		{ "MarkedRowReachesEverySlotOnce", TestMarkedRowReachesEverySlotOnce },
+		{ "RemarkingAfterACollect", TestRemarkingAfterACollect },
+		{ "CollectMergesNeighbours", TestCollectMergesNeighbours },
+	};
+
+	return TestUtil::RunTests(tests);
+}
@@ -0,0 +1,203 @@
+//***************************************************************************************
+// DynamicResolutionTests.cpp
+//
+// Drives DynamicResolution with load traces through a simple GPU model: a fixed cost
+// plus a pixel cost that scales with the rendered area.
+//***************************************************************************************
+
+#include "DynamicResolution.h"
+#include "TestUtil.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace
+{
+	const double Ms = 0.001;
+	const double Budget = 1.0 / 60.0;
+
+	// Time the GPU needs for a frame at the given scale, for a full resolution pixel cost.
+	double GpuTime(double pixelCost, float scale)
+	{
+		return 1.0*Ms + pixelCost*scale*scale;
+	}
+
+	struct TraceResult
+	{
+		std::vector<float> Scales;
+		std::vector<double> GpuTimes;
+
+		// Scale changes in frames [first, last).
+		int Changes(size_t first, size_t last)const
+		{
+			int changes = 0;
+			for(size_t i = std::max(first, (size_t)1); i < last; ++i)
+			{
+				if(Scales[i] != Scales[i - 1])
+					changes++;
+			}
+			return changes;
+		}
+
+		// Times the direction of change reversed in frames [first, last).
+		int Reversals(size_t first, size_t last)const
+		{
+			int reversals = 0;
+			int lastDirection = 0;
+			for(size_t i = std::max(first, (size_t)1); i < last; ++i)
+			{
+				int direction = Scales[i] > Scales[i - 1] ? 1 : Scales[i] < Scales[i - 1] ? -1 : 0;
+				if(direction != 0)
+				{
+					if(lastDirection != 0 && direction != lastDirection)
+						reversals++;
+					lastDirection = direction;
+				}
+			}
+			return reversals;
+		}
+
+		// Largest GPU time in frames [first, last).
+		double MaxGpuTime(size_t first, size_t last)const
+		{
+			return *std::max_element(GpuTimes.begin() + first, GpuTimes.begin() + last);
+		}
+	};
+
+	// pixelCost(frame) is the full resolution pixel cost of the frame.
+	template<typename Trace>
+	TraceResult Run(DynamicResolution& controller, int frameCount, Trace pixelCost, double cpuTime = 5*Ms)
+	{
+		TraceResult result;
+		for(int i = 0; i < frameCount; ++i)
+		{
+			double gpu = GpuTime(pixelCost(i), controller.Scale());
+			result.GpuTimes.push_back(gpu);
+			result.Scales.push_back(controller.Update(gpu, cpuTime));
+		}
+		return result;
+	}
+
+	void TestLightLoadStaysAtFullScale()
+	{
+		DynamicResolution controller;
+		TraceResult r = Run(controller, 600, [](int) { return 10*Ms; });
+
+		CHECK(controller.Scale() == 1.0f);
+		CHECK(r.Changes(0, 600) == 0);
+	}
+
+	void TestStepConverges()
+	{
+		// The pixel cost jumps from well under the budget to 1.6 times it.
+		DynamicResolution controller;
+		TraceResult r = Run(controller, 1200, [](int i) { return i < 300 ? 10*Ms : 26*Ms; });
+
+		// Settles within two seconds of the step, near the budget and not over it by
+		// more than the deadband and a step of scale.
+		CHECK(controller.Scale() < 1.0f);
+		CHECK(r.MaxGpuTime(420, 1200) <= Budget*1.12);
+		CHECK(r.GpuTimes.back() >= Budget*0.85);
+
+		// Overshooting by a step at most, then staying put.
+		CHECK(r.Changes(420, 1200) == 0);
+		CHECK(r.Reversals(300, 1200) <= 1);
+
+		// And returns to full scale once the load drops again.
+		TraceResult back = Run(controller, 600, [](int) { return 10*Ms; });
+		CHECK(controller.Scale() == 1.0f);
+		CHECK(back.Reversals(0, 600) == 0);
+	}
+
+	void TestRampIsTracked()
+	{
+		// The pixel cost climbs from 10ms to 40ms over 20 seconds and falls back.
+		DynamicResolution controller;
+		auto ramp = [](int i)
+		{
+			double t = i < 1200 ? i / 1200.0 : std::max(0.0, 2.0 - i / 1200.0);
+			return (10.0 + 30.0*t)*Ms;
+		};
+		TraceResult r = Run(controller, 2400, ramp);
+
+		// The scale only goes down while the load rises, and only up while it falls.
+		CHECK(r.Reversals(0, 1200) == 0);
+		CHECK(r.Reversals(1320, 2400) == 0);
+
+		// Lagging the ramp by a little at most.
+		CHECK(r.MaxGpuTime(0, 2400) <= Budget*1.15);
+		CHECK(controller.Scale() == 1.0f);
+	}
+
+	void TestFastOscillationAveragesOut()
+	{
+		// The pixel cost swings 20% either way around 1.3 times the budget, faster than
+		// the smoothing follows.  Once settled the scale has to hold still.
+		for(int halfPeriod : { 1, 2, 5 })
+		{
+			DynamicResolution controller;
+			auto oscillating = [halfPeriod](int i) { return (i / halfPeriod) % 2 == 0 ? 26.0*Ms : 17.3*Ms; };
+			TraceResult r = Run(controller, 1800, oscillating);
+
+			CHECK(controller.Scale() < 1.0f);
+			CHECK(r.Changes(600, 1800) == 0);
+		}
+	}
+
+	void TestSlowOscillationIsFollowed()
+	{
+		// Half a second heavy, half a second light.  The scale follows, but turns around
+		// no more often than the load does.
+		DynamicResolution controller;
+		auto oscillating = [](int i) { return (i / 30) % 2 == 0 ? 26.0*Ms : 12.0*Ms; };
+		TraceResult r = Run(controller, 1800, oscillating);
+
+		int loadReversals = 1800 / 30 - 1;
+		CHECK(r.Reversals(0, 1800) <= loadReversals);
+
+		float lowest = *std::min_element(r.Scales.begin() + 600, r.Scales.end());
+		float highest = *std::max_element(r.Scales.begin() + 600, r.Scales.end());
+		CHECK(lowest < 0.85f);
+		CHECK(highest == 1.0f);
+	}
+
+	void TestCpuBoundHoldsScale()
+	{
+		// The CPU misses the budget on its own, so a lower resolution would not help.
+		DynamicResolution controller;
+		TraceResult r = Run(controller, 600, [](int) { return 20*Ms; }, 20*Ms);
+
+		CHECK(controller.Scale() == 1.0f);
+		CHECK(r.Changes(0, 600) == 0);
+		CHECK(controller.Stats().CpuBoundFrames > 0);
+	}
+
+	void TestScaleLimits()
+	{
+		DynamicResolution controller;
+		Run(controller, 1200, [](int) { return 200*Ms; });
+		CHECK(controller.Scale() == controller.Settings().MinScale);
+		CHECK(controller.ScaledSize(1920) == 960);
+		CHECK(controller.ScaledSize(1) == 1);
+
+		controller.Reset();
+		CHECK(controller.Scale() == controller.Settings().MaxScale);
+		CHECK(controller.Stats().ScaleDecreases == 0);
+	}
+}
+
+int main()
+{
+	const TestUtil::TestCase tests[] =
+	{
+		{ "LightLoadStaysAtFullScale", TestLightLoadStaysAtFullScale },
+		{ "StepConverges", TestStepConverges },
+		{ "RampIsTracked", TestRampIsTracked },
+		{ "FastOscillationAveragesOut", TestFastOscillationAveragesOut },
+		{ "SlowOscillationIsFollowed", TestSlowOscillationIsFollowed },
+		{ "CpuBoundHoldsScale", TestCpuBoundHoldsScale },
+		{ "ScaleLimits", TestScaleLimits },
+	};
+
+	return TestUtil::RunTests(tests);
+}
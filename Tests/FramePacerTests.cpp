@@ -0,0 +1,206 @@
+//***************************************************************************************
+// FramePacerTests.cpp
+//
+// Drives FramePacer with a simulated GPU timeline the way the apps drive it: frame
+// resources are cycled modulo FramesInFlight(), BeginFrame waits on the one about to be
+// reused, and the fence of each submitted frame goes to EndFrame.
+//***************************************************************************************
+
+#include "FramePacer.h"
+#include "SimulatedGpuTimeline.h"
+#include "TestUtil.h"
+#include <algorithm>
+#include <cstdint>
+
+namespace
+{
+	const int NumFrameResources = 4;
+	const double Ms = 0.001;
+
+	struct PacedLoop
+	{
+		SimulatedGpuTimeline Gpu;
+		FramePacer Pacer;
+
+		std::uint64_t FrameResourceFence[NumFrameResources] = {};
+		int FrameResourceIndex = 0;
+		std::uint64_t LastFence = 0;
+
+		// Frames that started with more frames still on the GPU than the pacer allows.
+		int OverrunFrames = 0;
+
+		explicit PacedLoop(int initialFramesInFlight) :
+			Pacer(&Gpu, NumFrameResources, initialFramesInFlight, Gpu.Clock())
+		{
+		}
+
+		void Frame(double cpuTime, double gpuTime)
+		{
+			FrameResourceIndex = (FrameResourceIndex + 1) % Pacer.FramesInFlight();
+			bool depthChanged = Pacer.BeginFrame(FrameResourceFence[FrameResourceIndex]);
+
+			// The frame being recorded counts as one of the frames in flight.  A new depth
+			// is decided after the wait, so it only has to hold from the next frame on.
+			if(!depthChanged && LastFence - Gpu.GetCompletedValue() >= (std::uint64_t)Pacer.FramesInFlight())
+				OverrunFrames++;
+
+			Gpu.CpuWork(cpuTime);
+			LastFence = Gpu.Submit(gpuTime);
+			FrameResourceFence[FrameResourceIndex] = LastFence;
+			Pacer.EndFrame(LastFence);
+		}
+
+		template<typename Load>
+		void Run(int frameCount, Load load)
+		{
+			for(int i = 0; i < frameCount; ++i)
+			{
+				double cpuTime, gpuTime;
+				load(i, cpuTime, gpuTime);
+				Frame(cpuTime, gpuTime);
+			}
+		}
+	};
+
+	// Small deterministic generator so runs repeat exactly.
+	struct Lcg
+	{
+		std::uint32_t State = 12345u;
+
+		double Next()
+		{
+			State = State*1664525u + 1013904223u;
+			return (State >> 8) / 16777216.0;
+		}
+	};
+
+	void TestSerializedFramesGainDepth()
+	{
+		// With one frame in flight the CPU and GPU take turns, each idle half the time.
+		PacedLoop loop(1);
+		loop.Run(600, [](int, double& cpu, double& gpu) { cpu = 10*Ms; gpu = 10*Ms; });
+
+		const FramePacingStats& stats = loop.Pacer.Stats();
+		CHECK(loop.Pacer.FramesInFlight() == 2);
+		CHECK(stats.DepthIncreases == 1);
+		CHECK(stats.DepthDecreases == 0);
+		CHECK(stats.CpuWait < 0.1*stats.FrameTime);
+		CHECK_NEAR(stats.FrameTime, 10*Ms, 0.01*Ms);
+		CHECK(loop.OverrunFrames == 0);
+	}
+
+	void TestGpuBoundLosesDepth()
+	{
+		// A saturated GPU gains nothing from frames queued up behind it.
+		PacedLoop loop(4);
+		loop.Run(1200, [](int, double& cpu, double& gpu) { cpu = 2*Ms; gpu = 16*Ms; });
+
+		const FramePacingStats& stats = loop.Pacer.Stats();
+		CHECK(loop.Pacer.FramesInFlight() == 1);
+		CHECK(stats.DepthIncreases == 0);
+		CHECK(stats.DepthDecreases == 3);
+		CHECK(loop.OverrunFrames == 0);
+
+		// Serialized: each frame is the CPU's 2ms followed by the GPU's 16ms, and the
+		// GPU time is measured exactly because every frame is waited on.
+		CHECK_NEAR(stats.FrameTime, 18*Ms, 0.01*Ms);
+		CHECK_NEAR(stats.CpuWait, 16*Ms, 0.01*Ms);
+		CHECK_NEAR(stats.GpuBusy, 16*Ms, 0.01*Ms);
+		CHECK_NEAR(loop.Pacer.LastGpuBusy(), 16*Ms, 0.01*Ms);
+	}
+
+	void TestCpuBoundKeepsDepth()
+	{
+		PacedLoop loop(3);
+		loop.Run(600, [](int, double& cpu, double& gpu) { cpu = 16*Ms; gpu = 4*Ms; });
+
+		const FramePacingStats& stats = loop.Pacer.Stats();
+		CHECK(loop.Pacer.FramesInFlight() == 3);
+		CHECK(stats.DepthIncreases == 0 && stats.DepthDecreases == 0);
+		CHECK(stats.StalledFrames == 0);
+		CHECK(stats.CpuWait == 0.0);
+
+		// Without GPU timestamps a frame that finished before it was looked at counts as
+		// finishing when it was seen, so GPU busy is only an upper bound here, limited by
+		// the frame time.
+		CHECK(stats.GpuBusy >= 4*Ms);
+		CHECK(stats.GpuBusy <= stats.FrameTime + 1e-9);
+	}
+
+	void TestFixedDepthWhenNotAdaptive()
+	{
+		PacedLoop loop(1);
+		loop.Pacer.SetAdaptive(false);
+		loop.Run(600, [](int, double& cpu, double& gpu) { cpu = 10*Ms; gpu = 10*Ms; });
+
+		CHECK(loop.Pacer.FramesInFlight() == 1);
+		CHECK(loop.Pacer.Stats().DepthIncreases == 0);
+		CHECK(loop.Pacer.Stats().StalledFrames == 599);
+
+		loop.Pacer.SetFramesInFlight(3);
+		CHECK(loop.Pacer.BeginFrame(loop.FrameResourceFence[0]));
+		CHECK(!loop.Pacer.BeginFrame(loop.FrameResourceFence[0]));
+		CHECK(loop.Pacer.FramesInFlight() == 3);
+	}
+
+	void TestOscillatingLoadStaysBounded()
+	{
+		// The GPU load swings between light and heavy every 90 frames, so the controller
+		// is pulled both ways.  The hold off has to stop it from following every swing.
+		PacedLoop loop(2);
+		int minDepth = loop.Pacer.FramesInFlight();
+		int maxDepth = minDepth;
+
+		for(int i = 0; i < 9000; ++i)
+		{
+			bool heavy = (i / 90) % 2 == 1;
+			loop.Frame(8*Ms, heavy ? 20*Ms : 6*Ms);
+
+			minDepth = std::min(minDepth, loop.Pacer.FramesInFlight());
+			maxDepth = std::max(maxDepth, loop.Pacer.FramesInFlight());
+		}
+
+		const FramePacingStats& stats = loop.Pacer.Stats();
+		CHECK(minDepth >= FramePacer::MinFramesInFlight);
+		CHECK(maxDepth <= NumFrameResources);
+		CHECK(loop.OverrunFrames == 0);
+
+		// 300 evaluation windows; without hysteresis the depth would change in about half.
+		CHECK(stats.DepthIncreases + stats.DepthDecreases <= 12);
+		CHECK(stats.DepthIncreases <= stats.DepthDecreases + 3);
+	}
+
+	void TestRandomLoadStaysInRange()
+	{
+		PacedLoop loop(3);
+		Lcg random;
+
+		for(int i = 0; i < 6000; ++i)
+		{
+			double cpu = (2.0 + 14.0*random.Next())*Ms;
+			double gpu = (2.0 + 14.0*random.Next())*Ms;
+			loop.Frame(cpu, gpu);
+
+			CHECK(loop.Pacer.FramesInFlight() >= FramePacer::MinFramesInFlight);
+			CHECK(loop.Pacer.FramesInFlight() <= NumFrameResources);
+		}
+
+		CHECK(loop.OverrunFrames == 0);
+		CHECK(loop.Pacer.Stats().TotalFrames == 6000);
+	}
+}
+
+int main()
+{
+	const TestUtil::TestCase tests[] =
+	{
+		{ "SerializedFramesGainDepth", TestSerializedFramesGainDepth },
+		{ "GpuBoundLosesDepth", TestGpuBoundLosesDepth },
+		{ "CpuBoundKeepsDepth", TestCpuBoundKeepsDepth },
+		{ "FixedDepthWhenNotAdaptive", TestFixedDepthWhenNotAdaptive },
+		{ "OscillatingLoadStaysBounded", TestOscillatingLoadStaysBounded },
+		{ "RandomLoadStaysInRange", TestRandomLoadStaysInRange },
+	};
+
+	return TestUtil::RunTests(tests);
+}
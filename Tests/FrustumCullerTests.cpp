@@ -0,0 +1,172 @@
+//***************************************************************************************
+// FrustumCullerTests.cpp
+//
+// The planes taken from a view-projection matrix, the spheres culled with them against
+// a view space test of the same camera, and the vector path against the reference.
+//***************************************************************************************
+
+#include "FrustumCuller.h"
+#include "TestUtil.h"
+#include "ViewSpaceFrustum.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	float RandomFloat(float lo, float hi)
+	{
+		return lo + (hi - lo)*((float)std::rand() / RAND_MAX);
+	}
+
+	ViewSpaceFrustum TestCamera()
+	{
+		ViewSpaceFrustum frustum;
+		XMStoreFloat4x4(&frustum.View, XMMatrixLookAtLH(XMVectorSet(10.0f, 20.0f, -60.0f, 1.0f),
+			XMVectorSet(0.0f, 5.0f, 0.0f, 1.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f)));
+		frustum.Aspect = 16.0f / 9.0f;
+		frustum.FarZ = 200.0f;
+		return frustum;
+	}
+
+	void TestPlanesPointInwards()
+	{
+		ViewSpaceFrustum frustum = TestCamera();
+
+		XMFLOAT4 planes[6];
+		FrustumCuller::ExtractPlanes(frustum.ViewProj(), planes);
+
+		for(const XMFLOAT4& plane : planes)
+			CHECK_NEAR(std::sqrt(plane.x*plane.x + plane.y*plane.y + plane.z*plane.z), 1.0, 1e-5);
+
+		// Points on the view axis, in world space.
+		XMMATRIX invView = XMMatrixInverse(nullptr, XMLoadFloat4x4(&frustum.View));
+		auto onAxis = [&](float depth)
+		{
+			XMFLOAT3 p;
+			XMStoreFloat3(&p, XMVector3TransformCoord(XMVectorSet(0.0f, 0.0f, depth, 1.0f), invView));
+			return p;
+		};
+		auto distance = [](const XMFLOAT4& plane, const XMFLOAT3& p)
+		{
+			return plane.x*p.x + plane.y*p.y + plane.z*p.z + plane.w;
+		};
+
+		// A point halfway in is inside every plane, and its distance to the near and far
+		// planes is its depth from them.
+		XMFLOAT3 middle = onAxis(50.0f);
+		for(const XMFLOAT4& plane : planes)
+			CHECK(distance(plane, middle) > 0.0f);
+		CHECK_NEAR(distance(planes[4], middle), 50.0 - frustum.NearZ, 1e-3);
+		CHECK_NEAR(distance(planes[5], middle), frustum.FarZ - 50.0, 1e-3);
+
+		CHECK(distance(planes[4], onAxis(0.5f)) < 0.0f);
+		CHECK(distance(planes[5], onAxis(250.0f)) < 0.0f);
+
+		// Left, right, bottom and top, in that order.
+		XMFLOAT3 p;
+		XMStoreFloat3(&p, XMVector3TransformCoord(XMVectorSet(-100.0f, 0.0f, 50.0f, 1.0f), invView));
+		CHECK(distance(planes[0], p) < 0.0f && distance(planes[1], p) > 0.0f);
+		XMStoreFloat3(&p, XMVector3TransformCoord(XMVectorSet(100.0f, 0.0f, 50.0f, 1.0f), invView));
+		CHECK(distance(planes[0], p) > 0.0f && distance(planes[1], p) < 0.0f);
+		XMStoreFloat3(&p, XMVector3TransformCoord(XMVectorSet(0.0f, -100.0f, 50.0f, 1.0f), invView));
+		CHECK(distance(planes[2], p) < 0.0f && distance(planes[3], p) > 0.0f);
+		XMStoreFloat3(&p, XMVector3TransformCoord(XMVectorSet(0.0f, 100.0f, 50.0f, 1.0f), invView));
+		CHECK(distance(planes[2], p) > 0.0f && distance(planes[3], p) < 0.0f);
+	}
+
+	void TestCullMatchesViewSpace()
+	{
+		ViewSpaceFrustum frustum = TestCamera();
+
+		std::srand(2);
+
+		FrustumCuller culler;
+		std::vector<float> margins;
+		for(int i = 0; i < 2000; ++i)
+		{
+			BoundingSphere sphere;
+			sphere.Center = XMFLOAT3(RandomFloat(-150.0f, 150.0f), RandomFloat(-60.0f, 80.0f),
+				RandomFloat(-100.0f, 200.0f));
+			sphere.Radius = RandomFloat(0.0f, 10.0f);
+			culler.Add(sphere);
+			margins.push_back(frustum.Margin(sphere));
+		}
+
+		std::vector<std::uint32_t> visible;
+		culler.Cull(frustum.ViewProj(), visible);
+
+		std::vector<bool> culledIn(margins.size(), false);
+		for(std::uint32_t i : visible)
+			culledIn[i] = true;
+
+		// Spheres that only just touch a plane can go either way with rounding.
+		int inCount = 0, outCount = 0;
+		for(size_t i = 0; i < margins.size(); ++i)
+		{
+			if(std::fabs(margins[i]) < 1e-3f)
+				continue;
+
+			bool expected = margins[i] > 0.0f;
+			CHECK(culledIn[i] == expected);
+			(expected ? inCount : outCount)++;
+		}
+		CHECK(inCount > 100 && outCount > 100);
+	}
+
+	void TestCullMatchesReference()
+	{
+		ViewSpaceFrustum frustum = TestCamera();
+		XMMATRIX viewProj = frustum.ViewProj();
+
+		std::srand(3);
+
+		// Counts on either side of a multiple of four, so the padding lanes are covered.
+		FrustumCuller culler;
+		for(std::uint32_t count : { 0u, 1u, 3u, 4u, 5u, 37u, 1001u })
+		{
+			culler.Clear();
+			for(std::uint32_t i = 0; i < count; ++i)
+			{
+				BoundingSphere sphere;
+				sphere.Center = XMFLOAT3(RandomFloat(-150.0f, 150.0f), RandomFloat(-60.0f, 80.0f),
+					RandomFloat(-100.0f, 200.0f));
+				sphere.Radius = RandomFloat(0.0f, 10.0f);
+				CHECK(culler.Add(sphere) == i);
+			}
+			CHECK(culler.Count() == count);
+
+			for(std::uint32_t i = 0; i < count; i += 3)
+			{
+				BoundingSphere sphere;
+				sphere.Center = XMFLOAT3(RandomFloat(-20.0f, 20.0f), 5.0f, 0.0f);
+				sphere.Radius = 1.0f;
+				culler.Set(i, sphere);
+			}
+
+			std::vector<std::uint32_t> fast, reference;
+			culler.Cull(viewProj, fast);
+			culler.CullReference(viewProj, reference);
+			CHECK(fast == reference);
+
+			// Moved into the middle of the view, so they are all in.
+			for(std::uint32_t i = 0; i < count; i += 3)
+				CHECK(std::find(fast.begin(), fast.end(), i) != fast.end());
+		}
+	}
+}
+
+int main()
+{
+	const TestUtil::TestCase tests[] =
+	{
+		{ "PlanesPointInwards", TestPlanesPointInwards },
+		{ "CullMatchesViewSpace", TestCullMatchesViewSpace },
+		{ "CullMatchesReference", TestCullMatchesReference },
+	};
+
+	return TestUtil::RunTests(tests);
+}
@@ -0,0 +1,304 @@
+//***************************************************************************************
+// GeometryGeneratorTests.cpp
+//
+// Spheres, cylinders and cones built as surfaces of revolution, against the ring by
+// ring builders they replaced.  The vertices come out in a different order, so meshes
+// are compared as the set of triangles over matching vertices.
+//***************************************************************************************
+
+#include "GeometryGenerator.h"
+#include "TestUtil.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	using MeshData = GeometryGenerator::MeshData;
+	using Vertex = GeometryGenerator::Vertex;
+	using uint32 = GeometryGenerator::uint32;
+
+	// Largest difference in any attribute between matching vertices.
+	const float AttributeTolerance = 1.2e-7f;
+
+	// CreateSphere as it was, from the top pole down.
+	MeshData ReferenceSphere(float radius, uint32 sliceCount, uint32 stackCount)
+	{
+		MeshData meshData;
+
+		meshData.Vertices.push_back(Vertex(0.0f, +radius, 0.0f, 0.0f, +1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f));
+
+		float phiStep = XM_PI/stackCount;
+		float thetaStep = 2.0f*XM_PI/sliceCount;
+
+		for(uint32 i = 1; i <= stackCount-1; ++i)
+		{
+			float phi = i*phiStep;
+
+			for(uint32 j = 0; j <= sliceCount; ++j)
+			{
+				float theta = j*thetaStep;
+
+				Vertex v;
+
+				v.Position.x = radius*sinf(phi)*cosf(theta);
+				v.Position.y = radius*cosf(phi);
+				v.Position.z = radius*sinf(phi)*sinf(theta);
+
+				v.TangentU.x = -radius*sinf(phi)*sinf(theta);
+				v.TangentU.y = 0.0f;
+				v.TangentU.z = +radius*sinf(phi)*cosf(theta);
+
+				XMVECTOR T = XMLoadFloat3(&v.TangentU);
+				XMStoreFloat3(&v.TangentU, XMVector3Normalize(T));
+
+				XMVECTOR p = XMLoadFloat3(&v.Position);
+				XMStoreFloat3(&v.Normal, XMVector3Normalize(p));
+
+				v.TexC.x = theta / XM_2PI;
+				v.TexC.y = phi / XM_PI;
+
+				meshData.Vertices.push_back(v);
+			}
+		}
+
+		meshData.Vertices.push_back(Vertex(0.0f, -radius, 0.0f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f));
+
+		for(uint32 i = 1; i <= sliceCount; ++i)
+		{
+			meshData.Indices32.push_back(0);
+			meshData.Indices32.push_back(i+1);
+			meshData.Indices32.push_back(i);
+		}
+
+		uint32 baseIndex = 1;
+		uint32 ringVertexCount = sliceCount + 1;
+		for(uint32 i = 0; i < stackCount-2; ++i)
+		{
+			for(uint32 j = 0; j < sliceCount; ++j)
+			{
+				meshData.Indices32.push_back(baseIndex + i*ringVertexCount + j);
+				meshData.Indices32.push_back(baseIndex + i*ringVertexCount + j+1);
+				meshData.Indices32.push_back(baseIndex + (i+1)*ringVertexCount + j);
+
+				meshData.Indices32.push_back(baseIndex + (i+1)*ringVertexCount + j);
+				meshData.Indices32.push_back(baseIndex + i*ringVertexCount + j+1);
+				meshData.Indices32.push_back(baseIndex + (i+1)*ringVertexCount + j+1);
+			}
+		}
+
+		uint32 southPoleIndex = (uint32)meshData.Vertices.size()-1;
+		baseIndex = southPoleIndex - ringVertexCount;
+
+		for(uint32 i = 0; i < sliceCount; ++i)
+		{
+			meshData.Indices32.push_back(southPoleIndex);
+			meshData.Indices32.push_back(baseIndex+i);
+			meshData.Indices32.push_back(baseIndex+i+1);
+		}
+
+		return meshData;
+	}
+
+	// A cap of CreateCylinder as it was: a ring around a center vertex, facing up or down.
+	void AppendReferenceCap(float radius, float y, float height, uint32 sliceCount, bool top, MeshData& meshData)
+	{
+		uint32 baseIndex = (uint32)meshData.Vertices.size();
+		float ny = top ? 1.0f : -1.0f;
+		float dTheta = 2.0f*XM_PI/sliceCount;
+
+		for(uint32 i = 0; i <= sliceCount; ++i)
+		{
+			float x = radius*cosf(i*dTheta);
+			float z = radius*sinf(i*dTheta);
+
+			float u = x/height + 0.5f;
+			float v = z/height + 0.5f;
+
+			meshData.Vertices.push_back(Vertex(x, y, z, 0.0f, ny, 0.0f, 1.0f, 0.0f, 0.0f, u, v));
+		}
+
+		meshData.Vertices.push_back(Vertex(0.0f, y, 0.0f, 0.0f, ny, 0.0f, 1.0f, 0.0f, 0.0f, 0.5f, 0.5f));
+
+		uint32 centerIndex = (uint32)meshData.Vertices.size()-1;
+
+		for(uint32 i = 0; i < sliceCount; ++i)
+		{
+			meshData.Indices32.push_back(centerIndex);
+			meshData.Indices32.push_back(top ? baseIndex + i+1 : baseIndex + i);
+			meshData.Indices32.push_back(top ? baseIndex + i : baseIndex + i+1);
+		}
+	}
+
+	// CreateCylinder as it was, which CreateCone also was line for line.
+	MeshData ReferenceCylinder(float bottomRadius, float topRadius, float height, uint32 sliceCount, uint32 stackCount)
+	{
+		MeshData meshData;
+
+		float stackHeight = height / stackCount;
+		float radiusStep = (topRadius - bottomRadius) / stackCount;
+
+		uint32 ringCount = stackCount+1;
+
+		for(uint32 i = 0; i < ringCount; ++i)
+		{
+			float y = -0.5f*height + i*stackHeight;
+			float r = bottomRadius + i*radiusStep;
+
+			float dTheta = 2.0f*XM_PI/sliceCount;
+			for(uint32 j = 0; j <= sliceCount; ++j)
+			{
+				Vertex vertex;
+
+				float c = cosf(j*dTheta);
+				float s = sinf(j*dTheta);
+
+				vertex.Position = XMFLOAT3(r*c, y, r*s);
+
+				vertex.TexC.x = (float)j/sliceCount;
+				vertex.TexC.y = 1.0f - (float)i/stackCount;
+
+				vertex.TangentU = XMFLOAT3(-s, 0.0f, c);
+
+				float dr = bottomRadius-topRadius;
+				XMFLOAT3 bitangent(dr*c, -height, dr*s);
+
+				XMVECTOR T = XMLoadFloat3(&vertex.TangentU);
+				XMVECTOR B = XMLoadFloat3(&bitangent);
+				XMVECTOR N = XMVector3Normalize(XMVector3Cross(T, B));
+				XMStoreFloat3(&vertex.Normal, N);
+
+				meshData.Vertices.push_back(vertex);
+			}
+		}
+
+		uint32 ringVertexCount = sliceCount+1;
+
+		for(uint32 i = 0; i < stackCount; ++i)
+		{
+			for(uint32 j = 0; j < sliceCount; ++j)
+			{
+				meshData.Indices32.push_back(i*ringVertexCount + j);
+				meshData.Indices32.push_back((i+1)*ringVertexCount + j);
+				meshData.Indices32.push_back((i+1)*ringVertexCount + j+1);
+
+				meshData.Indices32.push_back(i*ringVertexCount + j);
+				meshData.Indices32.push_back((i+1)*ringVertexCount + j+1);
+				meshData.Indices32.push_back(i*ringVertexCount + j+1);
+			}
+		}
+
+		AppendReferenceCap(topRadius, 0.5f*height, height, sliceCount, true, meshData);
+		AppendReferenceCap(bottomRadius, -0.5f*height, height, sliceCount, false, meshData);
+
+		return meshData;
+	}
+
+	float Difference(const Vertex& a, const Vertex& b)
+	{
+		const float lhs[] = { a.Position.x, a.Position.y, a.Position.z, a.Normal.x, a.Normal.y, a.Normal.z,
+			a.TangentU.x, a.TangentU.y, a.TangentU.z, a.TexC.x, a.TexC.y };
+		const float rhs[] = { b.Position.x, b.Position.y, b.Position.z, b.Normal.x, b.Normal.y, b.Normal.z,
+			b.TangentU.x, b.TangentU.y, b.TangentU.z, b.TexC.x, b.TexC.y };
+
+		float difference = 0.0f;
+		for(int i = 0; i < 11; ++i)
+			difference = std::max(difference, std::fabs(lhs[i] - rhs[i]));
+		return difference;
+	}
+
+	// The first reference vertex within the tolerance of v, or the vertex count if there
+	// is none.  Vertices that are the same, such as the ring of a cap of radius 0, all
+	// match the first of them.
+	uint32 MatchingVertex(const Vertex& v, const MeshData& reference)
+	{
+		for(uint32 i = 0; i < (uint32)reference.Vertices.size(); ++i)
+		{
+			if(Difference(v, reference.Vertices[i]) <= AttributeTolerance)
+				return i;
+		}
+		return (uint32)reference.Vertices.size();
+	}
+
+	// The triangles over the matching reference vertices, each turned to start at its
+	// smallest index so the winding is kept, sorted.
+	std::vector<std::array<uint32, 3>> Triangles(const MeshData& mesh, const MeshData& reference)
+	{
+		std::vector<uint32> match(mesh.Vertices.size());
+		for(size_t i = 0; i < mesh.Vertices.size(); ++i)
+			match[i] = MatchingVertex(mesh.Vertices[i], reference);
+
+		std::vector<std::array<uint32, 3>> triangles;
+		for(size_t i = 0; i + 2 < mesh.Indices32.size(); i += 3)
+		{
+			std::array<uint32, 3> t = { match[mesh.Indices32[i]], match[mesh.Indices32[i + 1]],
+				match[mesh.Indices32[i + 2]] };
+			std::rotate(t.begin(), std::min_element(t.begin(), t.end()), t.end());
+			triangles.push_back(t);
+		}
+
+		std::sort(triangles.begin(), triangles.end());
+		return triangles;
+	}
+
+	void CheckMatchesReference(const MeshData& mesh, const MeshData& reference)
+	{
+		CHECK(mesh.Vertices.size() == reference.Vertices.size());
+		CHECK(mesh.Indices32.size() == reference.Indices32.size());
+
+		uint32 unmatched = 0;
+		for(const Vertex& v : mesh.Vertices)
+		{
+			if(MatchingVertex(v, reference) == (uint32)reference.Vertices.size())
+				++unmatched;
+		}
+		CHECK(unmatched == 0);
+
+		CHECK(Triangles(mesh, reference) == Triangles(reference, reference));
+	}
+
+	void TestSphereMatchesReference()
+	{
+		GeometryGenerator geoGen;
+
+		CheckMatchesReference(geoGen.CreateSphere(2.0f, 20, 20), ReferenceSphere(2.0f, 20, 20));
+		CheckMatchesReference(geoGen.CreateSphere(0.5f, 40, 30), ReferenceSphere(0.5f, 40, 30));
+
+		// Two stacks: the poles and a single ring.
+		CheckMatchesReference(geoGen.CreateSphere(1.0f, 3, 2), ReferenceSphere(1.0f, 3, 2));
+	}
+
+	void TestCylinderMatchesReference()
+	{
+		GeometryGenerator geoGen;
+
+		CheckMatchesReference(geoGen.CreateCylinder(8.0f, 8.0f, 40.0f, 20, 20), ReferenceCylinder(8.0f, 8.0f, 40.0f, 20, 20));
+		CheckMatchesReference(geoGen.CreateCylinder(1.0f, 2.0f, 3.0f, 60, 30), ReferenceCylinder(1.0f, 2.0f, 3.0f, 60, 30));
+	}
+
+	void TestConeMatchesReference()
+	{
+		GeometryGenerator geoGen;
+
+		CheckMatchesReference(geoGen.CreateCone(3.0f, 1.0f, 5.0f, 13, 7), ReferenceCylinder(3.0f, 1.0f, 5.0f, 13, 7));
+
+		// A point at the top: the top ring and cap collapse onto the apex.
+		CheckMatchesReference(geoGen.CreateCone(8.0f, 0.0f, 40.0f, 20, 20), ReferenceCylinder(8.0f, 0.0f, 40.0f, 20, 20));
+		CheckMatchesReference(geoGen.CreateCylinder(8.0f, 0.0f, 40.0f, 20, 20), ReferenceCylinder(8.0f, 0.0f, 40.0f, 20, 20));
+	}
+}
+
+int main()
+{
+	const TestUtil::TestCase tests[] =
+	{
+		{ "SphereMatchesReference", TestSphereMatchesReference },
+		{ "CylinderMatchesReference", TestCylinderMatchesReference },
+		{ "ConeMatchesReference", TestConeMatchesReference },
+	};
+
+	return TestUtil::RunTests(tests);
+}
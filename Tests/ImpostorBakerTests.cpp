@@ -0,0 +1,257 @@
+//***************************************************************************************
+// ImpostorBakerTests.cpp
+//
+// The baker as Tools/ImpostorBake uses it: diffuse maps decoded from DDS files and
+// sampled into the atlas, frame lookup, and the file the app reads the atlases from.
+//***************************************************************************************
+
+#include "ImpostorBaker.h"
+#include "ReferenceRenderer.h"
+#include "TestUtil.h"
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// A BC1 DDS file of 4x4 blocks side by side, each eight bytes as in the file.
+	bool WriteBc1(const char* path, const std::vector<std::uint64_t>& blocks)
+	{
+		std::uint8_t header[128] = {};
+		auto put = [&](std::size_t offset, std::uint32_t value)
+		{
+			for(int i = 0; i < 4; ++i)
+				header[offset + i] = std::uint8_t(value >> (8*i));
+		};
+
+		std::memcpy(header, "DDS ", 4);
+		put(4, 124);
+		put(8, 0x1007 | 0x80000);
+		put(12, 4);
+		put(16, 4*(std::uint32_t)blocks.size());
+		put(20, 8*(std::uint32_t)blocks.size());
+		put(28, 1);
+		put(76, 32);
+		put(80, 0x4);
+		std::memcpy(header + 84, "DXT1", 4);
+
+		std::ofstream file(path, std::ios::binary);
+		file.write(reinterpret_cast<const char*>(header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(blocks.data()), blocks.size()*8);
+		return bool(file);
+	}
+
+	// Endpoints c0 and c1 in RGB565, then two bits per texel.
+	std::uint64_t Bc1Block(std::uint16_t c0, std::uint16_t c1, std::uint32_t indices)
+	{
+		return std::uint64_t(c0) | (std::uint64_t(c1) << 16) | (std::uint64_t(indices) << 32);
+	}
+
+	std::uint32_t Rgba(std::uint32_t r, std::uint32_t g, std::uint32_t b, std::uint32_t a)
+	{
+		return r | (g << 8) | (b << 16) | (a << 24);
+	}
+
+	// A square facing dir across the middle of the frame baked from dir.  Texture u runs
+	// along the frame's right axis.
+	struct Square
+	{
+		struct Vertex
+		{
+			XMFLOAT3 Pos;
+			XMFLOAT3 Normal;
+			XMFLOAT2 TexC;
+		};
+
+		std::vector<Vertex> Vertices;
+		std::vector<std::uint16_t> Indices = { 0, 1, 2, 0, 2, 3 };
+
+		explicit Square(const XMFLOAT3& dir)
+		{
+			XMFLOAT3 right, up;
+			ImpostorBaker::FrameBasis(dir, right, up);
+
+			const float corners[4][2] = { { -1.0f, -1.0f }, { -1.0f, 1.0f }, { 1.0f, 1.0f }, { 1.0f, -1.0f } };
+			for(const auto& c : corners)
+			{
+				Vertex v;
+				XMStoreFloat3(&v.Pos, XMVectorAdd(XMVectorScale(XMLoadFloat3(&right), c[0]), XMVectorScale(XMLoadFloat3(&up), c[1])));
+				v.Normal = dir;
+				v.TexC = XMFLOAT2(0.5f + 0.5f*c[0], 0.5f - 0.5f*c[1]);
+				Vertices.push_back(v);
+			}
+		}
+
+		ImpostorMesh Mesh()const
+		{
+			ImpostorMesh mesh;
+			mesh.Vertices = Vertices.data();
+			mesh.VertexStride = sizeof(Vertex);
+			mesh.VertexCount = (std::uint32_t)Vertices.size();
+			mesh.Indices = Indices.data();
+			mesh.IndexCount = (std::uint32_t)Indices.size();
+			return mesh;
+		}
+	};
+
+	void TestFrameLookup()
+	{
+		const std::uint32_t framesPerSide = 8;
+		for(std::uint32_t y = 0; y < framesPerSide; ++y)
+		{
+			for(std::uint32_t x = 0; x < framesPerSide; ++x)
+			{
+				XMFLOAT3 dir = ImpostorBaker::FrameDirection(x, y, framesPerSide);
+				CHECK_NEAR(XMVectorGetX(XMVector3Length(XMLoadFloat3(&dir))), 1.0, 1e-5);
+
+				std::uint32_t nx, ny;
+				ImpostorBaker::NearestFrame(dir, framesPerSide, nx, ny);
+				CHECK(nx == x && ny == y);
+
+				XMFLOAT2 uv = ImpostorBaker::OctahedralEncode(dir);
+				XMFLOAT3 back = ImpostorBaker::OctahedralDecode(uv);
+				CHECK_NEAR(back.x, dir.x, 1e-5);
+				CHECK_NEAR(back.y, dir.y, 1e-5);
+				CHECK_NEAR(back.z, dir.z, 1e-5);
+			}
+		}
+	}
+
+	void TestBc1Decode()
+	{
+		// Four colour mode with every index, then three colour mode with its transparent texel.
+		std::vector<std::uint64_t> blocks =
+		{
+			Bc1Block(0xf800, 0x001f, 0xe4e4e4e4),
+			Bc1Block(0x001f, 0xf800, 0xe4e4e4e4)
+		};
+		CHECK(WriteBc1("ImpostorBakerTests.dds", blocks));
+
+		ReferenceImage image;
+		CHECK(ReferenceRenderer::ReadDds("ImpostorBakerTests.dds", image));
+		CHECK(image.Width == 8 && image.Height == 4);
+		if(image.Pixels.size() != 32)
+			return;
+
+		const std::uint32_t fourColors[4] =
+		{
+			Rgba(255, 0, 0, 255), Rgba(0, 0, 255, 255), Rgba(170, 0, 85, 255), Rgba(85, 0, 170, 255)
+		};
+		const std::uint32_t threeColors[4] =
+		{
+			Rgba(0, 0, 255, 255), Rgba(255, 0, 0, 255), Rgba(127, 0, 127, 255), Rgba(0, 0, 0, 0)
+		};
+
+		for(std::uint32_t y = 0; y < 4; ++y)
+		{
+			for(std::uint32_t x = 0; x < 4; ++x)
+			{
+				CHECK(image.Pixels[y*8 + x] == fourColors[x]);
+				CHECK(image.Pixels[y*8 + 4 + x] == threeColors[x]);
+			}
+		}
+	}
+
+	void TestAlbedoIsSampledFromTheDiffuseMap()
+	{
+		// Red on the left half of the texture, green on the right.
+		CHECK(WriteBc1("ImpostorBakerTests.dds", { Bc1Block(0xf800, 0xf800, 0), Bc1Block(0x07e0, 0x07e0, 0) }));
+
+		ReferenceImage diffuseMap;
+		CHECK(ReferenceRenderer::ReadDds("ImpostorBakerTests.dds", diffuseMap));
+
+		ImpostorBakeSettings settings;
+		ImpostorBaker baker(settings);
+
+		// A frame well away from the poles and the folds of the map.
+		const std::uint32_t frameX = 5, frameY = 2;
+		XMFLOAT3 dir = ImpostorBaker::FrameDirection(frameX, frameY, settings.FramesPerSide);
+		Square square(dir);
+
+		ImpostorAtlas atlas;
+		baker.Bake(square.Mesh(), XMMatrixIdentity(),
+			[&](const XMFLOAT2& texC) { return ReferenceRenderer::Sample(diffuseMap, texC); }, atlas);
+
+		CHECK(atlas.Width == settings.FramesPerSide*settings.FrameSize);
+		CHECK_NEAR(atlas.Radius, 1.41421356, 1e-4);
+
+		// The square covers the middle 1/sqrt(2) of the frame.
+		const std::uint32_t size = settings.FrameSize;
+		auto texel = [&](const std::vector<std::uint32_t>& channel, std::uint32_t x, std::uint32_t y)
+		{
+			return channel[(std::size_t)(frameY*size + y)*atlas.Width + frameX*size + x];
+		};
+
+		std::uint32_t middle = size / 2;
+		CHECK(texel(atlas.Albedo, size / 4, middle) == Rgba(255, 0, 0, 255));
+		CHECK(texel(atlas.Albedo, 3*size / 4, middle) == Rgba(0, 255, 0, 255));
+		CHECK(texel(atlas.Albedo, 1, middle) >> 24 == 0);
+		CHECK(texel(atlas.Albedo, middle, size - 2) >> 24 == 0);
+
+		// Normals are stored as n*0.5 + 0.5.
+		std::uint32_t n = texel(atlas.Normal, middle, middle);
+		CHECK_NEAR((n & 0xff) / 255.0, dir.x*0.5 + 0.5, 1.0 / 255.0);
+		CHECK_NEAR(((n >> 8) & 0xff) / 255.0, dir.y*0.5 + 0.5, 1.0 / 255.0);
+		CHECK_NEAR(((n >> 16) & 0xff) / 255.0, dir.z*0.5 + 0.5, 1.0 / 255.0);
+
+	}
+
+	void TestFileRoundTrip()
+	{
+		ImpostorBakeSettings settings;
+		settings.FramesPerSide = 4;
+		settings.FrameSize = 16;
+		ImpostorBaker baker(settings);
+
+		std::vector<ImpostorFileEntry> entries(2);
+		for(std::size_t i = 0; i < entries.size(); ++i)
+		{
+			Square square(XMFLOAT3(0.0f, 0.0f, 1.0f));
+			XMMATRIX transform = XMMatrixScaling(1.0f + i, 2.0f, 1.0f);
+
+			entries[i].Geometry = i == 0 ? "boxGeo" : "coneGeo";
+			entries[i].Material = "bricks";
+			XMStoreFloat4x4(&entries[i].Transform, transform);
+			baker.Bake(square.Mesh(), transform, [](const XMFLOAT2& texC) { return XMFLOAT4(texC.x, texC.y, 0.5f, 1.0f); },
+				entries[i].Atlas);
+		}
+
+		CHECK(ImpostorBaker::WriteFile("ImpostorBakerTests.bin", entries));
+
+		std::vector<ImpostorFileEntry> read;
+		CHECK(ImpostorBaker::ReadFile("ImpostorBakerTests.bin", read));
+		CHECK(read.size() == entries.size());
+
+		for(std::size_t i = 0; i < read.size() && i < entries.size(); ++i)
+		{
+			CHECK(read[i].Geometry == entries[i].Geometry);
+			CHECK(read[i].Material == entries[i].Material);
+			CHECK(std::memcmp(&read[i].Transform, &entries[i].Transform, sizeof(XMFLOAT4X4)) == 0);
+			CHECK(read[i].Atlas.FramesPerSide == entries[i].Atlas.FramesPerSide);
+			CHECK(read[i].Atlas.FrameSize == entries[i].Atlas.FrameSize);
+			CHECK(read[i].Atlas.Radius == entries[i].Atlas.Radius);
+			CHECK(read[i].Atlas.Albedo == entries[i].Atlas.Albedo);
+			CHECK(read[i].Atlas.Normal == entries[i].Atlas.Normal);
+		}
+
+		// Anything else is refused.
+		CHECK(!ImpostorBaker::ReadFile("ImpostorBakerTests.dds", read));
+		CHECK(!ImpostorBaker::ReadFile("ImpostorBakerTests.missing", read));
+	}
+}
+
+int main()
+{
+	const TestUtil::TestCase tests[] =
+	{
+		{ "FrameLookup", TestFrameLookup },
+		{ "Bc1Decode", TestBc1Decode },
+		{ "AlbedoIsSampledFromTheDiffuseMap", TestAlbedoIsSampledFromTheDiffuseMap },
+		{ "FileRoundTrip", TestFileRoundTrip },
+	};
+
+	return TestUtil::RunTests(tests);
+}
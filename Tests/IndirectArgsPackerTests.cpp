@@ -0,0 +1,311 @@
+//***************************************************************************************
+// IndirectArgsPackerTests.cpp
+//
+// Packing against the field by field reference, and the commands of a culled scene
+// against the draws DrawRenderItems would make for it.
+//***************************************************************************************
+
+#include "IndirectArgsPacker.h"
+#include "IndirectDrawCommand.h"
+#include "FrustumCuller.h"
+#include "TestUtil.h"
+#include "ViewSpaceFrustum.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	const std::uint32_t MatCBByteSize = 256;
+
+	struct Lcg
+	{
+		std::uint32_t State = 7u;
+
+		std::uint32_t Next()
+		{
+			State = State*1664525u + 1013904223u;
+			return State;
+		}
+	};
+
+	void FillRandom(IndirectArgsPacker& packer, std::uint32_t count, Lcg& random)
+	{
+		packer.Resize(count);
+
+		std::vector<std::uint32_t> words(packer.CommandByteSize() / 4);
+		for(std::uint32_t i = 0; i < count; ++i)
+		{
+			for(std::uint32_t& w : words)
+				w = random.Next();
+			packer.Set(i, words.data());
+		}
+	}
+
+	void TestPackMatchesReference()
+	{
+		Lcg random;
+
+		for(std::uint32_t commandByteSize : { 16u, 48u, 80u })
+		{
+			IndirectArgsPacker packer(commandByteSize);
+			FillRandom(packer, 37, random);
+
+			// Repeats, skips and a destination that is only 4 byte aligned.
+			std::vector<std::uint32_t> order;
+			for(int i = 0; i < 100; ++i)
+				order.push_back(random.Next() % packer.Count());
+
+			std::uint64_t base = 0x00000001fffff000ull;
+			std::vector<std::uint32_t> packed(order.size()*commandByteSize / 4 + 1, 0u);
+			std::vector<std::uint32_t> reference(packed.size(), 0u);
+
+			packer.Pack(order.data(), (std::uint32_t)order.size(), base, packed.data() + 1);
+			packer.PackReference(order.data(), (std::uint32_t)order.size(), base, reference.data() + 1);
+
+			CHECK(packed == reference);
+			CHECK(packed[0] == 0u);
+		}
+	}
+
+	void TestAddressRelocation()
+	{
+		IndirectArgsPacker packer(sizeof(IndirectDrawCommand));
+		packer.Resize(2);
+
+		IndirectDrawCommand cmd = {};
+		cmd.MaterialCBAddress = 3*MatCBByteSize;
+		cmd.VertexBufferView.BufferLocation = 0x1000;
+		cmd.IndexBufferView.BufferLocation = 0x2000;
+		packer.Set(0, &cmd);
+		cmd.MaterialCBAddress = 0x00ffffffull*MatCBByteSize;
+		packer.Set(1, &cmd);
+
+		// The second address carries into the upper 32 bits.
+		const std::uint64_t base = 0x0000000500000000ull + 0xff000000ull;
+		const std::uint32_t order[] = { 1, 0 };
+		IndirectDrawCommand packed[2];
+		packer.Pack(order, 2, base, packed);
+
+		CHECK(packed[0].MaterialCBAddress == base + 0x00ffffffull*MatCBByteSize);
+		CHECK(packed[1].MaterialCBAddress == base + 3*MatCBByteSize);
+		CHECK(packed[0].VertexBufferView.BufferLocation == 0x1000 && packed[1].IndexBufferView.BufferLocation == 0x2000);
+
+		// The stored commands keep their relative addresses.
+		const IndirectDrawCommand* stored = static_cast<const IndirectDrawCommand*>(packer.Command(0));
+		CHECK(stored->MaterialCBAddress == 3*MatCBByteSize);
+	}
+
+	// The parts of a render item its draw is made from.  ObjCBIndex is its index.
+	struct SceneItem
+	{
+		BoundingSphere Bounds;
+		int Layer;
+		std::uint32_t MatCBIndex;
+		D3D12_VERTEX_BUFFER_VIEW VertexBufferView;
+		D3D12_INDEX_BUFFER_VIEW IndexBufferView;
+		UINT IndexCount;
+		UINT StartIndexLocation;
+		INT BaseVertexLocation;
+	};
+
+	// What DrawRenderItems binds and draws for one item.
+	struct DirectDraw
+	{
+		UINT ObjectIndex;
+		D3D12_GPU_VIRTUAL_ADDRESS MaterialCBAddress;
+		D3D12_VERTEX_BUFFER_VIEW VertexBufferView;
+		D3D12_INDEX_BUFFER_VIEW IndexBufferView;
+		UINT IndexCount;
+		UINT StartIndexLocation;
+		INT BaseVertexLocation;
+	};
+
+	const int LayerCount = 3;
+
+	std::vector<SceneItem> BuildScene(const ViewSpaceFrustum& frustum)
+	{
+		std::srand(4);
+		auto randomFloat = [](float lo, float hi) { return lo + (hi - lo)*((float)std::rand() / RAND_MAX); };
+
+		// A few shared meshes, as geometries with several submeshes each.
+		std::vector<SceneItem> items;
+		while(items.size() < 300)
+		{
+			SceneItem item;
+			item.Bounds.Center = XMFLOAT3(randomFloat(-120.0f, 120.0f), randomFloat(-40.0f, 60.0f),
+				randomFloat(-80.0f, 180.0f));
+			item.Bounds.Radius = randomFloat(0.5f, 8.0f);
+
+			// Leave out spheres that just touch a plane, which rounding can put either way.
+			if(std::fabs(frustum.Margin(item.Bounds)) < 1e-3f)
+				continue;
+
+			std::uint32_t geo = (std::uint32_t)std::rand() % 4;
+			item.Layer = std::rand() % LayerCount;
+			item.MatCBIndex = (std::uint32_t)std::rand() % 8;
+			item.VertexBufferView.BufferLocation = 0x100000ull*(geo + 1);
+			item.VertexBufferView.SizeInBytes = 0x8000;
+			item.VertexBufferView.StrideInBytes = 32;
+			item.IndexBufferView.BufferLocation = item.VertexBufferView.BufferLocation + 0x8000;
+			item.IndexBufferView.SizeInBytes = 0x4000;
+			item.IndexBufferView.Format = geo % 2 == 0 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+			item.IndexCount = 3*(1 + (UINT)std::rand() % 100);
+			item.StartIndexLocation = 3*((UINT)std::rand() % 500);
+			item.BaseVertexLocation = std::rand() % 500;
+			items.push_back(item);
+		}
+
+		return items;
+	}
+
+	// As IndirectCommand in the app.
+	IndirectDrawCommand CommandFor(const SceneItem& item, UINT objectIndex)
+	{
+		IndirectDrawCommand cmd = {};
+		cmd.MaterialCBAddress = item.MatCBIndex*MatCBByteSize;
+		cmd.VertexBufferView = item.VertexBufferView;
+		cmd.IndexBufferView = item.IndexBufferView;
+		cmd.ObjectIndex = objectIndex;
+		cmd.DrawArgs.IndexCountPerInstance = item.IndexCount;
+		cmd.DrawArgs.InstanceCount = 1;
+		cmd.DrawArgs.StartIndexLocation = item.StartIndexLocation;
+		cmd.DrawArgs.BaseVertexLocation = item.BaseVertexLocation;
+		cmd.DrawArgs.StartInstanceLocation = 0;
+		return cmd;
+	}
+
+	void TestPackedMatchesDirectDraws()
+	{
+		ViewSpaceFrustum frustum;
+		XMStoreFloat4x4(&frustum.View, XMMatrixLookAtLH(XMVectorSet(0.0f, 10.0f, -50.0f, 1.0f),
+			XMVectorZero(), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f)));
+		frustum.Aspect = 4.0f / 3.0f;
+		frustum.FarZ = 150.0f;
+
+		std::vector<SceneItem> items = BuildScene(frustum);
+		const D3D12_GPU_VIRTUAL_ADDRESS matCB = 0x40000000ull;
+
+		// The direct path: every item of a layer that is in view, in the layer's order.
+		std::vector<DirectDraw> direct[LayerCount];
+		for(UINT i = 0; i < (UINT)items.size(); ++i)
+		{
+			const SceneItem& item = items[i];
+			if(frustum.Margin(item.Bounds) < 0.0f)
+				continue;
+
+			DirectDraw draw;
+			draw.ObjectIndex = i;
+			draw.MaterialCBAddress = matCB + item.MatCBIndex*MatCBByteSize;
+			draw.VertexBufferView = item.VertexBufferView;
+			draw.IndexBufferView = item.IndexBufferView;
+			draw.IndexCount = item.IndexCount;
+			draw.StartIndexLocation = item.StartIndexLocation;
+			draw.BaseVertexLocation = item.BaseVertexLocation;
+			direct[item.Layer].push_back(draw);
+		}
+
+		// The indirect path, as UpdateIndirectArgs: the culler's visible items of each
+		// layer, in an order sorted by material, packed in one go.
+		FrustumCuller culler;
+		IndirectArgsPacker packer(sizeof(IndirectDrawCommand));
+		packer.Resize((std::uint32_t)items.size());
+		for(UINT i = 0; i < (UINT)items.size(); ++i)
+		{
+			culler.Add(items[i].Bounds);
+			IndirectDrawCommand cmd = CommandFor(items[i], i);
+			packer.Set(i, &cmd);
+		}
+
+		std::vector<std::uint32_t> visibleItems;
+		culler.Cull(frustum.ViewProj(), visibleItems);
+		std::vector<bool> visible(items.size(), false);
+		for(std::uint32_t i : visibleItems)
+			visible[i] = true;
+
+		std::vector<std::uint32_t> order;
+		size_t layerStart[LayerCount + 1];
+		for(int layer = 0; layer < LayerCount; ++layer)
+		{
+			layerStart[layer] = order.size();
+
+			std::vector<std::uint32_t> layerOrder;
+			for(std::uint32_t i = 0; i < (std::uint32_t)items.size(); ++i)
+			{
+				if(items[i].Layer == layer)
+					layerOrder.push_back(i);
+			}
+			std::stable_sort(layerOrder.begin(), layerOrder.end(), [&](std::uint32_t a, std::uint32_t b)
+			{
+				return items[a].MatCBIndex < items[b].MatCBIndex;
+			});
+
+			for(std::uint32_t i : layerOrder)
+			{
+				if(visible[i])
+					order.push_back(i);
+			}
+		}
+		layerStart[LayerCount] = order.size();
+
+		std::vector<IndirectDrawCommand> packed(order.size());
+		packer.Pack(order.data(), (std::uint32_t)order.size(), matCB, packed.data());
+
+		// Every layer draws the same items with the same arguments either way.
+		size_t drawCount = 0;
+		for(int layer = 0; layer < LayerCount; ++layer)
+		{
+			std::vector<IndirectDrawCommand> commands(packed.begin() + layerStart[layer],
+				packed.begin() + layerStart[layer + 1]);
+			std::sort(commands.begin(), commands.end(), [](const IndirectDrawCommand& a, const IndirectDrawCommand& b)
+			{
+				return a.ObjectIndex < b.ObjectIndex;
+			});
+
+			CHECK(commands.size() == direct[layer].size());
+			if(commands.size() != direct[layer].size())
+				continue;
+
+			for(size_t i = 0; i < commands.size(); ++i)
+			{
+				const IndirectDrawCommand& cmd = commands[i];
+				const DirectDraw& draw = direct[layer][i];
+
+				CHECK(cmd.ObjectIndex == draw.ObjectIndex);
+				CHECK(cmd.MaterialCBAddress == draw.MaterialCBAddress);
+				CHECK(cmd.VertexBufferView.BufferLocation == draw.VertexBufferView.BufferLocation);
+				CHECK(cmd.VertexBufferView.SizeInBytes == draw.VertexBufferView.SizeInBytes);
+				CHECK(cmd.VertexBufferView.StrideInBytes == draw.VertexBufferView.StrideInBytes);
+				CHECK(cmd.DynamicVertexBufferView.BufferLocation == 0);
+				CHECK(cmd.IndexBufferView.BufferLocation == draw.IndexBufferView.BufferLocation);
+				CHECK(cmd.IndexBufferView.SizeInBytes == draw.IndexBufferView.SizeInBytes);
+				CHECK(cmd.IndexBufferView.Format == draw.IndexBufferView.Format);
+				CHECK(cmd.DrawArgs.IndexCountPerInstance == draw.IndexCount);
+				CHECK(cmd.DrawArgs.InstanceCount == 1);
+				CHECK(cmd.DrawArgs.StartIndexLocation == draw.StartIndexLocation);
+				CHECK(cmd.DrawArgs.BaseVertexLocation == draw.BaseVertexLocation);
+				CHECK(cmd.DrawArgs.StartInstanceLocation == 0);
+			}
+			drawCount += commands.size();
+		}
+
+		// Some of the scene is in view and some is not.
+		CHECK(drawCount > 20 && drawCount < items.size());
+	}
+}
+
+int main()
+{
+	const TestUtil::TestCase tests[] =
+	{
+		{ "PackMatchesReference", TestPackMatchesReference },
+		{ "AddressRelocation", TestAddressRelocation },
+		{ "PackedMatchesDirectDraws", TestPackedMatchesDirectDraws },
+	};
+
+	return TestUtil::RunTests(tests);
+}
@@ -0,0 +1,230 @@
+//***************************************************************************************
+// ResourceStateTrackerTests.cpp
+//
+// Which transitions reach the command list: the tracker flushes into a sink that keeps
+// every ResourceBarrier call, and the resources are addresses that are never touched.
+//***************************************************************************************
+
+#include "ResourceStateTracker.h"
+#include "TestUtil.h"
+#include <vector>
+
+namespace
+{
+	class RecordingSink : public ResourceBarrierSink
+	{
+	public:
+		void ResourceBarrier(UINT count, const D3D12_RESOURCE_BARRIER* barriers) override
+		{
+			Calls.push_back(std::vector<D3D12_RESOURCE_BARRIER>(barriers, barriers + count));
+		}
+
+		std::vector<std::vector<D3D12_RESOURCE_BARRIER>> Calls;
+	};
+
+	int gResources[4];
+
+	ID3D12Resource* FakeResource(int i)
+	{
+		return reinterpret_cast<ID3D12Resource*>(&gResources[i]);
+	}
+
+	bool IsTransition(const D3D12_RESOURCE_BARRIER& barrier, ID3D12Resource* resource, UINT subresource,
+		D3D12_RESOURCE_STATES before, D3D12_RESOURCE_STATES after)
+	{
+		return barrier.Type == D3D12_RESOURCE_BARRIER_TYPE_TRANSITION &&
+			barrier.Transition.pResource == resource &&
+			barrier.Transition.Subresource == subresource &&
+			barrier.Transition.StateBefore == before &&
+			barrier.Transition.StateAfter == after;
+	}
+
+	void TestRedundantTransitionsAreDropped()
+	{
+		ResourceStateTracker tracker;
+		RecordingSink sink;
+		ID3D12Resource* buffer = FakeResource(0);
+
+		tracker.Register(buffer, D3D12_RESOURCE_STATE_GENERIC_READ);
+		tracker.Transition(buffer, D3D12_RESOURCE_STATE_GENERIC_READ);
+		tracker.Flush(sink);
+
+		CHECK(sink.Calls.empty());
+		CHECK(tracker.FrameStats().Requested == 1);
+		CHECK(tracker.FrameStats().Elided == 1);
+		CHECK(tracker.FrameStats().Batches == 0);
+	}
+
+	void TestChainsFold()
+	{
+		ResourceStateTracker tracker;
+		RecordingSink sink;
+		ID3D12Resource* buffer = FakeResource(0);
+
+		// A->B->C before a flush is recorded as A->C.
+		tracker.Register(buffer, D3D12_RESOURCE_STATE_COMMON);
+		tracker.Transition(buffer, D3D12_RESOURCE_STATE_COPY_DEST);
+		tracker.Transition(buffer, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+		CHECK(tracker.GetState(buffer) == D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+		tracker.Flush(sink);
+
+		CHECK(sink.Calls.size() == 1);
+		CHECK(sink.Calls.size() == 1 && sink.Calls[0].size() == 1 &&
+			IsTransition(sink.Calls[0][0], buffer, D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES,
+				D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE));
+
+		const ResourceBarrierStats& stats = tracker.FrameStats();
+		CHECK(stats.Requested == 2);
+		CHECK(stats.Elided == 1);
+		CHECK(stats.Submitted == 1);
+		CHECK(stats.Batches == 1);
+
+		// Flushed transitions are not folded into later ones.
+		tracker.Transition(buffer, D3D12_RESOURCE_STATE_COPY_DEST);
+		tracker.Flush(sink);
+		CHECK(sink.Calls.size() == 2 && sink.Calls[1].size() == 1 &&
+			IsTransition(sink.Calls[1][0], buffer, D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES,
+				D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_DEST));
+	}
+
+	void TestReturnsCancel()
+	{
+		ResourceStateTracker tracker;
+		RecordingSink sink;
+		ID3D12Resource* target = FakeResource(0);
+		ID3D12Resource* other = FakeResource(1);
+
+		// A->B->A before a flush records nothing, and leaves other resources' barriers.
+		tracker.Register(target, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+		tracker.Register(other, D3D12_RESOURCE_STATE_COPY_DEST);
+		tracker.Transition(target, D3D12_RESOURCE_STATE_RENDER_TARGET);
+		tracker.Transition(other, D3D12_RESOURCE_STATE_GENERIC_READ);
+		tracker.Transition(target, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+		CHECK(tracker.PendingBarriers().size() == 1);
+		tracker.Flush(sink);
+
+		CHECK(sink.Calls.size() == 1 && sink.Calls[0].size() == 1 &&
+			IsTransition(sink.Calls[0][0], other, D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES,
+				D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_GENERIC_READ));
+		CHECK(tracker.FrameStats().Requested == 3);
+		CHECK(tracker.FrameStats().Elided == 2);
+		CHECK(tracker.FrameStats().Submitted == 1);
+
+		// Nothing left to record is not a batch.
+		tracker.Transition(target, D3D12_RESOURCE_STATE_RENDER_TARGET);
+		tracker.Transition(target, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+		tracker.Flush(sink);
+		CHECK(sink.Calls.size() == 1);
+		CHECK(tracker.FrameStats().Batches == 1);
+	}
+
+	void TestOneCallPerFlush()
+	{
+		ResourceStateTracker tracker;
+		RecordingSink sink;
+
+		for(int i = 0; i < 4; ++i)
+		{
+			tracker.Register(FakeResource(i), D3D12_RESOURCE_STATE_COPY_DEST);
+			tracker.Transition(FakeResource(i), D3D12_RESOURCE_STATE_GENERIC_READ);
+		}
+		tracker.Flush(sink);
+
+		CHECK(sink.Calls.size() == 1 && sink.Calls[0].size() == 4);
+		CHECK(tracker.PendingBarriers().empty());
+
+		// The frame's counts move on at the start of the next frame.
+		tracker.BeginFrame();
+		CHECK(tracker.LastFrameStats().Submitted == 4);
+		CHECK(tracker.LastFrameStats().Batches == 1);
+		CHECK(tracker.FrameStats().Requested == 0);
+	}
+
+	void TestSubresourcesDivergeAndConverge()
+	{
+		ResourceStateTracker tracker;
+		RecordingSink sink;
+		ID3D12Resource* texture = FakeResource(0);
+		const D3D12_RESOURCE_STATES copy = D3D12_RESOURCE_STATE_COPY_DEST;
+		const D3D12_RESOURCE_STATES read = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
+		const D3D12_RESOURCE_STATES target = D3D12_RESOURCE_STATE_RENDER_TARGET;
+
+		tracker.Register(texture, copy, 3);
+
+		// One mip moves on its own.
+		tracker.Transition(texture, read, 1);
+		CHECK(tracker.GetState(texture, 0) == copy);
+		CHECK(tracker.GetState(texture, 1) == read);
+		CHECK(tracker.GetState(texture, 2) == copy);
+		tracker.Flush(sink);
+		CHECK(sink.Calls.size() == 1 && sink.Calls[0].size() == 1 &&
+			IsTransition(sink.Calls[0][0], texture, 1, copy, read));
+
+		// While they differ, a whole resource transition moves each mip that is not
+		// there yet on its own, and then they agree again.
+		tracker.Transition(texture, read);
+		tracker.Flush(sink);
+		CHECK(sink.Calls.size() == 2 && sink.Calls[1].size() == 2 &&
+			IsTransition(sink.Calls[1][0], texture, 0, copy, read) &&
+			IsTransition(sink.Calls[1][1], texture, 2, copy, read));
+		CHECK(tracker.GetState(texture, 1) == read);
+
+		// So the next whole resource transition is a single barrier.
+		tracker.Transition(texture, target);
+		tracker.Flush(sink);
+		CHECK(sink.Calls.size() == 3 && sink.Calls[2].size() == 1 &&
+			IsTransition(sink.Calls[2][0], texture, D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, read, target));
+
+		// Diverging and converging one mip at a time ends up there as well.
+		tracker.Transition(texture, read, 0);
+		tracker.Transition(texture, read, 1);
+		tracker.Transition(texture, read, 2);
+		tracker.Flush(sink);
+		CHECK(sink.Calls.size() == 4 && sink.Calls[3].size() == 3);
+
+		tracker.Transition(texture, copy);
+		tracker.Flush(sink);
+		CHECK(sink.Calls.size() == 5 && sink.Calls[4].size() == 1 &&
+			IsTransition(sink.Calls[4][0], texture, D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, read, copy));
+
+		// A queued mip transition that is undone before the flush cancels like a whole
+		// resource one.
+		tracker.Transition(texture, target, 2);
+		tracker.Transition(texture, copy, 2);
+		CHECK(tracker.PendingBarriers().empty());
+		CHECK(tracker.GetState(texture) == copy);
+	}
+
+	void TestUnregisterDropsQueuedBarriers()
+	{
+		ResourceStateTracker tracker;
+		RecordingSink sink;
+
+		tracker.Register(FakeResource(0), D3D12_RESOURCE_STATE_COPY_DEST);
+		tracker.Register(FakeResource(1), D3D12_RESOURCE_STATE_COPY_DEST);
+		tracker.Transition(FakeResource(0), D3D12_RESOURCE_STATE_GENERIC_READ);
+		tracker.Transition(FakeResource(1), D3D12_RESOURCE_STATE_GENERIC_READ);
+
+		tracker.Unregister(FakeResource(0));
+		CHECK(!tracker.IsRegistered(FakeResource(0)));
+		tracker.Flush(sink);
+
+		CHECK(sink.Calls.size() == 1 && sink.Calls[0].size() == 1 &&
+			sink.Calls[0][0].Transition.pResource == FakeResource(1));
+	}
+}
+
+int main()
+{
+	const TestUtil::TestCase tests[] =
+	{
+		{ "RedundantTransitionsAreDropped", TestRedundantTransitionsAreDropped },
+		{ "ChainsFold", TestChainsFold },
+		{ "ReturnsCancel", TestReturnsCancel },
+		{ "OneCallPerFlush", TestOneCallPerFlush },
+		{ "SubresourcesDivergeAndConverge", TestSubresourcesDivergeAndConverge },
+		{ "UnregisterDropsQueuedBarriers", TestUnregisterDropsQueuedBarriers },
+	};
+
+	return TestUtil::RunTests(tests);
+}
@@ -0,0 +1,216 @@
+//***************************************************************************************
+// ShadowCascadesTests.cpp
+//
+// Cascade splits, the texel snapping that keeps shadows still as the camera turns, and
+// the vector caster culling against the one sphere at a time version.
+//***************************************************************************************
+
+#include "ShadowCascades.h"
+#include "TestUtil.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// The app's projection and main light.
+	const float FovY = 0.25f*XM_PI;
+	const float Aspect = 16.0f / 9.0f;
+	const float NearZ = 1.0f;
+	const float FarZ = 1000.0f;
+	const XMFLOAT3 LightDirection(0.57735f, -0.57735f, 0.57735f);
+
+	XMMATRIX CameraView(FXMVECTOR eye, float yaw, float pitch)
+	{
+		XMVECTOR look = XMVectorSet(std::cos(pitch)*std::sin(yaw), std::sin(pitch),
+			std::cos(pitch)*std::cos(yaw), 0.0f);
+		return XMMatrixLookToLH(eye, look, XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+	}
+
+	float RandomFloat(float lo, float hi)
+	{
+		return lo + (hi - lo)*((float)std::rand() / RAND_MAX);
+	}
+
+	void TestSplitsAreMonotonic()
+	{
+		const float lambdas[] = { 0.0f, 0.25f, 0.75f, 1.0f };
+		for(float lambda : lambdas)
+		{
+			for(int count = 1; count <= ShadowCascades::MaxCascades; ++count)
+			{
+				float splits[ShadowCascades::MaxCascades + 1];
+				ShadowCascades::ComputeSplits(NearZ, FarZ, count, lambda, splits);
+
+				CHECK(splits[0] == NearZ);
+				CHECK(splits[count] == FarZ);
+				for(int i = 0; i < count; ++i)
+					CHECK(splits[i] < splits[i + 1]);
+
+				// The two ends of the practical scheme.
+				for(int i = 1; i < count; ++i)
+				{
+					float t = (float)i / count;
+					if(lambda == 0.0f)
+						CHECK_NEAR(splits[i], NearZ + (FarZ - NearZ)*t, 1e-3);
+					if(lambda == 1.0f)
+						CHECK_NEAR(splits[i], NearZ*std::pow(FarZ / NearZ, t), 1e-3);
+				}
+			}
+		}
+
+		// A fitted camera's cascades follow on from each other up to MaxDistance.
+		ShadowCascadeSettings settings;
+		settings.MaxDistance = 300.0f;
+		ShadowCascades cascades(settings);
+		cascades.Fit(CameraView(XMVectorSet(0.0f, 10.0f, -50.0f, 1.0f), 0.0f, -0.1f), FovY, Aspect,
+			NearZ, FarZ, LightDirection);
+
+		CHECK(cascades.Cascade(0).SplitNear == NearZ);
+		CHECK(cascades.Cascade(cascades.CascadeCount() - 1).SplitFar == settings.MaxDistance);
+		for(int i = 0; i + 1 < cascades.CascadeCount(); ++i)
+		{
+			CHECK(cascades.Cascade(i).SplitNear < cascades.Cascade(i).SplitFar);
+			CHECK(cascades.Cascade(i).SplitFar == cascades.Cascade(i + 1).SplitNear);
+		}
+	}
+
+	void TestTexelsStayPutAsTheCameraTurns()
+	{
+		ShadowCascadeSettings settings;
+		settings.MaxDistance = 300.0f;
+		ShadowCascades first(settings);
+		ShadowCascades turned(settings);
+
+		// Turning about the eye moves the slices but must not resize them, and a world
+		// point must land on the same place within its texel however they have moved.
+		XMVECTOR eye = XMVectorSet(12.0f, 8.0f, -40.0f, 1.0f);
+		first.Fit(CameraView(eye, 0.0f, 0.0f), FovY, Aspect, NearZ, FarZ, LightDirection);
+
+		const XMVECTOR points[] =
+		{
+			XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f),
+			XMVectorSet(13.7f, 3.1f, -35.2f, 1.0f),
+			XMVectorSet(-41.3f, 12.9f, 27.5f, 1.0f),
+		};
+
+		float mapSize = (float)settings.MapSize;
+
+		for(int step = 1; step <= 24; ++step)
+		{
+			float yaw = 0.29f*step;
+			float pitch = 0.6f*std::sin(0.7f*step);
+			turned.Fit(CameraView(eye, yaw, pitch), FovY, Aspect, NearZ, FarZ, LightDirection);
+
+			for(int i = 0; i < turned.CascadeCount(); ++i)
+			{
+				const ShadowCascade& a = first.Cascade(i);
+				const ShadowCascade& b = turned.Cascade(i);
+
+				CHECK(b.Bounds.Radius == a.Bounds.Radius);
+				CHECK(b.TexelSize == a.TexelSize);
+
+				// The light view moves the snapped center to the origin across the map.
+				float texelsX = -b.LightView.m[3][0] / b.TexelSize;
+				float texelsY = -b.LightView.m[3][1] / b.TexelSize;
+				CHECK_NEAR(texelsX, std::floor(texelsX + 0.5f), 1e-3);
+				CHECK_NEAR(texelsY, std::floor(texelsY + 0.5f), 1e-3);
+
+				for(FXMVECTOR p : points)
+				{
+					XMFLOAT3 ndcA, ndcB;
+					XMStoreFloat3(&ndcA, XMVector3TransformCoord(p, XMLoadFloat4x4(&a.LightViewProj)));
+					XMStoreFloat3(&ndcB, XMVector3TransformCoord(p, XMLoadFloat4x4(&b.LightViewProj)));
+
+					const float texelA[2] = { 0.5f*mapSize*ndcA.x, 0.5f*mapSize*ndcA.y };
+					const float texelB[2] = { 0.5f*mapSize*ndcB.x, 0.5f*mapSize*ndcB.y };
+					for(int axis = 0; axis < 2; ++axis)
+					{
+						// Fractions of a texel, allowing for one being just under a whole
+						// texel and the other just over.
+						float d = std::fabs((texelA[axis] - std::floor(texelA[axis])) -
+							(texelB[axis] - std::floor(texelB[axis])));
+						CHECK_NEAR(std::min(d, 1.0f - d), 0.0, 1e-2);
+					}
+				}
+			}
+		}
+	}
+
+	void CheckCullMatchesReference(const ShadowCascades& cascades)
+	{
+		std::vector<std::vector<std::uint32_t>> fast, reference;
+		cascades.Cull(fast);
+		cascades.CullReference(reference);
+
+		CHECK((int)fast.size() == cascades.CascadeCount());
+		CHECK(fast == reference);
+	}
+
+	void TestCullMatchesReference()
+	{
+		ShadowCascadeSettings settings;
+		settings.MaxDistance = 300.0f;
+		settings.CasterDistance = 50.0f;
+		ShadowCascades cascades(settings);
+		cascades.Fit(CameraView(XMVectorSet(0.0f, 10.0f, -50.0f, 1.0f), 0.4f, -0.2f), FovY, Aspect,
+			NearZ, FarZ, LightDirection);
+
+		std::srand(1);
+
+		// Counts on either side of a multiple of four, so the padding lanes are covered.
+		const std::uint32_t counts[] = { 0, 1, 3, 4, 5, 37, 1001 };
+		std::size_t casterCount = 0;
+		std::size_t visibleCount = 0;
+		for(std::uint32_t count : counts)
+		{
+			cascades.ClearCasters();
+			for(std::uint32_t c = 0; c < count; ++c)
+			{
+				BoundingSphere sphere;
+				sphere.Center = XMFLOAT3(RandomFloat(-400.0f, 400.0f), RandomFloat(-50.0f, 150.0f),
+					RandomFloat(-400.0f, 400.0f));
+				sphere.Radius = RandomFloat(0.0f, 20.0f);
+				CHECK(cascades.AddCaster(sphere) == c);
+			}
+			CHECK(cascades.CasterCount() == count);
+			CheckCullMatchesReference(cascades);
+
+			// Moving some casters in place.
+			for(std::uint32_t c = 0; c < count; c += 3)
+			{
+				BoundingSphere sphere;
+				sphere.Center = XMFLOAT3(RandomFloat(-100.0f, 100.0f), RandomFloat(0.0f, 30.0f),
+					RandomFloat(-100.0f, 100.0f));
+				sphere.Radius = RandomFloat(0.5f, 5.0f);
+				cascades.SetCaster(c, sphere);
+			}
+			CheckCullMatchesReference(cascades);
+
+			std::vector<std::vector<std::uint32_t>> visible;
+			cascades.Cull(visible);
+			casterCount += count;
+			for(const auto& list : visible)
+				visibleCount += list.size();
+		}
+
+		// Some casters were kept and some were not, so both outcomes were compared.
+		CHECK(visibleCount > 0);
+		CHECK(visibleCount < casterCount*cascades.CascadeCount());
+	}
+}
+
+int main()
+{
+	const TestUtil::TestCase tests[] =
+	{
+		{ "SplitsAreMonotonic", TestSplitsAreMonotonic },
+		{ "TexelsStayPutAsTheCameraTurns", TestTexelsStayPutAsTheCameraTurns },
+		{ "CullMatchesReference", TestCullMatchesReference },
+	};
+
+	return TestUtil::RunTests(tests);
+}
@@ -0,0 +1,78 @@
+//***************************************************************************************
+// SimulatedGpuTimeline.h
+//
+// Stands in for the GPU and the clock when driving a FramePacer without a device.
+//
+// Time is virtual and only moves when the CPU side does work or waits.  Submitted frames
+// run on the GPU one after another in submission order, each starting once it has been
+// submitted and the previous one is done, and the fence reaches a frame's value when the
+// frame ends.
+//***************************************************************************************
+
+#pragma once
+
+#include "FramePacer.h"
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
+class SimulatedGpuTimeline : public FrameFence
+{
+public:
+	double Now()const
+	{
+		return mNow;
+	}
+
+	FramePacer::Clock Clock()
+	{
+		return [this]() { return mNow; };
+	}
+
+	// Spends CPU time, in seconds.
+	void CpuWork(double seconds)
+	{
+		assert(seconds >= 0.0);
+		mNow += seconds;
+	}
+
+	// Submits a frame taking gpuTime seconds and returns the fence value it signals.
+	std::uint64_t Submit(double gpuTime)
+	{
+		double start = std::max(mNow, mGpuFree);
+		mGpuFree = start + gpuTime;
+		mBusy += gpuTime;
+
+		mFrameEnds.push_back(mGpuFree);
+		return mFrameEnds.size();
+	}
+
+	// Total GPU time of everything submitted so far.
+	double GpuBusyTotal()const
+	{
+		return mBusy;
+	}
+
+	std::uint64_t GetCompletedValue()override
+	{
+		std::uint64_t completed = 0;
+		while(completed < mFrameEnds.size() && mFrameEnds[completed] <= mNow)
+			completed++;
+		return completed;
+	}
+
+	void WaitForValue(std::uint64_t value)override
+	{
+		assert(value <= mFrameEnds.size());
+		if(value > 0)
+			mNow = std::max(mNow, mFrameEnds[value - 1]);
+	}
+
+private:
+	double mNow = 0.0;
+	double mGpuFree = 0.0;
+	double mBusy = 0.0;
+
+	// End time of each submitted frame; frame i signals fence value i + 1.
+	std::vector<double> mFrameEnds;
+};
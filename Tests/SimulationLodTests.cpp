@@ -0,0 +1,182 @@
+//***************************************************************************************
+// SimulationLodTests.cpp
+//
+// The steps a body takes at each level, how it catches up and what it gives up when it
+// falls too far behind, and the uploads its copies are due.  The time step is a power of
+// two, so whole frames of time add up exactly.
+//***************************************************************************************
+
+#include "SimulationLod.h"
+#include "TestUtil.h"
+#include <algorithm>
+
+namespace
+{
+	const float TimeStep = 1.0f / 64.0f;
+
+	int AdvanceFrames(SimulationLod& lod, int frames, SimulationLodLevel level)
+	{
+		int steps = 0;
+		for(int i = 0; i < frames; ++i)
+			steps += lod.Advance(TimeStep, level);
+		return steps;
+	}
+
+	void TestStepsPerLevel()
+	{
+		SimulationLodSettings settings;
+		settings.DistantInterval = 4;
+		settings.HiddenInterval = 16;
+		settings.MaxLag = 1.0f;
+
+		// One step a frame at Full.
+		SimulationLod full(TimeStep, 1, settings);
+		for(int i = 0; i < 10; ++i)
+			CHECK(full.Advance(TimeStep, SimulationLodLevel::Full) == 1);
+		CHECK(full.Stats().Lag == 0.0f);
+
+		// One step every fourth frame while Distant, on the fourth.
+		SimulationLod distant(TimeStep, 1, settings);
+		for(int i = 1; i <= 16; ++i)
+			CHECK(distant.Advance(TimeStep, SimulationLodLevel::Distant) == (i % 4 == 0 ? 1 : 0));
+		CHECK(distant.Stats().StepsTaken == 4);
+		CHECK(distant.Stats().StepsDue == 16);
+		CHECK(distant.Stats().Lag == 12*TimeStep);
+
+		SimulationLod hidden(TimeStep, 1, settings);
+		CHECK(AdvanceFrames(hidden, 15, SimulationLodLevel::Hidden) == 0);
+		CHECK(AdvanceFrames(hidden, 1, SimulationLodLevel::Hidden) == 1);
+		CHECK(AdvanceFrames(hidden, 16, SimulationLodLevel::Hidden) == 1);
+		CHECK(hidden.Stats().Level == SimulationLodLevel::Hidden);
+
+		// A Hidden interval of 0 freezes the body.
+		settings.HiddenInterval = 0;
+		SimulationLod frozen(TimeStep, 1, settings);
+		CHECK(AdvanceFrames(frozen, 50, SimulationLodLevel::Hidden) == 0);
+		CHECK(frozen.Stats().StepsTaken == 0);
+	}
+
+	void TestCatchUpIsBounded()
+	{
+		SimulationLodSettings settings;
+		settings.HiddenInterval = 0;
+		settings.MaxCatchUpSteps = 4;
+		settings.MaxLag = 1.0f;
+
+		SimulationLod lod(TimeStep, 1, settings);
+		CHECK(AdvanceFrames(lod, 20, SimulationLodLevel::Hidden) == 0);
+		CHECK(lod.Stats().Lag == 20*TimeStep);
+
+		// Back at Full, each frame adds a step and takes up to four, until the lag is gone.
+		int owed = 20;
+		std::uint64_t catchUp = 0;
+		for(int frame = 0; frame < 12; ++frame)
+		{
+			owed += 1;
+			int expected = std::min(owed, settings.MaxCatchUpSteps);
+			owed -= expected;
+			catchUp += expected - 1;
+
+			CHECK(lod.Advance(TimeStep, SimulationLodLevel::Full) == expected);
+			CHECK(lod.Stats().Lag == owed*TimeStep);
+		}
+		CHECK(owed == 0);
+		CHECK(lod.Stats().CatchUpSteps == catchUp);
+		CHECK(lod.Stats().StepsTaken == lod.Stats().StepsDue);
+		CHECK(lod.Stats().StepsDropped == 0);
+
+		// A long frame is capped too.
+		CHECK(lod.Advance(10*TimeStep, SimulationLodLevel::Full) == 4);
+		CHECK(lod.Stats().Lag == 6*TimeStep);
+	}
+
+	void TestDropsPastMaxLag()
+	{
+		SimulationLodSettings settings;
+		settings.HiddenInterval = 0;
+		settings.MaxCatchUpSteps = 4;
+		settings.MaxLag = 8*TimeStep;
+
+		SimulationLod lod(TimeStep, 1, settings);
+		lod.AddStepTime(6.0, 3);
+		CHECK(lod.Stats().StepMs == 2.0);
+
+		// Eight steps are owed, and the twelve after them are given up.
+		AdvanceFrames(lod, 20, SimulationLodLevel::Hidden);
+		CHECK(lod.Stats().Lag == settings.MaxLag);
+		CHECK(lod.Stats().StepsDue == 20);
+		CHECK(lod.Stats().StepsDropped == 12);
+		CHECK_NEAR(lod.Stats().SavedMs, 12*2.0, 1e-9);
+
+		// Catching up takes the eight owed steps and drops nothing more.
+		CHECK(AdvanceFrames(lod, 3, SimulationLodLevel::Full) == 11);
+		CHECK(lod.Stats().Lag == 0.0f);
+		CHECK(lod.Stats().StepsDropped == 12);
+		CHECK(lod.Stats().StepsTaken + lod.Stats().StepsDropped == lod.Stats().StepsDue);
+
+		// Half steps dropped a frame at a time add up to whole ones.
+		AdvanceFrames(lod, 8, SimulationLodLevel::Hidden);
+		for(int i = 0; i < 4; ++i)
+			lod.Advance(1.5f*TimeStep, SimulationLodLevel::Hidden);
+		CHECK(lod.Stats().StepsDropped == 12 + 6);
+		CHECK_NEAR(lod.Stats().SavedMs, 18*2.0, 1e-9);
+
+		lod.ResetStats();
+		CHECK(lod.Stats().StepsDropped == 0 && lod.Stats().SavedMs == 0.0);
+		CHECK(lod.Stats().StepMs == 2.0 && lod.Stats().Lag == settings.MaxLag);
+	}
+
+	void TestUploadsCountDownPerCopy()
+	{
+		SimulationLodSettings settings;
+		settings.DistantInterval = 4;
+		settings.HiddenInterval = 1;
+
+		// Every copy starts out needing a write.
+		SimulationLod lod(TimeStep, 3, settings);
+		CHECK(lod.UploadDue() && lod.UploadDue() && lod.UploadDue());
+		CHECK(!lod.UploadDue());
+		CHECK(lod.Stats().UploadsSkipped == 1);
+
+		// A step makes each copy due once more.
+		CHECK(lod.Advance(TimeStep, SimulationLodLevel::Full) == 1);
+		for(int copy = 0; copy < 3; ++copy)
+		{
+			CHECK(lod.UploadDue());
+			CHECK(lod.Advance(TimeStep, SimulationLodLevel::Distant) == 0);
+		}
+		CHECK(!lod.UploadDue());
+
+		// Frames without a step have nothing new to upload.
+		CHECK(lod.Advance(0.0f, SimulationLodLevel::Distant) == 0);
+		CHECK(!lod.UploadDue());
+		CHECK(lod.Stats().UploadsSkipped == 3);
+
+		// A Hidden body steps but uploads nothing until it is seen again.
+		CHECK(lod.Advance(TimeStep, SimulationLodLevel::Hidden) == 1);
+		CHECK(!lod.UploadDue());
+		CHECK(lod.Advance(0.0f, SimulationLodLevel::Distant) == 0);
+		CHECK(lod.UploadDue() && lod.UploadDue() && lod.UploadDue());
+		CHECK(!lod.UploadDue());
+
+		lod.InvalidateUploads(2);
+		CHECK(lod.UploadDue() && lod.UploadDue());
+		CHECK(!lod.UploadDue());
+		lod.InvalidateUploads();
+		CHECK(lod.UploadDue() && lod.UploadDue());
+		CHECK(!lod.UploadDue());
+	}
+}
+
+int main()
+{
+	const TestUtil::TestCase tests[] =
+	{
+		{ "StepsPerLevel", TestStepsPerLevel },
+		{ "CatchUpIsBounded", TestCatchUpIsBounded },
+		{ "DropsPastMaxLag", TestDropsPastMaxLag },
+		{ "UploadsCountDownPerCopy", TestUploadsCountDownPerCopy },
+	};
+
+	return TestUtil::RunTests(tests);
+}
@@ -0,0 +1,159 @@
+//***************************************************************************************
+// TaskGraphTests.cpp
+//
+// Tasks run after the tasks they depend on, a task that throws keeps its dependents from
+// running, and the longest chain is worked out from the times the tasks took.
+//***************************************************************************************
+
+#include "TaskGraph.h"
+#include "TestUtil.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	void Sleep(int milliseconds)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
+	}
+
+	void TestDependenciesRunFirst()
+	{
+		std::srand(5);
+
+		// Each task takes a ticket when it starts and another when it ends.
+		const int count = 60;
+		std::atomic<int> ticket(0);
+		std::vector<int> started(count, -1), ended(count, -1);
+		std::vector<std::vector<TaskGraph::TaskId>> dependencies(count);
+
+		TaskGraph graph;
+		for(int i = 0; i < count; ++i)
+		{
+			auto work = [&, i]()
+			{
+				started[i] = ticket++;
+				if(i % 7 == 0)
+					Sleep(1);
+				ended[i] = ticket++;
+			};
+
+			// Up to three earlier tasks, or none.
+			TaskGraph::TaskId d[3];
+			int dependencyCount = i == 0 ? 0 : std::rand() % 4;
+			for(int j = 0; j < dependencyCount; ++j)
+			{
+				d[j] = std::rand() % i;
+				dependencies[i].push_back(d[j]);
+			}
+
+			TaskGraph::TaskId id = 0;
+			switch(dependencyCount)
+			{
+			case 0: id = graph.Add(L"Task", work); break;
+			case 1: id = graph.Add(L"Task", work, { d[0] }); break;
+			case 2: id = graph.Add(L"Task", work, { d[0], d[1] }); break;
+			default: id = graph.Add(L"Task", work, { d[0], d[1], d[2] }); break;
+			}
+			CHECK(id == i);
+		}
+		CHECK(graph.Count() == count);
+
+		// Running again starts over.
+		for(int run = 0; run < 2; ++run)
+		{
+			ticket = 0;
+			graph.Run();
+			CHECK(ticket == 2*count);
+
+			const std::vector<TaskTiming>& timings = graph.Timings();
+			for(int i = 0; i < count; ++i)
+			{
+				for(TaskGraph::TaskId d : dependencies[i])
+				{
+					CHECK(started[i] > ended[d]);
+					CHECK(timings[i].StartMs >= timings[d].EndMs);
+				}
+				CHECK(timings[i].EndMs >= timings[i].StartMs);
+				CHECK(timings[i].EndMs <= graph.TotalMs());
+			}
+		}
+	}
+
+	void TestExceptionStopsDependents()
+	{
+		std::atomic<int> ran[6];
+		for(std::atomic<int>& r : ran)
+			r = 0;
+
+		TaskGraph graph;
+		auto ok = graph.Add(L"Ok", [&] { ran[0]++; Sleep(5); });
+		auto fails = graph.Add(L"Fails", [&] { ran[1]++; throw std::runtime_error("fails"); });
+		auto after = graph.Add(L"After", [&] { ran[2]++; }, { fails });
+		graph.Add(L"After that", [&] { ran[3]++; }, { after });
+		graph.Add(L"Also waits for ok", [&] { ran[4]++; }, { ok, fails });
+		graph.Add(L"Only waits for ok", [&] { ran[5]++; }, { ok });
+
+		bool caught = false;
+		try
+		{
+			graph.Run();
+		}
+		catch(const std::runtime_error& e)
+		{
+			caught = std::string(e.what()) == "fails";
+		}
+		CHECK(caught);
+
+		// The tasks that do not depend on the failed one still run to the end.
+		CHECK(ran[0] == 1 && ran[1] == 1 && ran[5] == 1);
+		CHECK(ran[2] == 0 && ran[3] == 0 && ran[4] == 0);
+	}
+
+	void TestCriticalPath()
+	{
+		// a -> b is the longest chain; c hangs off a and d stands alone.
+		TaskGraph graph;
+		auto a = graph.Add(L"A", [] { Sleep(20); });
+		auto b = graph.Add(L"B", [] { Sleep(30); }, { a });
+		graph.Add(L"C", [] { Sleep(10); }, { a });
+		graph.Add(L"D", [] { Sleep(25); });
+		graph.Run();
+
+		const std::vector<TaskTiming>& t = graph.Timings();
+		auto duration = [&](TaskGraph::TaskId id) { return t[id].EndMs - t[id].StartMs; };
+
+		// Whatever the sleeps really took, the chain is the durations of a and b added up.
+		double chain = duration(a) + duration(b);
+		CHECK(chain >= 50.0);
+		CHECK_NEAR(graph.CriticalPathMs(), chain, 1e-9);
+
+		CHECK_NEAR(graph.TaskMs(), duration(0) + duration(1) + duration(2) + duration(3), 1e-9);
+		CHECK(graph.TotalMs() >= graph.CriticalPathMs());
+
+		// The tasks ran side by side, so the run took less than all of them one by one.
+		CHECK(graph.TotalMs() < graph.TaskMs());
+
+		std::wstring report = graph.FormatReport();
+		CHECK(report.find(L"  B: ") != std::wstring::npos);
+		CHECK(report.find(L"longest chain") != std::wstring::npos);
+	}
+}
+
+int main()
+{
+	const TestUtil::TestCase tests[] =
+	{
+		{ "DependenciesRunFirst", TestDependenciesRunFirst },
+		{ "ExceptionStopsDependents", TestExceptionStopsDependents },
+		{ "CriticalPath", TestCriticalPath },
+	};
+
+	return TestUtil::RunTests(tests);
+}
@@ -0,0 +1,65 @@
+//***************************************************************************************
+// TestUtil.h
+//
+// Minimal checking for the headless tests.  A failed check prints where it failed and is
+// counted; RunTests returns the count so it can be handed back from main.
+//***************************************************************************************
+
+#pragma once
+
+#include <cmath>
+#include <cstdio>
+
+namespace TestUtil
+{
+	inline int& FailureCount()
+	{
+		static int count = 0;
+		return count;
+	}
+
+	inline bool Check(bool passed, const char* expression, const char* file, int line)
+	{
+		if(!passed)
+		{
+			std::printf("%s(%d): check failed: %s\n", file, line, expression);
+			FailureCount()++;
+		}
+		return passed;
+	}
+
+	inline bool CheckNear(double a, double b, double tolerance, const char* expression,
+		const char* file, int line)
+	{
+		if(!(std::fabs(a - b) <= tolerance))
+		{
+			std::printf("%s(%d): check failed: %s (%.9g vs %.9g, tolerance %.3g)\n",
+				file, line, expression, a, b, tolerance);
+			FailureCount()++;
+			return false;
+		}
+		return true;
+	}
+
+	struct TestCase
+	{
+		const char* Name;
+		void (*Run)();
+	};
+
+	template<int N>
+	int RunTests(const TestCase (&tests)[N])
+	{
+		for(int i = 0; i < N; ++i)
+		{
+			int before = FailureCount();
+			tests[i].Run();
+			std::printf("%-48s %s\n", tests[i].Name, FailureCount() == before ? "ok" : "FAILED");
+		}
+
+		return FailureCount();
+	}
+}
+
+#define CHECK(expression) TestUtil::Check((expression), #expression, __FILE__, __LINE__)
+#define CHECK_NEAR(a, b, tolerance) TestUtil::CheckNear((a), (b), (tolerance), #a " ~ " #b, __FILE__, __LINE__)
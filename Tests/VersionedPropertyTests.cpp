@@ -0,0 +1,140 @@
+//***************************************************************************************
+// VersionedPropertyTests.cpp
+//
+// When a property's version moves on, and the summed version of a set of properties
+// shaped like a material's constants.
+//***************************************************************************************
+
+#include "VersionedProperty.h"
+#include "TestUtil.h"
+#include <DirectXMath.h>
+#include <cstdint>
+
+using namespace DirectX;
+
+namespace
+{
+	struct Lcg
+	{
+		std::uint32_t State = 7u;
+
+		std::uint32_t Next()
+		{
+			State = State*1664525u + 1013904223u;
+			return State >> 8;
+		}
+	};
+
+	struct Animation
+	{
+		XMFLOAT2 ScrollSpeed;
+		float RotationSpeed;
+		std::uint32_t FrameCount;
+	};
+
+	void TestEqualWritesKeepTheVersion()
+	{
+		VersionedProperty<float> roughness = 0.25f;
+		CHECK(roughness.Version() == 1);
+
+		CHECK(!roughness.Set(0.25f));
+		roughness = 0.25f;
+		CHECK(roughness.Version() == 1);
+
+		CHECK(roughness.Set(0.5f));
+		CHECK(roughness.Version() == 2);
+		CHECK(roughness.Get() == 0.5f);
+
+		// Values are compared bytewise, so -0 is a change from 0.
+		VersionedProperty<float> zero = 0.0f;
+		CHECK(zero.Set(-0.0f));
+		CHECK(zero.Version() == 2);
+
+		VersionedProperty<XMFLOAT3> fresnel = XMFLOAT3(0.01f, 0.01f, 0.01f);
+		fresnel = XMFLOAT3(0.01f, 0.01f, 0.01f);
+		CHECK(fresnel.Version() == 1);
+		fresnel = XMFLOAT3(0.01f, 0.02f, 0.01f);
+		CHECK(fresnel.Version() == 2);
+	}
+
+	void TestEditAlwaysBumps()
+	{
+		VersionedProperty<XMFLOAT4X4> world;
+		XMStoreFloat4x4(&world.Edit(), XMMatrixIdentity());
+		CHECK(world.Version() == 2);
+
+		// Even when it writes what was already there.
+		XMStoreFloat4x4(&world.Edit(), XMMatrixIdentity());
+		CHECK(world.Version() == 3);
+
+		world.Edit();
+		CHECK(world.Version() == 4);
+	}
+
+	void TestMaterialVersionOnlyGrows()
+	{
+		// The constant buffer properties of a Material.
+		VersionedProperty<XMFLOAT4> diffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
+		VersionedProperty<XMFLOAT3> fresnelR0 = XMFLOAT3(0.01f, 0.01f, 0.01f);
+		VersionedProperty<float> roughness = 0.25f;
+		VersionedProperty<XMFLOAT4X4> matTransform;
+		VersionedProperty<Animation> animation;
+
+		auto version = [&]()
+		{
+			return VersionSum(diffuseAlbedo, fresnelR0, roughness, matTransform, animation);
+		};
+
+		// A copy recording 0 for "never copied" is stale from the start.
+		std::uint64_t last = version();
+		CHECK(last == 5);
+
+		Lcg random;
+		for(int write = 0; write < 10000; ++write)
+		{
+			// A few values per property, so some writes repeat the stored one.
+			float v = (float)(random.Next() % 3);
+			bool changes = false;
+
+			switch(random.Next() % 6)
+			{
+			case 0:
+				changes = diffuseAlbedo.Set(XMFLOAT4(v, 1.0f, 1.0f, 1.0f));
+				break;
+			case 1:
+				changes = fresnelR0.Set(XMFLOAT3(0.01f, v, 0.01f));
+				break;
+			case 2:
+				changes = roughness.Set(v);
+				break;
+			case 3:
+				XMStoreFloat4x4(&matTransform.Edit(), XMMatrixScaling(v, v, 1.0f));
+				changes = true;
+				break;
+			case 4:
+				changes = animation.Set(Animation{ XMFLOAT2(v, 0.0f), 0.0f, 0u });
+				break;
+			default:
+				animation.Edit().FrameCount = (std::uint32_t)v;
+				changes = true;
+				break;
+			}
+
+			std::uint64_t current = version();
+			CHECK(current == last + (changes ? 1 : 0));
+			last = current;
+		}
+	}
+}
+
+int main()
+{
+	const TestUtil::TestCase tests[] =
+	{
+		{ "EqualWritesKeepTheVersion", TestEqualWritesKeepTheVersion },
+		{ "EditAlwaysBumps", TestEditAlwaysBumps },
+		{ "MaterialVersionOnlyGrows", TestMaterialVersionOnlyGrows },
+	};
+
+	return TestUtil::RunTests(tests);
+}
@@ -0,0 +1,210 @@
+//***************************************************************************************
+// VertexConverterTests.cpp
+//***************************************************************************************
+
+#include "VertexConverter.h"
+#include "GeometryGenerator.h"
+#include "TestUtil.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+
+namespace
+{
+	// Vertex of the A2 solution's FrameResource.h.
+	struct Vertex
+	{
+		XMFLOAT3 Pos;
+		XMFLOAT3 Normal;
+		XMFLOAT2 TexC;
+	};
+
+	struct CompactVertex
+	{
+		XMFLOAT3 Pos;
+		XMBYTEN4 Normal;
+		XMHALF2 TexC;
+	};
+
+	using StdLayout = VertexConversion::Layout<
+		VERTEX_ATTRIBUTE(GeometryGenerator::Vertex, Position, Vertex, Pos, VertexConversion::Copy),
+		VERTEX_ATTRIBUTE(GeometryGenerator::Vertex, Normal, Vertex, Normal, VertexConversion::Copy),
+		VERTEX_ATTRIBUTE(GeometryGenerator::Vertex, TexC, Vertex, TexC, VertexConversion::Copy)>;
+
+	using CompactLayout = VertexConversion::Layout<
+		VERTEX_ATTRIBUTE(GeometryGenerator::Vertex, Position, CompactVertex, Pos, VertexConversion::Copy),
+		VERTEX_ATTRIBUTE(GeometryGenerator::Vertex, Normal, CompactVertex, Normal, VertexConversion::PackNormal),
+		VERTEX_ATTRIBUTE(GeometryGenerator::Vertex, TexC, CompactVertex, TexC, VertexConversion::FloatToHalf)>;
+
+	struct Lcg
+	{
+		std::uint32_t State = 99u;
+
+		float Next(float a, float b)
+		{
+			State = State*1664525u + 1013904223u;
+			return a + (b - a)*((State >> 8) / 16777216.0f);
+		}
+	};
+
+	std::vector<GeometryGenerator::Vertex> RandomVertices(std::size_t count)
+	{
+		Lcg random;
+		std::vector<GeometryGenerator::Vertex> vertices(count);
+		for(GeometryGenerator::Vertex& v : vertices)
+		{
+			v.Position = XMFLOAT3(random.Next(-100.0f, 100.0f), random.Next(-100.0f, 100.0f), random.Next(-100.0f, 100.0f));
+			XMVECTOR n = XMVector3Normalize(XMVectorSet(random.Next(-1.0f, 1.0f), random.Next(-1.0f, 1.0f),
+				random.Next(-1.0f, 1.0f) + 0.01f, 0.0f));
+			XMStoreFloat3(&v.Normal, n);
+			v.TangentU = XMFLOAT3(1.0f, 0.0f, 0.0f);
+			v.TexC = XMFLOAT2(random.Next(-4.0f, 4.0f), random.Next(0.0f, 1.0f));
+		}
+		return vertices;
+	}
+
+	void TestCopyMatchesHandLoop()
+	{
+		// Through the parallel path as well as the serial one.
+		for(std::size_t count : { (std::size_t)1, (std::size_t)1000, VertexConversion::ParallelThreshold + 17 })
+		{
+			std::vector<GeometryGenerator::Vertex> src = RandomVertices(count);
+
+			std::vector<Vertex> expected(count);
+			for(std::size_t i = 0; i < count; ++i)
+			{
+				expected[i].Pos = src[i].Position;
+				expected[i].Normal = src[i].Normal;
+				expected[i].TexC = src[i].TexC;
+			}
+
+			std::vector<Vertex> converted;
+			VertexConversion::ConvertVertices<StdLayout>(src, converted);
+
+			CHECK(converted.size() == count);
+			CHECK(std::memcmp(converted.data(), expected.data(), count*sizeof(Vertex)) == 0);
+		}
+	}
+
+	void TestStridedGather()
+	{
+		// Heights gathered out of positions, as UpdateWaves does.
+		std::vector<GeometryGenerator::Vertex> src = RandomVertices(300);
+		std::vector<XMFLOAT2> dst(src.size(), XMFLOAT2(-1.0f, -1.0f));
+
+		VertexConversion::Copy::Run(&src[0].Position.y, sizeof(GeometryGenerator::Vertex),
+			&dst[0].y, sizeof(XMFLOAT2), src.size());
+
+		bool match = true;
+		for(std::size_t i = 0; i < src.size(); ++i)
+			match = match && dst[i].y == src[i].Position.y && dst[i].x == -1.0f;
+		CHECK(match);
+	}
+
+	void TestFloatToHalfRoundTrip()
+	{
+		// Values a half holds exactly come back unchanged.
+		const float exact[] = { 0.0f, -0.0f, 1.0f, -2.5f, 0.5f, 1024.0f, 65504.0f, 6.103515625e-05f,
+			5.9604644775390625e-08f, 0.333251953125f };
+		for(float f : exact)
+		{
+			HALF h;
+			VertexConversion::FloatToHalf::Run(&f, sizeof(float), &h, sizeof(HALF), 1);
+			CHECK(XMConvertHalfToFloat(h) == f);
+		}
+
+		// Anything else in the normal range comes back within half a unit in the last
+		// place, 2^-11 relative, and matches the scalar conversion.
+		Lcg random;
+		std::vector<XMFLOAT2> src(5000);
+		for(XMFLOAT2& v : src)
+		{
+			v.x = std::ldexp(random.Next(1.0f, 2.0f), (int)random.Next(-14.0f, 15.0f));
+			v.y = -v.x*random.Next(0.5f, 1.0f);
+		}
+
+		std::vector<XMHALF2> dst(src.size());
+		VertexConversion::FloatToHalf::Run(src.data(), sizeof(XMFLOAT2), dst.data(), sizeof(XMHALF2), src.size());
+
+		double worst = 0.0;
+		bool matchesScalar = true;
+		for(std::size_t i = 0; i < src.size(); ++i)
+		{
+			worst = std::max(worst, (double)std::fabs(XMConvertHalfToFloat(dst[i].x) - src[i].x) / std::fabs(src[i].x));
+			worst = std::max(worst, (double)std::fabs(XMConvertHalfToFloat(dst[i].y) - src[i].y) / std::fabs(src[i].y));
+			matchesScalar = matchesScalar && dst[i].x == XMConvertFloatToHalf(src[i].x) &&
+				dst[i].y == XMConvertFloatToHalf(src[i].y);
+		}
+
+		CHECK(worst <= 1.0 / 2048.0);
+		CHECK(matchesScalar);
+	}
+
+	void TestPackNormalRoundTrip()
+	{
+		std::vector<GeometryGenerator::Vertex> src = RandomVertices(5000);
+
+		// The axes and their negatives are exact.
+		const XMFLOAT3 axes[] = { XMFLOAT3(1, 0, 0), XMFLOAT3(0, 1, 0), XMFLOAT3(0, 0, 1),
+			XMFLOAT3(-1, 0, 0), XMFLOAT3(0, -1, 0), XMFLOAT3(0, 0, -1) };
+		for(int i = 0; i < 6; ++i)
+			src[i].Normal = axes[i];
+
+		std::vector<CompactVertex> dst;
+		VertexConversion::ConvertVertices<CompactLayout>(src, dst);
+
+		double worstComponent = 0.0;
+		double worstAngle = 0.0;
+		bool wIsZero = true;
+		for(std::size_t i = 0; i < src.size(); ++i)
+		{
+			XMFLOAT4 n;
+			XMStoreFloat4(&n, XMLoadByteN4(&dst[i].Normal));
+
+			worstComponent = std::max(worstComponent, (double)std::fabs(n.x - src[i].Normal.x));
+			worstComponent = std::max(worstComponent, (double)std::fabs(n.y - src[i].Normal.y));
+			worstComponent = std::max(worstComponent, (double)std::fabs(n.z - src[i].Normal.z));
+			wIsZero = wIsZero && dst[i].Normal.w == 0;
+
+			double length = std::sqrt(n.x*n.x + n.y*n.y + n.z*n.z);
+			double cosine = (n.x*src[i].Normal.x + n.y*src[i].Normal.y + n.z*src[i].Normal.z) / length;
+			worstAngle = std::max(worstAngle, std::acos(std::min(cosine, 1.0)));
+		}
+
+		for(int i = 0; i < 6; ++i)
+		{
+			XMFLOAT4 n;
+			XMStoreFloat4(&n, XMLoadByteN4(&dst[i].Normal));
+			CHECK(n.x == axes[i].x && n.y == axes[i].y && n.z == axes[i].z);
+		}
+
+		// Within one of the 127 steps per unit; SSE rounds to the nearest, the scalar path
+		// of some DirectXMath versions truncates.
+		CHECK(worstComponent <= 1.0 / 127.0 + 1e-6);
+		CHECK(worstAngle < 0.01);
+		CHECK(wIsZero);
+
+		// The other attributes of the compact layout.
+		bool positionsMatch = true;
+		for(std::size_t i = 0; i < src.size(); ++i)
+			positionsMatch = positionsMatch && std::memcmp(&dst[i].Pos, &src[i].Position, sizeof(XMFLOAT3)) == 0;
+		CHECK(positionsMatch);
+	}
+}
+
+int main()
+{
+	const TestUtil::TestCase tests[] =
+	{
+		{ "CopyMatchesHandLoop", TestCopyMatchesHandLoop },
+		{ "StridedGather", TestStridedGather },
+		{ "FloatToHalfRoundTrip", TestFloatToHalfRoundTrip },
+		{ "PackNormalRoundTrip", TestPackNormalRoundTrip },
+	};
+
+	return TestUtil::RunTests(tests);
+}
@@ -0,0 +1,53 @@
+//***************************************************************************************
+// ViewSpaceFrustum.h
+//
+// Decides whether a sphere is in view from the camera's field of view and depth range,
+// in view space, without a projection matrix.  It is what the tests check the culling
+// and the draws built from it against.
+//***************************************************************************************
+
+#pragma once
+
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+#include <algorithm>
+#include <cmath>
+
+struct ViewSpaceFrustum
+{
+	DirectX::XMFLOAT4X4 View;
+	float FovY = 0.25f*DirectX::XM_PI;
+	float Aspect = 1.0f;
+	float NearZ = 1.0f;
+	float FarZ = 1000.0f;
+
+	// How far the sphere reaches past the plane it is furthest behind: at least 0 for a
+	// sphere that is at least partly inside every plane.
+	float Margin(const DirectX::BoundingSphere& sphere)const
+	{
+		using namespace DirectX;
+
+		XMFLOAT3 c;
+		XMStoreFloat3(&c, XMVector3TransformCoord(XMLoadFloat3(&sphere.Center), XMLoadFloat4x4(&View)));
+
+		// The side planes go through the eye at the half angles of the field of view.
+		float tanY = std::tan(0.5f*FovY);
+		float tanX = tanY*Aspect;
+		float scaleX = 1.0f / std::sqrt(1.0f + tanX*tanX);
+		float scaleY = 1.0f / std::sqrt(1.0f + tanY*tanY);
+
+		float d = std::min(c.z - NearZ, FarZ - c.z);
+		d = std::min(d, (c.z*tanX - c.x)*scaleX);
+		d = std::min(d, (c.z*tanX + c.x)*scaleX);
+		d = std::min(d, (c.z*tanY - c.y)*scaleY);
+		d = std::min(d, (c.z*tanY + c.y)*scaleY);
+
+		return d + sphere.Radius;
+	}
+
+	DirectX::XMMATRIX ViewProj()const
+	{
+		using namespace DirectX;
+		return XMLoadFloat4x4(&View)*XMMatrixPerspectiveFovLH(FovY, Aspect, NearZ, FarZ);
+	}
+};
@@ -0,0 +1,161 @@
+//***************************************************************************************
+// WaveClipmapTests.cpp
+//
+// Nested wave grids around a moving camera: what they cost against one uniform grid,
+// how they follow the camera, and that waves leave the finest level as they would leave
+// the same area of a uniform grid.
+//***************************************************************************************
+
+#include "WaveClipmap.h"
+#include "TestUtil.h"
+#include <cmath>
+#include <cstdint>
+
+using namespace DirectX;
+
+namespace
+{
+	const int LevelCount = 3;
+	const int Size = 33;
+	const float Dx = 1.0f;
+	const float Dt = 0.03f;
+	const float Speed = 4.0f;
+
+	void TestCellsAgainstUniformGrid()
+	{
+		WaveClipmap clipmap(LevelCount, Size, Dx, Dt, Speed, 0.2f);
+		XMFLOAT3 eye(0.0f, 0.0f, 0.0f);
+
+		// The coarsest level steps once per 2^(LevelCount-1) level 0 steps.
+		std::uint64_t simulated = 0;
+		std::uint64_t uniform = 0;
+		for(int s = 0; s < 1 << (LevelCount - 1); ++s)
+		{
+			clipmap.Update(eye, Dt);
+			CHECK(clipmap.Stats().Steps == 1);
+			simulated += clipmap.Stats().CellsSimulated;
+			uniform += clipmap.Stats().UniformCells;
+		}
+
+		std::uint64_t interior = (Size - 2)*(Size - 2);
+		std::uint64_t uniformSize = (Size - 1)*(1 << (LevelCount - 1)) + 1;
+		CHECK(simulated == interior*(4 + 2 + 1));
+		CHECK(uniform == 4*(uniformSize - 2)*(uniformSize - 2));
+		CHECK_NEAR(clipmap.Extent(), (uniformSize - 1)*Dx, 0.0);
+
+		// Less than a step's worth of time takes none.
+		clipmap.Update(eye, 0.5f*Dt);
+		CHECK(clipmap.Stats().Steps == 0 && clipmap.Stats().CellsSimulated == 0);
+	}
+
+	void TestLevelsFollowTheCamera()
+	{
+		WaveClipmap clipmap(LevelCount, Size, Dx, Dt, Speed, 0.2f);
+
+		XMFLOAT3 eye(37.3f, 5.0f, -12.9f);
+		clipmap.Update(eye, 0.0f);
+		CHECK(clipmap.Stats().LevelsScrolled == LevelCount);
+
+		for(int level = 0; level < LevelCount; ++level)
+		{
+			// Centered on the multiple of twice the spacing nearest the eye.
+			float spacing = clipmap.LevelSpacing(level);
+			XMFLOAT2 center = clipmap.LevelCenter(level);
+			CHECK(std::fabs(center.x - eye.x) <= spacing);
+			CHECK(std::fabs(center.y - eye.z) <= spacing);
+			CHECK_NEAR(std::remainder(center.x, 2.0f*spacing), 0.0, 1e-4);
+			CHECK_NEAR(std::remainder(center.y, 2.0f*spacing), 0.0, 1e-4);
+		}
+
+		// Moving less than the finest spacing leaves every level where it is.
+		eye.x += 0.4f;
+		clipmap.Update(eye, 0.0f);
+		CHECK(clipmap.Stats().LevelsScrolled == 0);
+	}
+
+	void TestScrollKeepsTheWater()
+	{
+		WaveClipmap clipmap(LevelCount, Size, Dx, Dt, Speed, 0.2f);
+		XMFLOAT3 eye(0.0f, 0.0f, 0.0f);
+		clipmap.Update(eye, 0.0f);
+
+		clipmap.Disturb(2.0f, -3.0f, 1.0f);
+		for(int s = 0; s < 40; ++s)
+			clipmap.Update(eye, Dt);
+
+		// Points level 0 covers before and after moving four cells along x.
+		const int count = 9;
+		float before[count][count];
+		for(int i = 0; i < count; ++i)
+			for(int j = 0; j < count; ++j)
+				before[i][j] = clipmap.Height(-4.0f + j, -4.0f + i);
+
+		eye.x = 4.0f;
+		clipmap.Update(eye, 0.0f);
+		CHECK(clipmap.Stats().LevelsScrolled >= 1);
+
+		float largest = 0.0f;
+		for(int i = 0; i < count; ++i)
+		{
+			for(int j = 0; j < count; ++j)
+			{
+				CHECK_NEAR(clipmap.Height(-4.0f + j, -4.0f + i), before[i][j], 1e-6);
+				largest = std::fmax(largest, std::fabs(before[i][j]));
+			}
+		}
+
+		// The pulse is in the compared area.
+		CHECK(largest > 0.01f);
+	}
+
+	void TestEnergyLeavesLevelZero()
+	{
+		// Undamped, against a uniform grid at level 0's spacing over the clipmap's extent.
+		WaveClipmap clipmap(LevelCount, Size, Dx, Dt, Speed, 0.0f);
+		int uniformSize = (Size - 1)*(1 << (LevelCount - 1)) + 1;
+		Waves uniform(uniformSize, uniformSize, Dx, Dt, Speed, 0.0f, 8);
+
+		XMFLOAT3 eye(0.0f, 0.0f, 0.0f);
+		clipmap.Update(eye, 0.0f);
+		clipmap.Disturb(0.0f, 0.0f, 1.0f);
+		uniform.Disturb(uniformSize / 2, uniformSize / 2, 1.0f);
+
+		// Level 0 inside its blend band, and the same points of the uniform grid.
+		const Waves& level0 = clipmap.Level(0);
+		int band = WaveClipmap::BlendWidth;
+		int first = uniformSize / 2 - Size / 2 + band;
+		int last = first + Size - 2*band;
+		auto clipmapEnergy = [&] { return level0.Energy(band, Size - band, band, Size - band); };
+		auto uniformEnergy = [&] { return uniform.Energy(first, last, first, last); };
+
+		float initial = clipmapEnergy();
+		CHECK_NEAR(initial, uniformEnergy(), 1e-3*initial);
+
+		// Until the front has crossed level 0 and then again as long.
+		int steps = (int)(2.0f*0.5f*(Size - 1)*Dx / Speed / Dt);
+		for(int s = 0; s < steps; ++s)
+		{
+			clipmap.Update(eye, Dt);
+			uniform.Step();
+		}
+
+		// Most of it has left, and what is left is not far from what a uniform grid keeps
+		// in its wake.
+		float left = clipmapEnergy();
+		CHECK(left < 0.5f*initial);
+		CHECK(left < 2.0f*uniformEnergy());
+	}
+}
+
+int main()
+{
+	const TestUtil::TestCase tests[] =
+	{
+		{ "CellsAgainstUniformGrid", TestCellsAgainstUniformGrid },
+		{ "LevelsFollowTheCamera", TestLevelsFollowTheCamera },
+		{ "ScrollKeepsTheWater", TestScrollKeepsTheWater },
+		{ "EnergyLeavesLevelZero", TestEnergyLeavesLevelZero },
+	};
+
+	return TestUtil::RunTests(tests);
+}
@@ -0,0 +1,205 @@
+//***************************************************************************************
+// WavesTests.cpp
+//
+// The wave simulation the scene's water runs on.
+//***************************************************************************************
+
+#include "Waves.h"
+#include "TestUtil.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace
+{
+	// The scene's water, without damping so only the boundary takes energy out.
+	const float Dx = 1.0f;
+	const float Dt = 0.03f;
+	const float Speed = 4.0f;
+
+	// Energy a pulse dropped in the middle of a size x size grid sends back into the part
+	// of it inside the sponge, as a fraction of the pulse's energy.  It is measured once
+	// the front had time to reach the edge and come back, against a grid whose edges are
+	// too far away for anything reflected to be back yet: what is left on that one is the
+	// wake every grid has.
+	float ReflectedEnergy(int size, int spongeWidth)
+	{
+		int steps = (int)((size*Dx / Speed + 2.0f) / Dt);
+		int reach = (int)(steps*Dt*Speed / Dx);
+		int openSize = size + reach;
+
+		Waves waves(size, size, Dx, Dt, Speed, 0.0f, spongeWidth);
+		Waves open(openSize, openSize, Dx, Dt, Speed, 0.0f);
+		waves.Disturb(size / 2, size / 2, 1.0f);
+		open.Disturb(openSize / 2, openSize / 2, 1.0f);
+
+		float initial = waves.Energy();
+		for(int s = 0; s < steps; ++s)
+		{
+			waves.Step();
+			open.Step();
+		}
+
+		int window = size - 2*std::max(spongeWidth, 1);
+		int first = size / 2 - window / 2;
+		int openFirst = openSize / 2 - window / 2;
+		float energy = waves.Energy(first, first + window, first, first + window);
+		float openEnergy = open.Energy(openFirst, openFirst + window, openFirst, openFirst + window);
+
+		return (energy - openEnergy) / initial;
+	}
+
+	void TestSpongeAbsorbs()
+	{
+		// Without a sponge most of it comes back, which shows the measure works.
+		CHECK(ReflectedEnergy(64, 0) > 0.5f);
+
+		// The scene's sponge width.
+		float reflected = ReflectedEnergy(64, 20);
+		CHECK(reflected >= 0.0f);
+		CHECK(reflected < Waves::SpongeReflection);
+	}
+
+	void TestLongStepsAreImplicit()
+	{
+		float limit = Waves::MaxExplicitTimeStep(Dx, Speed);
+
+		Waves stable(32, 32, Dx, limit, Speed, 0.0f);
+		CHECK(stable.GetIntegrator() == Waves::Integrator::Explicit);
+
+		// Four times the limit: the explicit update would blow up within a few steps.
+		Waves waves(32, 32, Dx, 4.0f*limit, Speed, 0.0f);
+		CHECK(waves.GetIntegrator() == Waves::Integrator::Implicit);
+
+		waves.SetIntegrator(Waves::Integrator::Explicit);
+		CHECK(waves.GetIntegrator() == Waves::Integrator::Implicit);
+
+		waves.Disturb(16, 16, 1.0f);
+		float initial = waves.Energy();
+		float highest = initial;
+		for(int s = 0; s < 200; ++s)
+		{
+			waves.Step();
+			highest = std::max(highest, waves.Energy());
+		}
+
+		CHECK(highest <= 2.0f*initial);
+	}
+
+	// A 64 x 64 grid split by a wall four points thick, with a pulse on its left.
+	// Returns the largest height seen right of the wall over 800 steps.
+	double LeakThroughWall(Waves::Integrator integrator)
+	{
+		const int n = 64;
+		Waves waves(n, n, Dx, Dt, Speed, 0.0f);
+		waves.SetIntegrator(integrator);
+
+		std::vector<std::uint8_t> wet(n*n, 1);
+		for(int i = 0; i < n; ++i)
+			for(int j = 30; j < 34; ++j)
+				wet[i*n + j] = 0;
+		waves.SetWetMask(wet);
+		waves.Disturb(20, 15, 1.0f);
+
+		double leak = 0.0;
+		for(int s = 0; s < 800; ++s)
+		{
+			waves.Step();
+			for(int i = 0; i < n; ++i)
+				for(int j = 34; j < n; ++j)
+					leak = std::max(leak, (double)std::fabs(waves.Height(i, j)));
+		}
+
+		// The waves are still there on the left.
+		CHECK(waves.Energy(0, n, 0, 30) > 0.5f);
+		return leak;
+	}
+
+	void TestWallsHoldWaves()
+	{
+		// The explicit stencil never reads across a dry point.
+		CHECK(LeakThroughWall(Waves::Integrator::Explicit) == 0.0);
+
+		// The implicit solves run through the wall, so a little gets across: about 1e-12.
+		CHECK(LeakThroughWall(Waves::Integrator::Implicit) < 1e-11);
+	}
+
+	void TestDryPointsAreSkipped()
+	{
+		const int n = 40;
+		Waves waves(n, n, Dx, Dt, Speed, 0.2f);
+
+		std::vector<std::uint8_t> wet(n*n, 1);
+		int dryInterior = 0;
+		for(int i = 10; i < 20; ++i)
+		{
+			for(int j = 0; j < 15; ++j)
+			{
+				wet[i*n + j] = 0;
+				if(j > 0)
+					++dryInterior;
+			}
+		}
+		waves.SetWetMask(wet);
+
+		int interior = (n - 2)*(n - 2);
+		CHECK(waves.WetCount() == interior - dryInterior);
+		CHECK(!waves.IsWet(15, 5) && waves.IsWet(15, 20));
+
+		waves.Disturb(15, 5, 1.0f);
+		CHECK(waves.Height(15, 5) == 0.0f);
+		waves.Disturb(12, 17, 1.0f);
+
+		const int steps = 200;
+		for(int s = 0; s < steps; ++s)
+			waves.Step();
+
+		const WavesStats& stats = waves.Stats();
+		CHECK(stats.Steps == steps);
+		CHECK(stats.CellsStepped == (std::uint64_t)steps*waves.WetCount());
+		CHECK(stats.CellsSkipped == (std::uint64_t)steps*dryInterior);
+
+		for(int k = 0; k < n*n; ++k)
+		{
+			if(!wet[k])
+				CHECK(waves.Height(k / n, k % n) == 0.0f);
+		}
+	}
+
+	void TestAllWetIsUnmasked()
+	{
+		const int n = 37;
+		Waves masked(n, n, Dx, Dt, Speed, 0.2f, 6);
+		Waves unmasked(n, n, Dx, Dt, Speed, 0.2f, 6);
+		masked.SetWetMask(std::vector<std::uint8_t>(n*n, 1));
+
+		masked.Disturb(10, 12, 1.0f);
+		unmasked.Disturb(10, 12, 1.0f);
+		for(int s = 0; s < 300; ++s)
+		{
+			masked.Step();
+			unmasked.Step();
+		}
+
+		float largest = 0.0f;
+		for(int i = 0; i < n; ++i)
+			for(int j = 0; j < n; ++j)
+				largest = std::max(largest, std::fabs(masked.Height(i, j) - unmasked.Height(i, j)));
+		CHECK(largest == 0.0f);
+	}
+}
+
+int main()
+{
+	const TestUtil::TestCase tests[] =
+	{
+		{ "SpongeAbsorbs", TestSpongeAbsorbs },
+		{ "LongStepsAreImplicit", TestLongStepsAreImplicit },
+		{ "WallsHoldWaves", TestWallsHoldWaves },
+		{ "DryPointsAreSkipped", TestDryPointsAreSkipped },
+		{ "AllWetIsUnmasked", TestAllWetIsUnmasked },
+	};
+
+	return TestUtil::RunTests(tests);
+}
@@ -0,0 +1,103 @@
+//***************************************************************************************
+// ImpostorBake.cpp
+//
+// Bakes the impostors of the castle parts the tree billboards app draws as impostors
+// when they are far away, and writes them to the file the app reads at startup:
+//
+//   ImpostorBake [textures directory] [output file]
+//
+// which default to Textures and Textures/castleImpostors.bin, run from the root of the
+// repository.  Parts that share a mesh, material, scale and rotation share an atlas.
+// The albedo is the material's diffuse map, decoded from its DDS file and sampled at
+// the texture coordinates of each baked texel.
+//
+// Rerun it when CastleLayout, the castle meshes or their textures change; parts the
+// file has no atlas for are always drawn as meshes.
+//***************************************************************************************
+
+#include "ImpostorBaker.h"
+#include "ReferenceRenderer.h"
+#include "CastleLayout.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <map>
+#include <string>
+
+using namespace DirectX;
+
+int main(int argc, char** argv)
+{
+	std::string texturesDir = argc > 1 ? argv[1] : "Textures";
+	std::string outputPath = argc > 2 ? argv[2] : texturesDir + "/castleImpostors.bin";
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	// Meshes and diffuse maps, loaded the first time a part needs them.
+	std::map<CastleShape, GeometryGenerator::MeshData> meshes;
+	std::map<std::string, ReferenceImage> diffuseMaps;
+
+	ImpostorBaker baker;
+	std::vector<ImpostorFileEntry> entries;
+
+	for(const CastlePart& part : CastleLayout::Parts())
+	{
+		XMFLOAT4X4 transform = CastleLayout::BakeTransform(CastleLayout::World(part));
+		const char* geometry = CastleLayout::GeometryName(part.Shape);
+
+		if(ImpostorBaker::FindEntry(entries, geometry, part.Material, transform) >= 0)
+			continue;
+
+		if(meshes.count(part.Shape) == 0)
+			meshes[part.Shape] = CastleLayout::CreateMesh(part.Shape);
+		const GeometryGenerator::MeshData& meshData = meshes[part.Shape];
+
+		if(diffuseMaps.count(part.Material) == 0)
+		{
+			const char* file = CastleLayout::DiffuseMapFile(part.Material);
+			std::string path = texturesDir + "/" + (file != nullptr ? file : "");
+
+			ReferenceImage& image = diffuseMaps[part.Material];
+			if(file == nullptr || !ReferenceRenderer::ReadDds(path, image))
+			{
+				std::fprintf(stderr, "Could not read the diffuse map of %s (%s)\n", part.Material, path.c_str());
+				return 1;
+			}
+		}
+		const ReferenceImage& diffuseMap = diffuseMaps[part.Material];
+
+		ImpostorMesh mesh;
+		mesh.Vertices = meshData.Vertices.data();
+		mesh.VertexStride = sizeof(GeometryGenerator::Vertex);
+		mesh.VertexCount = (std::uint32_t)meshData.Vertices.size();
+		mesh.PositionOffset = offsetof(GeometryGenerator::Vertex, Position);
+		mesh.NormalOffset = offsetof(GeometryGenerator::Vertex, Normal);
+		mesh.TexCOffset = offsetof(GeometryGenerator::Vertex, TexC);
+		mesh.Indices = meshData.Indices32.data();
+		mesh.SixteenBitIndices = false;
+		mesh.IndexCount = (std::uint32_t)meshData.Indices32.size();
+
+		// The castle materials have a white DiffuseAlbedo and no texture transforms.
+		ImpostorFileEntry entry;
+		entry.Geometry = geometry;
+		entry.Material = part.Material;
+		entry.Transform = transform;
+		baker.Bake(mesh, XMLoadFloat4x4(&transform),
+			[&diffuseMap](const XMFLOAT2& texC) { return ReferenceRenderer::Sample(diffuseMap, texC); }, entry.Atlas);
+
+		std::printf("%-12s %-8s scale %.2f %.2f %.2f\n", geometry, part.Material, part.Scale.x, part.Scale.y, part.Scale.z);
+		entries.push_back(std::move(entry));
+	}
+
+	if(!ImpostorBaker::WriteFile(outputPath, entries))
+	{
+		std::fprintf(stderr, "Could not write %s\n", outputPath.c_str());
+		return 1;
+	}
+
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	std::printf("%zu atlases for %zu castle parts written to %s in %.1f ms\n",
+		entries.size(), CastleLayout::Parts().size(), outputPath.c_str(), ms);
+
+	return 0;
+}
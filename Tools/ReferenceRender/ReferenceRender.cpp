@@ -0,0 +1,233 @@
+//***************************************************************************************
+// ReferenceRender.cpp
+//
+// Draws the castle of the tree billboards scene with ReferenceRenderer, as the app's
+// camera first sees it, writes the image and prints the time spent in each stage:
+//
+//   ReferenceRender [-size width height] [-threads n] [-frames n] [-textures dir]
+//                   [-out file.tga] [-compare golden.tga] [-tolerance t]
+//
+// The defaults are 800 x 600, every hardware thread, one frame, Textures and
+// reference.tga, run from the root of the repository.  With -frames the timings are
+// those of the fastest frame.  With -compare the image is also checked against a golden
+// image: it fails when more than 0.5% of the pixels differ by more than the tolerance
+// in a channel, or the PSNR is below 40 dB.
+//
+// The scene is the static part of the app's: the grass and the castle parts, with the
+// app's materials, lights and fog.  Water, trees and the fence are left out.
+//***************************************************************************************
+
+#include "ReferenceRenderer.h"
+#include "CastleLayout.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+
+using namespace DirectX;
+
+namespace
+{
+	struct Options
+	{
+		std::uint32_t Width = 800;
+		std::uint32_t Height = 600;
+		std::uint32_t Threads = 0;
+		int Frames = 1;
+		std::string TexturesDir = "Textures";
+		std::string OutputPath = "reference.tga";
+		std::string GoldenPath;
+		std::uint32_t Tolerance = 4;
+	};
+
+	bool ParseOptions(int argc, char** argv, Options& options)
+	{
+		for(int i = 1; i < argc; ++i)
+		{
+			std::string arg = argv[i];
+			int left = argc - i - 1;
+
+			if(arg == "-size" && left >= 2)
+			{
+				options.Width = (std::uint32_t)std::atoi(argv[++i]);
+				options.Height = (std::uint32_t)std::atoi(argv[++i]);
+			}
+			else if(arg == "-threads" && left >= 1)
+				options.Threads = (std::uint32_t)std::atoi(argv[++i]);
+			else if(arg == "-frames" && left >= 1)
+				options.Frames = std::max(1, std::atoi(argv[++i]));
+			else if(arg == "-textures" && left >= 1)
+				options.TexturesDir = argv[++i];
+			else if(arg == "-out" && left >= 1)
+				options.OutputPath = argv[++i];
+			else if(arg == "-compare" && left >= 1)
+				options.GoldenPath = argv[++i];
+			else if(arg == "-tolerance" && left >= 1)
+				options.Tolerance = (std::uint32_t)std::atoi(argv[++i]);
+			else
+				return false;
+		}
+
+		return options.Width > 0 && options.Height > 0;
+	}
+
+	// Mesh data the draw items point into.
+	ReferenceMesh MeshOf(const GeometryGenerator::MeshData& meshData)
+	{
+		ReferenceMesh mesh;
+		mesh.Positions = &meshData.Vertices[0].Position;
+		mesh.PositionStride = sizeof(GeometryGenerator::Vertex);
+		mesh.Normals = &meshData.Vertices[0].Normal;
+		mesh.NormalStride = sizeof(GeometryGenerator::Vertex);
+		mesh.TexCoords = &meshData.Vertices[0].TexC;
+		mesh.TexCStride = sizeof(GeometryGenerator::Vertex);
+		mesh.VertexCount = (std::uint32_t)meshData.Vertices.size();
+		mesh.Indices = meshData.Indices32.data();
+		mesh.SixteenBitIndices = false;
+		mesh.IndexCount = (std::uint32_t)meshData.Indices32.size();
+		return mesh;
+	}
+
+	// As BuildMainPassCB and OnResize in the app, for its starting camera.
+	ReferencePass ScenePass(std::uint32_t width, std::uint32_t height)
+	{
+		float theta = 1.5f*XM_PI;
+		float phi = XM_PIDIV2 - 0.1f;
+		float radius = 50.0f;
+
+		XMVECTOR eye = XMVectorSet(radius*sinf(phi)*cosf(theta), radius*cosf(phi),
+			radius*sinf(phi)*sinf(theta), 1.0f);
+		XMMATRIX view = XMMatrixLookAtLH(eye, XMVectorZero(), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+		XMMATRIX proj = XMMatrixPerspectiveFovLH(0.25f*XM_PI, (float)width / height, 1.0f, 1000.0f);
+
+		ReferencePass pass;
+		XMStoreFloat4x4(&pass.ViewProj, view*proj);
+		XMStoreFloat3(&pass.EyePosW, eye);
+		pass.AmbientLight = { 0.25f, 0.25f, 0.35f, 1.0f };
+		pass.Lights[0].Direction = { 0.57735f, -0.57735f, 0.57735f };
+		pass.Lights[0].Strength = { 0.6f, 0.6f, 0.6f };
+		pass.Lights[1].Direction = { -0.57735f, -0.57735f, 0.57735f };
+		pass.Lights[1].Strength = { 0.3f, 0.3f, 0.3f };
+		pass.Lights[2].Direction = { 0.0f, -0.707f, -0.707f };
+		pass.Lights[2].Strength = { 0.15f, 0.15f, 0.15f };
+		pass.ClearColor = pass.FogColor;
+		return pass;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if(!ParseOptions(argc, argv, options))
+	{
+		std::fprintf(stderr, "Usage: ReferenceRender [-size width height] [-threads n] [-frames n] "
+			"[-textures dir] [-out file.tga] [-compare golden.tga] [-tolerance t]\n");
+		return 1;
+	}
+
+	std::map<std::string, ReferenceImage> diffuseMaps;
+	auto diffuseMap = [&](const char* file) -> const ReferenceImage*
+	{
+		if(diffuseMaps.count(file) == 0)
+		{
+			std::string path = options.TexturesDir + "/" + file;
+			if(!ReferenceRenderer::ReadDds(path, diffuseMaps[file]))
+			{
+				std::fprintf(stderr, "Could not read %s\n", path.c_str());
+				return nullptr;
+			}
+		}
+		return &diffuseMaps[file];
+	};
+
+	std::vector<ReferenceDrawItem> items;
+
+	// The grass is the app's land grid, which is flat.
+	GeometryGenerator geoGen;
+	GeometryGenerator::MeshData land = geoGen.CreateGrid(70.0f, 50.0f, 50, 50);
+	for(GeometryGenerator::Vertex& v : land.Vertices)
+		v.Position.y = 3.0f;
+
+	ReferenceDrawItem grass;
+	grass.Mesh = MeshOf(land);
+	XMStoreFloat4x4(&grass.TexTransform, XMMatrixScaling(5.0f, 5.0f, 1.0f));
+	grass.Roughness = 0.125f;
+	grass.DiffuseMap = diffuseMap("grass.dds");
+	if(grass.DiffuseMap == nullptr)
+		return 1;
+	items.push_back(grass);
+
+	std::map<CastleShape, GeometryGenerator::MeshData> meshes;
+	for(const CastlePart& part : CastleLayout::Parts())
+	{
+		if(meshes.count(part.Shape) == 0)
+			meshes[part.Shape] = CastleLayout::CreateMesh(part.Shape);
+
+		// The castle materials of BuildMaterials: bricks and tiles are shinier than wood.
+		bool wood = std::strcmp(part.Material, "wood") == 0;
+
+		ReferenceDrawItem item;
+		item.Mesh = MeshOf(meshes[part.Shape]);
+		XMStoreFloat4x4(&item.World, CastleLayout::World(part));
+		item.FresnelR0 = wood ? XMFLOAT3(0.01f, 0.01f, 0.01f) : XMFLOAT3(0.02f, 0.02f, 0.02f);
+		item.Roughness = wood ? 0.125f : 0.25f;
+		item.DiffuseMap = diffuseMap(CastleLayout::DiffuseMapFile(part.Material));
+		if(item.DiffuseMap == nullptr)
+			return 1;
+		items.push_back(item);
+	}
+
+	ReferencePass pass = ScenePass(options.Width, options.Height);
+	ReferenceRenderer renderer(options.Width, options.Height, options.Threads);
+
+	ReferenceStats fastest;
+	for(int frame = 0; frame < options.Frames; ++frame)
+	{
+		renderer.Render(pass, items);
+		if(frame == 0 || renderer.Stats().TotalMs < fastest.TotalMs)
+			fastest = renderer.Stats();
+	}
+
+	std::printf("%ux%u on %u threads, fastest of %d frames\n", options.Width, options.Height,
+		renderer.ThreadCount(), options.Frames);
+	std::printf("  vertex %8.3f ms\n  setup  %8.3f ms\n  raster %8.3f ms\n  resolve%8.3f ms\n  total  %8.3f ms\n",
+		fastest.VertexMs, fastest.SetupMs, fastest.RasterMs, fastest.ResolveMs, fastest.TotalMs);
+	std::printf("  %llu triangles, %llu culled, %llu clipped, %llu tile entries, %llu pixels shaded\n",
+		(unsigned long long)fastest.TrianglesSubmitted, (unsigned long long)fastest.TrianglesCulled,
+		(unsigned long long)fastest.TrianglesClipped, (unsigned long long)fastest.TileEntries,
+		(unsigned long long)fastest.PixelsShaded);
+
+	if(!ReferenceRenderer::WriteTga(options.OutputPath, renderer.Image()))
+	{
+		std::fprintf(stderr, "Could not write %s\n", options.OutputPath.c_str());
+		return 1;
+	}
+	std::printf("Written to %s\n", options.OutputPath.c_str());
+
+	if(options.GoldenPath.empty())
+		return 0;
+
+	ReferenceImage golden;
+	if(!ReferenceRenderer::ReadTga(options.GoldenPath, golden))
+	{
+		std::fprintf(stderr, "Could not read %s\n", options.GoldenPath.c_str());
+		return 1;
+	}
+	if(golden.Width != options.Width || golden.Height != options.Height)
+	{
+		std::fprintf(stderr, "%s is %ux%u\n", options.GoldenPath.c_str(), golden.Width, golden.Height);
+		return 1;
+	}
+
+	ReferenceImageDiff diff = ReferenceRenderer::Compare(renderer.Image(), golden, options.Tolerance);
+	std::uint32_t allowed = options.Width*options.Height / 200;
+	bool matches = diff.DifferentPixels <= allowed && diff.Psnr >= 40.0;
+
+	std::printf("Against %s: %u pixels (%u allowed) differ by more than %u, max difference %u, PSNR %.1f dB: %s\n",
+		options.GoldenPath.c_str(), diff.DifferentPixels, allowed, options.Tolerance, diff.MaxDifference,
+		diff.Psnr, matches ? "ok" : "FAILED");
+
+	return matches ? 0 : 1;
+}